@@ -0,0 +1,9 @@
+#ifndef BOOT_CONFIG_H
+#define BOOT_CONFIG_H
+
+#define BOOT_WORKERS 3 // Stages that can run at the same time
+#define BOOT_WORKER_STACK_SIZE 6144
+#define BOOT_WORKER_PRIORITY 5
+#define BOOT_MAX_STAGES 23 // One event group bit each, one more flags a dependency cycle
+
+#endif // BOOT_CONFIG_H
@@ -0,0 +1,161 @@
+#include <string.h>
+#include "boot_pipeline.h"
+#include "boot_config.h"
+#include "rtos_alloc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "BOOT_PIPELINE";
+
+#define BOOT_STALLED_BIT (1UL << BOOT_MAX_STAGES)
+
+static const boot_stage_t *boot_stages = NULL;
+static size_t boot_stage_count = 0;
+static uint32_t claimed_mask = 0;
+static uint32_t done_mask = 0;
+static boot_stage_timing_t boot_timeline[BOOT_MAX_STAGES];
+static EventGroupHandle_t boot_events = NULL;
+RTOS_EVENT_GROUP_STORAGE(boot_events);
+static portMUX_TYPE boot_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t all_stages_mask(void)
+{
+    return (1UL << boot_stage_count) - 1;
+}
+
+// Returns the index of a stage that may run now, or -1. *running_out gets the
+// stages claimed by other workers that have not finished yet.
+static int claim_ready_stage(uint32_t *running_out)
+{
+    int index = -1;
+
+    portENTER_CRITICAL(&boot_lock);
+    for (size_t i = 0; i < boot_stage_count; i++)
+    {
+        uint32_t bit = BOOT_DEP(i);
+        if (!(claimed_mask & bit) && (boot_stages[i].depends_on & done_mask) == boot_stages[i].depends_on)
+        {
+            claimed_mask |= bit;
+            index = (int)i;
+            break;
+        }
+    }
+    *running_out = claimed_mask & ~done_mask;
+    portEXIT_CRITICAL(&boot_lock);
+
+    return index;
+}
+
+static void boot_worker(void *arg)
+{
+    while (1)
+    {
+        uint32_t running;
+        int index = claim_ready_stage(&running);
+
+        if (index < 0)
+        {
+            if ((claimed_mask & all_stages_mask()) == all_stages_mask())
+            {
+                break;
+            }
+            if (running == 0)
+            {
+                // Nothing is running that could unblock the remaining stages
+                xEventGroupSetBits(boot_events, BOOT_STALLED_BIT);
+                break;
+            }
+            xEventGroupWaitBits(boot_events, running | BOOT_STALLED_BIT, pdFALSE, pdFALSE, portMAX_DELAY);
+            if (xEventGroupGetBits(boot_events) & BOOT_STALLED_BIT)
+            {
+                break;
+            }
+            continue;
+        }
+
+        boot_timeline[index].start_us = esp_timer_get_time();
+        boot_stages[index].run();
+        boot_timeline[index].end_us = esp_timer_get_time();
+
+        portENTER_CRITICAL(&boot_lock);
+        done_mask |= BOOT_DEP(index);
+        portEXIT_CRITICAL(&boot_lock);
+        xEventGroupSetBits(boot_events, BOOT_DEP(index));
+    }
+
+    vTaskDelete(NULL);
+}
+
+static void log_timeline(void)
+{
+    ESP_LOGI(TAG, "Boot timeline (ms since boot):");
+    for (size_t i = 0; i < boot_stage_count; i++)
+    {
+        ESP_LOGI(TAG, "  %-12s %6lld -> %6lld  (%lld)", boot_stages[i].name,
+                 (long long)(boot_timeline[i].start_us / 1000), (long long)(boot_timeline[i].end_us / 1000),
+                 (long long)((boot_timeline[i].end_us - boot_timeline[i].start_us) / 1000));
+    }
+}
+
+esp_err_t boot_pipeline_run(const boot_stage_t *stages, size_t count)
+{
+    if (count == 0 || count > BOOT_MAX_STAGES)
+    {
+        ESP_LOGE(TAG, "Boot pipeline needs 1 to %d stages", BOOT_MAX_STAGES);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    boot_events = RTOS_EVENT_GROUP_CREATE(boot_events);
+    if (boot_events == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create boot event group");
+        return ESP_FAIL;
+    }
+
+    boot_stages = stages;
+    boot_stage_count = count;
+    claimed_mask = 0;
+    done_mask = 0;
+    memset(boot_timeline, 0, sizeof(boot_timeline));
+
+    // Workers exit once boot is done, so their stacks stay on the heap even in
+    // RTOS_STATIC_ALLOCATION builds rather than pinning RAM for good
+    for (int i = 0; i < BOOT_WORKERS; i++)
+    {
+        if (xTaskCreate(boot_worker, "boot_worker", BOOT_WORKER_STACK_SIZE, NULL, BOOT_WORKER_PRIORITY, NULL) != pdPASS)
+        {
+            ESP_LOGE(TAG, "Failed to create boot worker %d", i);
+            if (i == 0)
+            {
+                return ESP_FAIL;
+            }
+        }
+    }
+
+    EventBits_t bits = 0;
+    while ((bits & all_stages_mask()) != all_stages_mask())
+    {
+        // Wake on any stage still outstanding, or a stall
+        uint32_t remaining = all_stages_mask() & ~bits;
+        bits = xEventGroupWaitBits(boot_events, remaining | BOOT_STALLED_BIT, pdFALSE, pdFALSE, portMAX_DELAY);
+        if (bits & BOOT_STALLED_BIT)
+        {
+            ESP_LOGE(TAG, "Boot stalled: stages 0x%lx never became ready, check for a dependency cycle",
+                     (unsigned long)(all_stages_mask() & ~claimed_mask));
+            log_timeline();
+            return ESP_FAIL;
+        }
+    }
+
+    log_timeline();
+    return ESP_OK;
+}
+
+const boot_stage_timing_t *boot_pipeline_timeline(size_t *count)
+{
+    *count = boot_stage_count;
+    return boot_timeline;
+}
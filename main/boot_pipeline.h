@@ -0,0 +1,30 @@
+#ifndef BOOT_PIPELINE_H
+#define BOOT_PIPELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define BOOT_DEP(stage) (1UL << (stage))
+
+typedef struct
+{
+    const char *name;
+    void (*run)(void);
+    uint32_t depends_on; // BOOT_DEP() of every stage that must finish first
+} boot_stage_t;
+
+typedef struct
+{
+    int64_t start_us; // esp_timer time, i.e. since boot
+    int64_t end_us;
+} boot_stage_timing_t;
+
+// Runs every stage as soon as its dependencies are done, up to BOOT_WORKERS at
+// once, and returns when all have finished. Logs the per-stage timeline.
+esp_err_t boot_pipeline_run(const boot_stage_t *stages, size_t count);
+
+// Timeline of the last run, indexed like the stage table.
+const boot_stage_timing_t *boot_pipeline_timeline(size_t *count);
+
+#endif // BOOT_PIPELINE_H
@@ -0,0 +1,17 @@
+#ifndef BROKER_CONFIG_H
+#define BROKER_CONFIG_H
+
+// Set by `idf.py -DMQTT_LOCAL_BROKER_URI=mqtts://<host>:8883 build`: the device
+// connects there instead of AWS IoT, with the CA, client certificate and key
+// made by tools/broker/gen_certs.sh (see tools/broker/harness.py)
+#ifndef MQTT_LOCAL_BROKER
+#define MQTT_LOCAL_BROKER 0
+#endif
+
+#if MQTT_LOCAL_BROKER
+#define MQTT_BROKER_URI MQTT_LOCAL_BROKER_URI
+#else
+#define MQTT_BROKER_URI CONFIG_AWS_IOT_ENDPOINT
+#endif
+
+#endif // BROKER_CONFIG_H
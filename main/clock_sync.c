@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <time.h>
+#include "clock_sync.h"
+#include "clock_sync_config.h"
+#include "mqtt_outbox.h"
+#include "outbox_config.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "CLOCK_SYNC";
+
+// Offset of system time from esp_timer, measured at one instant
+typedef struct
+{
+    int64_t mono_us;
+    int64_t offset_us;
+} clock_sync_point_t;
+
+// The drift estimate is a property of the crystal, so it survives deep sleep
+static RTC_DATA_ATTR int32_t rtc_drift_ppb;
+
+static clock_sync_point_t sync_points[CLOCK_SYNC_HISTORY];
+static size_t sync_head = 0; // Slot of the newest point
+static size_t sync_count = 0;
+static clock_sync_stats_t sync_stats = {0};
+static esp_timer_handle_t sample_timer = NULL;
+static portMUX_TYPE sync_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int64_t drift_correction_us(int64_t span_us, int32_t drift_ppb)
+{
+    return span_us / 1000 * drift_ppb / 1000000;
+}
+
+static const clock_sync_point_t *point_locked(size_t age)
+{
+    return &sync_points[(sync_head + CLOCK_SYNC_HISTORY - age) % CLOCK_SYNC_HISTORY];
+}
+
+static void publish_sync_point(int64_t mono_us, int64_t offset_us, int64_t step_us, int32_t drift_ppb)
+{
+    char payload[OUTBOX_PAYLOAD_MAX_LEN];
+
+    // Lets the backend backfill "ts" of events that were published before this sync
+    snprintf(payload, sizeof(payload), "{\"mono_ms\":%lld,\"ts\":%lld,\"step_ms\":%lld,\"drift_ppb\":%ld}",
+             (long long)(mono_us / 1000), (long long)((mono_us + offset_us) / 1000), (long long)(step_us / 1000),
+             (long)drift_ppb);
+    mqtt_outbox_enqueue(CLOCK_SYNC_TOPIC, payload, 1);
+}
+
+static void record_sync_point(int64_t mono_us, int64_t offset_us, bool publish)
+{
+    int64_t step_us = 0;
+    int64_t rejected_ppb = 0;
+
+    portENTER_CRITICAL(&sync_lock);
+    if (sync_count > 0)
+    {
+        const clock_sync_point_t *last = point_locked(0);
+        int64_t span_us = mono_us - last->mono_us;
+
+        step_us = offset_us - last->offset_us;
+        if (span_us >= (int64_t)CLOCK_SYNC_MIN_DRIFT_SPAN_MS * 1000)
+        {
+            int64_t measured_ppb = step_us * 1000000 / (span_us / 1000);
+            if (llabs(measured_ppb) > CLOCK_SYNC_MAX_DRIFT_PPB)
+            {
+                // A manual clock change or a first sync after a long outage, not crystal drift
+                rejected_ppb = measured_ppb;
+            }
+            else
+            {
+                rtc_drift_ppb = (int32_t)((rtc_drift_ppb == 0) ? measured_ppb
+                                                                : ((int64_t)rtc_drift_ppb * 3 + measured_ppb) / 4);
+            }
+        }
+        sync_head = (sync_head + 1) % CLOCK_SYNC_HISTORY;
+    }
+    sync_points[sync_head] = (clock_sync_point_t){.mono_us = mono_us, .offset_us = offset_us};
+    if (sync_count < CLOCK_SYNC_HISTORY)
+    {
+        sync_count++;
+    }
+
+    sync_stats.syncs++;
+    sync_stats.last_sync_mono_us = mono_us;
+    sync_stats.last_step_us = step_us;
+    if (llabs(step_us) > llabs(sync_stats.max_step_us))
+    {
+        sync_stats.max_step_us = step_us;
+    }
+    sync_stats.drift_ppb = rtc_drift_ppb;
+    int32_t drift_ppb = rtc_drift_ppb;
+    portEXIT_CRITICAL(&sync_lock);
+
+    if (rejected_ppb != 0)
+    {
+        ESP_LOGW(TAG, "Ignoring implausible drift of %lld ppb", (long long)rejected_ppb);
+    }
+    ESP_LOGI(TAG, "Clock synced, step %lld ms, drift %ld ppb", (long long)(step_us / 1000), (long)drift_ppb);
+    if (publish)
+    {
+        publish_sync_point(mono_us, offset_us, step_us, drift_ppb);
+    }
+}
+
+static void sample_clock(bool publish)
+{
+    struct timeval tv;
+
+    int64_t mono_us = esp_timer_get_time();
+    gettimeofday(&tv, NULL);
+    if (tv.tv_sec < CLOCK_SYNC_MIN_VALID_EPOCH)
+    {
+        return;
+    }
+
+    int64_t offset_us = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec - mono_us;
+
+    portENTER_CRITICAL(&sync_lock);
+    bool changed = sync_count == 0 || llabs(offset_us - point_locked(0)->offset_us) > CLOCK_SYNC_STEP_THRESHOLD_US;
+    portEXIT_CRITICAL(&sync_lock);
+
+    if (changed)
+    {
+        record_sync_point(mono_us, offset_us, publish);
+    }
+}
+
+static void sample_timer_callback(void *arg)
+{
+    sample_clock(true);
+}
+
+bool clock_sync_valid(void)
+{
+    return sync_count > 0;
+}
+
+bool clock_sync_mono_to_wall_us(int64_t mono_us, int64_t *wall_us)
+{
+    int64_t offset_us;
+
+    portENTER_CRITICAL(&sync_lock);
+    if (sync_count == 0)
+    {
+        portEXIT_CRITICAL(&sync_lock);
+        return false;
+    }
+
+    const clock_sync_point_t *newer = point_locked(0);
+    if (mono_us >= newer->mono_us)
+    {
+        // Since the last sync the system clock has been free-running on our crystal
+        offset_us = newer->offset_us + drift_correction_us(mono_us - newer->mono_us, rtc_drift_ppb);
+    }
+    else
+    {
+        const clock_sync_point_t *older = newer;
+        size_t age = 1;
+
+        while (age < sync_count && point_locked(age)->mono_us > mono_us)
+        {
+            age++;
+        }
+        if (age < sync_count)
+        {
+            // Between two syncs: spread the correction the later one applied
+            older = point_locked(age);
+            newer = point_locked(age - 1);
+            offset_us = older->offset_us + (newer->offset_us - older->offset_us) * (mono_us - older->mono_us) /
+                                               (newer->mono_us - older->mono_us);
+        }
+        else
+        {
+            // Before the oldest sync we remember, e.g. captured before SNTP was reachable
+            older = point_locked(sync_count - 1);
+            offset_us = older->offset_us - drift_correction_us(older->mono_us - mono_us, rtc_drift_ppb);
+        }
+    }
+    portEXIT_CRITICAL(&sync_lock);
+
+    *wall_us = mono_us + offset_us;
+    return true;
+}
+
+int64_t clock_sync_local_time_of_day_ms(int64_t mono_us)
+{
+    int64_t wall_us;
+    struct tm local;
+
+    if (!clock_sync_mono_to_wall_us(mono_us, &wall_us))
+    {
+        return -1;
+    }
+    time_t wall_s = (time_t)(wall_us / 1000000);
+    if (localtime_r(&wall_s, &local) == NULL)
+    {
+        return -1;
+    }
+    return ((int64_t)local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec) * 1000 + wall_us / 1000 % 1000;
+}
+
+void clock_sync_get_stats(clock_sync_stats_t *stats)
+{
+    portENTER_CRITICAL(&sync_lock);
+    *stats = sync_stats;
+    portEXIT_CRITICAL(&sync_lock);
+}
+
+esp_err_t init_clock_sync(void)
+{
+    const esp_timer_create_args_t timer_args = {.callback = sample_timer_callback, .name = "clock_sync"};
+
+    if (esp_timer_create(&timer_args, &sample_timer) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to create clock sample timer");
+        return ESP_FAIL;
+    }
+
+    // After a deep-sleep wake the RTC already holds valid time. Nothing has been
+    // stamped without it, so there is nothing for the backend to backfill.
+    sample_clock(false);
+    esp_timer_start_periodic(sample_timer, (uint64_t)CLOCK_SYNC_SAMPLE_PERIOD_MS * 1000);
+    return ESP_OK;
+}
@@ -0,0 +1,34 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef struct
+{
+    uint32_t syncs;         // Times the wall clock was set or stepped
+    int64_t last_sync_mono_us;
+    int64_t last_step_us;   // Correction applied by the last resync, 0 for the first sync
+    int64_t max_step_us;    // Largest correction seen, by magnitude
+    int32_t drift_ppb;      // Local oscillator rate error against UTC, positive if running slow
+} clock_sync_stats_t;
+
+// Samples system time against esp_timer. Sync points are recorded when SNTP sets
+// or steps the clock, and an estimate of oscillator drift is kept between them.
+esp_err_t init_clock_sync(void);
+
+bool clock_sync_valid(void);
+
+// Converts an esp_timer timestamp from this boot to UTC microseconds,
+// including timestamps taken before the first sync. Returns false until the
+// clock has been synced once.
+bool clock_sync_mono_to_wall_us(int64_t mono_us, int64_t *wall_us);
+
+// Local time of day of an esp_timer timestamp, in the TZ set by
+// init_door_reminder(). -1 until the clock has been synced once.
+int64_t clock_sync_local_time_of_day_ms(int64_t mono_us);
+
+void clock_sync_get_stats(clock_sync_stats_t *stats);
+
+#endif // CLOCK_SYNC_H
@@ -0,0 +1,14 @@
+#ifndef CLOCK_SYNC_CONFIG_H
+#define CLOCK_SYNC_CONFIG_H
+
+#include "sdkconfig.h"
+
+#define CLOCK_SYNC_MIN_VALID_EPOCH 1700000000 // System time below this has not been set yet
+#define CLOCK_SYNC_SAMPLE_PERIOD_MS 1000
+#define CLOCK_SYNC_STEP_THRESHOLD_US 2000 // Offset change that counts as a new sync rather than read jitter
+#define CLOCK_SYNC_HISTORY 8              // Sync points kept for mapping older timestamps
+#define CLOCK_SYNC_MIN_DRIFT_SPAN_MS 60000 // Shorter sync intervals are too noisy to estimate drift from
+#define CLOCK_SYNC_MAX_DRIFT_PPB 500000    // 500 ppm; larger rates are clock steps, kept out of the estimate
+#define CLOCK_SYNC_TOPIC CONFIG_MQTT_PUBLISH_DOOR_STATE_TOPIC "/clock"
+
+#endif // CLOCK_SYNC_CONFIG_H
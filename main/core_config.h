@@ -0,0 +1,20 @@
+#ifndef CORE_CONFIG_H
+#define CORE_CONFIG_H
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+
+// The sensor path (GPIO ISR and door_task) runs on APP_CPU, away from Wi-Fi,
+// lwIP, the MQTT client and TLS handshakes, which the IDF defaults put on
+// PRO_CPU. Those IDF tasks are placed by sdkconfig, not here:
+// CONFIG_ESP_WIFI_TASK_PINNED_TO_CORE_0, CONFIG_LWIP_TCPIP_TASK_AFFINITY_CPU0
+// and CONFIG_MQTT_USE_CORE_0 keep them on PRO_CPU.
+#if CONFIG_FREERTOS_UNICORE
+#define CORE_SENSOR 0
+#define CORE_NETWORK 0
+#else
+#define CORE_SENSOR APP_CPU_NUM
+#define CORE_NETWORK PRO_CPU_NUM
+#endif
+
+#endif // CORE_CONFIG_H
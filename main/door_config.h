@@ -2,13 +2,34 @@
 #define DOOR_CONFIG_H
 
 #include "driver/gpio.h"
+#include "core_config.h"
 
-#define BUTTON_GPIO GPIO_NUM_21
+#define BUTTON_GPIO GPIO_NUM_21 // Not an RTC GPIO, so no deep sleep (see sleep_config.h)
 #define DEBOUNCE_TIME_MS 500
+#define DOOR_DEBOUNCE_PROFILE {.mode = DEBOUNCE_MODE_INTEGRATING, .settle_ms = DEBOUNCE_TIME_MS}
 #define DOOR_OPEN_TIMER_PERIOD_MS 300000 // 5 minutes
-#define DOOR_TASK_STACK_SIZE 2048
+#define DOOR_TASK_STACK_SIZE 3072
 #define DOOR_TASK_PRIORITY 10
-#define GPIO_QUEUE_SIZE 10
+#define DOOR_TASK_CORE CORE_SENSOR // The GPIO ISR is installed from door_task, so it follows
+#define GPIO_QUEUE_SIZE (DOOR_MAX_SENSORS * 8) // A bounce burst of 8 edges on every sensor at once
 #define MQTT_PUBLISH_RETRIES 3
 
+#define DOOR_MAX_SENSORS 8 // The door journal has room for up to 16
+
+// Sensors watched by door_task. Each one publishes to
+// CONFIG_MQTT_PUBLISH_DOOR_STATE_TOPIC followed by its topic suffix, so the
+// suffixes must differ. Pins are pulled up; open_level is the level read while
+// the door is open. For example, a parcel locker on GPIO 22 would be
+//   {.name = "locker", .gpio = GPIO_NUM_22, .topic_suffix = "/locker", .debounce = DOOR_DEBOUNCE_PROFILE,
+//    .reminder_ms = DOOR_OPEN_TIMER_PERIOD_MS, .open_level = 1}
+#define DOOR_SENSOR_TABLE                                                                                   \
+    {                                                                                                       \
+        {.name = "mailbox",                                                                                 \
+         .gpio = BUTTON_GPIO,                                                                               \
+         .topic_suffix = "",                                                                                \
+         .debounce = DOOR_DEBOUNCE_PROFILE,                                                                 \
+         .reminder_ms = DOOR_OPEN_TIMER_PERIOD_MS,                                                          \
+         .open_level = 1},                                                                                  \
+    }
+
 #endif // DOOR_CONFIG_H
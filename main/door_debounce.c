@@ -0,0 +1,83 @@
+#include "door_debounce.h"
+
+static bool debounce_commit(debounce_state_t *db, int *level_out, int64_t *edge_us_out)
+{
+    db->stable_level = db->raw_level;
+    *level_out = db->stable_level;
+    *edge_us_out = db->last_edge_us;
+    return true;
+}
+
+void debounce_init(debounce_state_t *db, const debounce_profile_t *profile, int level, int64_t now_us)
+{
+    db->profile = *profile;
+    db->stable_level = level;
+    db->raw_level = level;
+    db->last_edge_us = now_us;
+    db->deadline_us = DEBOUNCE_NO_DEADLINE;
+    db->suppress_until_us = now_us;
+}
+
+bool debounce_feed(debounce_state_t *db, int level, int64_t timestamp_us, int *level_out, int64_t *edge_us_out)
+{
+    int64_t settle_us = (int64_t)db->profile.settle_ms * 1000;
+
+    if (level == db->raw_level)
+    {
+        // Repeated sample of the same level, not an edge
+        return false;
+    }
+
+    db->raw_level = level;
+    db->last_edge_us = timestamp_us;
+
+    if (db->profile.mode == DEBOUNCE_MODE_LEADING_EDGE)
+    {
+        if (timestamp_us >= db->suppress_until_us && level != db->stable_level)
+        {
+            db->suppress_until_us = timestamp_us + settle_us;
+            db->deadline_us = db->suppress_until_us;
+            return debounce_commit(db, level_out, edge_us_out);
+        }
+
+        // Echo inside the suppression window: re-check once the window closes
+        db->deadline_us = (db->suppress_until_us > timestamp_us) ? db->suppress_until_us : timestamp_us + settle_us;
+        return false;
+    }
+
+    // Integrating: every edge restarts the settle timer, bouncing back to the
+    // stable level cancels it
+    db->deadline_us = (level != db->stable_level) ? timestamp_us + settle_us : DEBOUNCE_NO_DEADLINE;
+    return false;
+}
+
+bool debounce_poll(debounce_state_t *db, int64_t now_us, int *level_out, int64_t *edge_us_out)
+{
+    int64_t settle_us = (int64_t)db->profile.settle_ms * 1000;
+
+    if (db->deadline_us == DEBOUNCE_NO_DEADLINE || now_us < db->deadline_us)
+    {
+        return false;
+    }
+
+    if (db->raw_level == db->stable_level)
+    {
+        db->deadline_us = DEBOUNCE_NO_DEADLINE;
+        return false;
+    }
+
+    if (now_us - db->last_edge_us < settle_us)
+    {
+        db->deadline_us = db->last_edge_us + settle_us;
+        return false;
+    }
+
+    db->deadline_us = DEBOUNCE_NO_DEADLINE;
+    db->suppress_until_us = now_us + settle_us;
+    return debounce_commit(db, level_out, edge_us_out);
+}
+
+int64_t debounce_next_deadline_us(const debounce_state_t *db)
+{
+    return db->deadline_us;
+}
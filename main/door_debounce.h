@@ -0,0 +1,49 @@
+#ifndef DOOR_DEBOUNCE_H
+#define DOOR_DEBOUNCE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define DEBOUNCE_NO_DEADLINE INT64_MAX
+
+typedef enum
+{
+    // Commit a level only once it has been stable for settle_ms. Adds settle_ms
+    // of latency but always ends on the final settled level.
+    DEBOUNCE_MODE_INTEGRATING,
+    // Commit on the first edge and suppress echoes for settle_ms, then commit the
+    // settled level if the bounce ended somewhere else.
+    DEBOUNCE_MODE_LEADING_EDGE
+} debounce_mode_t;
+
+typedef struct
+{
+    debounce_mode_t mode;
+    uint32_t settle_ms;
+} debounce_profile_t;
+
+// Pure state machine with no RTOS or driver dependencies, timestamps in
+// microseconds. Callers feed edges, and call debounce_poll() once the deadline
+// returned by debounce_next_deadline_us() has passed.
+// tools/host/test_debounce.py runs it on the host.
+typedef struct
+{
+    debounce_profile_t profile;
+    int stable_level;
+    int raw_level;
+    int64_t last_edge_us;
+    int64_t deadline_us;
+    int64_t suppress_until_us;
+} debounce_state_t;
+
+void debounce_init(debounce_state_t *db, const debounce_profile_t *profile, int level, int64_t now_us);
+
+// Returns true when the edge commits a new stable level. The committed level is
+// written to *level_out and the time of the edge that produced it to *edge_us_out.
+bool debounce_feed(debounce_state_t *db, int level, int64_t timestamp_us, int *level_out, int64_t *edge_us_out);
+
+bool debounce_poll(debounce_state_t *db, int64_t now_us, int *level_out, int64_t *edge_us_out);
+
+int64_t debounce_next_deadline_us(const debounce_state_t *db);
+
+#endif // DOOR_DEBOUNCE_H
@@ -1,135 +1,564 @@
+#include <string.h>
 #include "unity.h"
 #include "gecl-mqtt-manager.h"
 #include "door_handler.h"
 #include "door_config.h"
+#include "door_debounce.h"
 #include "mqtt_custom_handler.h"
+#include "mqtt_outbox.h"
+#include "outbox_config.h"
+#include "door_payload.h"
+#include "door_journal.h"
+#include "door_sleep.h"
+#include "door_reminder.h"
+#include "metrics.h"
+#include "rtos_alloc.h"
+#include "door_trace.h"
+#include "settings.h"
+#include "door_jitter.h"
+#include "jitter_config.h"
+#include "session_classifier.h"
+#include "session_config.h"
+#include "clock_sync.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "freertos/timers.h"
 #include "driver/gpio.h"
+#include "hal/gpio_ll.h"
+#include "esp_attr.h"
 #include "esp_timer.h"
 #include "esp_log.h"
 #include "gecl-rgb-led-manager.h"
 
 static const char *TAG = "DOOR_HANDLER";
 
+typedef struct
+{
+    door_sensor_config_t config;
+    door_state_t state;
+    debounce_state_t debounce;
+    int64_t last_transition_us; // 0 until the first state is known
+    uint32_t edges_since_commit;
+    session_state_t session;
+    uint32_t session_first_seq; // Journal range of the transitions the next session event covers, 0 if none
+    uint32_t session_last_seq;
+    char topic[OUTBOX_TOPIC_MAX_LEN];
+} door_sensor_t;
+
+static const door_sensor_config_t default_sensors[] = DOOR_SENSOR_TABLE;
+static const session_profile_t session_profile = {.gap_ms = SESSION_GAP_MS,
+                                                  .max_open_ms = SESSION_MAX_OPEN_MS,
+                                                  .bounce_max_open_ms = SESSION_BOUNCE_MAX_OPEN_MS,
+                                                  .delivery_max_open_ms = SESSION_DELIVERY_MAX_OPEN_MS,
+                                                  .carrier_start_ms = SESSION_CARRIER_START_MIN * 60000,
+                                                  .carrier_end_ms = SESSION_CARRIER_END_MIN * 60000,
+                                                  .weight_duration = SESSION_WEIGHT_DURATION,
+                                                  .weight_time_of_day = SESSION_WEIGHT_TIME_OF_DAY,
+                                                  .weight_mail_waiting = SESSION_WEIGHT_MAIL_WAITING};
+
+static door_sensor_t sensors[DOOR_MAX_SENSORS];
+static size_t sensor_count = 0;
+static DRAM_ATTR gpio_num_t sensor_gpio[DOOR_MAX_SENSORS]; // Read from the ISR
+static bool door_handler_started = false;
+
 static QueueHandle_t gpio_evt_queue = NULL;
-static door_state_t current_door_state = DOOR_STATE_CLOSED;
-static TimerHandle_t door_open_timer = NULL;
+RTOS_QUEUE_STORAGE(gpio_evt, GPIO_QUEUE_SIZE, sizeof(door_edge_event_t));
+RTOS_TASK_STORAGE(door_task, DOOR_TASK_STACK_SIZE);
+static volatile uint32_t gpio_evt_overflow_count = 0;
+static bool edges_injected = false;
+static uint32_t applied_settings = 0; // settings_generation() door_task last applied
+
+// Queued instead of an edge to wake door_task for a settings change, or by
+// the jitter profiler to time the wake
+#define DOOR_EVENT_RELOAD UINT32_MAX
+#define DOOR_EVENT_PROBE (UINT32_MAX - 1)
 
 // Forward declarations
-static void door_open_timer_callback(TimerHandle_t xTimer);
 static void IRAM_ATTR gpio_isr_handler(void *arg);
 static void door_task(void *arg);
+static esp_err_t install_door_isrs(void);
 
-static bool publish_door_state_with_retry(const char *state, int max_retries)
+static bool publish_door_state(door_sensor_t *sensor, door_state_t state, int64_t edge_time_us,
+                               uint32_t journal_seq, uint8_t flags, uint32_t dwell_ms)
 {
-    char payload[32];
-    snprintf(payload, sizeof(payload), "{\"door\": \"%s\"}", state);
+    door_payload_event_t event = {.seq = journal_seq,
+                                  .state = (uint8_t)state,
+                                  .flags = flags,
+                                  .mono_us = edge_time_us,
+                                  .dwell_ms = dwell_ms};
+    size_t index = (size_t)(sensor - sensors);
+
+    door_sleep_note_published(index, state, door_reminder_next_ms(index));
+    if (!mqtt_outbox_enqueue_door_event(sensor->topic, &event, 1))
+    {
+        metrics_inc(METRIC_DOOR_ENQUEUE_FAILURES);
+        return false;
+    }
+    return true;
+}
 
-    for (int i = 0; i < max_retries; i++)
+static void update_led(void)
+{
+    for (size_t i = 0; i < sensor_count; i++)
     {
-        if (mqtt_client_handle == NULL)
+        if (sensors[i].state == DOOR_STATE_OPEN)
         {
-            ESP_LOGE(TAG, "MQTT client handle is NULL");
-            return false;
+            set_rgb_led_named_color("LED_SOLID_WHITE");
+            return;
         }
+    }
+    set_rgb_led_named_color("LED_OFF");
+}
+
+// Journal sequence a session event of this sensor can acknowledge: its own
+// transitions, but none of a session still open on another sensor
+static uint32_t session_ack_seq(size_t index)
+{
+    uint32_t ack_seq = sensors[index].session_last_seq;
 
-        int msg_id = esp_mqtt_client_publish(mqtt_client_handle,
-                                             CONFIG_MQTT_PUBLISH_DOOR_STATE_TOPIC,
-                                             payload, 0, 1, 0);
-        if (msg_id != -1)
+    for (size_t i = 0; i < sensor_count; i++)
+    {
+        uint32_t first_seq = sensors[i].session_first_seq;
+        if (i != index && first_seq != 0 && first_seq <= ack_seq)
         {
-            ESP_LOGI(TAG, "Published message: %s", payload);
-            return true;
+            ack_seq = first_seq - 1;
         }
-
-        ESP_LOGW(TAG, "Publish attempt %d failed, retrying...", i + 1);
-        vTaskDelay(pdMS_TO_TICKS(100));
     }
+    return ack_seq;
+}
 
-    ESP_LOGE(TAG, "Failed to publish message after %d attempts", max_retries);
-    return false;
+// One event for the whole session replaces its transitions. They stay in the
+// journal until the broker acknowledges it, so a session lost to a reboot or
+// a failed publish is replayed as transitions.
+static void publish_session(size_t index, const session_summary_t *summary)
+{
+    door_sensor_t *sensor = &sensors[index];
+    char topic[OUTBOX_TOPIC_MAX_LEN];
+    door_payload_event_t event = {.seq = session_ack_seq(index),
+                                  .state = (uint8_t)summary->session_class,
+                                  .flags = DOOR_EVENT_FLAG_SESSION,
+                                  .mono_us = summary->start_us,
+                                  .dwell_ms = summary->span_ms,
+                                  .session = {.opens = (uint16_t)(summary->opens < UINT16_MAX ? summary->opens
+                                                                                             : UINT16_MAX),
+                                              .open_ms = summary->open_ms,
+                                              .longest_open_ms = summary->longest_open_ms,
+                                              .since_last_ms = summary->since_last_ms}};
+
+    ESP_LOGI(TAG, "%s session: %s, %lu opening(s), longest %lu ms", sensor->config.name,
+             session_class_name(summary->session_class), (unsigned long)summary->opens,
+             (unsigned long)summary->longest_open_ms);
+    metrics_inc(METRIC_DOOR_SESSIONS);
+    sensor->session_first_seq = 0;
+    sensor->session_last_seq = 0;
+
+    snprintf(topic, sizeof(topic), "%s%s", sensor->topic, SESSION_TOPIC_SUFFIX);
+    if (!mqtt_outbox_enqueue_door_event(topic, &event, 1))
+    {
+        metrics_inc(METRIC_DOOR_ENQUEUE_FAILURES);
+    }
 }
 
-static void handle_door_state_change(door_state_t new_state)
+// Called before each transition too, so a session that ended while door_task
+// was busy is not merged into the next one
+static void poll_session(size_t index, int64_t now_us)
 {
-    const char *state_str = (new_state == DOOR_STATE_OPEN) ? "open" : "closed";
-    const char *led_state = (new_state == DOOR_STATE_OPEN) ? "LED_SOLID_WHITE" : "LED_OFF";
+    session_summary_t summary;
 
-    current_door_state = new_state;
-    publish_door_state_with_retry(state_str, MQTT_PUBLISH_RETRIES);
-    set_rgb_led_named_color(led_state);
+    if (session_poll(&sensors[index].session, now_us, &summary))
+    {
+        publish_session(index, &summary);
+    }
+}
 
+static void update_reminder(size_t index, door_state_t new_state)
+{
     if (new_state == DOOR_STATE_OPEN)
     {
-        if (xTimerStart(door_open_timer, 0) != pdPASS)
-        {
-            ESP_LOGE(TAG, "Failed to start door open timer");
-        }
+        door_reminder_start(index, sensors[index].config.reminder_ms);
     }
     else
     {
-        if (xTimerStop(door_open_timer, 0) != pdPASS)
-        {
-            ESP_LOGE(TAG, "Failed to stop door open timer");
-        }
+        door_reminder_stop(index);
+    }
+}
+
+static void handle_door_state_change(size_t index, door_state_t new_state, int64_t edge_time_us)
+{
+    door_sensor_t *sensor = &sensors[index];
+
+    sensor->state = new_state;
+    // Every edge but the one that produced this transition was bounce
+    if (sensor->edges_since_commit > 1)
+    {
+        metrics_add(METRIC_DOOR_DEBOUNCE_REJECTS, sensor->edges_since_commit - 1);
+    }
+    sensor->edges_since_commit = 0;
+    metrics_inc(METRIC_DOOR_EVENTS);
+    door_trace_note_transition(index, new_state);
+    // Scheduled first, so the sleep policy learns when the first reminder is due
+    update_reminder(index, new_state);
+#if SESSION_SUMMARY
+    // Journaled but not published, the session event goes out once the session ends
+    poll_session(index, edge_time_us);
+    uint32_t journal_seq = door_journal_append((uint8_t)index, (uint8_t)new_state, edge_time_us);
+    if (journal_seq != 0)
+    {
+        sensor->session_first_seq = sensor->session_first_seq ? sensor->session_first_seq : journal_seq;
+        sensor->session_last_seq = journal_seq;
     }
+    session_feed(&sensor->session, new_state == DOOR_STATE_OPEN, edge_time_us,
+                 clock_sync_local_time_of_day_ms(edge_time_us));
+    door_sleep_note_published(index, new_state, door_reminder_next_ms(index));
+#else
+    uint32_t journal_seq = door_journal_append((uint8_t)index, (uint8_t)new_state, edge_time_us);
+    uint32_t dwell_ms =
+        sensor->last_transition_us ? (uint32_t)((edge_time_us - sensor->last_transition_us) / 1000) : 0;
+    publish_door_state(sensor, new_state, edge_time_us, journal_seq, 0, dwell_ms);
+#endif
+    sensor->last_transition_us = edge_time_us;
+    update_led();
 }
 
-static void door_open_timer_callback(TimerHandle_t xTimer)
+// Called by door_reminder from the timer service task. Dwell here is how long
+// the door has been open so far, across deep sleep.
+static void publish_reminder(size_t index, uint32_t open_ms)
 {
-    ESP_LOGI(TAG, "Door STILL open.");
-    publish_door_state_with_retry("open", MQTT_PUBLISH_RETRIES);
+    ESP_LOGI(TAG, "%s STILL open after %lu s.", sensors[index].config.name, (unsigned long)(open_ms / 1000));
+    publish_door_state(&sensors[index], DOOR_STATE_OPEN, esp_timer_get_time(), 0, DOOR_EVENT_FLAG_REMINDER, open_ms);
     set_rgb_led_named_color("LED_BLINK_RED");
 }
 
+// Every sensor pin is in one pin_bit_mask and shares this handler; the ISR
+// service dispatches on the interrupt status bits and passes the sensor index.
 static void IRAM_ATTR gpio_isr_handler(void *arg)
 {
-    uint32_t gpio_num = (uint32_t)arg;
-    xQueueSendFromISR(gpio_evt_queue, &gpio_num, NULL);
+    uint32_t sensor = (uint32_t)(uintptr_t)arg;
+    door_edge_event_t evt = {
+        .sensor = sensor,
+        .level = gpio_ll_get_level(&GPIO, sensor_gpio[sensor]),
+        .timestamp_us = esp_timer_get_time()};
+    BaseType_t higher_priority_task_woken = pdFALSE;
+
+    metrics_inc(METRIC_DOOR_ISR_EDGES);
+    if (xQueueSendFromISR(gpio_evt_queue, &evt, &higher_priority_task_woken) != pdTRUE)
+    {
+        gpio_evt_overflow_count++;
+        metrics_inc(METRIC_DOOR_QUEUE_OVERFLOWS);
+    }
+
+    if (higher_priority_task_woken)
+    {
+        portYIELD_FROM_ISR();
+    }
 }
 
-static void process_door_state_change(int current_state)
+static door_state_t level_to_state(size_t index, int level)
 {
-    door_state_t new_state = current_state ? DOOR_STATE_OPEN : DOOR_STATE_CLOSED;
-    ESP_LOGI(TAG, "Door %s.", current_state ? "opened" : "closed");
-    handle_door_state_change(new_state);
+    return (level == sensors[index].config.open_level) ? DOOR_STATE_OPEN : DOOR_STATE_CLOSED;
+}
+
+static void process_door_state_change(size_t index, int level, int64_t edge_time_us)
+{
+    door_state_t new_state = level_to_state(index, level);
+    ESP_LOGI(TAG, "%s %s.", sensors[index].config.name, new_state == DOOR_STATE_OPEN ? "opened" : "closed");
+    handle_door_state_change(index, new_state, edge_time_us);
+}
+
+// Once edges are injected the pin no longer reflects the door, the last edge does
+static int sample_sensor_level(size_t index)
+{
+    return edges_injected ? sensors[index].debounce.raw_level : gpio_get_level(sensors[index].config.gpio);
+}
+
+static TickType_t ticks_until_deadline(int64_t deadline_us)
+{
+    if (deadline_us == DEBOUNCE_NO_DEADLINE)
+    {
+        return portMAX_DELAY;
+    }
+
+    int64_t remaining_us = deadline_us - esp_timer_get_time();
+    if (remaining_us <= 0)
+    {
+        return 0;
+    }
+
+    return pdMS_TO_TICKS((remaining_us + 999) / 1000) + 1;
+}
+
+// Earliest debounce settle or session end
+static int64_t next_deadline_us(void)
+{
+    int64_t deadline_us = DEBOUNCE_NO_DEADLINE;
+
+    for (size_t i = 0; i < sensor_count; i++)
+    {
+        int64_t sensor_deadline_us = debounce_next_deadline_us(&sensors[i].debounce);
+        int64_t session_deadline_us = session_next_deadline_us(&sensors[i].session);
+        if (sensor_deadline_us < deadline_us)
+        {
+            deadline_us = sensor_deadline_us;
+        }
+        if (session_deadline_us < deadline_us)
+        {
+            deadline_us = session_deadline_us;
+        }
+    }
+    return deadline_us;
+}
+
+// Settings from the device shadow override DOOR_SENSOR_TABLE for every sensor
+static void apply_door_settings(void)
+{
+    applied_settings = settings_generation();
+
+    for (size_t i = 0; i < sensor_count; i++)
+    {
+        door_sensor_t *sensor = &sensors[i];
+
+        if (settings_is_set(SETTING_DEBOUNCE_MS))
+        {
+            sensor->config.debounce.settle_ms = settings_get(SETTING_DEBOUNCE_MS);
+        }
+        if (settings_is_set(SETTING_DEBOUNCE_MODE))
+        {
+            sensor->config.debounce.mode = (debounce_mode_t)settings_get(SETTING_DEBOUNCE_MODE);
+        }
+        // A bounce in progress finishes under the new profile
+        sensor->debounce.profile = sensor->config.debounce;
+
+        if (settings_is_set(SETTING_REMINDER_MS))
+        {
+            uint32_t reminder_ms = settings_get(SETTING_REMINDER_MS);
+            if (reminder_ms != sensor->config.reminder_ms)
+            {
+                sensor->config.reminder_ms = reminder_ms;
+                door_reminder_set_base(i, reminder_ms);
+            }
+        }
+    }
 }
 
 static void door_task(void *arg)
 {
-    uint32_t io_num;
-    int last_state = gpio_get_level(BUTTON_GPIO);
-    TickType_t last_change_time = xTaskGetTickCount();
+    door_edge_event_t evt;
+    uint32_t reported_overflows = 0;
+    int level;
+    int64_t edge_us;
+
+    install_door_isrs();
+#if DOOR_JITTER_PROFILE
+    door_jitter_start();
+#endif
 
     while (1)
     {
-        if (xQueueReceive(gpio_evt_queue, &io_num, portMAX_DELAY))
+        if (settings_generation() != applied_settings)
+        {
+            apply_door_settings();
+        }
+
+        if (xQueueReceive(gpio_evt_queue, &evt, ticks_until_deadline(next_deadline_us())) &&
+            evt.sensor != DOOR_EVENT_RELOAD)
         {
-            int current_state = gpio_get_level(io_num);
-            TickType_t current_time = xTaskGetTickCount();
+            int64_t dispatch_latency_us = esp_timer_get_time() - evt.timestamp_us;
 
-            if (current_time - last_change_time > pdMS_TO_TICKS(DEBOUNCE_TIME_MS))
+            if (evt.sensor == DOOR_EVENT_PROBE)
             {
-                if (current_state != last_state)
+                door_jitter_record(DOOR_JITTER_PROBE, dispatch_latency_us);
+                continue;
+            }
+
+            if (gpio_evt_overflow_count != reported_overflows)
+            {
+                reported_overflows = gpio_evt_overflow_count;
+                ESP_LOGW(TAG, "GPIO event queue overflowed, %lu edges lost so far", (unsigned long)reported_overflows);
+            }
+
+            ESP_LOGD(TAG, "Edge on %s reached door_task after %lld us", sensors[evt.sensor].config.name,
+                     (long long)dispatch_latency_us);
+            if (!edges_injected)
+            {
+                door_jitter_record(DOOR_JITTER_GPIO, dispatch_latency_us);
+            }
+
+            door_trace_capture(&evt);
+            sensors[evt.sensor].edges_since_commit++;
+            if (debounce_feed(&sensors[evt.sensor].debounce, evt.level, evt.timestamp_us, &level, &edge_us))
+            {
+                process_door_state_change(evt.sensor, level, edge_us);
+            }
+        }
+
+        int64_t now_us = esp_timer_get_time();
+        for (size_t i = 0; i < sensor_count; i++)
+        {
+            door_sensor_t *sensor = &sensors[i];
+
+            if (debounce_next_deadline_us(&sensor->debounce) <= now_us)
+            {
+                // Settle deadline reached. Sample the pin once more in case the
+                // final edge of a bounce was lost to a queue overflow.
+                if (debounce_feed(&sensor->debounce, sample_sensor_level(i), now_us, &level, &edge_us))
                 {
-                    last_state = current_state;
-                    last_change_time = current_time;
-                    process_door_state_change(current_state);
+                    process_door_state_change(i, level, edge_us);
                 }
             }
+
+            if (debounce_poll(&sensor->debounce, esp_timer_get_time(), &level, &edge_us))
+            {
+                process_door_state_change(i, level, edge_us);
+            }
+            poll_session(i, esp_timer_get_time());
         }
     }
 }
 
+esp_err_t door_handler_inject_edge(size_t sensor, int level)
+{
+    door_edge_event_t evt = {.sensor = (uint32_t)sensor, .level = level, .timestamp_us = esp_timer_get_time()};
+
+    if (gpio_evt_queue == NULL || sensor >= sensor_count)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    edges_injected = true;
+    if (xQueueSend(gpio_evt_queue, &evt, 0) != pdTRUE)
+    {
+        gpio_evt_overflow_count++;
+        metrics_inc(METRIC_DOOR_QUEUE_OVERFLOWS);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+bool IRAM_ATTR door_handler_probe_from_isr(void)
+{
+    door_edge_event_t evt = {.sensor = DOOR_EVENT_PROBE, .timestamp_us = esp_timer_get_time()};
+    BaseType_t higher_priority_task_woken = pdFALSE;
+
+    // Dropped when the queue is full, a probe is not worth losing an edge for
+    xQueueSendFromISR(gpio_evt_queue, &evt, &higher_priority_task_woken);
+    return higher_priority_task_woken == pdTRUE;
+}
+
+void door_handler_reload_settings(void)
+{
+    door_edge_event_t evt = {.sensor = DOOR_EVENT_RELOAD};
+
+    // A full queue wakes door_task anyway, which then sees the new generation
+    if (gpio_evt_queue != NULL)
+    {
+        xQueueSend(gpio_evt_queue, &evt, 0);
+    }
+}
+
+uint32_t door_handler_get_overflow_count(void)
+{
+    return gpio_evt_overflow_count;
+}
+
+static void load_default_sensors(void)
+{
+    if (sensor_count == 0 &&
+        door_handler_set_sensors(default_sensors, sizeof(default_sensors) / sizeof(default_sensors[0])) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Invalid DOOR_SENSOR_TABLE");
+    }
+}
+
+const char *door_handler_sensor_topic(uint8_t sensor)
+{
+    return (sensor < sensor_count) ? sensors[sensor].topic : NULL;
+}
+
+size_t door_handler_sensor_count(void)
+{
+    load_default_sensors();
+    return sensor_count;
+}
+
+bool door_handler_get_sensor(size_t index, door_sensor_config_t *config, door_state_t *state)
+{
+    load_default_sensors();
+    if (index >= sensor_count)
+    {
+        return false;
+    }
+    *config = sensors[index].config;
+    *state = sensors[index].state;
+    return true;
+}
+
+bool door_handler_settled(void)
+{
+    return gpio_evt_queue != NULL && uxQueueMessagesWaiting(gpio_evt_queue) == 0 &&
+           next_deadline_us() == DEBOUNCE_NO_DEADLINE;
+}
+
+esp_err_t door_handler_set_sensors(const door_sensor_config_t *table, size_t count)
+{
+    if (door_handler_started)
+    {
+        ESP_LOGE(TAG, "Sensor table can only be replaced before init_door_handler()");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (count == 0 || count > DOOR_MAX_SENSORS)
+    {
+        ESP_LOGE(TAG, "Sensor table needs 1 to %d entries, got %u", DOOR_MAX_SENSORS, (unsigned)count);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (strlen(CONFIG_MQTT_PUBLISH_DOOR_STATE_TOPIC) + strlen(table[i].topic_suffix) +
+                strlen(SESSION_TOPIC_SUFFIX) >=
+            OUTBOX_TOPIC_MAX_LEN)
+        {
+            ESP_LOGE(TAG, "Topic suffix of %s is too long", table[i].name);
+            return ESP_ERR_INVALID_ARG;
+        }
+        for (size_t j = 0; j < i; j++)
+        {
+            if (table[i].gpio == table[j].gpio || strcmp(table[i].topic_suffix, table[j].topic_suffix) == 0)
+            {
+                ESP_LOGE(TAG, "Sensors %s and %s share a pin or topic", table[j].name, table[i].name);
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+    }
+
+    memset(sensors, 0, sizeof(sensors));
+    for (size_t i = 0; i < count; i++)
+    {
+        sensors[i].config = table[i];
+        sensor_gpio[i] = table[i].gpio;
+        session_init(&sensors[i].session, &session_profile);
+        snprintf(sensors[i].topic, sizeof(sensors[i].topic), "%s%s", CONFIG_MQTT_PUBLISH_DOOR_STATE_TOPIC,
+                 table[i].topic_suffix);
+    }
+    sensor_count = count;
+
+    return ESP_OK;
+}
+
 static esp_err_t configure_gpio(void)
 {
+    uint64_t pin_mask = 0;
+
+    for (size_t i = 0; i < sensor_count; i++)
+    {
+        pin_mask |= 1ULL << sensors[i].config.gpio;
+    }
+
     gpio_config_t io_conf = {
         .intr_type = GPIO_INTR_ANYEDGE,
         .mode = GPIO_MODE_INPUT,
-        .pin_bit_mask = (1ULL << BUTTON_GPIO),
+        .pin_bit_mask = pin_mask,
         .pull_up_en = GPIO_PULLUP_ENABLE,
         .pull_down_en = GPIO_PULLDOWN_DISABLE};
 
@@ -143,26 +572,41 @@ static esp_err_t configure_gpio(void)
     return ESP_OK;
 }
 
-static esp_err_t create_door_timer(void)
+// The ISR service allocates its interrupt on the calling core, so door_task
+// installs it to keep GPIO interrupts on DOOR_TASK_CORE
+static esp_err_t install_door_isrs(void)
 {
-    door_open_timer = xTimerCreate(
-        "DoorOpenTimer",
-        pdMS_TO_TICKS(DOOR_OPEN_TIMER_PERIOD_MS),
-        pdTRUE,
-        (void *)0,
-        door_open_timer_callback);
+    esp_err_t isr_service = gpio_install_isr_service(0);
+    if (isr_service != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to install ISR service");
+        return isr_service;
+    }
 
-    if (door_open_timer == NULL)
+    for (size_t i = 0; i < sensor_count; i++)
     {
-        ESP_LOGE(TAG, "Failed to create door open timer");
-        return ESP_FAIL;
+        esp_err_t isr_handler = gpio_isr_handler_add(sensors[i].config.gpio, gpio_isr_handler, (void *)i);
+        if (isr_handler != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to add ISR handler for %s", sensors[i].config.name);
+            return isr_handler;
+        }
     }
 
+    ESP_LOGI(TAG, "GPIO interrupts on core %d", xPortGetCoreID());
     return ESP_OK;
 }
 
 void init_door_handler(void)
 {
+    load_default_sensors();
+    if (sensor_count == 0)
+    {
+        return;
+    }
+    door_handler_started = true;
+    apply_door_settings();
+
     // Configure GPIO
     if (configure_gpio() != ESP_OK)
     {
@@ -170,8 +614,39 @@ void init_door_handler(void)
         return;
     }
 
+    // Reminder timer before any edge can start one
+    if (init_door_reminder(publish_reminder) != ESP_OK)
+    {
+        return;
+    }
+
+    // Check initial door states. After a deep-sleep wake only what changed
+    // while asleep, or a reminder that fell due, is published.
+    int64_t now_us = esp_timer_get_time();
+    for (size_t i = 0; i < sensor_count; i++)
+    {
+        int level = gpio_get_level(sensors[i].config.gpio);
+        door_state_t state = level_to_state(i, level);
+
+        debounce_init(&sensors[i].debounce, &sensors[i].config.debounce, level, now_us);
+        switch (door_sleep_boot_action(i, state))
+        {
+        case SLEEP_ACTION_TRANSITION:
+            process_door_state_change(i, level, now_us);
+            break;
+        default:
+            // Still open: a reminder that fell due goes out as soon as the timer runs
+            sensors[i].state = state;
+            if (state == DOOR_STATE_OPEN)
+            {
+                door_reminder_resume(i, sensors[i].config.reminder_ms, door_sleep_reminder_due_in_ms(i));
+            }
+            break;
+        }
+    }
+
     // Create GPIO event queue
-    gpio_evt_queue = xQueueCreate(GPIO_QUEUE_SIZE, sizeof(uint32_t));
+    gpio_evt_queue = RTOS_QUEUE_CREATE(gpio_evt, GPIO_QUEUE_SIZE, sizeof(door_edge_event_t));
     if (gpio_evt_queue == NULL)
     {
         ESP_LOGE(TAG, "Failed to create GPIO event queue");
@@ -179,42 +654,20 @@ void init_door_handler(void)
     }
 
     // Create door task
-    BaseType_t task_created = xTaskCreate(
+    TaskHandle_t door_task_handle = NULL;
+    BaseType_t task_created = RTOS_TASK_CREATE(
+        door_task,
         door_task,
         "door_task",
-        DOOR_TASK_STACK_SIZE,
         NULL,
         DOOR_TASK_PRIORITY,
-        NULL);
+        &door_task_handle,
+        DOOR_TASK_CORE);
 
     if (task_created != pdPASS)
     {
         ESP_LOGE(TAG, "Failed to create door task");
         return;
     }
-
-    // Install ISR service and add handler
-    esp_err_t isr_service = gpio_install_isr_service(0);
-    if (isr_service != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Failed to install ISR service");
-        return;
-    }
-
-    esp_err_t isr_handler = gpio_isr_handler_add(BUTTON_GPIO, gpio_isr_handler, (void *)BUTTON_GPIO);
-    if (isr_handler != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Failed to add ISR handler");
-        return;
-    }
-
-    // Create door timer
-    if (create_door_timer() != ESP_OK)
-    {
-        return;
-    }
-
-    // Check initial door state
-    int initial_state = gpio_get_level(BUTTON_GPIO);
-    process_door_state_change(initial_state);
+    metrics_watch_task(door_task_handle);
 }
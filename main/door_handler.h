@@ -1,7 +1,12 @@
 #ifndef DOOR_HANDLER_H
 #define DOOR_HANDLER_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include "esp_err.h"
+#include "driver/gpio.h"
+#include "door_debounce.h"
 
 typedef enum
 {
@@ -9,6 +14,50 @@ typedef enum
     DOOR_STATE_OPEN
 } door_state_t;
 
+typedef struct
+{
+    const char *name;
+    gpio_num_t gpio;
+    const char *topic_suffix;     // Appended to CONFIG_MQTT_PUBLISH_DOOR_STATE_TOPIC
+    debounce_profile_t debounce;
+    uint32_t reminder_ms;         // Door-still-open reminder period, 0 for none
+    int open_level;
+} door_sensor_config_t;
+
+// Captured in the GPIO ISR so level and time reflect the edge itself, not the
+// moment door_task got scheduled.
+typedef struct
+{
+    uint32_t sensor; // Index into the sensor table
+    int level;
+    int64_t timestamp_us;
+} door_edge_event_t;
+
+// Replaces the compile-time DOOR_SENSOR_TABLE. Only valid before
+// init_door_handler(); the table is copied, strings must stay valid.
+esp_err_t door_handler_set_sensors(const door_sensor_config_t *sensors, size_t count);
+
 void init_door_handler(void);
+uint32_t door_handler_get_overflow_count(void);
+
+// Has door_task pick up changed debounce and reminder settings (see settings.h)
+void door_handler_reload_settings(void);
+
+// Queues an edge as if the GPIO ISR had seen it now. Used by trace replay; from
+// then on the settle check trusts injected levels over the pin.
+esp_err_t door_handler_inject_edge(size_t sensor, int level);
+
+// Queues a jitter probe from an interrupt (see door_jitter.h). Returns whether
+// a higher priority task woke.
+bool door_handler_probe_from_isr(void);
+
+// Publish topic of a sensor, NULL for an unknown index.
+const char *door_handler_sensor_topic(uint8_t sensor);
+
+size_t door_handler_sensor_count(void);
+bool door_handler_get_sensor(size_t index, door_sensor_config_t *config, door_state_t *state);
+
+// True when no edge is queued and no sensor is still debouncing.
+bool door_handler_settled(void);
 
 #endif // DOOR_HANDLER_H
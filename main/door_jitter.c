@@ -0,0 +1,232 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "door_jitter.h"
+#include "jitter_config.h"
+
+#if DOOR_JITTER_PROFILE
+
+#include "door_handler.h"
+#include "mqtt_outbox.h"
+#include "rtos_alloc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gptimer.h"
+#include "mbedtls/sha256.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "DOOR_JITTER";
+
+typedef struct
+{
+    uint32_t buckets[DOOR_JITTER_BUCKETS]; // Bucket i counts latencies from 2^i us, bucket 0 from 0
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+} jitter_histogram_t;
+
+static const char *const source_names[DOOR_JITTER_SOURCES] = {
+    [DOOR_JITTER_PROBE] = "probe",
+    [DOOR_JITTER_GPIO] = "gpio",
+};
+
+static jitter_histogram_t histograms[DOOR_JITTER_SOURCES];
+static portMUX_TYPE jitter_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool load_active = false;
+static int door_core = -1;
+static gptimer_handle_t probe_timer = NULL;
+static esp_timer_handle_t report_timer = NULL;
+RTOS_TASK_STORAGE(jitter_load, DOOR_JITTER_LOAD_TASK_STACK_SIZE);
+
+void door_jitter_record(door_jitter_source_t source, int64_t latency_us)
+{
+    uint32_t us = (latency_us < 0) ? 0 : (latency_us > UINT32_MAX) ? UINT32_MAX : (uint32_t)latency_us;
+    size_t bucket = (us < 2) ? 0 : (size_t)(31 - __builtin_clz(us));
+
+    if (bucket >= DOOR_JITTER_BUCKETS)
+    {
+        bucket = DOOR_JITTER_BUCKETS - 1;
+    }
+
+    portENTER_CRITICAL(&jitter_lock);
+    jitter_histogram_t *histogram = &histograms[source];
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    histogram->sum_us += us;
+    if (us > histogram->max_us)
+    {
+        histogram->max_us = us;
+    }
+    portEXIT_CRITICAL(&jitter_lock);
+}
+
+// Upper bound of the bucket that holds the pct-th percentile
+static uint32_t percentile_bound_us(const jitter_histogram_t *histogram, unsigned pct)
+{
+    uint32_t rank = (histogram->count * pct + 99) / 100;
+    uint32_t seen = 0;
+
+    for (size_t i = 0; i < DOOR_JITTER_BUCKETS; i++)
+    {
+        seen += histogram->buckets[i];
+        if (seen >= rank)
+        {
+            return (i + 1 < DOOR_JITTER_BUCKETS) ? (2u << i) : histogram->max_us;
+        }
+    }
+    return histogram->max_us;
+}
+
+static void report_histogram(const char *phase, door_jitter_source_t source, const jitter_histogram_t *histogram)
+{
+    char line[DOOR_JITTER_BUCKETS * 16];
+    int len = 0;
+
+    if (histogram->count == 0)
+    {
+        return;
+    }
+
+    ESP_LOGI(TAG, "%s %s on core %d: %lu wakes, mean %llu us, p50 < %lu us, p99 < %lu us, max %lu us", phase,
+             source_names[source], door_core, (unsigned long)histogram->count,
+             (unsigned long long)(histogram->sum_us / histogram->count),
+             (unsigned long)percentile_bound_us(histogram, 50), (unsigned long)percentile_bound_us(histogram, 99),
+             (unsigned long)histogram->max_us);
+
+    for (size_t i = 0; i < DOOR_JITTER_BUCKETS && len < (int)sizeof(line); i++)
+    {
+        if (histogram->buckets[i] != 0)
+        {
+            len += snprintf(line + len, sizeof(line) - len, " %lu:%lu", (unsigned long)((i == 0) ? 0 : 1u << i),
+                            (unsigned long)histogram->buckets[i]);
+        }
+    }
+    ESP_LOGI(TAG, "  us:count%s", line);
+}
+
+// Closes a report period and switches load on or off for the next one
+static void report_timer_callback(void *arg)
+{
+    jitter_histogram_t window[DOOR_JITTER_SOURCES];
+    const char *phase = load_active ? "load" : "idle";
+
+    portENTER_CRITICAL(&jitter_lock);
+    memcpy(window, histograms, sizeof(window));
+    memset(histograms, 0, sizeof(histograms));
+    portEXIT_CRITICAL(&jitter_lock);
+
+    for (size_t i = 0; i < DOOR_JITTER_SOURCES; i++)
+    {
+        report_histogram(phase, (door_jitter_source_t)i, &window[i]);
+    }
+    load_active = !load_active;
+}
+
+static void load_task(void *arg)
+{
+    static uint8_t buffer[DOOR_JITTER_LOAD_HASH_LEN];
+    char payload[DOOR_JITTER_LOAD_PAYLOAD_LEN + 1];
+    uint8_t digest[32];
+
+    memset(payload, 'x', DOOR_JITTER_LOAD_PAYLOAD_LEN);
+    payload[DOOR_JITTER_LOAD_PAYLOAD_LEN] = '\0';
+
+    while (1)
+    {
+        if (!load_active)
+        {
+            vTaskDelay(pdMS_TO_TICKS(DOOR_JITTER_LOAD_PUBLISH_MS));
+            continue;
+        }
+
+        // Keep the core busy for half of each period, then publish and yield
+        int64_t busy_until_us = esp_timer_get_time() + DOOR_JITTER_LOAD_PUBLISH_MS * 500;
+        while (esp_timer_get_time() < busy_until_us)
+        {
+            mbedtls_sha256(buffer, sizeof(buffer), digest, 0);
+            buffer[0] = digest[0];
+        }
+        mqtt_outbox_enqueue(DOOR_JITTER_LOAD_TOPIC, payload, 0);
+        vTaskDelay(pdMS_TO_TICKS(DOOR_JITTER_LOAD_PUBLISH_MS / 2));
+    }
+}
+
+static bool IRAM_ATTR probe_alarm_callback(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata,
+                                           void *user_ctx)
+{
+    return door_handler_probe_from_isr();
+}
+
+static esp_err_t start_probe(void)
+{
+    const gptimer_config_t timer_config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT, .direction = GPTIMER_COUNT_UP, .resolution_hz = 1000000};
+    const gptimer_alarm_config_t alarm_config = {
+        .alarm_count = DOOR_JITTER_PROBE_PERIOD_US, .reload_count = 0, .flags.auto_reload_on_alarm = true};
+    const gptimer_event_callbacks_t callbacks = {.on_alarm = probe_alarm_callback};
+
+    esp_err_t err = gptimer_new_timer(&timer_config, &probe_timer);
+    if (err == ESP_OK)
+    {
+        // The interrupt is allocated here, on the calling core
+        err = gptimer_register_event_callbacks(probe_timer, &callbacks, NULL);
+    }
+    if (err == ESP_OK)
+    {
+        err = gptimer_set_alarm_action(probe_timer, &alarm_config);
+    }
+    if (err == ESP_OK)
+    {
+        err = gptimer_enable(probe_timer);
+    }
+    if (err == ESP_OK)
+    {
+        err = gptimer_start(probe_timer);
+    }
+    return err;
+}
+
+esp_err_t door_jitter_start(void)
+{
+    const esp_timer_create_args_t report_args = {.callback = report_timer_callback, .name = "door_jitter"};
+
+    door_core = xPortGetCoreID();
+    if (start_probe() != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start the probe timer");
+        return ESP_FAIL;
+    }
+
+    if (RTOS_TASK_CREATE(jitter_load, load_task, "jitter_load", NULL, DOOR_JITTER_LOAD_TASK_PRIORITY, NULL,
+                         DOOR_JITTER_LOAD_TASK_CORE) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create the load task");
+        return ESP_FAIL;
+    }
+
+    if (esp_timer_create(&report_args, &report_timer) != ESP_OK ||
+        esp_timer_start_periodic(report_timer, (uint64_t)DOOR_JITTER_REPORT_PERIOD_MS * 1000) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start the report timer");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Probing door_task on core %d every %d us, load on core %d in every other %d ms", door_core,
+             DOOR_JITTER_PROBE_PERIOD_US, DOOR_JITTER_LOAD_TASK_CORE, DOOR_JITTER_REPORT_PERIOD_MS);
+    return ESP_OK;
+}
+
+#else
+
+void door_jitter_record(door_jitter_source_t source, int64_t latency_us)
+{
+}
+
+esp_err_t door_jitter_start(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
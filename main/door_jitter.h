@@ -0,0 +1,24 @@
+#ifndef DOOR_JITTER_H
+#define DOOR_JITTER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Wake latency profiler, see jitter_config.h. door_jitter_record() does
+// nothing unless DOOR_JITTER_PROFILE is compiled in.
+
+typedef enum
+{
+    DOOR_JITTER_PROBE, // Timer interrupt to door_task
+    DOOR_JITTER_GPIO,  // GPIO interrupt to door_task
+    DOOR_JITTER_SOURCES
+} door_jitter_source_t;
+
+// Called by door_task with the time from interrupt to dequeue
+void door_jitter_record(door_jitter_source_t source, int64_t latency_us);
+
+// Called from door_task, so the probe interrupt is allocated on its core like
+// the GPIO interrupts. Starts the probe, the load task and the reports.
+esp_err_t door_jitter_start(void);
+
+#endif // DOOR_JITTER_H
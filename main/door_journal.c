@@ -0,0 +1,591 @@
+#include <string.h>
+#include "door_journal.h"
+#include "journal_config.h"
+#include "rtos_alloc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "DOOR_JOURNAL";
+
+#define JOURNAL_MAGIC 0xA5
+#define JOURNAL_RECORD_EVENT 0x01
+#define JOURNAL_RECORD_ACK 0x02
+#define JOURNAL_SCAN_CHUNK 16
+#define JOURNAL_STATE_MASK 0x0F  // Record state byte: sensor index in the high nibble, door state in the low
+#define JOURNAL_SENSOR_SHIFT 4
+
+typedef struct
+{
+    uint8_t magic;
+    uint8_t type;
+    uint8_t state;
+    uint8_t crc;
+    uint32_t seq; // Event sequence number, or highest acknowledged seq for ACK records
+    int64_t timestamp_us;
+} journal_record_t;
+
+_Static_assert(sizeof(journal_record_t) == 16, "journal record must stay 16 bytes");
+
+static door_journal_backend_t journal_backend;
+static bool journal_ready = false;
+static SemaphoreHandle_t journal_mutex = NULL;
+RTOS_SEMAPHORE_STORAGE(journal_mutex);
+static esp_timer_handle_t journal_flush_timer = NULL;
+static TaskHandle_t journal_task_handle = NULL;
+RTOS_TASK_STORAGE(journal_task, JOURNAL_TASK_STACK_SIZE);
+static void (*flush_done)(void *arg) = NULL; // Posted by door_journal_flush_async()
+static void *flush_done_arg = NULL;
+static portMUX_TYPE flush_done_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static size_t slot_count = 0;
+static size_t write_slot = 0;
+static journal_record_t pending[JOURNAL_WRITE_BATCH + 1]; // +1 leaves room for an ACK record
+static size_t pending_count = 0;
+static bool ack_dirty = false;
+static door_journal_stats_t journal_stats = {0};
+
+static uint8_t journal_crc8(const journal_record_t *rec)
+{
+    journal_record_t copy = *rec;
+    const uint8_t *bytes = (const uint8_t *)&copy;
+    uint8_t crc = 0;
+
+    copy.crc = 0;
+    for (size_t i = 0; i < sizeof(copy); i++)
+    {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static bool record_is_empty(const journal_record_t *rec)
+{
+    const uint8_t *bytes = (const uint8_t *)rec;
+    for (size_t i = 0; i < sizeof(*rec); i++)
+    {
+        if (bytes[i] != 0xFF)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool record_is_valid(const journal_record_t *rec)
+{
+    return rec->magic == JOURNAL_MAGIC && rec->crc == journal_crc8(rec);
+}
+
+static size_t slots_per_sector(void)
+{
+    return journal_backend.sector_size / sizeof(journal_record_t);
+}
+
+static esp_err_t read_slots(size_t first, journal_record_t *recs, size_t count)
+{
+    return journal_backend.read(journal_backend.ctx, first * sizeof(journal_record_t), recs,
+                                count * sizeof(journal_record_t));
+}
+
+// Erases the sector that starts at slot, counting unacknowledged events it held
+static esp_err_t erase_sector_at(size_t slot)
+{
+    journal_record_t recs[JOURNAL_SCAN_CHUNK];
+
+    for (size_t i = 0; i < slots_per_sector(); i += JOURNAL_SCAN_CHUNK)
+    {
+        if (read_slots(slot + i, recs, JOURNAL_SCAN_CHUNK) != ESP_OK)
+        {
+            break;
+        }
+        for (size_t j = 0; j < JOURNAL_SCAN_CHUNK; j++)
+        {
+            if (record_is_valid(&recs[j]) && recs[j].type == JOURNAL_RECORD_EVENT &&
+                recs[j].seq > journal_stats.acked_seq)
+            {
+                journal_stats.overwritten++;
+            }
+        }
+    }
+
+    journal_stats.sector_erases++;
+    return journal_backend.erase_sector(journal_backend.ctx, slot * sizeof(journal_record_t));
+}
+
+// True when every slot from slot to the end of its sector is still erased
+static bool sector_blank_from(size_t slot)
+{
+    journal_record_t recs[JOURNAL_SCAN_CHUNK];
+    size_t end = slot - (slot % slots_per_sector()) + slots_per_sector();
+
+    while (slot < end)
+    {
+        size_t count = (end - slot < JOURNAL_SCAN_CHUNK) ? end - slot : JOURNAL_SCAN_CHUNK;
+        if (read_slots(slot, recs, count) != ESP_OK)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!record_is_empty(&recs[i]))
+            {
+                return false;
+            }
+        }
+        slot += count;
+    }
+    return true;
+}
+
+static esp_err_t journal_flush_locked(void)
+{
+    esp_err_t err = ESP_OK;
+    size_t written = 0;
+
+    if (ack_dirty)
+    {
+        journal_record_t *ack = &pending[pending_count++];
+        *ack = (journal_record_t){.magic = JOURNAL_MAGIC,
+                                  .type = JOURNAL_RECORD_ACK,
+                                  .seq = journal_stats.acked_seq,
+                                  .timestamp_us = esp_timer_get_time()};
+        ack->crc = journal_crc8(ack);
+        ack_dirty = false;
+    }
+
+    // One program operation per sector touched rather than one per record
+    while (written < pending_count)
+    {
+        size_t room = slots_per_sector() - (write_slot % slots_per_sector());
+        size_t chunk = pending_count - written;
+        if (chunk > room)
+        {
+            chunk = room;
+        }
+
+        err = journal_backend.write(journal_backend.ctx, write_slot * sizeof(journal_record_t), &pending[written],
+                                    chunk * sizeof(journal_record_t));
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Journal write failed: %s", esp_err_to_name(err));
+            break;
+        }
+        journal_stats.flash_writes++;
+        written += chunk;
+        write_slot = (write_slot + chunk) % slot_count;
+
+        // Erase the next sector before writing into it. The boundary between
+        // written and erased slots is how journal_mount() finds the write position.
+        if (write_slot % slots_per_sector() == 0)
+        {
+            err = erase_sector_at(write_slot);
+            if (err != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Journal sector erase failed: %s", esp_err_to_name(err));
+                break;
+            }
+        }
+    }
+
+    pending_count = 0;
+    return err;
+}
+
+// A program and sector erase can take tens of milliseconds, which would hold
+// up every other esp_timer callback, so the timer only wakes journal_task
+static void journal_flush_timer_callback(void *arg)
+{
+    xTaskNotifyGive(journal_task_handle);
+}
+
+static void journal_task(void *arg)
+{
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Taken before the flush, so everything appended before the request is on flash when done runs
+        portENTER_CRITICAL(&flush_done_lock);
+        void (*done)(void *arg) = flush_done;
+        void *done_arg = flush_done_arg;
+        flush_done = NULL;
+        portEXIT_CRITICAL(&flush_done_lock);
+
+        door_journal_flush();
+        if (done != NULL)
+        {
+            done(done_arg);
+        }
+    }
+}
+
+static esp_err_t journal_mount(void)
+{
+    journal_record_t recs[JOURNAL_SCAN_CHUNK];
+    bool prev_empty;
+    bool found_write_slot = false;
+    bool any_written = false;
+    size_t newest_slot = 0;
+    journal_record_t last;
+
+    slot_count = journal_backend.size / sizeof(journal_record_t);
+    slot_count -= slot_count % slots_per_sector();
+    if (slot_count < 2 * slots_per_sector())
+    {
+        ESP_LOGE(TAG, "Journal needs at least two sectors");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (read_slots(slot_count - 1, &last, 1) != ESP_OK)
+    {
+        return ESP_FAIL;
+    }
+    prev_empty = record_is_empty(&last);
+
+    for (size_t base = 0; base < slot_count; base += JOURNAL_SCAN_CHUNK)
+    {
+        esp_err_t err = read_slots(base, recs, JOURNAL_SCAN_CHUNK);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Journal read failed: %s", esp_err_to_name(err));
+            return err;
+        }
+
+        for (size_t i = 0; i < JOURNAL_SCAN_CHUNK; i++)
+        {
+            bool empty = record_is_empty(&recs[i]);
+
+            if (empty && !prev_empty && !found_write_slot)
+            {
+                write_slot = base + i;
+                found_write_slot = true;
+            }
+            prev_empty = empty;
+
+            if (empty)
+            {
+                continue;
+            }
+            any_written = true;
+
+            if (!record_is_valid(&recs[i]))
+            {
+                continue; // Torn write from a power loss
+            }
+
+            if (recs[i].type == JOURNAL_RECORD_EVENT && recs[i].seq >= journal_stats.next_seq)
+            {
+                journal_stats.next_seq = recs[i].seq + 1;
+                newest_slot = base + i;
+            }
+            else if (recs[i].type == JOURNAL_RECORD_ACK && recs[i].seq > journal_stats.acked_seq)
+            {
+                journal_stats.acked_seq = recs[i].seq;
+            }
+        }
+    }
+
+    if (!found_write_slot)
+    {
+        // Blank journal, or power failed between filling a sector and erasing
+        // the next one: carry on in the sector after the newest event
+        write_slot = 0;
+        if (any_written)
+        {
+            write_slot = (newest_slot - (newest_slot % slots_per_sector()) + slots_per_sector()) % slot_count;
+            if (erase_sector_at(write_slot) != ESP_OK)
+            {
+                return ESP_FAIL;
+            }
+        }
+    }
+    else if (!sector_blank_from(write_slot))
+    {
+        // An interrupted erase left old records behind the write position.
+        // Nothing written before it in this sector is lost by moving on.
+        if (write_slot % slots_per_sector() != 0)
+        {
+            write_slot = (write_slot - (write_slot % slots_per_sector()) + slots_per_sector()) % slot_count;
+        }
+        if (erase_sector_at(write_slot) != ESP_OK)
+        {
+            return ESP_FAIL;
+        }
+    }
+
+    if (journal_stats.next_seq <= journal_stats.acked_seq)
+    {
+        journal_stats.next_seq = journal_stats.acked_seq + 1;
+    }
+    journal_stats.replay_needed = (journal_stats.next_seq - 1) > journal_stats.acked_seq;
+
+    ESP_LOGI(TAG, "Journal mounted: next_seq=%lu acked_seq=%lu write_slot=%u", (unsigned long)journal_stats.next_seq,
+             (unsigned long)journal_stats.acked_seq, (unsigned)write_slot);
+    return ESP_OK;
+}
+
+esp_err_t door_journal_init_with_backend(const door_journal_backend_t *backend)
+{
+    journal_backend = *backend;
+    memset(&journal_stats, 0, sizeof(journal_stats));
+    journal_stats.next_seq = 1;
+    pending_count = 0;
+    ack_dirty = false;
+
+    if (journal_mutex == NULL)
+    {
+        journal_mutex = RTOS_MUTEX_CREATE(journal_mutex);
+        if (journal_mutex == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to create journal mutex");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    if (journal_task_handle == NULL &&
+        RTOS_TASK_CREATE(journal_task, journal_task, "journal_task", NULL, JOURNAL_TASK_PRIORITY,
+                         &journal_task_handle, JOURNAL_TASK_CORE) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create journal task");
+        return ESP_FAIL;
+    }
+
+    if (journal_flush_timer == NULL)
+    {
+        const esp_timer_create_args_t timer_args = {.callback = journal_flush_timer_callback,
+                                                    .name = "journal_flush"};
+        if (esp_timer_create(&timer_args, &journal_flush_timer) != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to create journal flush timer");
+            return ESP_FAIL;
+        }
+    }
+
+    esp_err_t err = journal_mount();
+    journal_ready = (err == ESP_OK);
+    return err;
+}
+
+static esp_err_t partition_read(void *ctx, size_t offset, void *dst, size_t len)
+{
+    return esp_partition_read((const esp_partition_t *)ctx, offset, dst, len);
+}
+
+static esp_err_t partition_write(void *ctx, size_t offset, const void *src, size_t len)
+{
+    return esp_partition_write((const esp_partition_t *)ctx, offset, src, len);
+}
+
+static esp_err_t partition_erase_sector(void *ctx, size_t offset)
+{
+    const esp_partition_t *partition = (const esp_partition_t *)ctx;
+    return esp_partition_erase_range(partition, offset, partition->erase_size);
+}
+
+esp_err_t init_door_journal(void)
+{
+    const esp_partition_t *partition = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)JOURNAL_PARTITION_SUBTYPE, JOURNAL_PARTITION_LABEL);
+    if (partition == NULL)
+    {
+        ESP_LOGE(TAG, "Journal partition '%s' not found", JOURNAL_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    door_journal_backend_t backend = {.read = partition_read,
+                                      .write = partition_write,
+                                      .erase_sector = partition_erase_sector,
+                                      .size = partition->size,
+                                      .sector_size = partition->erase_size,
+                                      .ctx = (void *)partition};
+    return door_journal_init_with_backend(&backend);
+}
+
+uint32_t door_journal_append(uint8_t sensor, uint8_t state, int64_t timestamp_us)
+{
+    uint32_t seq = 0;
+
+    if (!journal_ready)
+    {
+        return 0;
+    }
+
+    xSemaphoreTake(journal_mutex, portMAX_DELAY);
+    seq = journal_stats.next_seq++;
+    journal_record_t *rec = &pending[pending_count++];
+    *rec = (journal_record_t){.magic = JOURNAL_MAGIC,
+                              .type = JOURNAL_RECORD_EVENT,
+                              .state = (uint8_t)((sensor << JOURNAL_SENSOR_SHIFT) | (state & JOURNAL_STATE_MASK)),
+                              .seq = seq,
+                              .timestamp_us = timestamp_us};
+    rec->crc = journal_crc8(rec);
+
+    if (pending_count >= JOURNAL_WRITE_BATCH)
+    {
+        journal_flush_locked();
+    }
+    else if (!esp_timer_is_active(journal_flush_timer))
+    {
+        esp_timer_start_once(journal_flush_timer, (uint64_t)JOURNAL_FLUSH_DELAY_MS * 1000);
+    }
+    xSemaphoreGive(journal_mutex);
+
+    return seq;
+}
+
+esp_err_t door_journal_flush(void)
+{
+    if (!journal_ready)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(journal_mutex, portMAX_DELAY);
+    esp_err_t err = journal_flush_locked();
+    xSemaphoreGive(journal_mutex);
+    return err;
+}
+
+void door_journal_flush_async(void (*done)(void *arg), void *arg)
+{
+    if (journal_task_handle == NULL)
+    {
+        // Nothing was journaled, so there is nothing to flush
+        done(arg);
+        return;
+    }
+
+    portENTER_CRITICAL(&flush_done_lock);
+    flush_done = done;
+    flush_done_arg = arg;
+    portEXIT_CRITICAL(&flush_done_lock);
+    xTaskNotifyGive(journal_task_handle);
+}
+
+static void journal_schedule_ack_locked(uint32_t seq)
+{
+    if (seq <= journal_stats.acked_seq)
+    {
+        return;
+    }
+
+    journal_stats.acked_seq = seq;
+    ack_dirty = true;
+    if (!esp_timer_is_active(journal_flush_timer))
+    {
+        esp_timer_start_once(journal_flush_timer, (uint64_t)JOURNAL_FLUSH_DELAY_MS * 1000);
+    }
+}
+
+void door_journal_mark_delivered(uint32_t seq)
+{
+    if (!journal_ready || seq == 0)
+    {
+        return;
+    }
+
+    xSemaphoreTake(journal_mutex, portMAX_DELAY);
+    if (!journal_stats.replay_needed)
+    {
+        journal_schedule_ack_locked(seq);
+    }
+    xSemaphoreGive(journal_mutex);
+}
+
+void door_journal_mark_failed(uint32_t seq)
+{
+    if (!journal_ready || seq == 0)
+    {
+        return;
+    }
+
+    xSemaphoreTake(journal_mutex, portMAX_DELAY);
+    journal_stats.replay_needed = true;
+    xSemaphoreGive(journal_mutex);
+}
+
+size_t door_journal_read_pending(door_journal_entry_t *entries, size_t max)
+{
+    journal_record_t recs[JOURNAL_SCAN_CHUNK];
+    size_t found = 0;
+
+    if (!journal_ready)
+    {
+        return 0;
+    }
+
+    xSemaphoreTake(journal_mutex, portMAX_DELAY);
+    journal_flush_locked();
+
+    // The sector after the one being written holds the oldest records, so
+    // scanning from there around the ring visits events in sequence order
+    size_t oldest = write_slot - (write_slot % slots_per_sector()) + slots_per_sector();
+    for (size_t scanned = 0; scanned < slot_count && found < max; scanned += JOURNAL_SCAN_CHUNK)
+    {
+        size_t base = (oldest + scanned) % slot_count;
+        if (read_slots(base, recs, JOURNAL_SCAN_CHUNK) != ESP_OK)
+        {
+            break;
+        }
+
+        for (size_t i = 0; i < JOURNAL_SCAN_CHUNK && found < max; i++)
+        {
+            if (record_is_valid(&recs[i]) && recs[i].type == JOURNAL_RECORD_EVENT &&
+                recs[i].seq > journal_stats.acked_seq)
+            {
+                entries[found++] = (door_journal_entry_t){
+                    .seq = recs[i].seq,
+                    .sensor = recs[i].state >> JOURNAL_SENSOR_SHIFT,
+                    .state = recs[i].state & JOURNAL_STATE_MASK,
+                    .timestamp_us = recs[i].timestamp_us};
+            }
+        }
+    }
+
+    if (found == 0)
+    {
+        journal_stats.replay_needed = false;
+    }
+    xSemaphoreGive(journal_mutex);
+
+    return found;
+}
+
+esp_err_t door_journal_ack(uint32_t seq)
+{
+    if (!journal_ready)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(journal_mutex, portMAX_DELAY);
+    journal_schedule_ack_locked(seq);
+    xSemaphoreGive(journal_mutex);
+    return ESP_OK;
+}
+
+bool door_journal_replay_needed(void)
+{
+    return journal_ready && journal_stats.replay_needed;
+}
+
+void door_journal_get_stats(door_journal_stats_t *stats)
+{
+    if (journal_mutex == NULL)
+    {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+
+    xSemaphoreTake(journal_mutex, portMAX_DELAY);
+    *stats = journal_stats;
+    xSemaphoreGive(journal_mutex);
+}
@@ -0,0 +1,66 @@
+#ifndef DOOR_JOURNAL_H
+#define DOOR_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef struct
+{
+    uint32_t seq;
+    uint8_t sensor; // Index into the door sensor table
+    uint8_t state;
+    int64_t timestamp_us;
+} door_journal_entry_t;
+
+// Flash access used by the journal. The default backend is the "journal" data
+// partition; anything with NOR-flash semantics (erase to 0xFF, program 1->0)
+// can be plugged in instead, e.g. the file-backed emulator in
+// tools/host/journal_file_backend.c that tools/host/test_journal.py runs on.
+typedef struct
+{
+    esp_err_t (*read)(void *ctx, size_t offset, void *dst, size_t len);
+    esp_err_t (*write)(void *ctx, size_t offset, const void *src, size_t len);
+    esp_err_t (*erase_sector)(void *ctx, size_t offset);
+    size_t size;
+    size_t sector_size;
+    void *ctx;
+} door_journal_backend_t;
+
+typedef struct
+{
+    uint32_t next_seq;
+    uint32_t acked_seq;
+    uint32_t flash_writes;
+    uint32_t sector_erases;
+    uint32_t overwritten; // Unacknowledged events lost to ring wrap-around
+    bool replay_needed;
+} door_journal_stats_t;
+
+esp_err_t init_door_journal(void);
+esp_err_t door_journal_init_with_backend(const door_journal_backend_t *backend);
+
+// Returns the sequence number assigned to the event, 0 if it could not be journaled.
+// Up to 16 sensors; records written before sensors existed read back as sensor 0.
+uint32_t door_journal_append(uint8_t sensor, uint8_t state, int64_t timestamp_us);
+esp_err_t door_journal_flush(void);
+// Flushes from journal_task and then calls done there, for callers that must
+// not block on flash, such as esp_timer callbacks. Only the latest request's
+// done is called.
+void door_journal_flush_async(void (*done)(void *arg), void *arg);
+
+// Live publish of seq succeeded. Only trims the journal when no older event is
+// still waiting for replay.
+void door_journal_mark_delivered(uint32_t seq);
+void door_journal_mark_failed(uint32_t seq);
+
+// Reads up to max unacknowledged events in sequence order and returns the count.
+size_t door_journal_read_pending(door_journal_entry_t *entries, size_t max);
+// Acknowledge every event up to and including seq after a successful replay batch.
+esp_err_t door_journal_ack(uint32_t seq);
+
+bool door_journal_replay_needed(void);
+void door_journal_get_stats(door_journal_stats_t *stats);
+
+#endif // DOOR_JOURNAL_H
@@ -0,0 +1,230 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "door_payload.h"
+#include "payload_config.h"
+#include "session_classifier.h"
+#include "clock_sync.h"
+#include "esp_mac.h"
+#include "esp_wifi.h"
+#include "esp_log.h"
+
+static const char *TAG = "DOOR_PAYLOAD";
+
+static uint8_t device_mac[6];
+
+typedef struct
+{
+    int8_t rssi;
+    uint16_t battery_mv;
+} payload_context_t;
+
+static void payload_context_read(payload_context_t *ctx)
+{
+    wifi_ap_record_t ap;
+
+    ctx->rssi = (esp_wifi_sta_get_ap_info(&ap) == ESP_OK) ? ap.rssi : 0;
+    // This board has no battery sense divider; the field is reserved for one that does
+    ctx->battery_mv = 0;
+}
+
+// 0 until the clock has been synced; events queued before then are stamped
+// when they are finally encoded
+static int64_t event_wall_ms(const door_payload_event_t *event)
+{
+    int64_t wall_us;
+
+    return clock_sync_mono_to_wall_us(event->mono_us, &wall_us) ? wall_us / 1000 : 0;
+}
+
+#if DOOR_PAYLOAD_FORMAT == DOOR_PAYLOAD_FORMAT_BINARY
+
+static uint8_t *put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t *put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+static uint8_t *put_le64(uint8_t *p, uint64_t v)
+{
+    p = put_le32(p, (uint32_t)v);
+    return put_le32(p, (uint32_t)(v >> 32));
+}
+
+static size_t binary_event_size(const door_payload_event_t *event)
+{
+    return (event->flags & DOOR_EVENT_FLAG_SESSION) ? DOOR_PAYLOAD_BINARY_SESSION_SIZE
+                                                     : DOOR_PAYLOAD_BINARY_EVENT_SIZE;
+}
+
+static size_t encode_binary(const payload_context_t *ctx, const door_payload_event_t *events, size_t count,
+                            uint8_t *buf, size_t size, size_t *len_out)
+{
+    size_t fit = 0;
+    size_t len = DOOR_PAYLOAD_BINARY_HEADER_SIZE;
+
+    while (fit < count && fit < UINT8_MAX && len + binary_event_size(&events[fit]) <= size)
+    {
+        len += binary_event_size(&events[fit]);
+        fit++;
+    }
+    if (fit == 0)
+    {
+        return 0;
+    }
+    count = fit;
+
+    uint8_t *p = buf;
+    *p++ = DOOR_PAYLOAD_VERSION;
+    *p++ = (uint8_t)count;
+    memcpy(p, device_mac, sizeof(device_mac));
+    p += sizeof(device_mac);
+    *p++ = (uint8_t)ctx->rssi;
+    p = put_le16(p, ctx->battery_mv);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        p = put_le32(p, events[i].seq);
+        *p++ = events[i].state;
+        *p++ = events[i].flags;
+        p = put_le64(p, (uint64_t)(events[i].mono_us / 1000));
+        p = put_le32(p, (uint32_t)(event_wall_ms(&events[i]) / 1000));
+        p = put_le32(p, events[i].dwell_ms);
+        if (events[i].flags & DOOR_EVENT_FLAG_SESSION)
+        {
+            const door_payload_session_t *session = &events[i].session;
+            p = put_le16(p, session->opens);
+            p = put_le32(p, session->open_ms);
+            p = put_le32(p, session->longest_open_ms);
+            p = put_le32(p, session->since_last_ms < 0 ? UINT32_MAX : (uint32_t)session->since_last_ms);
+        }
+    }
+
+    *len_out = (size_t)(p - buf);
+    return count;
+}
+
+#else
+
+// "door" and the state for a transition, "session" and the class for a session
+static const char *json_kind(const door_payload_event_t *event, const char **value)
+{
+    if (event->flags & DOOR_EVENT_FLAG_SESSION)
+    {
+        *value = session_class_name((session_class_t)event->state);
+        return "session";
+    }
+    *value = event->state ? "open" : "closed";
+    return "door";
+}
+
+static int format_json_header(const payload_context_t *ctx, const door_payload_event_t *last, char *out,
+                              size_t size)
+{
+    const char *value;
+    const char *kind = json_kind(last, &value);
+
+    // The top-level "door" key keeps subscribers of the original {"door": "..."} payload working
+    return snprintf(out, size,
+                    "{\"%s\":\"%s\",\"v\":%d,\"dev\":\"%02x%02x%02x%02x%02x%02x\",\"rssi\":%d,\"bat_mv\":%u,"
+                    "\"events\":[",
+                    kind, value, DOOR_PAYLOAD_VERSION, device_mac[0], device_mac[1], device_mac[2], device_mac[3],
+                    device_mac[4], device_mac[5], ctx->rssi, (unsigned)ctx->battery_mv);
+}
+
+static int format_json_event(const payload_context_t *ctx, const door_payload_event_t *event, bool first, char *out,
+                             size_t size)
+{
+    const char *value;
+    const char *kind = json_kind(event, &value);
+    char session[128] = "";
+
+    if (event->flags & DOOR_EVENT_FLAG_SESSION)
+    {
+        snprintf(session, sizeof(session), ",\"opens\":%u,\"open_ms\":%lu,\"longest_ms\":%lu,\"since_last_ms\":%lld",
+                 (unsigned)event->session.opens, (unsigned long)event->session.open_ms,
+                 (unsigned long)event->session.longest_open_ms, (long long)event->session.since_last_ms);
+    }
+    return snprintf(out, size, "%s{\"%s\":\"%s\",\"seq\":%lu,\"mono_ms\":%lld,\"ts\":%lld,\"%s\":%lu%s%s%s}",
+                    first ? "" : ",", kind, value, (unsigned long)event->seq, (long long)(event->mono_us / 1000),
+                    (long long)event_wall_ms(event), (event->flags & DOOR_EVENT_FLAG_SESSION) ? "span_ms" : "dwell_ms",
+                    (unsigned long)event->dwell_ms, session,
+                    (event->flags & DOOR_EVENT_FLAG_REMINDER) ? ",\"reminder\":true" : "",
+                    (event->flags & DOOR_EVENT_FLAG_REPLAY) ? ",\"replay\":true" : "");
+}
+
+static size_t encode_json(const payload_context_t *ctx, const door_payload_event_t *events, size_t count,
+                          uint8_t *buf, size_t size, size_t *len_out)
+{
+    static const char tail[] = "]}";
+    char *out = (char *)buf;
+    size_t encoded = 0;
+
+    // Size the batch first so the header can name the last state it carries
+    size_t len = sizeof(tail);
+    while (encoded < count)
+    {
+        size_t event_len = (size_t)format_json_event(ctx, &events[encoded], encoded == 0, NULL, 0);
+        size_t header_len = (size_t)format_json_header(ctx, &events[encoded], NULL, 0);
+        if (len + event_len + header_len > size)
+        {
+            break;
+        }
+        len += event_len;
+        encoded++;
+    }
+    if (encoded == 0)
+    {
+        return 0;
+    }
+
+    len = (size_t)format_json_header(ctx, &events[encoded - 1], out, size);
+    for (size_t i = 0; i < encoded; i++)
+    {
+        len += (size_t)format_json_event(ctx, &events[i], i == 0, out + len, size - len);
+    }
+    memcpy(out + len, tail, sizeof(tail));
+
+    *len_out = len + sizeof(tail) - 1;
+    return encoded;
+}
+
+#endif
+
+size_t door_payload_encode(const door_payload_event_t *events, size_t count, uint8_t *buf, size_t size,
+                           size_t *len_out)
+{
+    payload_context_t ctx;
+
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    payload_context_read(&ctx);
+#if DOOR_PAYLOAD_FORMAT == DOOR_PAYLOAD_FORMAT_BINARY
+    return encode_binary(&ctx, events, count, buf, size, len_out);
+#else
+    return encode_json(&ctx, events, count, buf, size, len_out);
+#endif
+}
+
+esp_err_t init_door_payload(void)
+{
+    esp_err_t err = esp_read_mac(device_mac, ESP_MAC_WIFI_STA);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to read MAC address: %s", esp_err_to_name(err));
+    }
+    return err;
+}
@@ -0,0 +1,51 @@
+#ifndef DOOR_PAYLOAD_H
+#define DOOR_PAYLOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define DOOR_EVENT_FLAG_REMINDER 0x01 // Door-still-open reminder, not a transition
+#define DOOR_EVENT_FLAG_REPLAY 0x02   // Resent from the door journal
+#define DOOR_EVENT_FLAG_SESSION 0x04  // Summary of a door session, see session_config.h
+
+// Binary layout, version 1, little-endian:
+//   header  0 u8 version, 1 u8 event count, 2 u8[6] Wi-Fi MAC, 8 i8 RSSI (dBm, 0 = unknown),
+//           9 u16 battery mV (0 = not measured)
+//   event   0 u32 seq, 4 u8 state, 5 u8 flags, 6 u64 monotonic ms (a u32 would wrap
+//           after 49.7 days of uptime), 14 u32 wall clock s (0 = not synced), 18 u32 dwell ms
+//   session an event with DOOR_EVENT_FLAG_SESSION, whose state is the
+//           session_class_t and dwell the span, followed by 22 u16 openings,
+//           24 u32 open ms, 28 u32 longest opening ms, 32 u32 ms since the
+//           previous session (UINT32_MAX = none)
+// A JSON payload starts with '{', a binary one with its version byte.
+#define DOOR_PAYLOAD_BINARY_HEADER_SIZE 11
+#define DOOR_PAYLOAD_BINARY_EVENT_SIZE 22
+#define DOOR_PAYLOAD_BINARY_SESSION_SIZE 36
+
+typedef struct
+{
+    uint16_t opens;
+    uint32_t open_ms; // Summed over the openings
+    uint32_t longest_open_ms;
+    int64_t since_last_ms; // -1 for the first session
+} door_payload_session_t;
+
+typedef struct
+{
+    uint32_t seq; // Door journal sequence number, 0 if not journaled
+    uint8_t state;
+    uint8_t flags;
+    int64_t mono_us;   // esp_timer time of the edge, or of the first opening of a session
+    uint32_t dwell_ms; // Time spent in the previous state, 0 if unknown; span of a session
+    door_payload_session_t session; // DOOR_EVENT_FLAG_SESSION only
+} door_payload_event_t;
+
+esp_err_t init_door_payload(void);
+
+// Encodes as many of the events as fit into buf in the configured
+// DOOR_PAYLOAD_FORMAT. Returns the number encoded, 0 if not even one fits.
+size_t door_payload_encode(const door_payload_event_t *events, size_t count, uint8_t *buf, size_t size,
+                           size_t *len_out);
+
+#endif // DOOR_PAYLOAD_H
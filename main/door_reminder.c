@@ -0,0 +1,321 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "door_reminder.h"
+#include "reminder_config.h"
+#include "reminder_policy.h"
+#include "door_config.h"
+#include "clock_sync_config.h"
+#include "rtos_alloc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/timers.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "DOOR_REMINDER";
+
+#define REMINDER_RTC_MAGIC 0x524D4E31 // "RMN1"
+
+typedef struct
+{
+    bool active;
+    uint32_t base_ms;
+    uint32_t sent;        // Reminders since the door opened
+    int64_t opened_us;    // esp_timer time the door opened; before boot if it opened before deep sleep
+    int64_t due_us;       // REMINDER_POLICY_NONE once the cap is reached
+    int64_t interval_ms;  // Of the step due_us ends
+} reminder_slot_t;
+
+// Where each open door is on its curve, for the wake after deep sleep
+typedef struct
+{
+    uint32_t magic;
+    uint32_t sent[DOOR_MAX_SENSORS];
+    uint32_t open_ms[DOOR_MAX_SENSORS]; // Open time when the next reminder was scheduled
+    uint32_t next_ms[DOOR_MAX_SENSORS]; // And how far away it was
+} reminder_rtc_t;
+
+static const uint16_t curve_pct[] = REMINDER_CURVE_PCT;
+
+static RTC_DATA_ATTR reminder_rtc_t rtc_reminders;
+static reminder_slot_t slots[DOOR_MAX_SENSORS];
+static door_reminder_fn_t fire_reminder = NULL;
+static TimerHandle_t wheel_timer = NULL;
+RTOS_TIMER_STORAGE(reminder_wheel, 1);
+static portMUX_TYPE reminder_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Local time of day, -1 while the clock is unset and quiet hours cannot apply
+static int64_t local_time_of_day_ms(void)
+{
+    time_t now = time(NULL);
+    struct tm local;
+
+    if (now < CLOCK_SYNC_MIN_VALID_EPOCH || localtime_r(&now, &local) == NULL)
+    {
+        return -1;
+    }
+    return ((int64_t)local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec) * 1000;
+}
+
+// Reminders due this close go out together with something else
+static int64_t coalesce_window_us(const reminder_slot_t *slot)
+{
+    int64_t window_ms = slot->interval_ms / 4; // So pulled-forward reminders cannot chain
+
+    return (window_ms < REMINDER_COALESCE_MS ? window_ms : REMINDER_COALESCE_MS) * 1000;
+}
+
+// Called with reminder_lock held
+static void schedule_next(size_t sensor, int64_t now_us, int64_t local_ms)
+{
+    reminder_slot_t *slot = &slots[sensor];
+    reminder_policy_t policy = {.base_ms = slot->base_ms,
+                                .curve_pct = curve_pct,
+                                .curve_len = sizeof(curve_pct) / sizeof(curve_pct[0]),
+                                .max_per_open = REMINDER_MAX_PER_OPEN,
+                                .quiet_start_ms = REMINDER_QUIET_START_MIN * 60000,
+                                .quiet_end_ms = REMINDER_QUIET_END_MIN * 60000};
+
+    slot->interval_ms = reminder_policy_interval_ms(&policy, slot->sent);
+    if (slot->interval_ms == REMINDER_POLICY_NONE)
+    {
+        slot->due_us = REMINDER_POLICY_NONE;
+    }
+    else
+    {
+        int64_t delay_ms = slot->interval_ms;
+        if (local_ms >= 0)
+        {
+            delay_ms += reminder_policy_quiet_delay_ms(&policy, local_ms + delay_ms);
+        }
+        slot->due_us = now_us + delay_ms * 1000;
+    }
+
+    rtc_reminders.magic = REMINDER_RTC_MAGIC;
+    rtc_reminders.sent[sensor] = slot->sent;
+    rtc_reminders.open_ms[sensor] = (uint32_t)((now_us - slot->opened_us) / 1000);
+    rtc_reminders.next_ms[sensor] =
+        (slot->due_us == REMINDER_POLICY_NONE) ? 0 : (uint32_t)((slot->due_us - now_us) / 1000);
+}
+
+// Points the shared timer at the earliest reminder due
+static void rearm(void)
+{
+    int64_t due_us = REMINDER_POLICY_NONE;
+
+    if (wheel_timer == NULL)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&reminder_lock);
+    for (size_t i = 0; i < DOOR_MAX_SENSORS; i++)
+    {
+        if (slots[i].active && slots[i].due_us < due_us)
+        {
+            due_us = slots[i].due_us;
+        }
+    }
+    portEXIT_CRITICAL(&reminder_lock);
+
+    if (due_us == REMINDER_POLICY_NONE)
+    {
+        xTimerStop(wheel_timer, 0);
+        return;
+    }
+
+    int64_t delay_us = due_us - esp_timer_get_time();
+    // Whole ticks, rounded up; pdMS_TO_TICKS() overflows for periods of hours
+    TickType_t ticks = (delay_us > 0) ? (TickType_t)(delay_us / (portTICK_PERIOD_MS * 1000)) + 1 : 1;
+    if (xTimerChangePeriod(wheel_timer, ticks, 0) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to arm reminder timer");
+    }
+}
+
+static void wheel_timer_callback(TimerHandle_t timer)
+{
+    int64_t local_ms = local_time_of_day_ms();
+    int64_t now_us = esp_timer_get_time();
+    uint32_t open_ms[DOOR_MAX_SENSORS];
+    bool due[DOOR_MAX_SENSORS] = {false};
+
+    portENTER_CRITICAL(&reminder_lock);
+    for (size_t i = 0; i < DOOR_MAX_SENSORS; i++)
+    {
+        reminder_slot_t *slot = &slots[i];
+        if (slot->active && slot->due_us != REMINDER_POLICY_NONE && slot->due_us <= now_us + coalesce_window_us(slot))
+        {
+            due[i] = true;
+            open_ms[i] = (uint32_t)((now_us - slot->opened_us) / 1000);
+            slot->sent++;
+            schedule_next(i, now_us, local_ms);
+        }
+    }
+    portEXIT_CRITICAL(&reminder_lock);
+
+    for (size_t i = 0; i < DOOR_MAX_SENSORS; i++)
+    {
+        if (due[i])
+        {
+            fire_reminder(i, open_ms[i]);
+            if (door_reminder_next_ms(i) == 0)
+            {
+                ESP_LOGI(TAG, "Sensor %u reached %d reminders, none until it closes", (unsigned)i,
+                         REMINDER_MAX_PER_OPEN);
+            }
+        }
+    }
+    rearm();
+}
+
+static void start_slot(size_t sensor, uint32_t base_ms, uint32_t sent, int64_t opened_us, int64_t due_in_ms)
+{
+    int64_t local_ms = local_time_of_day_ms();
+    int64_t now_us = esp_timer_get_time();
+
+    if (sensor >= DOOR_MAX_SENSORS)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&reminder_lock);
+    reminder_slot_t *slot = &slots[sensor];
+    slot->active = true;
+    slot->base_ms = base_ms;
+    slot->sent = sent;
+    slot->opened_us = opened_us;
+    schedule_next(sensor, now_us, local_ms);
+    if (due_in_ms >= 0 && slot->due_us != REMINDER_POLICY_NONE)
+    {
+        slot->due_us = now_us + due_in_ms * 1000;
+        rtc_reminders.next_ms[sensor] = (uint32_t)due_in_ms;
+    }
+    portEXIT_CRITICAL(&reminder_lock);
+    rearm();
+}
+
+void door_reminder_start(size_t sensor, uint32_t base_ms)
+{
+    start_slot(sensor, base_ms, 0, esp_timer_get_time(), -1);
+}
+
+void door_reminder_resume(size_t sensor, uint32_t base_ms, int64_t due_in_ms)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    if (sensor >= DOOR_MAX_SENSORS || rtc_reminders.magic != REMINDER_RTC_MAGIC)
+    {
+        door_reminder_start(sensor, base_ms);
+        return;
+    }
+
+    if (due_in_ms == INT64_MAX)
+    {
+        due_in_ms = -1; // Past the cap, or reminders off
+    }
+    else if (due_in_ms < 0)
+    {
+        due_in_ms = 0;
+    }
+    // Open for as long as before the sleep, plus the part of the interval slept through
+    int64_t open_ms = (int64_t)rtc_reminders.open_ms[sensor] + rtc_reminders.next_ms[sensor] -
+                      (due_in_ms > 0 ? due_in_ms : 0);
+    start_slot(sensor, base_ms, rtc_reminders.sent[sensor], now_us - (open_ms > 0 ? open_ms : 0) * 1000, due_in_ms);
+}
+
+void door_reminder_stop(size_t sensor)
+{
+    if (sensor >= DOOR_MAX_SENSORS)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&reminder_lock);
+    slots[sensor].active = false;
+    rtc_reminders.sent[sensor] = 0;
+    rtc_reminders.open_ms[sensor] = 0;
+    rtc_reminders.next_ms[sensor] = 0;
+    portEXIT_CRITICAL(&reminder_lock);
+    rearm();
+}
+
+void door_reminder_set_base(size_t sensor, uint32_t base_ms)
+{
+    int64_t local_ms = local_time_of_day_ms();
+
+    if (sensor >= DOOR_MAX_SENSORS)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&reminder_lock);
+    slots[sensor].base_ms = base_ms;
+    if (slots[sensor].active)
+    {
+        // The current step starts over at the new rate
+        schedule_next(sensor, esp_timer_get_time(), local_ms);
+    }
+    portEXIT_CRITICAL(&reminder_lock);
+    rearm();
+}
+
+uint32_t door_reminder_next_ms(size_t sensor)
+{
+    int64_t remaining_ms = 0;
+
+    if (sensor >= DOOR_MAX_SENSORS)
+    {
+        return 0;
+    }
+
+    portENTER_CRITICAL(&reminder_lock);
+    if (slots[sensor].active && slots[sensor].due_us != REMINDER_POLICY_NONE)
+    {
+        remaining_ms = (slots[sensor].due_us - esp_timer_get_time()) / 1000;
+        remaining_ms = (remaining_ms > 0) ? remaining_ms : 1;
+    }
+    portEXIT_CRITICAL(&reminder_lock);
+    return (uint32_t)remaining_ms;
+}
+
+void door_reminder_note_publish(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    bool due_soon = false;
+
+    if (wheel_timer == NULL)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&reminder_lock);
+    for (size_t i = 0; i < DOOR_MAX_SENSORS && !due_soon; i++)
+    {
+        due_soon = slots[i].active && slots[i].due_us != REMINDER_POLICY_NONE &&
+                   slots[i].due_us <= now_us + coalesce_window_us(&slots[i]);
+    }
+    portEXIT_CRITICAL(&reminder_lock);
+
+    if (due_soon)
+    {
+        xTimerChangePeriod(wheel_timer, 1, 0);
+    }
+}
+
+esp_err_t init_door_reminder(door_reminder_fn_t fire)
+{
+    setenv("TZ", REMINDER_TIMEZONE, 1);
+    tzset();
+
+    fire_reminder = fire;
+    wheel_timer = RTOS_TIMER_CREATE(reminder_wheel, 0, "DoorReminder", 1, pdFALSE, NULL, wheel_timer_callback);
+    if (wheel_timer == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create reminder timer");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
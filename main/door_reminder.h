@@ -0,0 +1,31 @@
+#ifndef DOOR_REMINDER_H
+#define DOOR_REMINDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Door-still-open reminders for every sensor on one shared timer, on the
+// backoff curve, cap and quiet hours of reminder_config.h.
+
+// Called from the FreeRTOS timer service task when a reminder is due
+typedef void (*door_reminder_fn_t)(size_t sensor, uint32_t open_ms);
+
+esp_err_t init_door_reminder(door_reminder_fn_t fire);
+
+// The door opened; reminders every base_ms along the curve, none for 0
+void door_reminder_start(size_t sensor, uint32_t base_ms);
+void door_reminder_stop(size_t sensor);
+void door_reminder_set_base(size_t sensor, uint32_t base_ms);
+
+// Picks up the curve where it was before deep sleep for a door that stayed
+// open, with its next reminder due_in_ms from now (INT64_MAX for none).
+void door_reminder_resume(size_t sensor, uint32_t base_ms, int64_t due_in_ms);
+
+// Time until the next reminder of a sensor, 0 if none is scheduled
+uint32_t door_reminder_next_ms(size_t sensor);
+
+// Something is being published anyway; reminders due soon go out with it
+void door_reminder_note_publish(void);
+
+#endif // DOOR_REMINDER_H
@@ -0,0 +1,290 @@
+#include <string.h>
+#include <sys/time.h>
+#include "door_sleep.h"
+#include "sleep_config.h"
+#include "door_config.h"
+#include "clock_sync_config.h"
+#include "door_journal.h"
+#include "mqtt_outbox.h"
+#include "mqtt_inflight.h"
+#include "ota_stream.h"
+#include "driver/rtc_io.h"
+#include "esp_sleep.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "gecl-wifi-manager.h"
+
+static const char *TAG = "DOOR_SLEEP";
+
+_Static_assert(SLEEP_POLICY_MAX_SENSORS >= DOOR_MAX_SENSORS, "sleep policy must cover every door sensor");
+_Static_assert(!SLEEP_MODE_ENABLED || SLEEP_IS_RTC_GPIO(BUTTON_GPIO),
+               "deep sleep needs the mailbox sensor on an RTC GPIO, see sleep_config.h");
+
+// RTC slow memory survives deep sleep; the policy magic tells a wake from a power-on
+static RTC_DATA_ATTR sleep_policy_state_t rtc_policy;
+static RTC_DATA_ATTR door_sleep_timing_t rtc_last_timing;
+static RTC_DATA_ATTR uint32_t rtc_wakes;
+
+static door_sleep_timing_t timing;
+static bool sleep_enabled = false;
+static bool woke_from_sleep = false;
+static portMUX_TYPE sleep_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// System time keeps running in deep sleep, unlike esp_timer
+static int64_t sleep_clock_us(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static bool sensor_pins_can_wake(void)
+{
+    door_sensor_config_t config;
+    door_state_t state;
+
+    for (size_t i = 0; door_handler_get_sensor(i, &config, &state); i++)
+    {
+        if (!rtc_gpio_is_valid_gpio(config.gpio))
+        {
+            ESP_LOGE(TAG, "GPIO %d of %s cannot wake from deep sleep, staying awake", config.gpio, config.name);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool door_sleep_enabled(void)
+{
+    return sleep_enabled;
+}
+
+bool door_sleep_woke_from_sleep(void)
+{
+    return woke_from_sleep;
+}
+
+bool door_sleep_needs_time_sync(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return !woke_from_sleep || tv.tv_sec < CLOCK_SYNC_MIN_VALID_EPOCH || rtc_wakes % SLEEP_TIME_RESYNC_WAKES == 0;
+}
+
+void door_sleep_mark_phase(door_sleep_phase_t phase)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&sleep_lock);
+    if (timing.phase_us[phase] == 0)
+    {
+        timing.phase_us[phase] = now_us;
+    }
+    portEXIT_CRITICAL(&sleep_lock);
+}
+
+sleep_action_t door_sleep_boot_action(size_t sensor, door_state_t state)
+{
+    if (!sleep_enabled)
+    {
+        return SLEEP_ACTION_TRANSITION;
+    }
+
+    if (!sleep_policy_valid(&rtc_policy, door_handler_sensor_count()))
+    {
+        sleep_policy_reset(&rtc_policy, door_handler_sensor_count());
+    }
+    return sleep_policy_on_wake(&rtc_policy, sensor, (uint8_t)state, sleep_clock_us());
+}
+
+void door_sleep_note_published(size_t sensor, door_state_t state, uint32_t next_reminder_ms)
+{
+    if (sleep_enabled)
+    {
+        sleep_policy_reported(&rtc_policy, sensor, (uint8_t)state, next_reminder_ms, sleep_clock_us());
+    }
+}
+
+int64_t door_sleep_reminder_due_in_ms(size_t sensor)
+{
+    if (!sleep_enabled || sensor >= rtc_policy.sensor_count ||
+        rtc_policy.next_reminder_us[sensor] == SLEEP_POLICY_NO_WAKE)
+    {
+        return INT64_MAX;
+    }
+    return (rtc_policy.next_reminder_us[sensor] - sleep_clock_us()) / 1000;
+}
+
+static void track_phases(void)
+{
+    mqtt_outbox_stats_t outbox;
+    mqtt_inflight_stats_t inflight;
+
+    if (wifi_active())
+    {
+        door_sleep_mark_phase(SLEEP_PHASE_WIFI_UP);
+    }
+    mqtt_outbox_get_stats(&outbox);
+    if (outbox.sent > 0)
+    {
+        door_sleep_mark_phase(SLEEP_PHASE_PUBLISHED);
+    }
+    mqtt_inflight_get_stats(&inflight);
+    if (inflight.acked > 0)
+    {
+        door_sleep_mark_phase(SLEEP_PHASE_PUBACK);
+    }
+}
+
+static bool ready_to_sleep(int64_t now_us, bool *timed_out)
+{
+    mqtt_outbox_stats_t outbox;
+    mqtt_inflight_stats_t inflight;
+
+    *timed_out = false;
+    if (now_us < (int64_t)SLEEP_MIN_AWAKE_MS * 1000 || !door_handler_settled() || ota_stream_running())
+    {
+        return false;
+    }
+
+    mqtt_outbox_get_stats(&outbox);
+    mqtt_inflight_get_stats(&inflight);
+    if (outbox.depth == 0 && inflight.in_flight == 0 && !door_journal_replay_needed())
+    {
+        return true;
+    }
+
+    *timed_out = now_us >= (int64_t)SLEEP_PUBLISH_TIMEOUT_MS * 1000;
+    return *timed_out;
+}
+
+// ext1 can only wake on "any pin high" or "all pins low", so closed doors
+// (low) share ext1 and the first open door gets ext0. Further open doors are
+// covered by their reminder timer wake.
+static void arm_wake_sources(void)
+{
+    door_sensor_config_t config;
+    door_state_t state;
+    uint64_t ext1_mask = 0;
+    bool ext0_used = false;
+
+    esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
+
+    for (size_t i = 0; door_handler_get_sensor(i, &config, &state); i++)
+    {
+        rtc_gpio_pullup_en(config.gpio);
+        rtc_gpio_pulldown_dis(config.gpio);
+
+        if (gpio_get_level(config.gpio) == 0)
+        {
+            ext1_mask |= 1ULL << config.gpio;
+        }
+        else if (!ext0_used)
+        {
+            esp_sleep_enable_ext0_wakeup(config.gpio, 0);
+            ext0_used = true;
+        }
+        else
+        {
+            ESP_LOGW(TAG, "%s only wakes on its reminder", config.name);
+        }
+    }
+
+    if (ext1_mask != 0)
+    {
+        esp_sleep_enable_ext1_wakeup(ext1_mask, ESP_EXT1_WAKEUP_ANY_HIGH);
+    }
+
+    int64_t next_us = sleep_policy_next_wake_us(&rtc_policy);
+    if (next_us != SLEEP_POLICY_NO_WAKE)
+    {
+        int64_t delay_us = next_us - sleep_clock_us();
+        esp_sleep_enable_timer_wakeup(delay_us > 1000000 ? (uint64_t)delay_us : 1000000);
+    }
+}
+
+void door_sleep_maybe_sleep(void)
+{
+    bool timed_out;
+
+    if (!sleep_enabled)
+    {
+        return;
+    }
+
+    track_phases();
+    if (!ready_to_sleep(esp_timer_get_time(), &timed_out))
+    {
+        return;
+    }
+
+    door_sleep_mark_phase(SLEEP_PHASE_SLEEP);
+    portENTER_CRITICAL(&sleep_lock);
+    timing.wakes = rtc_wakes;
+    timing.publish_timeouts = rtc_last_timing.publish_timeouts + (timed_out ? 1 : 0);
+    rtc_last_timing = timing;
+    portEXIT_CRITICAL(&sleep_lock);
+
+    ESP_LOGI(TAG, "Wake %lu: Wi-Fi %lld ms, MQTT %lld ms, publish %lld ms, PUBACK %lld ms, sleep at %lld ms",
+             (unsigned long)timing.wakes, (long long)(timing.phase_us[SLEEP_PHASE_WIFI_UP] / 1000),
+             (long long)(timing.phase_us[SLEEP_PHASE_MQTT_CONNECTED] / 1000),
+             (long long)(timing.phase_us[SLEEP_PHASE_PUBLISHED] / 1000),
+             (long long)(timing.phase_us[SLEEP_PHASE_PUBACK] / 1000),
+             (long long)(timing.phase_us[SLEEP_PHASE_SLEEP] / 1000));
+    if (timed_out)
+    {
+        ESP_LOGW(TAG, "Sleeping with undelivered events; the journal replays them on the next wake");
+    }
+
+    // Batched journal records live in RAM, which deep sleep does not keep
+    door_journal_flush();
+    arm_wake_sources();
+    esp_deep_sleep_start();
+}
+
+void door_sleep_get_last_timing(door_sleep_timing_t *timing_out)
+{
+    portENTER_CRITICAL(&sleep_lock);
+    *timing_out = rtc_last_timing;
+    portEXIT_CRITICAL(&sleep_lock);
+}
+
+esp_err_t init_door_sleep(void)
+{
+    esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+
+    memset(&timing, 0, sizeof(timing));
+    timing.wake_cause = (int)cause;
+    door_sleep_mark_phase(SLEEP_PHASE_APP_START);
+
+    woke_from_sleep = cause == ESP_SLEEP_WAKEUP_EXT0 || cause == ESP_SLEEP_WAKEUP_EXT1 ||
+                      cause == ESP_SLEEP_WAKEUP_TIMER;
+    if (!woke_from_sleep)
+    {
+        memset(&rtc_last_timing, 0, sizeof(rtc_last_timing));
+        rtc_wakes = 0;
+        rtc_policy.magic = 0;
+    }
+    rtc_wakes++;
+
+    // The RTC pins were handed to the RTC domain for the wake; give them back
+    door_sensor_config_t config;
+    door_state_t state;
+    for (size_t i = 0; door_handler_get_sensor(i, &config, &state); i++)
+    {
+        if (rtc_gpio_is_valid_gpio(config.gpio))
+        {
+            rtc_gpio_deinit(config.gpio);
+        }
+    }
+
+    sleep_enabled = SLEEP_MODE_ENABLED && sensor_pins_can_wake();
+    if (sleep_enabled)
+    {
+        ESP_LOGI(TAG, "Deep-sleep mode, wake cause %d", (int)cause);
+    }
+    return ESP_OK;
+}
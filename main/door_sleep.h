@@ -0,0 +1,56 @@
+#ifndef DOOR_SLEEP_H
+#define DOOR_SLEEP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "door_handler.h"
+#include "door_sleep_policy.h"
+
+typedef enum
+{
+    SLEEP_PHASE_APP_START,
+    SLEEP_PHASE_WIFI_UP,
+    SLEEP_PHASE_MQTT_CONNECTED,
+    SLEEP_PHASE_PUBLISHED, // First message handed to esp-mqtt
+    SLEEP_PHASE_PUBACK,    // First PUBACK
+    SLEEP_PHASE_SLEEP,
+    SLEEP_PHASE_COUNT
+} door_sleep_phase_t;
+
+typedef struct
+{
+    uint32_t wakes;
+    uint32_t publish_timeouts;            // Wakes that went back to sleep with PUBACKs outstanding
+    int wake_cause;                       // esp_sleep_wakeup_cause_t of the last wake
+    int64_t phase_us[SLEEP_PHASE_COUNT]; // Since boot, 0 if the phase was not reached
+} door_sleep_timing_t;
+
+// Reads the wake cause and restores the state kept in RTC memory. Call first.
+esp_err_t init_door_sleep(void);
+
+bool door_sleep_enabled(void);
+bool door_sleep_woke_from_sleep(void);
+bool door_sleep_needs_time_sync(void);
+
+// Records when a boot phase was first reached.
+void door_sleep_mark_phase(door_sleep_phase_t phase);
+
+// What door_handler should publish for a sensor's state found at boot. Always
+// a transition when sleep mode is off.
+sleep_action_t door_sleep_boot_action(size_t sensor, door_state_t state);
+// next_reminder_ms is when the timer wake for a door left open is due, 0 for none
+void door_sleep_note_published(size_t sensor, door_state_t state, uint32_t next_reminder_ms);
+
+// Time until the reminder a wake was armed for, INT64_MAX if none
+int64_t door_sleep_reminder_due_in_ms(size_t sensor);
+
+// Polled from app_main. Enters deep sleep once the doors have settled and
+// everything is delivered, armed to wake on any door pin or the next reminder.
+void door_sleep_maybe_sleep(void);
+
+// Timing of the previous wake, which is complete once the device went to sleep.
+void door_sleep_get_last_timing(door_sleep_timing_t *timing);
+
+#endif // DOOR_SLEEP_H
@@ -0,0 +1,71 @@
+#include <string.h>
+#include "door_sleep_policy.h"
+
+#define SLEEP_POLICY_MAGIC 0x534C5031 // "SLP1"
+#define SLEEP_POLICY_UNREPORTED 0xFF
+#define SLEEP_POLICY_EARLY_US 500000   // A timer wake may fire slightly before the reminder is due
+
+void sleep_policy_reset(sleep_policy_state_t *st, size_t sensor_count)
+{
+    memset(st, 0, sizeof(*st));
+    st->magic = SLEEP_POLICY_MAGIC;
+    st->sensor_count = (uint8_t)sensor_count;
+    for (size_t i = 0; i < SLEEP_POLICY_MAX_SENSORS; i++)
+    {
+        st->reported_state[i] = SLEEP_POLICY_UNREPORTED;
+        st->next_reminder_us[i] = SLEEP_POLICY_NO_WAKE;
+    }
+}
+
+bool sleep_policy_valid(const sleep_policy_state_t *st, size_t sensor_count)
+{
+    return st->magic == SLEEP_POLICY_MAGIC && st->sensor_count == sensor_count;
+}
+
+sleep_action_t sleep_policy_on_wake(const sleep_policy_state_t *st, size_t sensor, uint8_t state, int64_t now_us)
+{
+    if (sensor >= st->sensor_count)
+    {
+        return SLEEP_ACTION_NONE;
+    }
+
+    if (st->reported_state[sensor] != state)
+    {
+        return SLEEP_ACTION_TRANSITION;
+    }
+
+    if (state && st->next_reminder_us[sensor] != SLEEP_POLICY_NO_WAKE &&
+        now_us + SLEEP_POLICY_EARLY_US >= st->next_reminder_us[sensor])
+    {
+        return SLEEP_ACTION_REMINDER;
+    }
+
+    return SLEEP_ACTION_NONE;
+}
+
+void sleep_policy_reported(sleep_policy_state_t *st, size_t sensor, uint8_t state, uint32_t reminder_ms,
+                           int64_t now_us)
+{
+    if (sensor >= st->sensor_count)
+    {
+        return;
+    }
+
+    st->reported_state[sensor] = state;
+    st->next_reminder_us[sensor] =
+        (state && reminder_ms > 0) ? now_us + (int64_t)reminder_ms * 1000 : SLEEP_POLICY_NO_WAKE;
+}
+
+int64_t sleep_policy_next_wake_us(const sleep_policy_state_t *st)
+{
+    int64_t next_us = SLEEP_POLICY_NO_WAKE;
+
+    for (size_t i = 0; i < st->sensor_count; i++)
+    {
+        if (st->next_reminder_us[i] < next_us)
+        {
+            next_us = st->next_reminder_us[i];
+        }
+    }
+    return next_us;
+}
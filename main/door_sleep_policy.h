@@ -0,0 +1,42 @@
+#ifndef DOOR_SLEEP_POLICY_H
+#define DOOR_SLEEP_POLICY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sleep_config.h"
+
+#define SLEEP_POLICY_NO_WAKE INT64_MAX
+
+typedef enum
+{
+    SLEEP_ACTION_NONE,       // Already reported, nothing due
+    SLEEP_ACTION_TRANSITION, // State differs from the last one published
+    SLEEP_ACTION_REMINDER    // Still open and the reminder is due
+} sleep_action_t;
+
+// What the device remembers across deep sleep. Pure data with no RTOS or
+// driver dependencies, times on a clock that keeps running while asleep.
+typedef struct
+{
+    uint32_t magic;
+    uint8_t sensor_count;
+    uint8_t reported_state[SLEEP_POLICY_MAX_SENSORS];
+    int64_t next_reminder_us[SLEEP_POLICY_MAX_SENSORS];
+} sleep_policy_state_t;
+
+// Forgets everything reported so the first wake publishes every sensor.
+void sleep_policy_reset(sleep_policy_state_t *st, size_t sensor_count);
+bool sleep_policy_valid(const sleep_policy_state_t *st, size_t sensor_count);
+
+// Decides what a wake has to publish for a sensor found in state (1 = open).
+sleep_action_t sleep_policy_on_wake(const sleep_policy_state_t *st, size_t sensor, uint8_t state, int64_t now_us);
+
+// Records a publish and schedules the next reminder while the door stays open.
+void sleep_policy_reported(sleep_policy_state_t *st, size_t sensor, uint8_t state, uint32_t reminder_ms,
+                           int64_t now_us);
+
+// Earliest reminder due, SLEEP_POLICY_NO_WAKE if no door is open.
+int64_t sleep_policy_next_wake_us(const sleep_policy_state_t *st);
+
+#endif // DOOR_SLEEP_POLICY_H
@@ -0,0 +1,290 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "door_trace.h"
+#include "door_trace_config.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "DOOR_TRACE";
+
+void door_trace_capture(const door_edge_event_t *evt)
+{
+#if DOOR_TRACE_CAPTURE
+    ESP_LOGI(TAG, "TRACE,%lld,%d,%lu", (long long)evt->timestamp_us, evt->level, (unsigned long)evt->sensor);
+#endif
+}
+
+#if DOOR_TRACE_REPLAY
+
+#define DOOR_TRACE_DRAIN_POLL_MS 50
+
+typedef struct
+{
+    int64_t offset_us; // From the start of the replay, after gap compression
+    uint8_t sensor;
+    uint8_t level;
+} trace_edge_t;
+
+extern const char door_trace_csv_start[] asm("_binary_door_trace_csv_start");
+
+static trace_edge_t trace_edges[DOOR_TRACE_MAX_EDGES];
+static size_t trace_edge_count = 0;
+static int64_t trace_span_us = 0; // Duration of the trace as recorded
+static uint8_t expected[DOOR_TRACE_MAX_EXPECTED];
+static size_t expected_count = 0;
+
+static uint8_t observed[DOOR_TRACE_MAX_EXPECTED];
+static size_t observed_count = 0;
+static uint32_t latencies_us[DOOR_TRACE_LATENCY_SAMPLES];
+static size_t latency_count = 0;
+static size_t published_count = 0;
+static int64_t last_publish_us = 0;
+
+static size_t next_edge = 0;
+static int64_t replay_start_us = 0;
+static int64_t replay_end_us = 0; // Time the last edge was injected
+static volatile bool replaying = false;
+static esp_timer_handle_t replay_timer = NULL;
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void parse_expect(const char *p)
+{
+    while (*p != '\0' && *p != '\n' && expected_count < DOOR_TRACE_MAX_EXPECTED)
+    {
+        while (*p == ' ' || *p == '\t' || *p == ',')
+        {
+            p++;
+        }
+        if (strncmp(p, "open", 4) == 0)
+        {
+            expected[expected_count++] = DOOR_STATE_OPEN;
+            p += 4;
+        }
+        else if (strncmp(p, "closed", 6) == 0)
+        {
+            expected[expected_count++] = DOOR_STATE_CLOSED;
+            p += 6;
+        }
+        else if (*p != '\0' && *p != '\n' && *p != '\r')
+        {
+            p++;
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+static esp_err_t parse_trace(const char *csv)
+{
+    int64_t first_us = 0;
+    int64_t prev_us = 0;
+    int64_t offset_us = 0;
+
+    for (const char *line = csv; *line != '\0';)
+    {
+        const char *next = strchr(line, '\n');
+        next = (next != NULL) ? next + 1 : line + strlen(line);
+
+        if (strncmp(line, "# expect:", 9) == 0)
+        {
+            parse_expect(line + 9);
+        }
+        else if ((*line >= '0' && *line <= '9') || *line == '-')
+        {
+            char *end;
+            int64_t timestamp_us = strtoll(line, &end, 10);
+            long level = (*end == ',') ? strtol(end + 1, &end, 10) : -1;
+            long sensor = (*end == ',') ? strtol(end + 1, &end, 10) : 0;
+
+            if ((level != 0 && level != 1) || sensor < 0 || sensor >= (long)door_handler_sensor_count())
+            {
+                ESP_LOGE(TAG, "Bad trace row: %.*s", (int)(next - line), line);
+                return ESP_ERR_INVALID_ARG;
+            }
+            if (trace_edge_count == DOOR_TRACE_MAX_EDGES)
+            {
+                ESP_LOGW(TAG, "Trace truncated to %d edges", DOOR_TRACE_MAX_EDGES);
+                break;
+            }
+            if (trace_edge_count == 0)
+            {
+                first_us = prev_us = timestamp_us;
+            }
+            if (timestamp_us < prev_us)
+            {
+                ESP_LOGE(TAG, "Trace timestamps go backwards at %lld", (long long)timestamp_us);
+                return ESP_ERR_INVALID_ARG;
+            }
+
+            int64_t gap_us = timestamp_us - prev_us;
+            offset_us += (gap_us < (int64_t)DOOR_TRACE_MAX_GAP_MS * 1000) ? gap_us : (int64_t)DOOR_TRACE_MAX_GAP_MS * 1000;
+            trace_edges[trace_edge_count++] =
+                (trace_edge_t){.offset_us = offset_us, .sensor = (uint8_t)sensor, .level = (uint8_t)level};
+            trace_span_us = timestamp_us - first_us;
+            prev_us = timestamp_us;
+        }
+        line = next;
+    }
+
+    return trace_edge_count > 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+void door_trace_note_transition(size_t sensor, door_state_t state)
+{
+    if (!replaying)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&trace_lock);
+    if (observed_count < DOOR_TRACE_MAX_EXPECTED)
+    {
+        observed[observed_count] = (uint8_t)state;
+    }
+    observed_count++;
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+void door_trace_note_published(int64_t origin_us, size_t events)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    if (!replaying)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&trace_lock);
+    if (latency_count < DOOR_TRACE_LATENCY_SAMPLES)
+    {
+        latencies_us[latency_count++] = (uint32_t)(now_us - origin_us);
+    }
+    published_count += events;
+    last_publish_us = now_us;
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile_us(unsigned pct)
+{
+    return latency_count ? latencies_us[(latency_count - 1) * pct / 100] : 0;
+}
+
+static void report_replay(void)
+{
+    int64_t replay_us = replay_end_us - replay_start_us;
+    int64_t pipeline_us = (last_publish_us > replay_start_us ? last_publish_us : replay_end_us) - replay_start_us;
+    bool match = observed_count == expected_count &&
+                 memcmp(observed, expected, expected_count < DOOR_TRACE_MAX_EXPECTED ? expected_count
+                                                                                     : DOOR_TRACE_MAX_EXPECTED) == 0;
+
+    qsort(latencies_us, latency_count, sizeof(latencies_us[0]), compare_u32);
+
+    ESP_LOGI(TAG, "Replayed %u edges of a %lld ms trace in %lld ms (%.1fx real time)", (unsigned)trace_edge_count,
+             (long long)(trace_span_us / 1000), (long long)(replay_us / 1000),
+             replay_us > 0 ? (double)trace_span_us / (double)replay_us : 0.0);
+    ESP_LOGI(TAG, "%u transitions, %u published, %.1f edges/s in, %.1f events/s published", (unsigned)observed_count,
+             (unsigned)published_count, replay_us > 0 ? trace_edge_count * 1e6 / (double)replay_us : 0.0,
+             pipeline_us > 0 ? published_count * 1e6 / (double)pipeline_us : 0.0);
+    ESP_LOGI(TAG, "Edge-to-publish latency over %u publishes: p50 %lu us, p90 %lu us, p99 %lu us, max %lu us",
+             (unsigned)latency_count, (unsigned long)percentile_us(50), (unsigned long)percentile_us(90),
+             (unsigned long)percentile_us(99), (unsigned long)percentile_us(100));
+
+    if (expected_count == 0)
+    {
+        ESP_LOGW(TAG, "Trace has no '# expect:' line, transitions not checked");
+    }
+    else if (match)
+    {
+        ESP_LOGI(TAG, "PASS: %u transitions as expected", (unsigned)expected_count);
+    }
+    else
+    {
+        ESP_LOGE(TAG, "FAIL: expected %u transitions, got %u", (unsigned)expected_count, (unsigned)observed_count);
+        for (size_t i = 0; i < observed_count && i < DOOR_TRACE_MAX_EXPECTED; i++)
+        {
+            ESP_LOGE(TAG, "  #%u %s%s", (unsigned)i, observed[i] ? "open" : "closed",
+                     (i < expected_count && observed[i] != expected[i]) ? " (mismatch)" : "");
+        }
+    }
+}
+
+static void replay_timer_callback(void *arg)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    if (next_edge < trace_edge_count)
+    {
+        while (next_edge < trace_edge_count && replay_start_us + trace_edges[next_edge].offset_us <= now_us)
+        {
+            door_handler_inject_edge(trace_edges[next_edge].sensor, trace_edges[next_edge].level);
+            next_edge++;
+        }
+        if (next_edge < trace_edge_count)
+        {
+            esp_timer_start_once(replay_timer, replay_start_us + trace_edges[next_edge].offset_us - now_us);
+            return;
+        }
+        replay_end_us = now_us;
+    }
+
+    // Drain: every edge injected, wait for debouncing and publishing to finish
+    bool drained = door_handler_settled() && published_count >= observed_count;
+    if (!drained && now_us - replay_end_us < (int64_t)DOOR_TRACE_DRAIN_TIMEOUT_MS * 1000)
+    {
+        esp_timer_start_once(replay_timer, (uint64_t)DOOR_TRACE_DRAIN_POLL_MS * 1000);
+        return;
+    }
+
+    replaying = false;
+    report_replay();
+}
+
+esp_err_t door_trace_start_replay(void)
+{
+    const esp_timer_create_args_t timer_args = {.callback = replay_timer_callback, .name = "door_trace"};
+
+    esp_err_t err = parse_trace(door_trace_csv_start);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "No usable edges in the embedded trace");
+        return err;
+    }
+
+    if (esp_timer_create(&timer_args, &replay_timer) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to create replay timer");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Replaying %u edges, %u expected transitions", (unsigned)trace_edge_count, (unsigned)expected_count);
+    replaying = true;
+    replay_start_us = esp_timer_get_time() + (int64_t)DOOR_TRACE_START_DELAY_MS * 1000;
+    esp_timer_start_once(replay_timer, (uint64_t)DOOR_TRACE_START_DELAY_MS * 1000);
+    return ESP_OK;
+}
+
+#else
+
+void door_trace_note_transition(size_t sensor, door_state_t state)
+{
+}
+
+void door_trace_note_published(int64_t origin_us, size_t events)
+{
+}
+
+esp_err_t door_trace_start_replay(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
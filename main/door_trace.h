@@ -0,0 +1,27 @@
+#ifndef DOOR_TRACE_H
+#define DOOR_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "door_handler.h"
+
+// Edge trace capture and on-device replay, see door_trace_config.h. The hooks
+// below do nothing unless capture or replay is compiled in.
+//
+// A trace is CSV: one "timestamp_us,level[,sensor]" row per edge, timestamps
+// relative to any origin. A "# expect: open closed ..." line lists the door
+// transitions the trace must produce; other lines starting with '#' and a
+// header row are ignored. tools/trace/replay_trace.py runs the same traces
+// through door_debounce.c on the host.
+
+void door_trace_capture(const door_edge_event_t *evt);
+void door_trace_note_transition(size_t sensor, door_state_t state);
+void door_trace_note_published(int64_t origin_us, size_t events);
+
+// Replays the trace embedded with DOOR_TRACE_FILE through the door pipeline,
+// from the GPIO event queue to publish, then logs whether the expected transitions came
+// out, the throughput, and edge-to-publish latency percentiles.
+esp_err_t door_trace_start_replay(void);
+
+#endif // DOOR_TRACE_H
@@ -0,0 +1,20 @@
+#ifndef DOOR_TRACE_CONFIG_H
+#define DOOR_TRACE_CONFIG_H
+
+// Logs every raw edge as "TRACE,<timestamp_us>,<level>,<sensor>", the CSV
+// format a replay trace is written in
+#define DOOR_TRACE_CAPTURE 0
+
+// DOOR_TRACE_REPLAY is set by `idf.py -DDOOR_TRACE_FILE=<csv> build`
+#ifndef DOOR_TRACE_REPLAY
+#define DOOR_TRACE_REPLAY 0
+#endif
+
+#define DOOR_TRACE_START_DELAY_MS 10000 // Lets MQTT connect so latency is not connection setup
+#define DOOR_TRACE_MAX_EDGES 512
+#define DOOR_TRACE_MAX_GAP_MS 2000      // Longer idle gaps in a replayed trace are cut to this
+#define DOOR_TRACE_LATENCY_SAMPLES 128  // Edge-to-publish latencies kept for the percentiles
+#define DOOR_TRACE_MAX_EXPECTED 64
+#define DOOR_TRACE_DRAIN_TIMEOUT_MS 10000 // After the last edge, wait this long for the pipeline to empty
+
+#endif // DOOR_TRACE_CONFIG_H
@@ -0,0 +1,16 @@
+#ifndef INFLIGHT_CONFIG_H
+#define INFLIGHT_CONFIG_H
+
+#define INFLIGHT_MAX_MSGS 16            // QoS1 publishes awaiting PUBACK
+#define INFLIGHT_ACK_TIMEOUT_MS 15000
+#define INFLIGHT_EARLY_ACKS 4           // PUBACKs buffered while a publish returns its msg_id
+#define INFLIGHT_SWEEP_PERIOD_MS 1000
+#define INFLIGHT_DIAG_PERIOD_MS 300000
+#define INFLIGHT_DIAG_TOPIC CONFIG_MQTT_PUBLISH_DOOR_STATE_TOPIC "/diagnostics"
+
+// Upper bounds of the publish-to-PUBACK histogram buckets. One extra bucket
+// collects everything slower than the last bound.
+#define INFLIGHT_RTT_BUCKET_LIMITS_MS {50, 100, 250, 500, 1000, 2500, 5000, 10000}
+#define INFLIGHT_RTT_BUCKETS 9
+
+#endif // INFLIGHT_CONFIG_H
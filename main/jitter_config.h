@@ -0,0 +1,30 @@
+#ifndef JITTER_CONFIG_H
+#define JITTER_CONFIG_H
+
+#include "core_config.h"
+
+// DOOR_JITTER_PROFILE is set by `idf.py -DDOOR_JITTER_PROFILE=ON build`. A
+// hardware timer then fires a probe interrupt every DOOR_JITTER_PROBE_PERIOD_US
+// that queues an event to door_task like a GPIO edge, and the wake latency of
+// probes and real edges is logged as a histogram per report period. Periods
+// alternate between idle and synthetic load, so the two can be compared; to
+// compare placements, rebuild with a different DOOR_TASK_CORE.
+#ifndef DOOR_JITTER_PROFILE
+#define DOOR_JITTER_PROFILE 0
+#endif
+
+#define DOOR_JITTER_PROBE_PERIOD_US 10000
+#define DOOR_JITTER_REPORT_PERIOD_MS 30000
+#define DOOR_JITTER_BUCKETS 17 // Powers of two from 1 us; the last one takes 64 ms and up
+
+// Synthetic network load: publishes through the outbox, which TLS encrypts,
+// and SHA-256 over a buffer as a stand-in for handshake and record crypto
+#define DOOR_JITTER_LOAD_TOPIC CONFIG_MQTT_PUBLISH_DOOR_STATE_TOPIC "/jitter"
+#define DOOR_JITTER_LOAD_PUBLISH_MS 20
+#define DOOR_JITTER_LOAD_PAYLOAD_LEN 200
+#define DOOR_JITTER_LOAD_HASH_LEN 4096 // Hashed between publishes
+#define DOOR_JITTER_LOAD_TASK_STACK_SIZE 3072
+#define DOOR_JITTER_LOAD_TASK_PRIORITY 5
+#define DOOR_JITTER_LOAD_TASK_CORE CORE_NETWORK
+
+#endif // JITTER_CONFIG_H
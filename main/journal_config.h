@@ -0,0 +1,15 @@
+#ifndef JOURNAL_CONFIG_H
+#define JOURNAL_CONFIG_H
+
+#include "core_config.h"
+
+#define JOURNAL_PARTITION_LABEL "journal"
+#define JOURNAL_PARTITION_SUBTYPE 0x40
+#define JOURNAL_WRITE_BATCH 8          // Records buffered in RAM per flash program
+#define JOURNAL_FLUSH_DELAY_MS 2000    // Upper bound on how long a record stays in RAM
+#define JOURNAL_REPLAY_BATCH 8
+#define JOURNAL_TASK_STACK_SIZE 2560   // Timed flushes run here, off the esp_timer task
+#define JOURNAL_TASK_PRIORITY 4
+#define JOURNAL_TASK_CORE CORE_NETWORK
+
+#endif // JOURNAL_CONFIG_H
@@ -18,34 +18,164 @@
 #include "unity.h"
 #include "sdkconfig.h"
 #include "door_handler.h"
+#include "mqtt_outbox.h"
+#include "door_payload.h"
+#include "door_journal.h"
+#include "ota_stream.h"
+#include "door_sleep.h"
+#include "sleep_config.h"
+#include "boot_pipeline.h"
+#include "clock_sync.h"
+#include "metrics.h"
+#include "door_trace.h"
+#include "door_trace_config.h"
+#include "settings.h"
 #include "driver/gpio.h"
 #include "freertos/FreeRTOS.h"
 
 static const char *TAG = "MAILBOX";
 
-void app_main(void)
+enum
+{
+    STAGE_DOOR_SLEEP,
+    STAGE_NVS,
+    STAGE_SETTINGS,
+    STAGE_DOOR_JOURNAL,
+    STAGE_DOOR_PAYLOAD,
+    STAGE_CLOCK_SYNC,
+    STAGE_MQTT_OUTBOX,
+    STAGE_RGB_LED,
+    STAGE_DOOR_HANDLER,
+    STAGE_WIFI,
+    STAGE_TIME_SYNC,
+    STAGE_MQTT,
+    STAGE_OTA_STREAM,
+    STAGE_METRICS,
+    STAGE_COUNT
+};
+
+static void stage_door_sleep(void)
+{
+    init_door_sleep();
+}
+
+static void stage_nvs(void)
 {
-    ESP_LOGI(TAG, "Init NVS");
     init_nvs();
+}
 
-    ESP_LOGI(TAG, "Init WiFi");
-    init_wifi();
+static void stage_settings(void)
+{
+    init_settings();
+}
 
-    ESP_LOGI(TAG, "Init Time Sync");
-    init_time_sync();
+static void stage_door_journal(void)
+{
+    init_door_journal();
+}
 
-    ESP_LOGI(TAG, "Init MQTT");
-    init_custom_mqtt();
+static void stage_door_payload(void)
+{
+    init_door_payload();
+}
 
-    ESP_LOGI(TAG, "Init RGB LED");
+static void stage_clock_sync(void)
+{
+    init_clock_sync();
+}
+
+static void stage_mqtt_outbox(void)
+{
+    init_mqtt_outbox();
+}
+
+static void stage_rgb_led(void)
+{
     init_rgb_led();
+}
 
-    ESP_LOGI(TAG, "Init door handler");
+static void stage_door_handler(void)
+{
     init_door_handler();
+}
+
+static void stage_wifi(void)
+{
+    init_wifi();
+}
+
+static void stage_time_sync(void)
+{
+    // After a deep-sleep wake the RTC still has the time; don't wait for SNTP
+    if (door_sleep_needs_time_sync())
+    {
+        init_time_sync();
+    }
+}
+
+static void stage_mqtt(void)
+{
+    init_custom_mqtt();
+    mqtt_outbox_start();
+}
+
+static void stage_ota_stream(void)
+{
+    init_ota_stream();
+}
+
+static void stage_metrics(void)
+{
+    init_metrics();
+}
+
+// Door edges are captured as soon as the journal, outbox queue and LED are
+// up; they wait in the outbox while Wi-Fi, SNTP and TLS come up in parallel.
+// Events carry esp_timer stamps that clock_sync turns into UTC once SNTP has
+// run, so only certificate expiry checks make MQTT wait for the wall clock.
+#ifdef CONFIG_MBEDTLS_HAVE_TIME_DATE
+#define MQTT_CLOCK_DEPS BOOT_DEP(STAGE_TIME_SYNC)
+#else
+#define MQTT_CLOCK_DEPS 0
+#endif
+
+static const boot_stage_t boot_stages[STAGE_COUNT] = {
+    [STAGE_DOOR_SLEEP] = {"door_sleep", stage_door_sleep, 0},
+    [STAGE_NVS] = {"nvs", stage_nvs, 0},
+    [STAGE_SETTINGS] = {"settings", stage_settings, BOOT_DEP(STAGE_NVS)},
+    [STAGE_DOOR_JOURNAL] = {"door_journal", stage_door_journal, 0},
+    [STAGE_DOOR_PAYLOAD] = {"door_payload", stage_door_payload, 0},
+    [STAGE_CLOCK_SYNC] = {"clock_sync", stage_clock_sync, BOOT_DEP(STAGE_MQTT_OUTBOX)},
+    [STAGE_MQTT_OUTBOX] = {"mqtt_outbox", stage_mqtt_outbox, BOOT_DEP(STAGE_DOOR_JOURNAL)},
+    [STAGE_RGB_LED] = {"rgb_led", stage_rgb_led, 0},
+    [STAGE_DOOR_HANDLER] = {"door_handler", stage_door_handler,
+                            BOOT_DEP(STAGE_DOOR_SLEEP) | BOOT_DEP(STAGE_DOOR_JOURNAL) | BOOT_DEP(STAGE_DOOR_PAYLOAD) |
+                                BOOT_DEP(STAGE_MQTT_OUTBOX) | BOOT_DEP(STAGE_RGB_LED) | BOOT_DEP(STAGE_SETTINGS)},
+    [STAGE_WIFI] = {"wifi", stage_wifi, BOOT_DEP(STAGE_NVS)},
+    [STAGE_TIME_SYNC] = {"time_sync", stage_time_sync, BOOT_DEP(STAGE_WIFI) | BOOT_DEP(STAGE_DOOR_SLEEP)},
+    [STAGE_MQTT] = {"mqtt", stage_mqtt, MQTT_CLOCK_DEPS | BOOT_DEP(STAGE_WIFI) | BOOT_DEP(STAGE_MQTT_OUTBOX) |
+                                          BOOT_DEP(STAGE_SETTINGS)},
+    [STAGE_OTA_STREAM] = {"ota_stream", stage_ota_stream, BOOT_DEP(STAGE_NVS)},
+    [STAGE_METRICS] = {"metrics", stage_metrics, BOOT_DEP(STAGE_MQTT_OUTBOX)},
+};
+
+void app_main(void)
+{
+    ESP_LOGI(TAG, "Starting boot pipeline");
+    if (boot_pipeline_run(boot_stages, STAGE_COUNT) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Boot pipeline failed");
+    }
+
+#if DOOR_TRACE_REPLAY
+    door_trace_start_replay();
+#endif
 
     ESP_LOGI(TAG, "Entering infinite loop");
     while (true)
     {
-        vTaskDelay(pdMS_TO_TICKS(1000)); // Delay to allow other tasks to run
+        door_sleep_maybe_sleep();
+        // Delay to allow other tasks to run
+        vTaskDelay(pdMS_TO_TICKS(door_sleep_enabled() ? SLEEP_POLL_PERIOD_MS : 1000));
     }
 }
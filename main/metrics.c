@@ -0,0 +1,278 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "metrics.h"
+#include "metrics_config.h"
+#include "mqtt_outbox.h"
+#include "outbox_config.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "METRICS";
+
+static const char *const counter_names[METRIC_COUNTER_COUNT] = {
+    [METRIC_DOOR_ISR_EDGES] = "isr_edges",
+    [METRIC_DOOR_QUEUE_OVERFLOWS] = "q_overflow",
+    [METRIC_DOOR_DEBOUNCE_REJECTS] = "db_reject",
+    [METRIC_DOOR_EVENTS] = "door_events",
+    [METRIC_DOOR_SESSIONS] = "door_sessions",
+    [METRIC_DOOR_ENQUEUE_FAILURES] = "door_drop",
+    [METRIC_PUBLISH_RETRIES] = "pub_retry",
+    [METRIC_PUBLISH_FAILURES] = "pub_fail",
+    [METRIC_MQTT_CONNECTS] = "connects",
+    [METRIC_MQTT_DISCONNECTS] = "disconnects",
+    [METRIC_TLS_FULL_HANDSHAKES] = "tls_full",
+    [METRIC_TLS_RESUMED_HANDSHAKES] = "tls_resumed",
+    [METRIC_OTA_ATTEMPTS] = "ota_attempts",
+};
+
+static const char *const gauge_names[METRIC_GAUGE_COUNT] = {
+    [METRIC_MQTT_CONNECTED] = "mqtt_up",
+    [METRIC_HEAP_FREE] = "heap",
+    [METRIC_HEAP_MIN_FREE] = "heap_min",
+    [METRIC_WIFI_RSSI] = "rssi",
+};
+
+static const char *const histogram_names[METRIC_HISTOGRAM_COUNT] = {
+    [METRIC_HIST_EDGE_TO_PUBLISH_MS] = "edge_pub_ms",
+    [METRIC_HIST_RECONNECT_MS] = "reconnect_ms",
+    [METRIC_HIST_TLS_FULL_MS] = "tls_full_ms",
+    [METRIC_HIST_TLS_RESUMED_MS] = "tls_resumed_ms",
+};
+
+static const uint32_t bucket_limits_ms[METRICS_HIST_BUCKETS - 1] = METRICS_HIST_BUCKET_LIMITS_MS;
+
+typedef struct
+{
+    uint32_t counters[METRIC_COUNTER_COUNT];
+    int32_t gauges[METRIC_GAUGE_COUNT];
+    uint32_t histograms[METRIC_HISTOGRAM_COUNT][METRICS_HIST_BUCKETS];
+    uint32_t stacks[METRICS_MAX_TASKS];
+} metrics_snapshot_t;
+
+// A report in progress; split over several publishes if it outgrows one payload
+typedef struct
+{
+    char buf[OUTBOX_PAYLOAD_MAX_LEN];
+    size_t len;
+    size_t header_len;
+    size_t items;
+    bool failed;
+} metrics_writer_t;
+
+static DRAM_ATTR metrics_snapshot_t live;
+static metrics_snapshot_t reported; // Only used from the report timer
+static metrics_writer_t writer;     // Only used from the report timer
+static TaskHandle_t watched_tasks[METRICS_MAX_TASKS];
+static size_t watched_count = 0;
+static uint32_t report_seq = 0;
+static bool force_keyframe = true;
+static esp_timer_handle_t report_timer = NULL;
+static DRAM_ATTR portMUX_TYPE metrics_lock = portMUX_INITIALIZER_UNLOCKED;
+
+IRAM_ATTR void metrics_add(metric_counter_t counter, uint32_t n)
+{
+    portENTER_CRITICAL_SAFE(&metrics_lock);
+    live.counters[counter] += n;
+    portEXIT_CRITICAL_SAFE(&metrics_lock);
+}
+
+IRAM_ATTR void metrics_inc(metric_counter_t counter)
+{
+    metrics_add(counter, 1);
+}
+
+void metrics_gauge_set(metric_gauge_t gauge, int32_t value)
+{
+    portENTER_CRITICAL(&metrics_lock);
+    live.gauges[gauge] = value;
+    portEXIT_CRITICAL(&metrics_lock);
+}
+
+void metrics_observe_ms(metric_histogram_t histogram, uint32_t value_ms)
+{
+    size_t bucket = 0;
+
+    while (bucket < METRICS_HIST_BUCKETS - 1 && value_ms > bucket_limits_ms[bucket])
+    {
+        bucket++;
+    }
+
+    portENTER_CRITICAL(&metrics_lock);
+    live.histograms[histogram][bucket]++;
+    portEXIT_CRITICAL(&metrics_lock);
+}
+
+void metrics_watch_task(TaskHandle_t task)
+{
+    portENTER_CRITICAL(&metrics_lock);
+    if (task != NULL && watched_count < METRICS_MAX_TASKS)
+    {
+        watched_tasks[watched_count++] = task;
+    }
+    portEXIT_CRITICAL(&metrics_lock);
+}
+
+static void sample_system_gauges(void)
+{
+    wifi_ap_record_t ap;
+
+    metrics_gauge_set(METRIC_HEAP_FREE, (int32_t)esp_get_free_heap_size());
+    metrics_gauge_set(METRIC_HEAP_MIN_FREE, (int32_t)esp_get_minimum_free_heap_size());
+    metrics_gauge_set(METRIC_WIFI_RSSI, (esp_wifi_sta_get_ap_info(&ap) == ESP_OK) ? ap.rssi : 0);
+}
+
+static void writer_begin(bool keyframe)
+{
+    writer.len = (size_t)snprintf(writer.buf, sizeof(writer.buf), "{\"seq\":%lu,\"up\":%lld,\"k\":%d",
+                                  (unsigned long)report_seq, (long long)(esp_timer_get_time() / 1000000),
+                                  keyframe ? 1 : 0);
+    writer.header_len = writer.len;
+    writer.items = 0;
+}
+
+static void writer_flush(void)
+{
+    if (writer.items == 0)
+    {
+        return;
+    }
+
+    writer.buf[writer.len++] = '}';
+    writer.buf[writer.len] = '\0';
+    // QoS 0 like the in-flight diagnostics; a lost delta is made good by the next keyframe
+    if (!mqtt_outbox_enqueue(METRICS_TOPIC, writer.buf, 0))
+    {
+        writer.failed = true;
+    }
+    writer.len = writer.header_len;
+    writer.items = 0;
+}
+
+// Appends ,"name":value and starts another message when the payload is full
+static void writer_item(const char *item, size_t item_len)
+{
+    if (writer.len + item_len + 1 >= sizeof(writer.buf))
+    {
+        writer_flush();
+    }
+    if (writer.len + item_len + 1 >= sizeof(writer.buf))
+    {
+        ESP_LOGW(TAG, "Metric does not fit a payload: %s", item);
+        return;
+    }
+    memcpy(writer.buf + writer.len, item, item_len);
+    writer.len += item_len;
+    writer.items++;
+}
+
+static void write_histogram(const char *name, const uint32_t *now, const uint32_t *before)
+{
+    char item[128];
+    int len = snprintf(item, sizeof(item), ",\"%s\":[", name);
+
+    for (size_t b = 0; b < METRICS_HIST_BUCKETS; b++)
+    {
+        len += snprintf(item + len, sizeof(item) - len, "%s%lu", b ? "," : "", (unsigned long)(now[b] - before[b]));
+    }
+    len += snprintf(item + len, sizeof(item) - len, "]");
+    writer_item(item, (size_t)len);
+}
+
+static void write_report(const metrics_snapshot_t *now, const metrics_snapshot_t *before, bool keyframe)
+{
+    static const metrics_snapshot_t zero;
+    const metrics_snapshot_t *base = keyframe ? &zero : before;
+    char item[48];
+    int len;
+
+    writer_begin(keyframe);
+
+    for (size_t i = 0; i < METRIC_COUNTER_COUNT; i++)
+    {
+        if (keyframe || now->counters[i] != before->counters[i])
+        {
+            len = snprintf(item, sizeof(item), ",\"%s\":%lu", counter_names[i],
+                           (unsigned long)(now->counters[i] - base->counters[i]));
+            writer_item(item, (size_t)len);
+        }
+    }
+
+    for (size_t i = 0; i < METRIC_GAUGE_COUNT; i++)
+    {
+        if (keyframe || now->gauges[i] != before->gauges[i])
+        {
+            len = snprintf(item, sizeof(item), ",\"%s\":%ld", gauge_names[i], (long)now->gauges[i]);
+            writer_item(item, (size_t)len);
+        }
+    }
+
+    for (size_t i = 0; i < METRIC_HISTOGRAM_COUNT; i++)
+    {
+        if (keyframe || memcmp(now->histograms[i], before->histograms[i], sizeof(now->histograms[i])) != 0)
+        {
+            write_histogram(histogram_names[i], now->histograms[i], base->histograms[i]);
+        }
+    }
+
+    for (size_t i = 0; i < watched_count; i++)
+    {
+        if (keyframe || now->stacks[i] != before->stacks[i])
+        {
+            len = snprintf(item, sizeof(item), ",\"stk_%s\":%lu", pcTaskGetName(watched_tasks[i]),
+                           (unsigned long)now->stacks[i]);
+            writer_item(item, (size_t)len);
+        }
+    }
+
+    writer_flush();
+}
+
+static void report_timer_callback(void *arg)
+{
+    metrics_snapshot_t now;
+
+    sample_system_gauges();
+
+    portENTER_CRITICAL(&metrics_lock);
+    now = live;
+    portEXIT_CRITICAL(&metrics_lock);
+
+    // Deltas keep accumulating until there is a broker to send them to
+    if (!now.gauges[METRIC_MQTT_CONNECTED])
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < watched_count; i++)
+    {
+        // ESP-IDF reports the high-water mark in bytes
+        now.stacks[i] = (uint32_t)uxTaskGetStackHighWaterMark(watched_tasks[i]);
+    }
+
+    bool keyframe = force_keyframe || report_seq % METRICS_KEYFRAME_EVERY == 0;
+    writer.failed = false;
+    write_report(&now, &reported, keyframe);
+
+    // After a lost message only absolute values get the backend back in step
+    force_keyframe = writer.failed;
+    reported = now;
+    report_seq++;
+}
+
+esp_err_t init_metrics(void)
+{
+    const esp_timer_create_args_t timer_args = {.callback = report_timer_callback, .name = "metrics"};
+
+    if (esp_timer_create(&timer_args, &report_timer) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to create metrics report timer");
+        return ESP_FAIL;
+    }
+
+    esp_timer_start_periodic(report_timer, (uint64_t)METRICS_REPORT_PERIOD_MS * 1000);
+    return ESP_OK;
+}
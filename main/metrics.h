@@ -0,0 +1,60 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+typedef enum
+{
+    METRIC_DOOR_ISR_EDGES,
+    METRIC_DOOR_QUEUE_OVERFLOWS,
+    METRIC_DOOR_DEBOUNCE_REJECTS, // Edges absorbed by the debouncer
+    METRIC_DOOR_EVENTS,
+    METRIC_DOOR_SESSIONS,
+    METRIC_DOOR_ENQUEUE_FAILURES,
+    METRIC_PUBLISH_RETRIES,
+    METRIC_PUBLISH_FAILURES,
+    METRIC_MQTT_CONNECTS,
+    METRIC_MQTT_DISCONNECTS,
+    METRIC_TLS_FULL_HANDSHAKES,
+    METRIC_TLS_RESUMED_HANDSHAKES,
+    METRIC_OTA_ATTEMPTS,
+    METRIC_COUNTER_COUNT
+} metric_counter_t;
+
+typedef enum
+{
+    METRIC_MQTT_CONNECTED,
+    METRIC_HEAP_FREE,     // Sampled when a report is built
+    METRIC_HEAP_MIN_FREE, // Sampled when a report is built
+    METRIC_WIFI_RSSI,     // Sampled when a report is built
+    METRIC_GAUGE_COUNT
+} metric_gauge_t;
+
+typedef enum
+{
+    METRIC_HIST_EDGE_TO_PUBLISH_MS,
+    METRIC_HIST_RECONNECT_MS,
+    METRIC_HIST_TLS_FULL_MS,
+    METRIC_HIST_TLS_RESUMED_MS,
+    METRIC_HISTOGRAM_COUNT
+} metric_histogram_t;
+
+// Safe to call from an ISR
+void metrics_add(metric_counter_t counter, uint32_t n);
+void metrics_inc(metric_counter_t counter);
+void metrics_gauge_set(metric_gauge_t gauge, int32_t value);
+void metrics_observe_ms(metric_histogram_t histogram, uint32_t value_ms);
+
+// Adds the task's stack high-water mark to every report. For tasks that are
+// never deleted.
+void metrics_watch_task(TaskHandle_t task);
+
+// Publishes to METRICS_TOPIC every METRICS_REPORT_PERIOD_MS while MQTT is
+// connected. Only counters, gauges and buckets that changed since the last
+// report are sent, as deltas, except in periodic keyframes ("k":1).
+esp_err_t init_metrics(void);
+
+#endif // METRICS_H
@@ -0,0 +1,16 @@
+#ifndef METRICS_CONFIG_H
+#define METRICS_CONFIG_H
+
+#include "sdkconfig.h"
+
+#define METRICS_REPORT_PERIOD_MS 60000
+#define METRICS_KEYFRAME_EVERY 15 // Every Nth report carries absolute values instead of deltas
+#define METRICS_MAX_TASKS 6       // Tasks whose stack high-water mark is reported
+#define METRICS_TOPIC CONFIG_MQTT_PUBLISH_DOOR_STATE_TOPIC "/diagnostics/metrics"
+
+// Upper bounds of the latency histogram buckets. One extra bucket collects
+// everything slower than the last bound.
+#define METRICS_HIST_BUCKET_LIMITS_MS {50, 100, 250, 500, 1000, 2500, 5000, 15000, 60000}
+#define METRICS_HIST_BUCKETS 10
+
+#endif // METRICS_CONFIG_H
@@ -1,7 +1,11 @@
+#include <string.h>
 #include "cJSON.h"
+#include "esp_app_desc.h"
 #include "esp_log.h"
 #include "esp_mac.h"
+#include "esp_system.h"
 #include "esp_task_wdt.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
@@ -15,22 +19,57 @@
 #include "mbedtls/debug.h" // Add this to include mbedtls debug functions
 #include "nvs_flash.h"
 #include "mqtt_custom_handler.h"
+#include "mqtt_outbox.h"
+#include "outbox_config.h"
+#include "ota_manifest_scanner.h"
+#include "ota_stream.h"
+#include "ota_stream_config.h"
+#include "mqtt_reconnect.h"
+#include "tls_handshake_stats.h"
+#include "tls_session_transport.h"
+#include "tls_session_config.h"
+#include "mqtt_inflight.h"
+#include "door_sleep.h"
+#include "metrics.h"
+#include "mqtt_router.h"
+#include "router_config.h"
+#include "broker_config.h"
+#include "settings.h"
 
 static const char *TAG = "MQTT_CUSTOM_HANDLER";
 
 esp_mqtt_client_handle_t mqtt_client_handle = NULL;
 
+// Still referenced by the gecl OTA manager; downloads now go through ota_stream
 TaskHandle_t ota_task_handle = NULL;
 
+#if MQTT_LOCAL_BROKER
+extern const uint8_t local_client_crt[] asm("_binary_client_crt_start");
+extern const uint8_t local_client_key[] asm("_binary_client_key_start");
+extern const uint8_t local_ca_crt[] asm("_binary_ca_crt_start");
+const uint8_t *cert = local_client_crt;
+const uint8_t *key = local_client_key;
+const uint8_t *ca = local_ca_crt;
+#else
 extern const uint8_t certificate[];
 extern const uint8_t private_key[];
 extern const uint8_t root_ca[];
 const uint8_t *cert = certificate;
 const uint8_t *key = private_key;
 const uint8_t *ca = root_ca;
+#endif
 
 char mac_address[18];
 
+static ota_stream_request_t ota_request;
+static ota_manifest_scanner_t ota_scanner;
+static bool ota_manifest_in_progress = false;
+
+static char ota_device_topic[sizeof(CONFIG_MQTT_SUBSCRIBE_OTA_UPDATE_MAILBOX_TOPIC) + 13];
+static char ota_command[OTA_COMMAND_MAX_LEN];
+static char ping_device_topic[sizeof(COMMAND_TOPIC_ROOT) + 18];
+static char ping_command[COMMAND_MAX_LEN];
+
 void record_local_mac_address(char *mac_str)
 {
     uint8_t mac[6];
@@ -45,150 +84,286 @@ void record_local_mac_address(char *mac_str)
     }
 }
 
+// <prefix>/<MAC without colons><suffix>, for topics only this device listens on
+static void format_device_topic(char *topic, size_t size, const char *prefix, const char *mac_str, const char *suffix)
+{
+    size_t len = (size_t)snprintf(topic, size, "%s/", prefix);
+
+    for (const char *p = mac_str; *p != '\0' && len + 1 < size; p++)
+    {
+        if (*p != ':')
+        {
+            topic[len++] = *p;
+        }
+    }
+    snprintf(topic + len, size - len, "%s", suffix);
+}
+
 void custom_handle_mqtt_event_connected(esp_mqtt_event_handle_t event)
 {
     esp_mqtt_client_handle_t client = event->client;
     ESP_LOGI(TAG, "Custom handler: MQTT_EVENT_CONNECTED");
-    int msg_id;
 
-    record_local_mac_address(mac_address);
+    mqtt_reconnect_on_connected();
+    tls_handshake_stats_on_connected();
+    mqtt_inflight_on_connected();
+    door_sleep_mark_phase(SLEEP_PHASE_MQTT_CONNECTED);
+    metrics_inc(METRIC_MQTT_CONNECTS);
+    metrics_gauge_set(METRIC_MQTT_CONNECTED, 1);
+
     ESP_LOGW(TAG, "Burned-In MAC Address: %s", mac_address);
+    mqtt_router_subscribe(client);
+    settings_on_connected();
 
-    msg_id = esp_mqtt_client_subscribe(client, CONFIG_MQTT_SUBSCRIBE_OTA_UPDATE_MAILBOX_TOPIC, 0);
-    ESP_LOGI(TAG, "Subscribed to topic %s, msg_id=%d", CONFIG_MQTT_SUBSCRIBE_OTA_UPDATE_MAILBOX_TOPIC, msg_id);
+    // Deliver door events that were journaled while the connection was down
+    mqtt_outbox_request_replay();
 }
 
 void custom_handle_mqtt_event_disconnected(esp_mqtt_event_handle_t event)
 {
     ESP_LOGI(TAG, "Custom handler: MQTT_EVENT_DISCONNECTED");
-    if (ota_task_handle != NULL)
+    mqtt_inflight_on_disconnected();
+    metrics_inc(METRIC_MQTT_DISCONNECTS);
+    metrics_gauge_set(METRIC_MQTT_CONNECTED, 0);
+    // An OTA download runs over its own HTTP connection and survives a broker
+    // outage; if Wi-Fi drops it resumes from its last checkpoint
+
+    // Backoff, Wi-Fi handling and the reboot fallback all run from a timer so
+    // the MQTT event loop is never blocked here
+    mqtt_reconnect_on_disconnected(event->client);
+}
+
+ota_scan_result_t extract_ota_url_from_event(const mqtt_route_msg_t *msg, char *local_mac_address, char *ota_url,
+                                             size_t ota_url_size)
+{
+    // A large manifest arrives as several MQTT_EVENT_DATA events; only the first
+    // one has offset 0
+    if (msg->offset == 0)
     {
-        vTaskDelete(ota_task_handle);
-        ota_task_handle = NULL;
+        ota_scanner_init(&ota_scanner, local_mac_address, ota_url, ota_url_size);
     }
-    // Reconnect logic
-    int retry_count = 0;
-    const int max_retries = 5;
-    const int retry_delay_ms = 5000;
-    esp_err_t err;
-    esp_mqtt_client_handle_t client = event->client;
 
-    // Check if the network is connected before attempting reconnection
-    if (wifi_active())
+    ota_scan_result_t result = ota_scanner_feed(&ota_scanner, msg->data, msg->len);
+    if (result == OTA_SCAN_MORE && msg->offset + msg->len >= msg->total_len)
     {
-        do
-        {
-            ESP_LOGI(TAG, "Attempting to reconnect, retry %d/%d", retry_count + 1, max_retries);
-            err = esp_mqtt_client_reconnect(client);
-            if (err != ESP_OK)
-            {
-                ESP_LOGE(TAG, "Failed to reconnect MQTT client, retrying in %d seconds...", retry_delay_ms / 1000);
-                vTaskDelay(pdMS_TO_TICKS(retry_delay_ms)); // Delay for 5 seconds
-                retry_count++;
-            }
-        } while (err != ESP_OK && retry_count < max_retries);
-
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "Failed to reconnect MQTT client after %d retries. Restarting", retry_count);
-            error_reload(mqtt_client_handle);
-        }
+        ESP_LOGW(TAG, "OTA manifest ended before its closing brace");
+        result = OTA_SCAN_ERROR;
     }
-    else
+    else if (result == OTA_SCAN_NOT_FOUND)
     {
-        ESP_LOGE(TAG, "Network not connected, skipping MQTT reconnection");
-        error_reload(mqtt_client_handle);
+        ESP_LOGW(TAG, "'%s' MAC address key not found in JSON", local_mac_address);
+    }
+    else if (result == OTA_SCAN_ERROR)
+    {
+        ESP_LOGE(TAG, "Malformed OTA manifest or URL longer than %u bytes", (unsigned)(ota_url_size - 1));
     }
+
+    return result;
 }
 
-bool extract_ota_url_from_event(esp_mqtt_event_handle_t event, char *local_mac_address, char *ota_url)
+void custom_handle_mqtt_event_ota(const mqtt_route_msg_t *msg, char *my_mac_address)
 {
-    bool success = false;
-    cJSON *root = cJSON_Parse(event->data);
-    cJSON *host_key = cJSON_GetObjectItem(root, local_mac_address);
-    const char *host_key_value = cJSON_GetStringValue(host_key);
+    assert(msg->data != NULL);
 
-    if (!host_key || !host_key_value)
+    if (msg->offset == 0)
     {
-        ESP_LOGW(TAG, "'%s' MAC address key not found in JSON", local_mac_address);
+        ota_manifest_in_progress = !ota_stream_running();
+        if (!ota_manifest_in_progress)
+        {
+            ESP_LOGW(TAG, "OTA already in progress, skipping OTA update");
+        }
     }
-    else
+
+    // Remaining chunks of a manifest we already finished with or chose to skip
+    if (!ota_manifest_in_progress)
+    {
+        return;
+    }
+
+    ota_scan_result_t result = extract_ota_url_from_event(msg, my_mac_address, ota_request.url,
+                                                          sizeof(ota_request.url));
+    if (result == OTA_SCAN_MORE)
+    {
+        return;
+    }
+
+    ota_manifest_in_progress = false;
+    if (result != OTA_SCAN_FOUND)
     {
-        size_t url_len = strlen(host_key_value);
-        strncpy(ota_url, host_key_value, url_len);
-        ota_url[url_len] = '\0'; // Manually set the null terminator
-        success = true;
+        ESP_LOGW(TAG, "OTA URL not found in event data");
+        return;
     }
 
-    cJSON_Delete(root); // Free JSON object
-    return success;
+    metrics_inc(METRIC_OTA_ATTEMPTS);
+    if (ota_stream_start(&ota_request) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start OTA download");
+    }
 }
 
-void custom_handle_mqtt_event_ota(esp_mqtt_event_handle_t event, char *my_mac_address)
+static int hex_nibble(char c)
 {
-    if (ota_task_handle != NULL)
+    if (c >= '0' && c <= '9')
     {
-        eTaskState task_state = eTaskGetState(ota_task_handle);
-        if (task_state != eDeleted)
-        {
-            char log_message[256]; // Adjust the size according to your needs
-            snprintf(log_message, sizeof(log_message),
-                     "OTA task is already running or not yet cleaned up, skipping OTA update. task_state=%d",
-                     task_state);
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
 
-            ESP_LOGW(TAG, "%s", log_message);
-            return;
-        }
-        else
+static bool parse_sha256_hex(const char *hex, uint8_t *out)
+{
+    if (strlen(hex) != 64)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < 64; i++)
+    {
+        int nibble = hex_nibble(hex[i]);
+        if (nibble < 0)
         {
-            // Clean up task handle if it has been deleted
-            ota_task_handle = NULL;
+            return false;
         }
+        out[i / 2] = (uint8_t)((i % 2) ? (out[i / 2] | nibble) : (nibble << 4));
+    }
+    return true;
+}
+
+static esp_err_t parse_ota_command(const char *json, size_t len, ota_stream_request_t *request)
+{
+    esp_err_t err = ESP_ERR_INVALID_ARG;
+    cJSON *root = cJSON_ParseWithLength(json, len);
+    const cJSON *url = cJSON_GetObjectItemCaseSensitive(root, "url");
+    const cJSON *sha256 = cJSON_GetObjectItemCaseSensitive(root, "sha256");
+    const cJSON *version = cJSON_GetObjectItemCaseSensitive(root, "version");
+
+    if (!cJSON_IsString(url) || !cJSON_IsString(sha256) || !cJSON_IsString(version))
+    {
+        ESP_LOGE(TAG, "OTA command needs string url, sha256 and version");
+    }
+    else if (strlen(url->valuestring) >= sizeof(request->url) ||
+             strlen(version->valuestring) >= sizeof(request->version))
+    {
+        ESP_LOGE(TAG, "OTA command url or version too long");
+    }
+    else if (!parse_sha256_hex(sha256->valuestring, request->sha256))
+    {
+        ESP_LOGE(TAG, "OTA command sha256 is not 64 hex digits");
     }
     else
     {
-        ESP_LOGI(TAG, "OTA task handle is NULL");
+        strlcpy(request->url, url->valuestring, sizeof(request->url));
+        strlcpy(request->version, version->valuestring, sizeof(request->version));
+        request->has_sha256 = true;
+        err = ESP_OK;
     }
 
-    // Parse the message and get any URL associated with our MAC address
-    assert(event->data != NULL);
-    assert(event->data_len > 0);
+    cJSON_Delete(root);
+    return err;
+}
+
+static void handle_ota_manifest(const mqtt_route_msg_t *msg)
+{
+    custom_handle_mqtt_event_ota(msg, mac_address);
+}
 
-    ota_config_t ota_config;
-    ota_config.mqtt_client = event->client;
+// A per-device command names one image for this device, so there is nothing
+// to scan; the router hands it over whole
+void custom_handle_mqtt_event_ota_command(const mqtt_route_msg_t *msg)
+{
+    ota_stream_request_t request = {0};
 
-    if (!extract_ota_url_from_event(event, my_mac_address, ota_config.url))
+    // An empty payload only clears a retained command
+    if (msg->len == 0 || parse_ota_command(msg->data, msg->len, &request) != ESP_OK)
     {
-        ESP_LOGW(TAG, "OTA URL not found in event data");
         return;
     }
 
-    // Pass the allocated URL string to the OTA task
-    if (xTaskCreate(&ota_task, "ota_task", 8192, (void *)&ota_config, 5, &ota_task_handle) != pdPASS)
+    // A retained command is delivered again after the update reboots
+    if (strcmp(request.version, esp_app_get_description()->version) == 0)
     {
-        error_reload(mqtt_client_handle);
+        ESP_LOGI(TAG, "Already running %s, OTA command ignored", request.version);
+        return;
+    }
+    if (ota_stream_running())
+    {
+        ESP_LOGW(TAG, "OTA already in progress, skipping OTA update");
+        return;
+    }
+
+    metrics_inc(METRIC_OTA_ATTEMPTS);
+    if (ota_stream_start(&request) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start OTA download");
     }
 }
 
-void custom_handle_mqtt_event_data(esp_mqtt_event_handle_t event)
+// Liveness check from the backend; the request payload, if any, is echoed as "id"
+static void handle_ping(const mqtt_route_msg_t *msg)
 {
+    char reply[OUTBOX_PAYLOAD_MAX_LEN];
+    size_t id_len = strcspn(msg->data, "\"\\\r\n");
 
-    ESP_LOGW(TAG, "Received topic %.*s", event->topic_len, event->topic);
+    snprintf(reply, sizeof(reply), "{\"dev\":\"%s\",\"ver\":\"%s\",\"up_ms\":%lld,\"heap\":%lu,\"id\":\"%.*s\"}",
+             mac_address, esp_app_get_description()->version, (long long)(esp_timer_get_time() / 1000),
+             (unsigned long)esp_get_free_heap_size(), (int)(id_len < 32 ? id_len : 32), msg->data);
+    mqtt_outbox_enqueue(COMMAND_PONG_TOPIC, reply, 0);
+}
 
-    if (strncmp(event->topic, CONFIG_MQTT_SUBSCRIBE_OTA_UPDATE_MAILBOX_TOPIC, event->topic_len) == 0)
-    {
-        // Use the global mac_address variable to pass the MAC address to the OTA function
-        custom_handle_mqtt_event_ota(event, mac_address);
-    }
-    else
+// Exact topics are filled in from the MAC before the table is indexed
+static char shadow_document[SETTINGS_DOC_MAX_LEN];
+
+static const mqtt_route_t routes[] = {
+    {.filter = ota_device_topic,
+     .qos = OTA_COMMAND_QOS,
+     .handler = custom_handle_mqtt_event_ota_command,
+     .buffer = ota_command,
+     .buffer_size = sizeof(ota_command)},
+    // Fleet-wide MAC->URL manifest, kept while publishers move to the per-device
+    // topic. It can be large, so it is scanned chunk by chunk.
+    {.filter = CONFIG_MQTT_SUBSCRIBE_OTA_UPDATE_MAILBOX_TOPIC, .qos = 0, .handler = handle_ota_manifest},
+    {.filter = ping_device_topic,
+     .qos = 0,
+     .handler = handle_ping,
+     .buffer = ping_command,
+     .buffer_size = sizeof(ping_command)},
+    {.filter = COMMAND_TOPIC_ROOT "/all/ping",
+     .qos = 0,
+     .handler = handle_ping,
+     .buffer = ping_command,
+     .buffer_size = sizeof(ping_command)},
+    {.filter = settings_delta_topic,
+     .qos = 1,
+     .handler = settings_handle_delta,
+     .buffer = shadow_document,
+     .buffer_size = sizeof(shadow_document)},
+    {.filter = settings_get_accepted_topic,
+     .qos = 1,
+     .handler = settings_handle_get_accepted,
+     .buffer = shadow_document,
+     .buffer_size = sizeof(shadow_document)},
+};
+
+void custom_handle_mqtt_event_data(esp_mqtt_event_handle_t event)
+{
+    if (event->current_data_offset == 0)
     {
-        ESP_LOGE(TAG, "Un-Handled topic %.*s", event->topic_len, event->topic);
+        ESP_LOGW(TAG, "Received topic %.*s", event->topic_len, event->topic);
     }
+    mqtt_router_dispatch(event);
 }
 
 void custom_handle_mqtt_event_error(esp_mqtt_event_handle_t event)
 {
     ESP_LOGI(TAG, "Custom handler: MQTT_EVENT_ERROR");
+    tls_handshake_stats_on_error(event);
     if (event->error_handle->error_type == MQTT_ERROR_TYPE_ESP_TLS)
     {
         ESP_LOGI(TAG, "Last ESP error code: 0x%x", event->error_handle->esp_tls_last_esp_err);
@@ -203,11 +378,23 @@ void custom_handle_mqtt_event_error(esp_mqtt_event_handle_t event)
     {
         ESP_LOGI(TAG, "Unknown error type: 0x%x", event->error_handle->error_type);
     }
-    error_reload(mqtt_client_handle);
+    // A failed connection attempt is followed by MQTT_EVENT_DISCONNECTED, which
+    // hands recovery to the reconnect scheduler, which reboots only as a last resort.
 }
 
 void init_custom_mqtt()
 {
+    init_mqtt_reconnect();
+
+    record_local_mac_address(mac_address);
+    format_device_topic(ota_device_topic, sizeof(ota_device_topic), CONFIG_MQTT_SUBSCRIBE_OTA_UPDATE_MAILBOX_TOPIC,
+                        mac_address, "");
+    format_device_topic(ping_device_topic, sizeof(ping_device_topic), COMMAND_TOPIC_ROOT, mac_address, "/ping");
+    if (mqtt_router_init(routes, sizeof(routes) / sizeof(routes[0])) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to index MQTT routes");
+    }
+
     mqtt_set_event_connected_handler(custom_handle_mqtt_event_connected);
     mqtt_set_event_disconnected_handler(custom_handle_mqtt_event_disconnected);
     mqtt_set_event_data_handler(custom_handle_mqtt_event_data);
@@ -216,8 +403,9 @@ void init_custom_mqtt()
     mqtt_config_t config = {.certificate = cert,
                             .private_key = key,
                             .root_ca = ca,
-                            .broker_uri = CONFIG_AWS_IOT_ENDPOINT};
+                            .broker_uri = MQTT_BROKER_URI};
 
+    ESP_LOGI(TAG, "Connecting to %s", config.broker_uri);
     mqtt_client_handle = init_mqtt(&config);
 
     if (mqtt_client_handle == NULL)
@@ -225,4 +413,13 @@ void init_custom_mqtt()
         ESP_LOGE(TAG, "Failed to initialize MQTT client");
         error_reload(mqtt_client_handle);
     }
+
+#if TLS_SESSION_RESUMPTION
+    if (tls_session_install(mqtt_client_handle, (const char *)ca, (const char *)cert, (const char *)key) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "TLS session resumption unavailable, every connect does a full handshake");
+    }
+#endif
+    init_tls_handshake_stats(mqtt_client_handle);
+    init_mqtt_inflight(mqtt_client_handle);
 }
\ No newline at end of file
@@ -6,14 +6,18 @@
 #include "freertos/task.h"     // For TaskHandle_t
 #include "gecl-ota-manager.h"  // For ota_config_t
 #include "gecl-wifi-manager.h" // For wifi_active()
+#include "ota_manifest_scanner.h" // For ota_scan_result_t
+#include "mqtt_router.h"          // For mqtt_route_msg_t
 
 extern esp_mqtt_client_handle_t mqtt_client_handle;
 
 // Function prototypes
 void custom_handle_mqtt_event_connected(esp_mqtt_event_handle_t event);
 void custom_handle_mqtt_event_disconnected(esp_mqtt_event_handle_t event);
-bool extract_ota_url_from_event(esp_mqtt_event_handle_t event, char *local_mac_address, char *ota_url);
-void custom_handle_mqtt_event_ota(esp_mqtt_event_handle_t event, char *my_mac_address);
+ota_scan_result_t extract_ota_url_from_event(const mqtt_route_msg_t *msg, char *local_mac_address, char *ota_url,
+                                             size_t ota_url_size);
+void custom_handle_mqtt_event_ota(const mqtt_route_msg_t *msg, char *my_mac_address);
+void custom_handle_mqtt_event_ota_command(const mqtt_route_msg_t *msg);
 void custom_handle_mqtt_event_data(esp_mqtt_event_handle_t event);
 void custom_handle_mqtt_event_error(esp_mqtt_event_handle_t event);
 void init_custom_mqtt();
@@ -0,0 +1,428 @@
+#include <stdio.h>
+#include <string.h>
+#include "mqtt_inflight.h"
+#include "mqtt_outbox.h"
+#include "outbox_config.h"
+#include "door_journal.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "MQTT_INFLIGHT";
+
+typedef struct
+{
+    bool used;
+    bool pending; // Reserved, msg_id not known until esp_mqtt_client_publish() returns
+    bool replay;
+    int msg_id;
+    uint32_t first_seq;
+    uint32_t last_seq;
+    int64_t sent_us;
+    int64_t origin_us;
+    int64_t deadline_us;
+    char topic[OUTBOX_TOPIC_MAX_LEN];
+} inflight_slot_t;
+
+// Journal bookkeeping of one PUBACK, done once the lock is released
+typedef struct
+{
+    uint32_t live_through;
+    uint32_t replay_through;
+    bool replay_done;
+} inflight_ack_t;
+
+static const uint32_t rtt_bucket_limits_ms[INFLIGHT_RTT_BUCKETS - 1] = INFLIGHT_RTT_BUCKET_LIMITS_MS;
+
+static inflight_slot_t inflight_slots[INFLIGHT_MAX_MSGS];
+static inflight_slot_t expired_slot; // Only touched by the sweep timer callback
+// PUBACKs that arrived while a publish was still returning its msg_id
+static int early_acks[INFLIGHT_EARLY_ACKS];
+static size_t early_ack_next = 0;
+static size_t pending_count = 0;
+static mqtt_inflight_stats_t inflight_stats = {0};
+static uint32_t live_confirmed_seq = 0;
+static uint32_t replay_confirmed_seq = 0;
+static bool inflight_connected = false;
+static esp_timer_handle_t sweep_timer = NULL;
+static esp_timer_handle_t diag_timer = NULL;
+static portMUX_TYPE inflight_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static size_t rtt_bucket(int64_t rtt_us)
+{
+    size_t i = 0;
+
+    while (i < INFLIGHT_RTT_BUCKETS - 1 && rtt_us > (int64_t)rtt_bucket_limits_ms[i] * 1000)
+    {
+        i++;
+    }
+    return i;
+}
+
+static inflight_slot_t *find_slot_locked(int msg_id)
+{
+    for (size_t i = 0; i < INFLIGHT_MAX_MSGS; i++)
+    {
+        if (inflight_slots[i].used && !inflight_slots[i].pending && inflight_slots[i].msg_id == msg_id)
+        {
+            return &inflight_slots[i];
+        }
+    }
+    return NULL;
+}
+
+static bool replay_pending_locked(void)
+{
+    for (size_t i = 0; i < INFLIGHT_MAX_MSGS; i++)
+    {
+        if (inflight_slots[i].used && inflight_slots[i].replay)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// PUBACKs may overtake each other, so the journal is only acknowledged up to
+// just below the oldest journaled message that is still unconfirmed
+static uint32_t ack_through_locked(uint32_t confirmed_seq)
+{
+    uint32_t through = confirmed_seq;
+
+    for (size_t i = 0; i < INFLIGHT_MAX_MSGS; i++)
+    {
+        uint32_t seq = inflight_slots[i].first_seq;
+        if (inflight_slots[i].used && seq != 0 && seq <= through)
+        {
+            through = seq - 1;
+        }
+    }
+    return through;
+}
+
+static void release_slot_locked(inflight_slot_t *slot)
+{
+    slot->used = false;
+    inflight_stats.in_flight--;
+}
+
+static void ack_slot_locked(inflight_slot_t *slot, int64_t now_us, inflight_ack_t *ack)
+{
+    int64_t rtt_us = now_us - slot->sent_us;
+    int64_t e2e_us = now_us - slot->origin_us;
+    inflight_stats.acked++;
+    inflight_stats.last_rtt_us = rtt_us;
+    inflight_stats.total_rtt_us += rtt_us;
+    if (rtt_us > inflight_stats.max_rtt_us)
+    {
+        inflight_stats.max_rtt_us = rtt_us;
+    }
+    inflight_stats.last_e2e_us = e2e_us;
+    if (e2e_us > inflight_stats.max_e2e_us)
+    {
+        inflight_stats.max_e2e_us = e2e_us;
+    }
+    inflight_stats.rtt_histogram[rtt_bucket(rtt_us)]++;
+
+    uint32_t seq = slot->last_seq;
+    bool replay = slot->replay;
+    release_slot_locked(slot);
+
+    if (seq != 0 && replay)
+    {
+        if (seq > replay_confirmed_seq)
+        {
+            replay_confirmed_seq = seq;
+        }
+        ack->replay_through = ack_through_locked(replay_confirmed_seq);
+        ack->replay_done = !replay_pending_locked();
+    }
+    else if (seq != 0)
+    {
+        if (seq > live_confirmed_seq)
+        {
+            live_confirmed_seq = seq;
+        }
+        ack->live_through = ack_through_locked(live_confirmed_seq);
+    }
+}
+
+static void finish_ack(const inflight_ack_t *ack)
+{
+    if (ack->replay_through != 0)
+    {
+        door_journal_ack(ack->replay_through);
+    }
+    if (ack->live_through != 0)
+    {
+        door_journal_mark_delivered(ack->live_through);
+    }
+    if (ack->replay_done)
+    {
+        // The whole batch is confirmed; move on to the next one
+        mqtt_outbox_request_replay();
+    }
+}
+
+// Once no publish is waiting for its msg_id, buffered PUBACKs belong to no one
+static void drop_early_acks_locked(void)
+{
+    if (pending_count > 0)
+    {
+        return;
+    }
+    for (size_t i = 0; i < INFLIGHT_EARLY_ACKS; i++)
+    {
+        if (early_acks[i] != 0)
+        {
+            inflight_stats.unknown_acks++;
+            early_acks[i] = 0;
+        }
+    }
+}
+
+static void published_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    esp_mqtt_event_handle_t event = event_data;
+    inflight_ack_t ack = {0};
+
+    portENTER_CRITICAL(&inflight_lock);
+    inflight_slot_t *slot = find_slot_locked(event->msg_id);
+    if (slot != NULL)
+    {
+        ack_slot_locked(slot, esp_timer_get_time(), &ack);
+    }
+    else if (pending_count > 0)
+    {
+        // The PUBACK overtook mqtt_inflight_commit(); it settles the slot there
+        if (early_acks[early_ack_next] != 0)
+        {
+            inflight_stats.unknown_acks++;
+        }
+        early_acks[early_ack_next] = event->msg_id;
+        early_ack_next = (early_ack_next + 1) % INFLIGHT_EARLY_ACKS;
+    }
+    else
+    {
+        inflight_stats.unknown_acks++;
+    }
+    portEXIT_CRITICAL(&inflight_lock);
+
+    finish_ack(&ack);
+}
+
+static bool take_expired_slot(int64_t now_us)
+{
+    bool found = false;
+
+    portENTER_CRITICAL(&inflight_lock);
+    for (size_t i = 0; i < INFLIGHT_MAX_MSGS && inflight_connected; i++)
+    {
+        if (inflight_slots[i].used && !inflight_slots[i].pending && now_us >= inflight_slots[i].deadline_us)
+        {
+            expired_slot = inflight_slots[i];
+            release_slot_locked(&inflight_slots[i]);
+            inflight_stats.timeouts++;
+            found = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&inflight_lock);
+
+    return found;
+}
+
+static void sweep_timer_callback(void *arg)
+{
+    int64_t now_us = esp_timer_get_time();
+    bool replay_needed = false;
+
+    while (take_expired_slot(now_us))
+    {
+        ESP_LOGW(TAG, "No PUBACK for msg_id=%d to %s after %d ms", expired_slot.msg_id, expired_slot.topic,
+                 INFLIGHT_ACK_TIMEOUT_MS);
+
+        if (expired_slot.last_seq != 0)
+        {
+            // The journal still holds the events; replay resends them in order
+            if (!expired_slot.replay)
+            {
+                door_journal_mark_failed(expired_slot.last_seq);
+            }
+            replay_needed = true;
+            portENTER_CRITICAL(&inflight_lock);
+            inflight_stats.journaled++;
+            portEXIT_CRITICAL(&inflight_lock);
+        }
+        // Anything else stays in esp-mqtt's outbox, which resends it with DUP
+        // set; publishing it again here would only make a duplicate
+    }
+
+    if (replay_needed && !mqtt_inflight_replay_pending())
+    {
+        mqtt_outbox_request_replay();
+    }
+}
+
+static void diag_timer_callback(void *arg)
+{
+    mqtt_inflight_stats_t stats;
+    char payload[OUTBOX_PAYLOAD_MAX_LEN];
+    const uint32_t *h = stats.rtt_histogram;
+
+    if (!inflight_connected)
+    {
+        return;
+    }
+
+    mqtt_inflight_get_stats(&stats);
+    uint32_t avg_ms = stats.acked ? (uint32_t)(stats.total_rtt_us / stats.acked / 1000) : 0;
+    snprintf(payload, sizeof(payload),
+             "{\"acked\":%lu,\"timeouts\":%lu,\"in_flight\":%lu,\"rtt_avg_ms\":%lu,\"rtt_max_ms\":%lu,"
+             "\"e2e_max_ms\":%lu,\"rtt_hist\":[%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu]}",
+             (unsigned long)stats.acked, (unsigned long)stats.timeouts, (unsigned long)stats.in_flight,
+             (unsigned long)avg_ms, (unsigned long)(stats.max_rtt_us / 1000), (unsigned long)(stats.max_e2e_us / 1000),
+             (unsigned long)h[0], (unsigned long)h[1], (unsigned long)h[2], (unsigned long)h[3], (unsigned long)h[4],
+             (unsigned long)h[5], (unsigned long)h[6], (unsigned long)h[7], (unsigned long)h[8]);
+
+    // QoS 0 so the report itself never occupies an in-flight slot
+    mqtt_outbox_enqueue(INFLIGHT_DIAG_TOPIC, payload, 0);
+}
+
+int mqtt_inflight_reserve(const mqtt_inflight_msg_t *msg)
+{
+    int64_t now_us = esp_timer_get_time();
+    int handle = INFLIGHT_NO_SLOT;
+
+    portENTER_CRITICAL(&inflight_lock);
+    for (size_t i = 0; i < INFLIGHT_MAX_MSGS; i++)
+    {
+        if (!inflight_slots[i].used)
+        {
+            handle = (int)i;
+            break;
+        }
+    }
+    if (handle == INFLIGHT_NO_SLOT)
+    {
+        inflight_stats.untracked++;
+        portEXIT_CRITICAL(&inflight_lock);
+        ESP_LOGW(TAG, "In-flight table full, publish to %s is not tracked", msg->topic);
+        return INFLIGHT_NO_SLOT;
+    }
+
+    inflight_slot_t *slot = &inflight_slots[handle];
+    *slot = (inflight_slot_t){.used = true,
+                              .pending = true,
+                              .replay = msg->replay,
+                              .first_seq = msg->first_seq,
+                              .last_seq = msg->last_seq,
+                              .sent_us = now_us,
+                              .origin_us = msg->origin_us};
+    strlcpy(slot->topic, msg->topic, sizeof(slot->topic));
+    pending_count++;
+    inflight_stats.tracked++;
+    inflight_stats.in_flight++;
+    if (inflight_stats.in_flight > inflight_stats.in_flight_high_water)
+    {
+        inflight_stats.in_flight_high_water = inflight_stats.in_flight;
+    }
+    portEXIT_CRITICAL(&inflight_lock);
+
+    return handle;
+}
+
+void mqtt_inflight_commit(int handle, int msg_id)
+{
+    inflight_ack_t ack = {0};
+
+    portENTER_CRITICAL(&inflight_lock);
+    inflight_slot_t *slot = &inflight_slots[handle];
+    slot->msg_id = msg_id;
+    slot->pending = false;
+    // Publish retries may have taken a while; the timeout runs from here
+    slot->deadline_us = esp_timer_get_time() + (int64_t)INFLIGHT_ACK_TIMEOUT_MS * 1000;
+    pending_count--;
+    for (size_t i = 0; i < INFLIGHT_EARLY_ACKS; i++)
+    {
+        if (early_acks[i] == msg_id)
+        {
+            early_acks[i] = 0;
+            ack_slot_locked(slot, esp_timer_get_time(), &ack);
+            break;
+        }
+    }
+    drop_early_acks_locked();
+    portEXIT_CRITICAL(&inflight_lock);
+
+    finish_ack(&ack);
+}
+
+void mqtt_inflight_cancel(int handle)
+{
+    portENTER_CRITICAL(&inflight_lock);
+    inflight_stats.tracked--;
+    release_slot_locked(&inflight_slots[handle]);
+    pending_count--;
+    drop_early_acks_locked();
+    portEXIT_CRITICAL(&inflight_lock);
+}
+
+bool mqtt_inflight_replay_pending(void)
+{
+    portENTER_CRITICAL(&inflight_lock);
+    bool pending = replay_pending_locked();
+    portEXIT_CRITICAL(&inflight_lock);
+    return pending;
+}
+
+void mqtt_inflight_on_connected(void)
+{
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)INFLIGHT_ACK_TIMEOUT_MS * 1000;
+
+    portENTER_CRITICAL(&inflight_lock);
+    inflight_connected = true;
+    // Give esp-mqtt a full timeout to resend what was pending before the outage
+    for (size_t i = 0; i < INFLIGHT_MAX_MSGS; i++)
+    {
+        inflight_slots[i].deadline_us = deadline_us;
+    }
+    portEXIT_CRITICAL(&inflight_lock);
+}
+
+void mqtt_inflight_on_disconnected(void)
+{
+    portENTER_CRITICAL(&inflight_lock);
+    inflight_connected = false;
+    portEXIT_CRITICAL(&inflight_lock);
+}
+
+void mqtt_inflight_get_stats(mqtt_inflight_stats_t *stats)
+{
+    portENTER_CRITICAL(&inflight_lock);
+    *stats = inflight_stats;
+    portEXIT_CRITICAL(&inflight_lock);
+}
+
+esp_err_t init_mqtt_inflight(esp_mqtt_client_handle_t client)
+{
+    const esp_timer_create_args_t sweep_args = {.callback = sweep_timer_callback, .name = "inflight_sweep"};
+    const esp_timer_create_args_t diag_args = {.callback = diag_timer_callback, .name = "inflight_diag"};
+
+    esp_err_t err = esp_mqtt_client_register_event(client, MQTT_EVENT_PUBLISHED, published_handler, NULL);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to register PUBLISHED handler: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if (esp_timer_create(&sweep_args, &sweep_timer) != ESP_OK || esp_timer_create(&diag_args, &diag_timer) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to create in-flight timers");
+        return ESP_FAIL;
+    }
+
+    esp_timer_start_periodic(sweep_timer, (uint64_t)INFLIGHT_SWEEP_PERIOD_MS * 1000);
+    esp_timer_start_periodic(diag_timer, (uint64_t)INFLIGHT_DIAG_PERIOD_MS * 1000);
+    return ESP_OK;
+}
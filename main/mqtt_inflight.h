@@ -0,0 +1,63 @@
+#ifndef MQTT_INFLIGHT_H
+#define MQTT_INFLIGHT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "mqtt_client.h"
+#include "inflight_config.h"
+
+typedef struct
+{
+    uint32_t tracked;
+    uint32_t acked;
+    uint32_t timeouts;      // Left to esp-mqtt's own resend, or to the door journal replay
+    uint32_t journaled;     // Timed out and left to the door journal replay
+    uint32_t untracked;     // Published while the table was full, delivery unconfirmed
+    uint32_t unknown_acks;  // PUBACKs for msg_ids we were not tracking
+    uint32_t in_flight;
+    uint32_t in_flight_high_water;
+    int64_t last_rtt_us;    // Publish to PUBACK
+    int64_t max_rtt_us;
+    int64_t total_rtt_us;
+    int64_t last_e2e_us;    // Event origin (e.g. GPIO edge) to PUBACK
+    int64_t max_e2e_us;
+    uint32_t rtt_histogram[INFLIGHT_RTT_BUCKETS]; // See INFLIGHT_RTT_BUCKET_LIMITS_MS
+} mqtt_inflight_stats_t;
+
+#define INFLIGHT_NO_SLOT -1
+
+typedef struct
+{
+    const char *topic;
+    int64_t origin_us;
+    uint32_t first_seq; // Door journal range carried by the payload, 0 if none
+    uint32_t last_seq;
+    bool replay;        // Part of a journal replay batch
+} mqtt_inflight_msg_t;
+
+// Registers for MQTT_EVENT_PUBLISHED on the client and starts the ack timeout
+// sweep and the periodic diagnostics publish.
+esp_err_t init_mqtt_inflight(esp_mqtt_client_handle_t client);
+
+// A QoS1 publish is reserved before esp_mqtt_client_publish() and committed
+// with the msg_id it returns, so a PUBACK that arrives before the commit is
+// still matched. The journal range it carries is acknowledged only once its
+// PUBACK arrives. Reserve returns INFLIGHT_NO_SLOT if the table is full;
+// cancel releases the slot of a publish that failed.
+int mqtt_inflight_reserve(const mqtt_inflight_msg_t *msg);
+void mqtt_inflight_commit(int handle, int msg_id);
+void mqtt_inflight_cancel(int handle);
+
+// True while PUBACKs for a journal replay batch are outstanding.
+bool mqtt_inflight_replay_pending(void);
+
+// Ack timeouts only run while connected; esp-mqtt resends unacknowledged QoS1
+// messages itself after a reconnect.
+void mqtt_inflight_on_connected(void);
+void mqtt_inflight_on_disconnected(void);
+
+void mqtt_inflight_get_stats(mqtt_inflight_stats_t *stats);
+
+#endif // MQTT_INFLIGHT_H
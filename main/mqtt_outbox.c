@@ -0,0 +1,534 @@
+#include <string.h>
+#include "mqtt_outbox.h"
+#include "outbox_config.h"
+#include "payload_config.h"
+#include "door_config.h"
+#include "door_journal.h"
+#include "door_handler.h"
+#include "journal_config.h"
+#include "mqtt_custom_handler.h"
+#include "mqtt_inflight.h"
+#include "metrics.h"
+#include "rtos_alloc.h"
+#include "door_trace.h"
+#include "settings.h"
+#include "door_reminder.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "MQTT_OUTBOX";
+
+typedef enum
+{
+    OUTBOX_MSG_PUBLISH,
+    OUTBOX_MSG_DOOR_EVENT
+} outbox_msg_kind_t;
+
+typedef struct
+{
+    outbox_msg_kind_t kind;
+    char topic[OUTBOX_TOPIC_MAX_LEN];
+    uint8_t payload[OUTBOX_PAYLOAD_MAX_LEN];
+    uint16_t payload_len;
+    uint16_t event_count; // Door events encoded in the payload
+    int qos;
+    int64_t enqueued_us;
+    int64_t origin_us;
+    uint32_t first_seq; // Door journal range carried by the payload, 0 if none
+    uint32_t last_seq;
+    door_payload_event_t event; // OUTBOX_MSG_DOOR_EVENT, encoded by the outbox task
+} outbox_msg_t;
+
+// Messages are built in place in a slot and the queue carries slot indexes, so
+// no caller needs a whole outbox_msg_t on its stack (the timer service and
+// esp_timer tasks enqueue too, on small stacks).
+#define OUTBOX_REPLAY_SLOT UINT8_MAX
+_Static_assert(OUTBOX_QUEUE_SIZE <= 32, "outbox slots are tracked in a 32-bit mask");
+
+static outbox_msg_t outbox_slots[OUTBOX_QUEUE_SIZE];
+static uint32_t outbox_slots_used = 0; // Bit per slot
+static QueueHandle_t outbox_queue = NULL;
+static SemaphoreHandle_t outbox_started = NULL;
+RTOS_QUEUE_STORAGE(outbox, OUTBOX_QUEUE_SIZE, sizeof(uint8_t));
+RTOS_SEMAPHORE_STORAGE(outbox_started);
+RTOS_TASK_STORAGE(outbox_task, OUTBOX_TASK_STACK_SIZE);
+static bool first_publish_logged = false;
+static mqtt_outbox_stats_t outbox_stats = {0};
+static portMUX_TYPE outbox_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Only used from the outbox task, kept off its stack
+static outbox_msg_t batch_msg;
+static door_payload_event_t batch_events[PAYLOAD_MAX_BATCH];
+
+static outbox_msg_t *outbox_claim_slot(void)
+{
+    outbox_msg_t *msg = NULL;
+
+    portENTER_CRITICAL(&outbox_stats_lock);
+    for (size_t i = 0; i < OUTBOX_QUEUE_SIZE; i++)
+    {
+        if (!(outbox_slots_used & (1u << i)))
+        {
+            outbox_slots_used |= 1u << i;
+            msg = &outbox_slots[i];
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&outbox_stats_lock);
+    return msg;
+}
+
+static void outbox_release_slot(const outbox_msg_t *msg)
+{
+    portENTER_CRITICAL(&outbox_stats_lock);
+    outbox_slots_used &= ~(1u << (msg - outbox_slots));
+    portEXIT_CRITICAL(&outbox_stats_lock);
+}
+
+static void outbox_record_sent(const outbox_msg_t *msg)
+{
+    int64_t now_us = esp_timer_get_time();
+    int64_t latency_us = now_us - msg->enqueued_us;
+    int64_t origin_latency_us = now_us - msg->origin_us;
+
+    if (!first_publish_logged)
+    {
+        first_publish_logged = true;
+        ESP_LOGI(TAG, "First publish %lld ms after boot", (long long)(now_us / 1000));
+    }
+
+    portENTER_CRITICAL(&outbox_stats_lock);
+    outbox_stats.sent++;
+    outbox_stats.last_latency_us = latency_us;
+    outbox_stats.total_latency_us += latency_us;
+    if (latency_us > outbox_stats.max_latency_us)
+    {
+        outbox_stats.max_latency_us = latency_us;
+    }
+    outbox_stats.last_origin_latency_us = origin_latency_us;
+    if (origin_latency_us > outbox_stats.max_origin_latency_us)
+    {
+        outbox_stats.max_origin_latency_us = origin_latency_us;
+    }
+    if (msg->event_count > 0)
+    {
+        outbox_stats.door_events += msg->event_count;
+        outbox_stats.door_payload_bytes += msg->payload_len;
+    }
+    portEXIT_CRITICAL(&outbox_stats_lock);
+
+    if (msg->event_count > 0)
+    {
+        // origin_us of a live door event batch is the time of its first edge, or of the end of a session
+        metrics_observe_ms(METRIC_HIST_EDGE_TO_PUBLISH_MS, (uint32_t)(origin_latency_us / 1000));
+        door_trace_note_published(msg->origin_us, msg->event_count);
+    }
+}
+
+// Returns the esp-mqtt msg_id, -1 if the message could not be queued. Queued is
+// not delivered: for QoS 1 the PUBACK is tracked by mqtt_inflight.
+static int outbox_publish_with_retry(const outbox_msg_t *msg)
+{
+    int max_retries = (int)settings_get(SETTING_PUBLISH_RETRIES);
+
+    for (int i = 0; i < max_retries; i++)
+    {
+        if (mqtt_client_handle == NULL)
+        {
+            ESP_LOGE(TAG, "MQTT client handle is NULL");
+            return -1;
+        }
+
+        int msg_id = esp_mqtt_client_publish(mqtt_client_handle, msg->topic, (const char *)msg->payload,
+                                             msg->payload_len, msg->qos, 0);
+        if (msg_id != -1)
+        {
+            ESP_LOGI(TAG, "Published %u bytes to %s", (unsigned)msg->payload_len, msg->topic);
+            return msg_id;
+        }
+
+        ESP_LOGW(TAG, "Publish attempt %d failed, retrying...", i + 1);
+        portENTER_CRITICAL(&outbox_stats_lock);
+        outbox_stats.retries++;
+        portEXIT_CRITICAL(&outbox_stats_lock);
+        metrics_inc(METRIC_PUBLISH_RETRIES);
+        vTaskDelay(pdMS_TO_TICKS(OUTBOX_RETRY_DELAY_MS));
+    }
+
+    ESP_LOGE(TAG, "Failed to publish message after %d attempts", max_retries);
+    return -1;
+}
+
+static int outbox_reserve(const outbox_msg_t *msg, bool replay)
+{
+    const mqtt_inflight_msg_t inflight = {.topic = msg->topic,
+                                          .origin_us = msg->origin_us,
+                                          .first_seq = msg->first_seq,
+                                          .last_seq = msg->last_seq,
+                                          .replay = replay};
+
+    return mqtt_inflight_reserve(&inflight);
+}
+
+static void outbox_send(const outbox_msg_t *msg)
+{
+    // Reserved first: the PUBACK can arrive before esp_mqtt_client_publish() returns
+    int handle = (msg->qos > 0) ? outbox_reserve(msg, false) : INFLIGHT_NO_SLOT;
+    int msg_id = outbox_publish_with_retry(msg);
+
+    if (msg_id == -1)
+    {
+        if (handle != INFLIGHT_NO_SLOT)
+        {
+            mqtt_inflight_cancel(handle);
+        }
+        portENTER_CRITICAL(&outbox_stats_lock);
+        outbox_stats.failed++;
+        portEXIT_CRITICAL(&outbox_stats_lock);
+        metrics_inc(METRIC_PUBLISH_FAILURES);
+        door_journal_mark_failed(msg->last_seq);
+        return;
+    }
+
+    outbox_record_sent(msg);
+    door_reminder_note_publish();
+    if (handle != INFLIGHT_NO_SLOT)
+    {
+        mqtt_inflight_commit(handle, msg_id);
+    }
+    else
+    {
+        // Nothing will confirm it, so trust esp-mqtt's outbox as before
+        door_journal_mark_delivered(msg->last_seq);
+    }
+}
+
+// Fills batch_msg with as many of the events as fit and returns how many it took
+static size_t outbox_encode_events(const door_payload_event_t *events, size_t count)
+{
+    size_t len = 0;
+    size_t encoded = door_payload_encode(events, count, batch_msg.payload, sizeof(batch_msg.payload), &len);
+
+    batch_msg.payload_len = (uint16_t)len;
+    batch_msg.event_count = (uint16_t)encoded;
+    batch_msg.first_seq = 0;
+    batch_msg.last_seq = 0;
+    for (size_t i = 0; i < encoded; i++)
+    {
+        if (events[i].seq != 0)
+        {
+            batch_msg.first_seq = batch_msg.first_seq ? batch_msg.first_seq : events[i].seq;
+            batch_msg.last_seq = events[i].seq;
+        }
+    }
+    return encoded;
+}
+
+// Coalesces the door event in first with any others already waiting in the
+// queue (or arriving within PAYLOAD_COALESCE_WINDOW_MS) into as few publishes
+// as the payload size allows.
+static void outbox_send_door_events(const outbox_msg_t *first)
+{
+    uint8_t slot;
+    size_t count = 0;
+    TickType_t wait = pdMS_TO_TICKS(PAYLOAD_COALESCE_WINDOW_MS);
+
+    batch_msg = (outbox_msg_t){.kind = OUTBOX_MSG_PUBLISH,
+                               .qos = first->qos,
+                               .enqueued_us = first->enqueued_us,
+                               .origin_us = first->origin_us};
+    strcpy(batch_msg.topic, first->topic);
+    batch_events[count++] = first->event;
+
+    while (count < PAYLOAD_MAX_BATCH && xQueuePeek(outbox_queue, &slot, wait) == pdTRUE &&
+           slot != OUTBOX_REPLAY_SLOT && outbox_slots[slot].kind == OUTBOX_MSG_DOOR_EVENT &&
+           strcmp(outbox_slots[slot].topic, first->topic) == 0)
+    {
+        xQueueReceive(outbox_queue, &slot, 0);
+        batch_events[count++] = outbox_slots[slot].event;
+        outbox_release_slot(&outbox_slots[slot]);
+    }
+
+    for (size_t offset = 0; offset < count;)
+    {
+        size_t encoded = outbox_encode_events(&batch_events[offset], count - offset);
+        if (encoded == 0)
+        {
+            ESP_LOGE(TAG, "Door event does not fit an outbox payload");
+            door_journal_mark_failed(batch_events[offset].seq);
+            return;
+        }
+        outbox_send(&batch_msg);
+        offset += encoded;
+    }
+}
+
+// The journal is acknowledged as PUBACKs for the batch arrive, and the last
+// one requests the next batch. Each run of events from one sensor goes to that
+// sensor's topic.
+static void outbox_replay_journal_batch(void)
+{
+    door_journal_entry_t entries[JOURNAL_REPLAY_BATCH];
+
+    if (mqtt_inflight_replay_pending())
+    {
+        return;
+    }
+
+    size_t count = door_journal_read_pending(entries, JOURNAL_REPLAY_BATCH);
+    if (count == 0)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        batch_events[i] = (door_payload_event_t){.seq = entries[i].seq,
+                                                 .state = entries[i].state,
+                                                 .flags = DOOR_EVENT_FLAG_REPLAY,
+                                                 .mono_us = entries[i].timestamp_us};
+    }
+
+    for (size_t offset = 0; offset < count;)
+    {
+        const char *topic = door_handler_sensor_topic(entries[offset].sensor);
+        size_t run = 1;
+
+        while (offset + run < count && entries[offset + run].sensor == entries[offset].sensor)
+        {
+            run++;
+        }
+
+        batch_msg = (outbox_msg_t){.kind = OUTBOX_MSG_PUBLISH, .qos = 1};
+        strcpy(batch_msg.topic, topic ? topic : CONFIG_MQTT_PUBLISH_DOOR_STATE_TOPIC);
+        size_t encoded = outbox_encode_events(&batch_events[offset], run);
+        batch_msg.enqueued_us = esp_timer_get_time();
+        batch_msg.origin_us = batch_events[offset].mono_us;
+
+        int handle = (encoded > 0) ? outbox_reserve(&batch_msg, true) : INFLIGHT_NO_SLOT;
+        int msg_id = (handle != INFLIGHT_NO_SLOT) ? outbox_publish_with_retry(&batch_msg) : -1;
+        if (msg_id == -1)
+        {
+            if (handle != INFLIGHT_NO_SLOT)
+            {
+                mqtt_inflight_cancel(handle);
+            }
+            // Leave the rest in the journal for the next batch or reconnect
+            ESP_LOGW(TAG, "Journal replay stopped at seq %lu", (unsigned long)batch_events[offset].seq);
+            return;
+        }
+
+        mqtt_inflight_commit(handle, msg_id);
+        portENTER_CRITICAL(&outbox_stats_lock);
+        outbox_stats.replayed += encoded;
+        portEXIT_CRITICAL(&outbox_stats_lock);
+        offset += encoded;
+    }
+
+    ESP_LOGI(TAG, "Replayed journal events %lu..%lu", (unsigned long)entries[0].seq,
+             (unsigned long)entries[count - 1].seq);
+}
+
+static void outbox_task(void *arg)
+{
+    uint8_t slot;
+
+    // Door events queue up from the moment GPIO is armed; hold them until
+    // there is an MQTT client to hand them to
+    xSemaphoreTake(outbox_started, portMAX_DELAY);
+
+    while (1)
+    {
+        if (xQueueReceive(outbox_queue, &slot, portMAX_DELAY))
+        {
+            if (slot == OUTBOX_REPLAY_SLOT)
+            {
+                outbox_replay_journal_batch();
+                continue;
+            }
+
+            const outbox_msg_t *msg = &outbox_slots[slot];
+            if (msg->kind == OUTBOX_MSG_DOOR_EVENT)
+            {
+                outbox_send_door_events(msg);
+            }
+            else
+            {
+                outbox_send(msg);
+            }
+            outbox_release_slot(msg);
+        }
+    }
+}
+
+static void outbox_drop(const char *topic, uint32_t seq)
+{
+    portENTER_CRITICAL(&outbox_stats_lock);
+    outbox_stats.dropped++;
+    portEXIT_CRITICAL(&outbox_stats_lock);
+    ESP_LOGW(TAG, "Outbox full, dropping message to %s", topic);
+    door_journal_mark_failed(seq);
+}
+
+// Claims a slot for a message to be built in place, NULL if the outbox is full
+static outbox_msg_t *outbox_begin(const char *topic, uint32_t seq)
+{
+    if (outbox_queue == NULL)
+    {
+        ESP_LOGE(TAG, "Outbox not initialized");
+        return NULL;
+    }
+
+    outbox_msg_t *msg = outbox_claim_slot();
+    if (msg == NULL)
+    {
+        outbox_drop(topic, seq);
+    }
+    return msg;
+}
+
+static bool outbox_enqueue(outbox_msg_t *msg)
+{
+    uint8_t slot = (uint8_t)(msg - outbox_slots);
+
+    // A queued replay request can hold the place a free slot promised
+    if (xQueueSend(outbox_queue, &slot, 0) != pdTRUE)
+    {
+        outbox_release_slot(msg);
+        outbox_drop(msg->topic, msg->last_seq);
+        return false;
+    }
+
+    uint32_t depth = (uint32_t)uxQueueMessagesWaiting(outbox_queue);
+    portENTER_CRITICAL(&outbox_stats_lock);
+    outbox_stats.enqueued++;
+    if (depth > outbox_stats.depth_high_water)
+    {
+        outbox_stats.depth_high_water = depth;
+    }
+    portEXIT_CRITICAL(&outbox_stats_lock);
+    return true;
+}
+
+static bool outbox_enqueue_payload(const char *topic, const uint8_t *payload, size_t payload_len, int qos,
+                                   int64_t origin_us)
+{
+    if (strlen(topic) >= OUTBOX_TOPIC_MAX_LEN || payload_len > OUTBOX_PAYLOAD_MAX_LEN)
+    {
+        ESP_LOGE(TAG, "Message too large for outbox");
+        return false;
+    }
+
+    outbox_msg_t *msg = outbox_begin(topic, 0);
+    if (msg == NULL)
+    {
+        return false;
+    }
+    *msg = (outbox_msg_t){.kind = OUTBOX_MSG_PUBLISH,
+                          .payload_len = (uint16_t)payload_len,
+                          .qos = qos,
+                          .enqueued_us = esp_timer_get_time(),
+                          .origin_us = origin_us};
+    strcpy(msg->topic, topic);
+    memcpy(msg->payload, payload, payload_len);
+
+    return outbox_enqueue(msg);
+}
+
+bool mqtt_outbox_enqueue(const char *topic, const char *payload, int qos)
+{
+    return outbox_enqueue_payload(topic, (const uint8_t *)payload, strlen(payload), qos, esp_timer_get_time());
+}
+
+bool mqtt_outbox_enqueue_door_event(const char *topic, const door_payload_event_t *event, int qos)
+{
+    if (strlen(topic) >= OUTBOX_TOPIC_MAX_LEN)
+    {
+        ESP_LOGE(TAG, "Topic too long for outbox");
+        door_journal_mark_failed(event->seq);
+        return false;
+    }
+
+    outbox_msg_t *msg = outbox_begin(topic, event->seq);
+    if (msg == NULL)
+    {
+        return false;
+    }
+    int64_t now_us = esp_timer_get_time();
+    // A session event leaves once the session ended, its latency counts from there
+    *msg = (outbox_msg_t){.kind = OUTBOX_MSG_DOOR_EVENT,
+                          .qos = qos,
+                          .enqueued_us = now_us,
+                          .origin_us = (event->flags & DOOR_EVENT_FLAG_SESSION) ? now_us : event->mono_us,
+                          .first_seq = event->seq,
+                          .last_seq = event->seq,
+                          .event = *event};
+    strcpy(msg->topic, topic);
+
+    return outbox_enqueue(msg);
+}
+
+void mqtt_outbox_request_replay(void)
+{
+    uint8_t slot = OUTBOX_REPLAY_SLOT;
+
+    if (outbox_queue == NULL || !door_journal_replay_needed())
+    {
+        return;
+    }
+
+    if (xQueueSend(outbox_queue, &slot, 0) != pdTRUE)
+    {
+        ESP_LOGW(TAG, "Outbox full, journal replay deferred");
+    }
+}
+
+void mqtt_outbox_start(void)
+{
+    if (outbox_started != NULL)
+    {
+        xSemaphoreGive(outbox_started);
+    }
+}
+
+void mqtt_outbox_get_stats(mqtt_outbox_stats_t *stats)
+{
+    portENTER_CRITICAL(&outbox_stats_lock);
+    *stats = outbox_stats;
+    portEXIT_CRITICAL(&outbox_stats_lock);
+    stats->depth = (outbox_queue != NULL) ? (uint32_t)uxQueueMessagesWaiting(outbox_queue) : 0;
+}
+
+esp_err_t init_mqtt_outbox(void)
+{
+    outbox_queue = RTOS_QUEUE_CREATE(outbox, OUTBOX_QUEUE_SIZE, sizeof(uint8_t));
+    outbox_started = RTOS_BINARY_SEMAPHORE_CREATE(outbox_started);
+    if (outbox_queue == NULL || outbox_started == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create outbox queue");
+        return ESP_FAIL;
+    }
+
+    TaskHandle_t outbox_task_handle = NULL;
+    BaseType_t task_created = RTOS_TASK_CREATE(
+        outbox_task,
+        outbox_task,
+        "outbox_task",
+        NULL,
+        OUTBOX_TASK_PRIORITY,
+        &outbox_task_handle,
+        OUTBOX_TASK_CORE);
+
+    if (task_created != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create outbox task");
+        return ESP_FAIL;
+    }
+    metrics_watch_task(outbox_task_handle);
+
+    return ESP_OK;
+}
@@ -0,0 +1,48 @@
+#ifndef MQTT_OUTBOX_H
+#define MQTT_OUTBOX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "door_payload.h"
+
+typedef struct
+{
+    uint32_t enqueued;
+    uint32_t sent;      // Handed to esp-mqtt; see mqtt_inflight for PUBACKs
+    uint32_t dropped;   // Rejected at enqueue time because the outbox was full
+    uint32_t failed;    // Gave up after all publish retries
+    uint32_t retries;
+    uint32_t replayed;
+    uint32_t depth;
+    uint32_t depth_high_water;
+    int64_t last_latency_us; // Enqueue-to-send latency of the most recent message
+    int64_t max_latency_us;
+    int64_t total_latency_us;
+    int64_t last_origin_latency_us; // Origin-to-send latency, e.g. GPIO edge to publish
+    int64_t max_origin_latency_us;
+    uint32_t door_events;        // Door events handed to esp-mqtt, possibly several per publish
+    uint32_t door_payload_bytes; // Payload bytes that carried them
+} mqtt_outbox_stats_t;
+
+// Creates the queue so messages can be enqueued right away. Nothing is
+// published before mqtt_outbox_start(), called once the MQTT client exists.
+esp_err_t init_mqtt_outbox(void);
+void mqtt_outbox_start(void);
+
+// Copies topic and payload into the outbox and returns immediately. Safe to call
+// from any task, including the FreeRTOS timer service task.
+bool mqtt_outbox_enqueue(const char *topic, const char *payload, int qos);
+
+// Queues a door event for the outbox task, which encodes it with door_payload
+// together with any other door events waiting for the same topic. A non-zero
+// event->seq ties it to its door journal entry, which is trimmed once the
+// broker acknowledges it.
+bool mqtt_outbox_enqueue_door_event(const char *topic, const door_payload_event_t *event, int qos);
+
+// Asks the outbox task to republish journaled events that were never delivered.
+void mqtt_outbox_request_replay(void);
+
+void mqtt_outbox_get_stats(mqtt_outbox_stats_t *stats);
+
+#endif // MQTT_OUTBOX_H
@@ -0,0 +1,206 @@
+#include "mqtt_reconnect.h"
+#include "reconnect_config.h"
+#include "door_journal.h"
+#include "metrics.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_log.h"
+#include "gecl-wifi-manager.h"
+#include "gecl-misc-util-manager.h"
+
+static const char *TAG = "MQTT_RECONNECT";
+
+typedef enum
+{
+    RECONNECT_IDLE,
+    RECONNECT_WAIT_WIFI,
+    RECONNECT_WAIT_BROKER
+} reconnect_state_t;
+
+static esp_timer_handle_t reconnect_timer = NULL;
+static esp_mqtt_client_handle_t reconnect_client = NULL;
+static reconnect_state_t reconnect_state = RECONNECT_IDLE;
+static uint32_t attempt = 0;
+static int64_t outage_start_us = 0;
+static int64_t wifi_down_since_us = 0;
+static mqtt_reconnect_stats_t reconnect_stats = {0};
+static portMUX_TYPE reconnect_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Exponential backoff with "equal jitter": half the delay is fixed, the other
+// half random, so a fleet that lost the broker together does not retry in lockstep.
+static uint32_t backoff_delay_ms(uint32_t n)
+{
+    uint32_t delay_ms = RECONNECT_BASE_DELAY_MS;
+
+    while (n-- > 0 && delay_ms < RECONNECT_MAX_DELAY_MS)
+    {
+        delay_ms *= 2;
+    }
+    if (delay_ms > RECONNECT_MAX_DELAY_MS)
+    {
+        delay_ms = RECONNECT_MAX_DELAY_MS;
+    }
+
+    return delay_ms / 2 + esp_random() % (delay_ms / 2 + 1);
+}
+
+static void schedule_next(uint32_t delay_ms)
+{
+    esp_timer_stop(reconnect_timer);
+    esp_timer_start_once(reconnect_timer, (uint64_t)delay_ms * 1000);
+}
+
+static void reconnect_restart(void *arg)
+{
+    error_reload(reconnect_client);
+}
+
+// Runs in the esp_timer callback, so the flash flush and the restart are left
+// to journal_task
+static void reconnect_give_up(const char *reason)
+{
+    ESP_LOGE(TAG, "%s. Restarting", reason);
+    portENTER_CRITICAL(&reconnect_lock);
+    reconnect_stats.reboots++;
+    portEXIT_CRITICAL(&reconnect_lock);
+    door_journal_flush_async(reconnect_restart, NULL);
+}
+
+static void reconnect_timer_callback(void *arg)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    if (reconnect_state == RECONNECT_IDLE)
+    {
+        return;
+    }
+
+    if (!wifi_active())
+    {
+        if (reconnect_state != RECONNECT_WAIT_WIFI)
+        {
+            ESP_LOGW(TAG, "Wi-Fi down, waiting for it before reconnecting MQTT");
+            reconnect_state = RECONNECT_WAIT_WIFI;
+            wifi_down_since_us = now_us;
+            portENTER_CRITICAL(&reconnect_lock);
+            reconnect_stats.wifi_down_events++;
+            portEXIT_CRITICAL(&reconnect_lock);
+        }
+        else if (now_us - wifi_down_since_us > (int64_t)RECONNECT_WIFI_DOWN_MAX_MS * 1000)
+        {
+            reconnect_give_up("Wi-Fi did not come back");
+            return;
+        }
+
+        schedule_next(RECONNECT_WIFI_POLL_MS);
+        return;
+    }
+
+    if (reconnect_state == RECONNECT_WAIT_WIFI)
+    {
+        // Wi-Fi just came back: the broker has not failed us yet
+        ESP_LOGI(TAG, "Wi-Fi back after %lld ms", (long long)((now_us - wifi_down_since_us) / 1000));
+        attempt = 0;
+    }
+    reconnect_state = RECONNECT_WAIT_BROKER;
+
+    if (attempt >= RECONNECT_MAX_ATTEMPTS)
+    {
+        reconnect_give_up("Broker unreachable after all reconnect attempts");
+        return;
+    }
+
+    attempt++;
+    portENTER_CRITICAL(&reconnect_lock);
+    reconnect_stats.attempts++;
+    portEXIT_CRITICAL(&reconnect_lock);
+
+    uint32_t delay_ms = backoff_delay_ms(attempt);
+    ESP_LOGI(TAG, "Reconnect attempt %lu/%d, next check in %lu ms", (unsigned long)attempt, RECONNECT_MAX_ATTEMPTS,
+             (unsigned long)delay_ms);
+
+    esp_err_t err = esp_mqtt_client_reconnect(reconnect_client);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "esp_mqtt_client_reconnect failed: %s", esp_err_to_name(err));
+    }
+
+    // Re-armed unconditionally; mqtt_reconnect_on_connected() cancels it
+    schedule_next(delay_ms);
+}
+
+void mqtt_reconnect_on_disconnected(esp_mqtt_client_handle_t client)
+{
+    if (reconnect_timer == NULL)
+    {
+        ESP_LOGE(TAG, "Reconnect scheduler not initialized");
+        return;
+    }
+
+    reconnect_client = client;
+    portENTER_CRITICAL(&reconnect_lock);
+    reconnect_stats.disconnects++;
+    portEXIT_CRITICAL(&reconnect_lock);
+
+    if (reconnect_state != RECONNECT_IDLE)
+    {
+        // Failed attempt within an outage already being handled
+        return;
+    }
+
+    outage_start_us = esp_timer_get_time();
+    attempt = 0;
+    reconnect_state = RECONNECT_WAIT_BROKER;
+    schedule_next(backoff_delay_ms(0));
+}
+
+void mqtt_reconnect_on_connected(void)
+{
+    if (reconnect_timer == NULL || reconnect_state == RECONNECT_IDLE)
+    {
+        return;
+    }
+
+    esp_timer_stop(reconnect_timer);
+    reconnect_state = RECONNECT_IDLE;
+
+    int64_t recovery_us = esp_timer_get_time() - outage_start_us;
+    portENTER_CRITICAL(&reconnect_lock);
+    reconnect_stats.recoveries++;
+    reconnect_stats.last_recovery_us = recovery_us;
+    reconnect_stats.total_recovery_us += recovery_us;
+    if (reconnect_stats.min_recovery_us == 0 || recovery_us < reconnect_stats.min_recovery_us)
+    {
+        reconnect_stats.min_recovery_us = recovery_us;
+    }
+    if (recovery_us > reconnect_stats.max_recovery_us)
+    {
+        reconnect_stats.max_recovery_us = recovery_us;
+    }
+    portEXIT_CRITICAL(&reconnect_lock);
+    metrics_observe_ms(METRIC_HIST_RECONNECT_MS, (uint32_t)(recovery_us / 1000));
+
+    ESP_LOGI(TAG, "MQTT recovered after %lld ms and %lu attempts", (long long)(recovery_us / 1000),
+             (unsigned long)attempt);
+}
+
+void mqtt_reconnect_get_stats(mqtt_reconnect_stats_t *stats)
+{
+    portENTER_CRITICAL(&reconnect_lock);
+    *stats = reconnect_stats;
+    portEXIT_CRITICAL(&reconnect_lock);
+}
+
+esp_err_t init_mqtt_reconnect(void)
+{
+    const esp_timer_create_args_t timer_args = {.callback = reconnect_timer_callback, .name = "mqtt_reconnect"};
+
+    if (esp_timer_create(&timer_args, &reconnect_timer) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to create reconnect timer");
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
@@ -0,0 +1,29 @@
+#ifndef MQTT_RECONNECT_H
+#define MQTT_RECONNECT_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "mqtt_client.h"
+
+typedef struct
+{
+    uint32_t disconnects;
+    uint32_t attempts;
+    uint32_t wifi_down_events;
+    uint32_t recoveries;
+    uint32_t reboots;
+    int64_t last_recovery_us;
+    int64_t min_recovery_us;
+    int64_t max_recovery_us;
+    int64_t total_recovery_us;
+} mqtt_reconnect_stats_t;
+
+esp_err_t init_mqtt_reconnect(void);
+
+// Both are safe to call from the MQTT event handler; neither blocks.
+void mqtt_reconnect_on_disconnected(esp_mqtt_client_handle_t client);
+void mqtt_reconnect_on_connected(void);
+
+void mqtt_reconnect_get_stats(mqtt_reconnect_stats_t *stats);
+
+#endif // MQTT_RECONNECT_H
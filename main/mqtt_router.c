@@ -0,0 +1,116 @@
+#include <stdbool.h>
+#include <string.h>
+#include "mqtt_router.h"
+#include "mqtt_topic_match.h"
+#include "router_config.h"
+#include "esp_log.h"
+
+static const char *TAG = "MQTT_ROUTER";
+
+static const mqtt_route_t *route_table = NULL;
+static size_t route_count = 0;
+static topic_index_t topic_index;
+
+// Message in progress; only the first chunk of a message carries its topic
+static int active_route = -1;
+static bool active_dropped = false;
+static char active_topic[MQTT_ROUTER_TOPIC_MAX_LEN];
+static size_t active_topic_len = 0;
+
+esp_err_t mqtt_router_init(const mqtt_route_t *routes, size_t count)
+{
+    if (count > MQTT_ROUTER_MAX_ROUTES)
+    {
+        ESP_LOGE(TAG, "%u routes, at most %d fit", (unsigned)count, MQTT_ROUTER_MAX_ROUTES);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    route_table = routes;
+    route_count = count;
+    topic_index_init(&topic_index);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (topic_index_add(&topic_index, routes[i].filter) < 0)
+        {
+            ESP_LOGE(TAG, "Topic %s routed twice", routes[i].filter);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return ESP_OK;
+}
+
+void mqtt_router_subscribe(esp_mqtt_client_handle_t client)
+{
+    for (size_t i = 0; i < route_count; i++)
+    {
+        int msg_id = esp_mqtt_client_subscribe(client, route_table[i].filter, route_table[i].qos);
+        ESP_LOGI(TAG, "Subscribed to topic %s, msg_id=%d", route_table[i].filter, msg_id);
+    }
+}
+
+void mqtt_router_dispatch(esp_mqtt_event_handle_t event)
+{
+    size_t offset = (size_t)event->current_data_offset;
+    size_t len = (size_t)event->data_len;
+    size_t total_len = (size_t)event->total_data_len;
+
+    if (offset == 0)
+    {
+        active_route = topic_index_match(&topic_index, event->topic, event->topic_len);
+        if (active_route < 0)
+        {
+            ESP_LOGE(TAG, "Un-Handled topic %.*s", event->topic_len, event->topic);
+            return;
+        }
+        active_topic_len = ((size_t)event->topic_len < sizeof(active_topic)) ? (size_t)event->topic_len
+                                                                             : sizeof(active_topic) - 1;
+        memcpy(active_topic, event->topic, active_topic_len);
+        active_topic[active_topic_len] = '\0';
+
+        const mqtt_route_t *route = &route_table[active_route];
+        active_dropped = route->buffer != NULL && total_len >= route->buffer_size;
+        if (active_dropped)
+        {
+            ESP_LOGE(TAG, "Payload of %u bytes on %s exceeds %u", (unsigned)total_len, active_topic,
+                     (unsigned)(route->buffer_size - 1));
+        }
+    }
+
+    if (active_route < 0 || offset + len > total_len)
+    {
+        return;
+    }
+
+    const mqtt_route_t *route = &route_table[active_route];
+    bool last = offset + len >= total_len;
+    mqtt_route_msg_t msg = {.topic = active_topic,
+                            .topic_len = active_topic_len,
+                            .data = event->data,
+                            .len = len,
+                            .offset = offset,
+                            .total_len = total_len};
+
+    if (route->buffer != NULL)
+    {
+        if (active_dropped)
+        {
+            return;
+        }
+        memcpy(route->buffer + offset, event->data, len);
+        if (!last)
+        {
+            return;
+        }
+        route->buffer[total_len] = '\0';
+        msg.data = route->buffer;
+        msg.len = total_len;
+        msg.offset = 0;
+    }
+
+    route->handler(&msg);
+    if (last)
+    {
+        active_route = -1;
+    }
+}
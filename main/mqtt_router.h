@@ -0,0 +1,40 @@
+#ifndef MQTT_ROUTER_H
+#define MQTT_ROUTER_H
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "mqtt_client.h"
+
+typedef struct
+{
+    const char *topic; // Not NUL-terminated
+    size_t topic_len;
+    const char *data;
+    size_t len;
+    size_t offset;     // Of data within the payload; 0 when the route reassembles
+    size_t total_len;
+} mqtt_route_msg_t;
+
+typedef void (*mqtt_route_handler_t)(const mqtt_route_msg_t *msg);
+
+typedef struct
+{
+    const char *filter; // As given to SUBSCRIBE, may use + and #
+    int qos;
+    mqtt_route_handler_t handler;
+    // With a buffer, a payload split over several MQTT_EVENT_DATA events is
+    // collected and handed over once, NUL-terminated; payloads that do not fit
+    // are dropped. Without one the handler sees every chunk as it arrives.
+    char *buffer;
+    size_t buffer_size;
+} mqtt_route_t;
+
+// Indexes a route table once, see mqtt_topic_match.h; a topic goes to the
+// first wildcard route only when no exact route matched. The table and its
+// filter strings must outlive the router.
+esp_err_t mqtt_router_init(const mqtt_route_t *routes, size_t count);
+
+void mqtt_router_subscribe(esp_mqtt_client_handle_t client);
+void mqtt_router_dispatch(esp_mqtt_event_handle_t event);
+
+#endif // MQTT_ROUTER_H
@@ -0,0 +1,135 @@
+#include <string.h>
+#include "mqtt_topic_match.h"
+
+_Static_assert((MQTT_ROUTER_HASH_SLOTS & (MQTT_ROUTER_HASH_SLOTS - 1)) == 0, "hash slots must be a power of two");
+_Static_assert(MQTT_ROUTER_HASH_SLOTS >= 2 * MQTT_ROUTER_MAX_ROUTES, "hash index too small for the route table");
+
+// FNV-1a
+static uint32_t topic_hash(const char *topic, size_t len)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ (uint8_t)topic[i]) * 16777619u;
+    }
+    return hash;
+}
+
+bool topic_filter_matches(const char *filter, const char *topic, size_t topic_len)
+{
+    size_t t = 0;
+
+    // Wildcards at the first level do not match $-topics such as $aws/...
+    if (topic_len > 0 && topic[0] == '$' && (filter[0] == '+' || filter[0] == '#'))
+    {
+        return false;
+    }
+
+    while (*filter != '\0')
+    {
+        if (*filter == '#')
+        {
+            return true;
+        }
+        if (*filter == '+')
+        {
+            while (t < topic_len && topic[t] != '/')
+            {
+                t++;
+            }
+            filter++;
+        }
+        else if (t < topic_len && topic[t] == *filter)
+        {
+            t++;
+            filter++;
+        }
+        else
+        {
+            // "a/#" also matches its parent level "a"
+            return t == topic_len && strcmp(filter, "/#") == 0;
+        }
+    }
+    return t == topic_len;
+}
+
+static int exact_lookup(const topic_index_t *index, const char *topic, size_t topic_len, uint32_t hash)
+{
+    for (size_t probe = 0; probe < MQTT_ROUTER_HASH_SLOTS; probe++)
+    {
+        const topic_slot_t *slot = &index->exact[(hash + probe) & (MQTT_ROUTER_HASH_SLOTS - 1)];
+        if (slot->filter < 0)
+        {
+            break;
+        }
+        if (slot->hash == hash && index->filter_lens[slot->filter] == topic_len &&
+            memcmp(index->filters[slot->filter], topic, topic_len) == 0)
+        {
+            return slot->filter;
+        }
+    }
+    return -1;
+}
+
+void topic_index_init(topic_index_t *index)
+{
+    memset(index, 0, sizeof(*index));
+    for (size_t i = 0; i < MQTT_ROUTER_HASH_SLOTS; i++)
+    {
+        index->exact[i].filter = -1;
+    }
+}
+
+int topic_index_add(topic_index_t *index, const char *filter)
+{
+    size_t len = strlen(filter);
+    int position = (int)index->count;
+
+    if (index->count >= MQTT_ROUTER_MAX_ROUTES)
+    {
+        return -1;
+    }
+
+    if (strpbrk(filter, "+#") != NULL)
+    {
+        index->wildcards[index->wildcard_count++] = (uint8_t)position;
+    }
+    else
+    {
+        uint32_t hash = topic_hash(filter, len);
+        if (exact_lookup(index, filter, len, hash) >= 0)
+        {
+            return -1;
+        }
+        size_t slot = hash & (MQTT_ROUTER_HASH_SLOTS - 1);
+        while (index->exact[slot].filter >= 0)
+        {
+            slot = (slot + 1) & (MQTT_ROUTER_HASH_SLOTS - 1);
+        }
+        index->exact[slot] = (topic_slot_t){.hash = hash, .filter = (int8_t)position};
+    }
+
+    index->filters[position] = filter;
+    index->filter_lens[position] = (uint16_t)len;
+    index->count++;
+    return position;
+}
+
+int topic_index_match(const topic_index_t *index, const char *topic, size_t topic_len)
+{
+    int match = exact_lookup(index, topic, topic_len, topic_hash(topic, topic_len));
+
+    if (match >= 0)
+    {
+        return match;
+    }
+    for (size_t i = 0; i < index->wildcard_count; i++)
+    {
+        if (topic_filter_matches(index->filters[index->wildcards[i]], topic, topic_len))
+        {
+            return index->wildcards[i];
+        }
+    }
+    return -1;
+}
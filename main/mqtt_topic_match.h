@@ -0,0 +1,41 @@
+#ifndef MQTT_TOPIC_MATCH_H
+#define MQTT_TOPIC_MATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "router_config.h"
+
+// Topic filter index behind mqtt_router.c, with no RTOS or driver
+// dependencies. Exact filters go into a hash index, so a lookup costs one hash
+// of the topic and one compare; wildcard filters are matched by segment, in
+// the order added, and only when no exact filter matched.
+// tools/host/test_mqtt_topic_match.py runs it on the host.
+typedef struct
+{
+    uint32_t hash;
+    int8_t filter; // -1 for an empty slot
+} topic_slot_t;
+
+typedef struct
+{
+    const char *filters[MQTT_ROUTER_MAX_ROUTES];
+    uint16_t filter_lens[MQTT_ROUTER_MAX_ROUTES];
+    size_t count;
+    topic_slot_t exact[MQTT_ROUTER_HASH_SLOTS];
+    uint8_t wildcards[MQTT_ROUTER_MAX_ROUTES];
+    size_t wildcard_count;
+} topic_index_t;
+
+void topic_index_init(topic_index_t *index);
+
+// Adds a filter as given to SUBSCRIBE, which must outlive the index. Returns
+// its position, or -1 when the index is full or the exact filter is already in.
+int topic_index_add(topic_index_t *index, const char *filter);
+
+// Position of the filter a topic (not NUL-terminated) goes to, or -1
+int topic_index_match(const topic_index_t *index, const char *topic, size_t topic_len);
+
+bool topic_filter_matches(const char *filter, const char *topic, size_t topic_len);
+
+#endif // MQTT_TOPIC_MATCH_H
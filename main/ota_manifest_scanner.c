@@ -0,0 +1,264 @@
+#include <ctype.h>
+#include <string.h>
+#include "ota_manifest_scanner.h"
+
+enum
+{
+    SCAN_EXPECT_OBJECT,
+    SCAN_EXPECT_KEY,
+    SCAN_IN_KEY,
+    SCAN_EXPECT_COLON,
+    SCAN_EXPECT_VALUE,
+    SCAN_IN_VALUE,
+    SCAN_SKIP_NESTED,
+    SCAN_SKIP_NESTED_STRING,
+    SCAN_SKIP_LITERAL,
+    SCAN_AFTER_VALUE
+};
+
+static bool is_ws(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Keys match case-insensitively, like cJSON_GetObjectItem() did, so a manifest
+// with upper-case MACs still finds the device
+static bool key_char_matches(char a, char b)
+{
+    return tolower((unsigned char)a) == tolower((unsigned char)b);
+}
+
+static char unescape(char c)
+{
+    switch (c)
+    {
+    case 'n':
+        return '\n';
+    case 't':
+        return '\t';
+    case 'r':
+        return '\r';
+    default:
+        return c; // \" \\ \/ and anything we do not expect in a URL
+    }
+}
+
+void ota_scanner_init(ota_manifest_scanner_t *scanner, const char *key, char *out, size_t out_size)
+{
+    memset(scanner, 0, sizeof(*scanner));
+    scanner->key = key;
+    scanner->key_len = strlen(key);
+    scanner->out = out;
+    scanner->out_size = out_size;
+    scanner->state = SCAN_EXPECT_OBJECT;
+    scanner->result = OTA_SCAN_MORE;
+    if (out_size > 0)
+    {
+        out[0] = '\0';
+    }
+}
+
+static ota_scan_result_t scanner_finish(ota_manifest_scanner_t *scanner, ota_scan_result_t result)
+{
+    scanner->result = result;
+    return result;
+}
+
+static ota_scan_result_t scan_char(ota_manifest_scanner_t *scanner, char c)
+{
+    switch (scanner->state)
+    {
+    case SCAN_EXPECT_OBJECT:
+        if (c == '{')
+        {
+            scanner->state = SCAN_EXPECT_KEY;
+        }
+        else if (!is_ws(c))
+        {
+            return OTA_SCAN_ERROR;
+        }
+        break;
+
+    case SCAN_EXPECT_KEY:
+        if (c == '"')
+        {
+            scanner->state = SCAN_IN_KEY;
+            scanner->key_pos = 0;
+            scanner->key_match = true;
+        }
+        else if (c == '}')
+        {
+            return OTA_SCAN_NOT_FOUND;
+        }
+        else if (!is_ws(c))
+        {
+            return OTA_SCAN_ERROR;
+        }
+        break;
+
+    case SCAN_IN_KEY:
+        if (scanner->escape)
+        {
+            scanner->escape = false;
+            scanner->key_match = false; // Our keys never contain escapes
+        }
+        else if (c == '\\')
+        {
+            scanner->escape = true;
+        }
+        else if (c == '"')
+        {
+            scanner->key_match = scanner->key_match && scanner->key_pos == scanner->key_len;
+            scanner->state = SCAN_EXPECT_COLON;
+        }
+        else if (scanner->key_match && scanner->key_pos < scanner->key_len &&
+                 key_char_matches(c, scanner->key[scanner->key_pos]))
+        {
+            scanner->key_pos++;
+        }
+        else
+        {
+            scanner->key_match = false;
+        }
+        break;
+
+    case SCAN_EXPECT_COLON:
+        if (c == ':')
+        {
+            scanner->state = SCAN_EXPECT_VALUE;
+        }
+        else if (!is_ws(c))
+        {
+            return OTA_SCAN_ERROR;
+        }
+        break;
+
+    case SCAN_EXPECT_VALUE:
+        if (c == '"')
+        {
+            if (scanner->key_match && scanner->out_size == 0)
+            {
+                return OTA_SCAN_ERROR; // No room even for the terminator
+            }
+            scanner->state = SCAN_IN_VALUE;
+            scanner->out_len = 0;
+        }
+        else if (c == '{' || c == '[')
+        {
+            scanner->state = SCAN_SKIP_NESTED;
+            scanner->depth = 1;
+        }
+        else if (!is_ws(c))
+        {
+            scanner->state = SCAN_SKIP_LITERAL;
+        }
+        break;
+
+    case SCAN_IN_VALUE:
+        if (!scanner->escape && c == '\\')
+        {
+            scanner->escape = true;
+            break;
+        }
+        if (!scanner->escape && c == '"')
+        {
+            if (scanner->key_match)
+            {
+                scanner->out[scanner->out_len] = '\0';
+                return OTA_SCAN_FOUND;
+            }
+            scanner->state = SCAN_AFTER_VALUE;
+            break;
+        }
+        if (scanner->key_match)
+        {
+            if (scanner->out_len + 1 >= scanner->out_size)
+            {
+                return OTA_SCAN_ERROR;
+            }
+            scanner->out[scanner->out_len++] = scanner->escape ? unescape(c) : c;
+        }
+        scanner->escape = false;
+        break;
+
+    case SCAN_SKIP_NESTED:
+        if (c == '"')
+        {
+            scanner->state = SCAN_SKIP_NESTED_STRING;
+        }
+        else if (c == '{' || c == '[')
+        {
+            scanner->depth++;
+        }
+        else if ((c == '}' || c == ']') && --scanner->depth == 0)
+        {
+            scanner->state = SCAN_AFTER_VALUE;
+        }
+        break;
+
+    case SCAN_SKIP_NESTED_STRING:
+        if (scanner->escape)
+        {
+            scanner->escape = false;
+        }
+        else if (c == '\\')
+        {
+            scanner->escape = true;
+        }
+        else if (c == '"')
+        {
+            scanner->state = SCAN_SKIP_NESTED;
+        }
+        break;
+
+    case SCAN_SKIP_LITERAL:
+        if (c == ',')
+        {
+            scanner->state = SCAN_EXPECT_KEY;
+        }
+        else if (c == '}')
+        {
+            return OTA_SCAN_NOT_FOUND;
+        }
+        break;
+
+    case SCAN_AFTER_VALUE:
+        if (c == ',')
+        {
+            scanner->state = SCAN_EXPECT_KEY;
+        }
+        else if (c == '}')
+        {
+            return OTA_SCAN_NOT_FOUND;
+        }
+        else if (!is_ws(c))
+        {
+            return OTA_SCAN_ERROR;
+        }
+        break;
+
+    default:
+        return OTA_SCAN_ERROR;
+    }
+
+    return OTA_SCAN_MORE;
+}
+
+ota_scan_result_t ota_scanner_feed(ota_manifest_scanner_t *scanner, const char *data, size_t len)
+{
+    if (scanner->result != OTA_SCAN_MORE)
+    {
+        return scanner->result;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        ota_scan_result_t result = scan_char(scanner, data[i]);
+        if (result != OTA_SCAN_MORE)
+        {
+            return scanner_finish(scanner, result);
+        }
+    }
+
+    return OTA_SCAN_MORE;
+}
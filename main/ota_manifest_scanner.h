@@ -0,0 +1,42 @@
+#ifndef OTA_MANIFEST_SCANNER_H
+#define OTA_MANIFEST_SCANNER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum
+{
+    OTA_SCAN_MORE,      // Need more input
+    OTA_SCAN_FOUND,     // Value for the key is in the output buffer
+    OTA_SCAN_NOT_FOUND, // Top-level object closed without the key
+    OTA_SCAN_ERROR      // Malformed JSON or value larger than the output buffer
+} ota_scan_result_t;
+
+// Incremental scanner for a flat JSON object such as the fleet OTA manifest
+// {"aa:bb:cc:dd:ee:ff": "https://...", ...}. It keeps no copy of the input and
+// allocates nothing, so a payload split over several MQTT_EVENT_DATA chunks can
+// be fed piece by piece, and scanning stops as soon as the key has been seen.
+// Keys compare case-insensitively. tools/host/test_ota_manifest_scanner.py runs
+// it on the host and tools/ota/bench_manifest_scan.py compares it with cJSON.
+typedef struct
+{
+    const char *key;
+    size_t key_len;
+    char *out;
+    size_t out_size;
+    size_t out_len;
+    size_t key_pos;
+    int state;
+    int depth;
+    bool key_match;
+    bool escape;
+    ota_scan_result_t result;
+} ota_manifest_scanner_t;
+
+void ota_scanner_init(ota_manifest_scanner_t *scanner, const char *key, char *out, size_t out_size);
+
+// Feeds the next chunk. Once a terminal result has been returned, further
+// input is ignored and the same result is returned again.
+ota_scan_result_t ota_scanner_feed(ota_manifest_scanner_t *scanner, const char *data, size_t len);
+
+#endif // OTA_MANIFEST_SCANNER_H
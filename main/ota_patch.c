@@ -0,0 +1,173 @@
+#include <string.h>
+#include "ota_patch.h"
+
+#define OTA_PATCH_NO_OP -1
+
+static uint32_t read_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static size_t args_size(int op)
+{
+    return op == OTA_PATCH_OP_INSERT ? 4 : 8;
+}
+
+void ota_patch_init(ota_patch_t *patch, uint32_t base_size, ota_patch_read_t read_base, ota_patch_write_t write,
+                    void *ctx)
+{
+    memset(patch, 0, sizeof(*patch));
+    patch->read_base = read_base;
+    patch->write = write;
+    patch->ctx = ctx;
+    patch->base_size = base_size;
+    patch->op = OTA_PATCH_NO_OP;
+    patch->result = OTA_PATCH_OK;
+}
+
+static ota_patch_result_t emit(ota_patch_t *patch, const uint8_t *data, size_t len)
+{
+    if (!patch->write(patch->ctx, data, len))
+    {
+        return OTA_PATCH_IO_ERROR;
+    }
+    patch->written += len;
+    return OTA_PATCH_OK;
+}
+
+// COPY carries no body, so it runs as soon as its arguments are in
+static ota_patch_result_t copy_base(ota_patch_t *patch)
+{
+    while (patch->remaining > 0)
+    {
+        size_t take = patch->remaining < sizeof(patch->buf) ? patch->remaining : sizeof(patch->buf);
+        if (!patch->read_base(patch->ctx, patch->src, patch->buf, take))
+        {
+            return OTA_PATCH_IO_ERROR;
+        }
+        ota_patch_result_t result = emit(patch, patch->buf, take);
+        if (result != OTA_PATCH_OK)
+        {
+            return result;
+        }
+        patch->src += take;
+        patch->remaining -= take;
+    }
+    patch->op = OTA_PATCH_NO_OP;
+    return OTA_PATCH_OK;
+}
+
+static ota_patch_result_t start_op(ota_patch_t *patch)
+{
+    if (patch->op == OTA_PATCH_OP_INSERT)
+    {
+        patch->remaining = read_le32(patch->args);
+    }
+    else
+    {
+        patch->src = read_le32(patch->args);
+        patch->remaining = read_le32(patch->args + 4);
+        if (patch->src > patch->base_size || patch->remaining > patch->base_size - patch->src)
+        {
+            return OTA_PATCH_OUT_OF_RANGE;
+        }
+        if (patch->op == OTA_PATCH_OP_COPY)
+        {
+            return copy_base(patch);
+        }
+    }
+
+    if (patch->remaining == 0)
+    {
+        patch->op = OTA_PATCH_NO_OP;
+    }
+    return OTA_PATCH_OK;
+}
+
+// Consumes up to len body bytes of the current DIFF or INSERT
+static ota_patch_result_t body(ota_patch_t *patch, const uint8_t *data, size_t len, size_t *used)
+{
+    size_t take = len < patch->remaining ? len : patch->remaining;
+    ota_patch_result_t result;
+
+    if (patch->op == OTA_PATCH_OP_DIFF)
+    {
+        if (take > sizeof(patch->buf))
+        {
+            take = sizeof(patch->buf);
+        }
+        if (!patch->read_base(patch->ctx, patch->src, patch->buf, take))
+        {
+            return OTA_PATCH_IO_ERROR;
+        }
+        for (size_t i = 0; i < take; i++)
+        {
+            patch->buf[i] = (uint8_t)(patch->buf[i] + data[i]);
+        }
+        result = emit(patch, patch->buf, take);
+    }
+    else
+    {
+        result = emit(patch, data, take);
+    }
+    if (result != OTA_PATCH_OK)
+    {
+        return result;
+    }
+
+    patch->src += take;
+    patch->remaining -= take;
+    if (patch->remaining == 0)
+    {
+        patch->op = OTA_PATCH_NO_OP;
+    }
+    *used = take;
+    return OTA_PATCH_OK;
+}
+
+ota_patch_result_t ota_patch_feed(ota_patch_t *patch, const uint8_t *data, size_t len)
+{
+    while (len > 0 && patch->result == OTA_PATCH_OK)
+    {
+        size_t used = 1;
+
+        if (patch->op == OTA_PATCH_NO_OP)
+        {
+            if (data[0] > OTA_PATCH_OP_INSERT)
+            {
+                patch->result = OTA_PATCH_BAD_OP;
+                break;
+            }
+            patch->op = data[0];
+            patch->args_len = 0;
+        }
+        else if (patch->args_len < args_size(patch->op))
+        {
+            used = args_size(patch->op) - patch->args_len;
+            if (used > len)
+            {
+                used = len;
+            }
+            memcpy(patch->args + patch->args_len, data, used);
+            patch->args_len += used;
+            if (patch->args_len == args_size(patch->op))
+            {
+                patch->result = start_op(patch);
+            }
+        }
+        else
+        {
+            patch->result = body(patch, data, len, &used);
+        }
+
+        data += used;
+        len -= used;
+    }
+
+    return patch->result;
+}
+
+bool ota_patch_complete(const ota_patch_t *patch)
+{
+    return patch->result == OTA_PATCH_OK && patch->op == OTA_PATCH_NO_OP;
+}
@@ -0,0 +1,74 @@
+#ifndef OTA_PATCH_H
+#define OTA_PATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Delta container produced by tools/ota/make_ota_delta.py: this header
+// followed by a zlib stream of patch operations. All fields are little-endian.
+//     0   4   magic "MBD1"
+//     4   4   patched image size
+//     8   4   compressed stream size
+//     12  32  SHA-256 of the patched image
+//     44  4   base image size
+//     48  32  SHA-256 of the base image, the application the delta was made against
+#define OTA_PATCH_MAGIC "MBD1"
+#define OTA_PATCH_HEADER_SIZE 80
+
+// Operations in the inflated stream, each an opcode byte and little-endian
+// arguments:
+//     COPY   src u32, len u32            len bytes of the base from src
+//     DIFF   src u32, len u32, len bytes base bytes from src plus each byte, mod 256
+//     INSERT len u32, len bytes          the bytes themselves
+#define OTA_PATCH_OP_COPY 0
+#define OTA_PATCH_OP_DIFF 1
+#define OTA_PATCH_OP_INSERT 2
+
+// Base bytes read per flash access. This, and the decoder state below, is all
+// the RAM a patch needs besides the inflate window.
+#define OTA_PATCH_BUFFER_SIZE 256
+
+typedef enum
+{
+    OTA_PATCH_OK,
+    OTA_PATCH_BAD_OP,       // Unknown opcode
+    OTA_PATCH_OUT_OF_RANGE, // COPY or DIFF past the end of the base image
+    OTA_PATCH_IO_ERROR      // A read or write callback failed
+} ota_patch_result_t;
+
+typedef bool (*ota_patch_read_t)(void *ctx, uint32_t offset, uint8_t *buf, size_t len);
+typedef bool (*ota_patch_write_t)(void *ctx, const uint8_t *data, size_t len);
+
+// Streaming decoder for the operation stream, with no RTOS or driver
+// dependencies: the base is read and the output written through callbacks, so
+// ota_stream.c patches against the running partition straight into the next
+// one. Input may be split anywhere. tools/host/test_ota_patch.py runs it on
+// the host.
+typedef struct
+{
+    ota_patch_read_t read_base;
+    ota_patch_write_t write;
+    void *ctx;
+    uint32_t base_size;
+    uint32_t written;
+    int op; // -1 between operations
+    uint8_t args[8];
+    size_t args_len;
+    uint32_t src;
+    uint32_t remaining;
+    ota_patch_result_t result;
+    uint8_t buf[OTA_PATCH_BUFFER_SIZE];
+} ota_patch_t;
+
+void ota_patch_init(ota_patch_t *patch, uint32_t base_size, ota_patch_read_t read_base, ota_patch_write_t write,
+                    void *ctx);
+
+// Feeds the next chunk of inflated operations. Once an error has been
+// returned, further input is ignored and the same error is returned again.
+ota_patch_result_t ota_patch_feed(ota_patch_t *patch, const uint8_t *data, size_t len);
+
+// True when the stream so far ends on an operation boundary without error
+bool ota_patch_complete(const ota_patch_t *patch);
+
+#endif // OTA_PATCH_H
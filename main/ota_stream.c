@@ -0,0 +1,856 @@
+#include <stdlib.h>
+#include <string.h>
+#include "ota_stream.h"
+#include "ota_patch.h"
+#include "ota_stream_config.h"
+#include "rtos_alloc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp32/rom/miniz.h"
+#include "mbedtls/sha256.h"
+#include "nvs.h"
+#include "gecl-wifi-manager.h"
+
+static const char *TAG = "OTA_STREAM";
+
+#define OTA_CHECKPOINT_MAGIC 0x4F544131 // "OTA1"
+#define OTA_DIGEST_LEN 32
+#define OTA_IMAGE_HASH_APPENDED_OFFSET 23 // esp_image_header_t.hash_appended
+
+typedef struct
+{
+    const esp_partition_t *partition;
+    bool packed;
+    bool delta; // Packed as a patch against the running image
+    uint32_t written;
+    uint32_t erased;
+    uint32_t total_size;  // Inflated image size, 0 until known
+    uint32_t hash_limit;  // Bytes below this offset are hashed, the rest is the appended digest
+    uint8_t tail[OTA_DIGEST_LEN];
+    mbedtls_sha256_context sha;
+} ota_sink_t;
+
+// Persisted to NVS so a raw image download can continue with a Range request
+// after a dropped connection or a reboot
+typedef struct
+{
+    uint32_t magic;
+    uint32_t partition_address;
+    uint32_t total_size;
+    uint32_t written;
+    uint32_t erased;
+    uint8_t tail[OTA_DIGEST_LEN];
+    char url[OTA_STREAM_URL_MAX_LEN];
+    char version[OTA_STREAM_VERSION_MAX_LEN];
+    uint8_t expected_sha[OTA_DIGEST_LEN];
+    bool has_expected_sha;
+    mbedtls_sha256_context sha;
+} ota_checkpoint_t;
+
+typedef struct
+{
+    tinfl_decompressor inflator;
+    uint8_t window[OTA_STREAM_WINDOW_SIZE];
+    uint32_t window_pos;
+    tinfl_status status;
+    uint8_t header[OTA_PATCH_HEADER_SIZE];
+    size_t header_len;
+    uint8_t expected_sha[OTA_DIGEST_LEN];
+    ota_sink_t *sink;
+    ota_patch_t patch;
+    esp_err_t patch_err; // Why the patch callbacks failed
+} ota_inflate_t;
+
+typedef struct
+{
+    char data[OTA_STREAM_HTTP_BUFFER_SIZE];
+} ota_http_buffer_t;
+
+static ota_stream_request_t ota_request;
+static TaskHandle_t ota_stream_task_handle = NULL;
+static volatile bool ota_busy = false;
+static ota_stream_stats_t ota_stats = {0};
+RTOS_TASK_STORAGE(ota_stream_task, OTA_STREAM_TASK_STACK_SIZE);
+
+#if RTOS_STATIC_ALLOCATION
+// An OTA may be the first large allocation after months of uptime; static
+// builds reserve its buffers up front instead of hoping the heap still has them.
+// Only one download runs at a time, and init_ota_stream() is done with the
+// checkpoint buffer before it starts one.
+static ota_checkpoint_t ota_checkpoint_storage;
+static ota_inflate_t ota_inflate_storage;
+static ota_http_buffer_t ota_http_storage;
+#define OTA_BUFFER_ALLOC(type, storage) (&(storage))
+#define OTA_BUFFER_FREE(ptr) ((void)(ptr))
+#else
+#define OTA_BUFFER_ALLOC(type, storage) ((type *)malloc(sizeof(type)))
+#define OTA_BUFFER_FREE(ptr) free(ptr)
+#endif
+
+static uint32_t read_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool url_has_suffix(const char *url, const char *suffix)
+{
+    size_t url_len = strlen(url);
+    size_t suffix_len = strlen(suffix);
+
+    return url_len > suffix_len && strcmp(url + url_len - suffix_len, suffix) == 0;
+}
+
+bool ota_stream_is_compressed_url(const char *url)
+{
+    return url_has_suffix(url, OTA_STREAM_COMPRESSED_SUFFIX) || ota_stream_is_delta_url(url);
+}
+
+bool ota_stream_is_delta_url(const char *url)
+{
+    return url_has_suffix(url, OTA_STREAM_DELTA_SUFFIX);
+}
+
+static void ota_sink_reset(ota_sink_t *sink)
+{
+    sink->written = 0;
+    sink->erased = 0;
+    sink->total_size = 0;
+    sink->hash_limit = UINT32_MAX;
+    mbedtls_sha256_free(&sink->sha);
+    mbedtls_sha256_init(&sink->sha);
+    mbedtls_sha256_starts(&sink->sha, 0);
+}
+
+static void ota_sink_set_total(ota_sink_t *sink, uint32_t total_size)
+{
+    sink->total_size = total_size;
+    // Raw app images end with a SHA-256 of everything before it. Packed images
+    // carry their digest in the container header instead.
+    sink->hash_limit = (!sink->packed && total_size > OTA_DIGEST_LEN) ? total_size - OTA_DIGEST_LEN : UINT32_MAX;
+}
+
+// Hashes and writes image bytes, erasing each flash sector just before it is
+// first written so the update never needs a second pass over the partition
+static esp_err_t ota_sink_write(ota_sink_t *sink, const uint8_t *data, size_t len)
+{
+    if (sink->written + len > sink->partition->size)
+    {
+        ESP_LOGE(TAG, "Image does not fit the %lu byte partition", (unsigned long)sink->partition->size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    while (sink->written + len > sink->erased)
+    {
+        esp_err_t err = esp_partition_erase_range(sink->partition, sink->erased, sink->partition->erase_size);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+        sink->erased += sink->partition->erase_size;
+    }
+
+    esp_err_t err = esp_partition_write(sink->partition, sink->written, data, len);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        uint32_t offset = sink->written + i;
+        if (offset >= sink->hash_limit)
+        {
+            sink->tail[offset - sink->hash_limit] = data[i];
+        }
+    }
+    if (sink->written < sink->hash_limit)
+    {
+        size_t hashed = (sink->written + len > sink->hash_limit) ? sink->hash_limit - sink->written : len;
+        mbedtls_sha256_update(&sink->sha, data, hashed);
+    }
+
+    sink->written += len;
+    ota_stats.bytes_written = sink->written;
+    return ESP_OK;
+}
+
+static void ota_checkpoint_clear(void)
+{
+    nvs_handle_t nvs;
+
+    if (nvs_open(OTA_STREAM_NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK)
+    {
+        nvs_erase_key(nvs, OTA_STREAM_NVS_KEY);
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+}
+
+static void ota_checkpoint_save(const ota_sink_t *sink)
+{
+    nvs_handle_t nvs;
+    ota_checkpoint_t *ckpt = OTA_BUFFER_ALLOC(ota_checkpoint_t, ota_checkpoint_storage);
+
+    if (ckpt == NULL)
+    {
+        return;
+    }
+
+    memset(ckpt, 0, sizeof(*ckpt));
+    ckpt->magic = OTA_CHECKPOINT_MAGIC;
+    ckpt->partition_address = sink->partition->address;
+    ckpt->total_size = sink->total_size;
+    ckpt->written = sink->written;
+    ckpt->erased = sink->erased;
+    memcpy(ckpt->tail, sink->tail, sizeof(ckpt->tail));
+    strlcpy(ckpt->url, ota_request.url, sizeof(ckpt->url));
+    strlcpy(ckpt->version, ota_request.version, sizeof(ckpt->version));
+    memcpy(ckpt->expected_sha, ota_request.sha256, sizeof(ckpt->expected_sha));
+    ckpt->has_expected_sha = ota_request.has_sha256;
+    // Cloning pulls the running state out of the SHA peripheral if it is in use
+    mbedtls_sha256_init(&ckpt->sha);
+    mbedtls_sha256_clone(&ckpt->sha, &sink->sha);
+
+    if (nvs_open(OTA_STREAM_NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK)
+    {
+        if (nvs_set_blob(nvs, OTA_STREAM_NVS_KEY, ckpt, sizeof(*ckpt)) == ESP_OK && nvs_commit(nvs) == ESP_OK)
+        {
+            ota_stats.checkpoints++;
+        }
+        nvs_close(nvs);
+    }
+
+    mbedtls_sha256_free(&ckpt->sha);
+    OTA_BUFFER_FREE(ckpt);
+}
+
+static bool ota_checkpoint_load(ota_checkpoint_t *ckpt)
+{
+    nvs_handle_t nvs;
+    size_t len = sizeof(*ckpt);
+    esp_err_t err;
+
+    if (nvs_open(OTA_STREAM_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK)
+    {
+        return false;
+    }
+    err = nvs_get_blob(nvs, OTA_STREAM_NVS_KEY, ckpt, &len);
+    nvs_close(nvs);
+
+    return err == ESP_OK && len == sizeof(*ckpt) && ckpt->magic == OTA_CHECKPOINT_MAGIC;
+}
+
+// Restores a checkpoint for the same URL and target partition, if one exists
+static void ota_sink_resume(ota_sink_t *sink)
+{
+    ota_checkpoint_t *ckpt = OTA_BUFFER_ALLOC(ota_checkpoint_t, ota_checkpoint_storage);
+
+    if (ckpt == NULL)
+    {
+        return;
+    }
+
+    if (ota_checkpoint_load(ckpt) && ckpt->partition_address == sink->partition->address &&
+        strcmp(ckpt->url, ota_request.url) == 0)
+    {
+        ota_sink_set_total(sink, ckpt->total_size);
+        sink->written = ckpt->written;
+        sink->erased = ckpt->erased;
+        memcpy(sink->tail, ckpt->tail, sizeof(sink->tail));
+        mbedtls_sha256_free(&sink->sha);
+        mbedtls_sha256_init(&sink->sha);
+        mbedtls_sha256_clone(&sink->sha, &ckpt->sha);
+        ESP_LOGI(TAG, "Resuming OTA at byte %lu of %lu", (unsigned long)sink->written, (unsigned long)sink->total_size);
+    }
+    OTA_BUFFER_FREE(ckpt);
+}
+
+static bool ota_patch_read_base(void *ctx, uint32_t offset, uint8_t *buf, size_t len)
+{
+    ota_inflate_t *inf = ctx;
+
+    inf->patch_err = esp_partition_read(esp_ota_get_running_partition(), offset, buf, len);
+    return inf->patch_err == ESP_OK;
+}
+
+static bool ota_patch_write(void *ctx, const uint8_t *data, size_t len)
+{
+    ota_inflate_t *inf = ctx;
+
+    inf->patch_err = ota_sink_write(inf->sink, data, len);
+    return inf->patch_err == ESP_OK;
+}
+
+// A delta only makes sense against the exact image it was made from. The
+// inflate window is still unused here and serves as the read buffer.
+static esp_err_t ota_check_base(ota_inflate_t *inf, uint32_t base_size, const uint8_t *base_sha)
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    mbedtls_sha256_context sha;
+    uint8_t actual_sha[OTA_DIGEST_LEN];
+    esp_err_t err = ESP_OK;
+
+    if (running == NULL || base_size > running->size)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    for (uint32_t offset = 0; offset < base_size && err == ESP_OK; offset += OTA_STREAM_WINDOW_SIZE)
+    {
+        size_t take = (base_size - offset < OTA_STREAM_WINDOW_SIZE) ? base_size - offset : OTA_STREAM_WINDOW_SIZE;
+        err = esp_partition_read(running, offset, inf->window, take);
+        mbedtls_sha256_update(&sha, inf->window, take);
+    }
+    mbedtls_sha256_finish(&sha, actual_sha);
+    mbedtls_sha256_free(&sha);
+
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    if (memcmp(actual_sha, base_sha, OTA_DIGEST_LEN) != 0)
+    {
+        ESP_LOGW(TAG, "Delta was made against a different image than the running one");
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t ota_inflate_header(ota_sink_t *sink, ota_inflate_t *inf)
+{
+    if (memcmp(inf->header, sink->delta ? OTA_PATCH_MAGIC : OTA_STREAM_MAGIC, 4) != 0)
+    {
+        ESP_LOGE(TAG, "Not a %s OTA image", sink->delta ? "delta" : "packed");
+        return ESP_ERR_INVALID_VERSION;
+    }
+    ota_sink_set_total(sink, read_le32(inf->header + 4));
+    memcpy(inf->expected_sha, inf->header + 12, sizeof(inf->expected_sha));
+
+    if (sink->delta)
+    {
+        uint32_t base_size = read_le32(inf->header + 44);
+        esp_err_t err = ota_check_base(inf, base_size, inf->header + 48);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+        ota_patch_init(&inf->patch, base_size, ota_patch_read_base, ota_patch_write, inf);
+    }
+
+    ESP_LOGI(TAG, "%s image: %lu bytes inflated, %lu compressed", sink->delta ? "Delta" : "Packed",
+             (unsigned long)sink->total_size, (unsigned long)read_le32(inf->header + 8));
+    return ESP_OK;
+}
+
+static esp_err_t ota_inflate_emit(ota_sink_t *sink, ota_inflate_t *inf, const uint8_t *data, size_t len)
+{
+    if (!sink->delta)
+    {
+        return ota_sink_write(sink, data, len);
+    }
+
+    switch (ota_patch_feed(&inf->patch, data, len))
+    {
+    case OTA_PATCH_OK:
+        return ESP_OK;
+    case OTA_PATCH_IO_ERROR:
+        return inf->patch_err;
+    default:
+        ESP_LOGE(TAG, "Malformed delta at output byte %lu", (unsigned long)inf->patch.written);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+}
+
+static esp_err_t ota_inflate_chunk(ota_sink_t *sink, ota_inflate_t *inf, const uint8_t *in, size_t in_left,
+                                   bool *done)
+{
+    size_t header_size = sink->delta ? OTA_PATCH_HEADER_SIZE : OTA_STREAM_HEADER_SIZE;
+
+    if (inf->header_len < header_size)
+    {
+        size_t take = header_size - inf->header_len;
+        if (take > in_left)
+        {
+            take = in_left;
+        }
+        memcpy(inf->header + inf->header_len, in, take);
+        inf->header_len += take;
+        in += take;
+        in_left -= take;
+
+        if (inf->header_len < header_size)
+        {
+            return ESP_OK;
+        }
+        esp_err_t err = ota_inflate_header(sink, inf);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+    }
+
+    // The window doubles as tinfl's circular dictionary, so output is flushed
+    // to flash before it wraps
+    while ((in_left > 0 || inf->status == TINFL_STATUS_HAS_MORE_OUTPUT) && !*done)
+    {
+        size_t in_bytes = in_left;
+        size_t out_bytes = OTA_STREAM_WINDOW_SIZE - inf->window_pos;
+        inf->status = tinfl_decompress(&inf->inflator, in, &in_bytes, inf->window, inf->window + inf->window_pos,
+                                       &out_bytes, TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+        in += in_bytes;
+        in_left -= in_bytes;
+
+        if (inf->status < TINFL_STATUS_DONE)
+        {
+            ESP_LOGE(TAG, "Inflate failed: %d", inf->status);
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+
+        if (out_bytes > 0)
+        {
+            esp_err_t err = ota_inflate_emit(sink, inf, inf->window + inf->window_pos, out_bytes);
+            if (err != ESP_OK)
+            {
+                return err;
+            }
+            inf->window_pos = (inf->window_pos + out_bytes) & (OTA_STREAM_WINDOW_SIZE - 1);
+        }
+
+        *done = (inf->status == TINFL_STATUS_DONE);
+    }
+
+    if (*done && sink->delta && !ota_patch_complete(&inf->patch))
+    {
+        ESP_LOGE(TAG, "Delta ends inside an operation");
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    return ESP_OK;
+}
+
+static void ota_inflate_reset(ota_inflate_t *inf, ota_sink_t *sink)
+{
+    inf->sink = sink;
+    tinfl_init(&inf->inflator);
+    inf->window_pos = 0;
+    inf->status = TINFL_STATUS_NEEDS_MORE_INPUT;
+    inf->header_len = 0;
+}
+
+// One HTTP session. Returns ESP_ERR_TIMEOUT when the connection dropped and
+// the download is worth retrying from the current offset.
+static esp_err_t ota_stream_attempt(ota_sink_t *sink, ota_inflate_t *inf, char *http_buf)
+{
+    bool done = false;
+    uint32_t last_checkpoint = sink->written;
+    int64_t content_length;
+    int status;
+    esp_err_t err = ESP_OK;
+
+    // Packed images inflate through state too large to checkpoint, so they
+    // always restart from the beginning
+    if (sink->packed && sink->written > 0)
+    {
+        ota_sink_reset(sink);
+    }
+    if (sink->packed)
+    {
+        ota_inflate_reset(inf, sink);
+    }
+
+    esp_http_client_config_t http_config = {.url = ota_request.url,
+                                            .timeout_ms = OTA_STREAM_HTTP_TIMEOUT_MS,
+                                            .crt_bundle_attach = esp_crt_bundle_attach};
+    esp_http_client_handle_t http = esp_http_client_init(&http_config);
+    if (http == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (sink->written > 0)
+    {
+        char range[32];
+        snprintf(range, sizeof(range), "bytes=%lu-", (unsigned long)sink->written);
+        esp_http_client_set_header(http, "Range", range);
+    }
+
+    err = esp_http_client_open(http, 0);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "HTTP open failed: %s", esp_err_to_name(err));
+        err = ESP_ERR_TIMEOUT;
+        goto cleanup;
+    }
+
+    content_length = esp_http_client_fetch_headers(http);
+    status = esp_http_client_get_status_code(http);
+    if (status == 200)
+    {
+        if (sink->written > 0)
+        {
+            ESP_LOGW(TAG, "Server ignored the Range request, restarting download");
+            ota_sink_reset(sink);
+        }
+        if (!sink->packed && content_length > 0)
+        {
+            ota_sink_set_total(sink, (uint32_t)content_length);
+        }
+    }
+    else if (status == 206)
+    {
+        ota_stats.resumes++;
+        if (content_length > 0 && sink->total_size != 0 && sink->written + content_length != sink->total_size)
+        {
+            ESP_LOGE(TAG, "Partial content does not match the checkpointed image size");
+            ota_sink_reset(sink);
+            err = ESP_ERR_TIMEOUT;
+            goto cleanup;
+        }
+    }
+    else
+    {
+        ESP_LOGE(TAG, "HTTP status %d", status);
+        err = ESP_FAIL;
+        goto cleanup;
+    }
+
+    while (!done)
+    {
+        int read_len = esp_http_client_read(http, http_buf, OTA_STREAM_HTTP_BUFFER_SIZE);
+        if (read_len < 0)
+        {
+            ESP_LOGW(TAG, "Connection dropped at byte %lu", (unsigned long)sink->written);
+            err = ESP_ERR_TIMEOUT;
+            goto cleanup;
+        }
+        if (read_len == 0)
+        {
+            if (!sink->packed && sink->total_size != 0 && sink->written == sink->total_size)
+            {
+                break;
+            }
+            ESP_LOGW(TAG, "Download ended early at byte %lu", (unsigned long)sink->written);
+            err = ESP_ERR_TIMEOUT;
+            goto cleanup;
+        }
+        ota_stats.bytes_transferred += read_len;
+
+        if (sink->packed)
+        {
+            err = ota_inflate_chunk(sink, inf, (const uint8_t *)http_buf, read_len, &done);
+        }
+        else
+        {
+            err = ota_sink_write(sink, (const uint8_t *)http_buf, read_len);
+            done = (sink->total_size != 0 && sink->written >= sink->total_size);
+        }
+        if (err != ESP_OK)
+        {
+            goto cleanup;
+        }
+
+        if (!sink->packed && sink->written - last_checkpoint >= OTA_STREAM_CHECKPOINT_INTERVAL)
+        {
+            ota_checkpoint_save(sink);
+            last_checkpoint = sink->written;
+        }
+    }
+
+cleanup:
+    if (err == ESP_ERR_TIMEOUT && !sink->packed && sink->written > last_checkpoint)
+    {
+        ota_checkpoint_save(sink);
+    }
+    esp_http_client_close(http);
+    esp_http_client_cleanup(http);
+    return err;
+}
+
+// Digest of the whole image, as a per-device OTA command states it: the
+// running digest continued over the tail held back as the appended digest
+static void ota_sink_image_sha(const ota_sink_t *sink, uint8_t *out)
+{
+    mbedtls_sha256_context sha;
+
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_clone(&sha, &sink->sha);
+    if (sink->written > sink->hash_limit)
+    {
+        mbedtls_sha256_update(&sha, sink->tail, sink->written - sink->hash_limit);
+    }
+    mbedtls_sha256_finish(&sha, out);
+    mbedtls_sha256_free(&sha);
+}
+
+// Incremental verification: the digest was computed while writing, so no
+// second read of the image is needed here
+static esp_err_t ota_sink_verify(ota_sink_t *sink, const ota_inflate_t *inf)
+{
+    uint8_t actual_sha[OTA_DIGEST_LEN];
+    uint8_t image_header[OTA_IMAGE_HASH_APPENDED_OFFSET + 1];
+
+    if (sink->total_size == 0 || sink->written != sink->total_size)
+    {
+        ESP_LOGE(TAG, "Image incomplete (%lu of %lu bytes)", (unsigned long)sink->written,
+                 (unsigned long)sink->total_size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (ota_request.has_sha256)
+    {
+        ota_sink_image_sha(sink, actual_sha);
+        if (memcmp(actual_sha, ota_request.sha256, OTA_DIGEST_LEN) != 0)
+        {
+            ESP_LOGE(TAG, "Image SHA-256 differs from the one in the OTA command");
+            return ESP_ERR_INVALID_CRC;
+        }
+    }
+
+    mbedtls_sha256_finish(&sink->sha, actual_sha);
+
+    if (sink->packed)
+    {
+        return memcmp(actual_sha, inf->expected_sha, OTA_DIGEST_LEN) == 0 ? ESP_OK : ESP_ERR_INVALID_CRC;
+    }
+
+    if (esp_partition_read(sink->partition, 0, image_header, sizeof(image_header)) != ESP_OK ||
+        image_header[OTA_IMAGE_HASH_APPENDED_OFFSET] != 1)
+    {
+        // No appended digest to compare against; esp_ota_set_boot_partition()
+        // still validates the image checksum
+        return ESP_OK;
+    }
+
+    return memcmp(actual_sha, sink->tail, OTA_DIGEST_LEN) == 0 ? ESP_OK : ESP_ERR_INVALID_CRC;
+}
+
+// A device running something other than the delta's base takes the full
+// packed image published next to it
+static void ota_fall_back_to_packed(ota_sink_t *sink)
+{
+    size_t stem_len = strlen(ota_request.url) - strlen(OTA_STREAM_DELTA_SUFFIX);
+
+    if (stem_len + strlen(OTA_STREAM_COMPRESSED_SUFFIX) < sizeof(ota_request.url))
+    {
+        strcpy(ota_request.url + stem_len, OTA_STREAM_COMPRESSED_SUFFIX);
+        sink->delta = false;
+        ESP_LOGI(TAG, "Falling back to %s", ota_request.url);
+    }
+}
+
+static void ota_stream_run(void)
+{
+    int64_t start_us = esp_timer_get_time();
+    ota_sink_t sink = {.partition = esp_ota_get_next_update_partition(NULL),
+                       .packed = ota_stream_is_compressed_url(ota_request.url),
+                       .delta = ota_stream_is_delta_url(ota_request.url)};
+    ota_inflate_t *inf = NULL;
+    ota_http_buffer_t *http = OTA_BUFFER_ALLOC(ota_http_buffer_t, ota_http_storage);
+    char *http_buf = (http != NULL) ? http->data : NULL;
+    esp_err_t err = ESP_ERR_NO_MEM;
+
+    memset(&ota_stats, 0, sizeof(ota_stats));
+    ESP_LOGI(TAG, "Starting OTA%s%s from %s", ota_request.version[0] ? " to " : "", ota_request.version,
+             ota_request.url);
+
+    mbedtls_sha256_init(&sink.sha);
+    if (sink.packed)
+    {
+        inf = OTA_BUFFER_ALLOC(ota_inflate_t, ota_inflate_storage);
+    }
+
+    if (sink.partition == NULL)
+    {
+        err = ESP_ERR_NOT_FOUND;
+    }
+    else if (http_buf != NULL && (!sink.packed || inf != NULL))
+    {
+        ota_sink_reset(&sink);
+        if (!sink.packed)
+        {
+            ota_sink_resume(&sink);
+        }
+
+        for (int attempt = 0; attempt < OTA_STREAM_MAX_ATTEMPTS; attempt++)
+        {
+            while (!wifi_active())
+            {
+                vTaskDelay(pdMS_TO_TICKS(OTA_STREAM_RETRY_DELAY_MS));
+            }
+
+            err = ota_stream_attempt(&sink, inf, http_buf);
+            if (err == ESP_ERR_INVALID_STATE && sink.delta)
+            {
+                ota_fall_back_to_packed(&sink);
+                continue;
+            }
+            if (err != ESP_ERR_TIMEOUT)
+            {
+                break;
+            }
+            vTaskDelay(pdMS_TO_TICKS(OTA_STREAM_RETRY_DELAY_MS));
+        }
+
+        if (err == ESP_OK)
+        {
+            err = ota_sink_verify(&sink, inf);
+        }
+    }
+
+    // Keep the checkpoint only for a download that can still be resumed
+    if (err != ESP_ERR_TIMEOUT)
+    {
+        ota_checkpoint_clear();
+    }
+    mbedtls_sha256_free(&sink.sha);
+    if (inf != NULL)
+    {
+        OTA_BUFFER_FREE(inf);
+    }
+    if (http != NULL)
+    {
+        OTA_BUFFER_FREE(http);
+    }
+
+    ota_stats.wall_time_us = esp_timer_get_time() - start_us;
+    ota_stats.last_error = err;
+    ESP_LOGI(TAG, "OTA %s: %lu bytes transferred, %lu bytes written, %lu resumes in %lld ms",
+             err == ESP_OK ? "complete" : "failed", (unsigned long)ota_stats.bytes_transferred,
+             (unsigned long)ota_stats.bytes_written, (unsigned long)ota_stats.resumes,
+             (long long)(ota_stats.wall_time_us / 1000));
+
+    if (err == ESP_OK)
+    {
+        // IDF re-validates the image header and checksum before switching
+        err = esp_ota_set_boot_partition(sink.partition);
+        if (err == ESP_OK)
+        {
+            ESP_LOGI(TAG, "Rebooting into %s", sink.partition->label);
+            esp_restart();
+        }
+        ESP_LOGE(TAG, "Failed to set boot partition: %s", esp_err_to_name(err));
+    }
+}
+
+#if RTOS_STATIC_ALLOCATION
+
+// A static task's stack cannot be handed to a new task until the idle task has
+// reaped the old one, so a single task is created at init and waits for work
+static void ota_stream_task(void *arg)
+{
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        ota_stream_run();
+        ota_busy = false;
+    }
+}
+
+static esp_err_t ota_stream_create_task(void)
+{
+    if (ota_stream_task_handle == NULL &&
+        RTOS_TASK_CREATE(ota_stream_task, ota_stream_task, "ota_stream", NULL, OTA_STREAM_TASK_PRIORITY,
+                         &ota_stream_task_handle, OTA_STREAM_TASK_CORE) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create OTA task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t ota_stream_dispatch(void)
+{
+    if (ota_stream_create_task() != ESP_OK)
+    {
+        return ESP_FAIL;
+    }
+    xTaskNotifyGive(ota_stream_task_handle);
+    return ESP_OK;
+}
+
+#else
+
+static void ota_stream_task(void *arg)
+{
+    ota_stream_run();
+    ota_stream_task_handle = NULL;
+    ota_busy = false;
+    vTaskDelete(NULL);
+}
+
+static esp_err_t ota_stream_dispatch(void)
+{
+    if (RTOS_TASK_CREATE(ota_stream_task, ota_stream_task, "ota_stream", NULL, OTA_STREAM_TASK_PRIORITY,
+                         &ota_stream_task_handle, OTA_STREAM_TASK_CORE) != pdPASS)
+    {
+        ota_stream_task_handle = NULL;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+#endif
+
+esp_err_t ota_stream_start(const ota_stream_request_t *request)
+{
+    if (ota_busy)
+    {
+        ESP_LOGW(TAG, "OTA already in progress");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ota_busy = true;
+    ota_request = *request;
+
+    if (ota_stream_dispatch() != ESP_OK)
+    {
+        ota_busy = false;
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t init_ota_stream(void)
+{
+    ota_checkpoint_t *ckpt = OTA_BUFFER_ALLOC(ota_checkpoint_t, ota_checkpoint_storage);
+    esp_err_t err = ESP_OK;
+
+    if (ckpt == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // A download interrupted by a reboot picks up where it left off
+    if (ota_checkpoint_load(ckpt))
+    {
+        ota_stream_request_t request = {0};
+        strlcpy(request.url, ckpt->url, sizeof(request.url));
+        strlcpy(request.version, ckpt->version, sizeof(request.version));
+        memcpy(request.sha256, ckpt->expected_sha, sizeof(request.sha256));
+        request.has_sha256 = ckpt->has_expected_sha;
+        ESP_LOGI(TAG, "Found OTA checkpoint at byte %lu", (unsigned long)ckpt->written);
+        err = ota_stream_start(&request);
+    }
+
+    OTA_BUFFER_FREE(ckpt);
+    return err;
+}
+
+bool ota_stream_running(void)
+{
+    return ota_busy;
+}
+
+void ota_stream_get_stats(ota_stream_stats_t *stats)
+{
+    *stats = ota_stats;
+}
@@ -0,0 +1,50 @@
+#ifndef OTA_STREAM_H
+#define OTA_STREAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define OTA_STREAM_URL_MAX_LEN 256
+#define OTA_STREAM_VERSION_MAX_LEN 32
+
+// Container produced by tools/ota/pack_ota_image.py: this header followed by a
+// zlib stream of the application image. All fields are little-endian.
+#define OTA_STREAM_MAGIC "MBZ1"
+#define OTA_STREAM_HEADER_SIZE 44
+
+typedef struct
+{
+    char url[OTA_STREAM_URL_MAX_LEN];
+    char version[OTA_STREAM_VERSION_MAX_LEN]; // Empty when announced by the fleet manifest
+    uint8_t sha256[32];                       // Of the application image as flashed, checked if has_sha256
+    bool has_sha256;
+} ota_stream_request_t;
+
+typedef struct
+{
+    uint32_t bytes_transferred; // Bytes received over HTTP
+    uint32_t bytes_written;     // Image bytes in the OTA partition, including resumed ones
+    uint32_t resumes;           // Range requests answered with 206 Partial Content
+    uint32_t checkpoints;       // Progress snapshots committed to NVS
+    int64_t wall_time_us;
+    esp_err_t last_error;
+} ota_stream_stats_t;
+
+bool ota_stream_is_compressed_url(const char *url);
+bool ota_stream_is_delta_url(const char *url);
+
+// Resumes a download that was interrupted by a reboot, if NVS holds a checkpoint.
+esp_err_t init_ota_stream(void);
+
+// Downloads an image in a background task into the next OTA partition and
+// boots it once its SHA-256 checks out. Packed images (see above) are inflated
+// as they stream, and deltas (see ota_patch.h) are applied against the running
+// partition as they inflate. Raw images are checkpointed to NVS and continued with an
+// HTTP Range request when the connection drops.
+esp_err_t ota_stream_start(const ota_stream_request_t *request);
+bool ota_stream_running(void);
+
+void ota_stream_get_stats(ota_stream_stats_t *stats);
+
+#endif // OTA_STREAM_H
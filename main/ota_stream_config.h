@@ -0,0 +1,29 @@
+#ifndef OTA_STREAM_CONFIG_H
+#define OTA_STREAM_CONFIG_H
+
+#include "core_config.h"
+
+#define OTA_STREAM_TASK_STACK_SIZE 8192
+#define OTA_STREAM_TASK_PRIORITY 5
+#define OTA_STREAM_TASK_CORE CORE_NETWORK
+#define OTA_STREAM_HTTP_BUFFER_SIZE 1024
+#define OTA_STREAM_HTTP_TIMEOUT_MS 10000
+// Decompression window. Must be a power of two and at least the zlib window
+// the image was packed with (tools/ota/pack_ota_image.py uses wbits=12).
+#define OTA_STREAM_WINDOW_SIZE 4096
+#define OTA_STREAM_COMPRESSED_SUFFIX ".mbz"
+// Deltas against the running image (see ota_patch.h). A device whose image is
+// not the delta's base downloads the .mbz of the same name instead.
+#define OTA_STREAM_DELTA_SUFFIX ".mbd"
+#define OTA_STREAM_CHECKPOINT_INTERVAL (64 * 1024)
+#define OTA_STREAM_MAX_ATTEMPTS 10
+#define OTA_STREAM_RETRY_DELAY_MS 5000
+#define OTA_STREAM_NVS_NAMESPACE "ota_stream"
+#define OTA_STREAM_NVS_KEY "checkpoint"
+
+// Per-device OTA command on <OTA topic>/<MAC without colons>, e.g.
+// {"url": "https://...", "sha256": "<64 hex digits>", "version": "v1.4.0"}
+#define OTA_COMMAND_MAX_LEN 512
+#define OTA_COMMAND_QOS 1
+
+#endif // OTA_STREAM_CONFIG_H
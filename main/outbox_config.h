@@ -0,0 +1,14 @@
+#ifndef OUTBOX_CONFIG_H
+#define OUTBOX_CONFIG_H
+
+#include "core_config.h"
+
+#define OUTBOX_QUEUE_SIZE 16 // Message slots, at most 32
+#define OUTBOX_TOPIC_MAX_LEN 96
+#define OUTBOX_PAYLOAD_MAX_LEN 320 // Fits a JSON session event with every field at its widest
+#define OUTBOX_TASK_STACK_SIZE 4096
+#define OUTBOX_TASK_PRIORITY 6
+#define OUTBOX_TASK_CORE CORE_NETWORK // Next to the MQTT client it hands messages to
+#define OUTBOX_RETRY_DELAY_MS 100
+
+#endif // OUTBOX_CONFIG_H
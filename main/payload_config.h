@@ -0,0 +1,16 @@
+#ifndef PAYLOAD_CONFIG_H
+#define PAYLOAD_CONFIG_H
+
+#define DOOR_PAYLOAD_FORMAT_JSON 0
+#define DOOR_PAYLOAD_FORMAT_BINARY 1
+
+// Wire format of door state messages; tools/payload/decode_door_payload.py reads both
+#ifndef DOOR_PAYLOAD_FORMAT
+#define DOOR_PAYLOAD_FORMAT DOOR_PAYLOAD_FORMAT_JSON
+#endif
+#define DOOR_PAYLOAD_VERSION 1
+
+#define PAYLOAD_MAX_BATCH 8           // Door events coalesced into one publish
+#define PAYLOAD_COALESCE_WINDOW_MS 0  // Extra wait for more events; 0 batches only what is already queued
+
+#endif // PAYLOAD_CONFIG_H
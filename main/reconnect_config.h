@@ -0,0 +1,10 @@
+#ifndef RECONNECT_CONFIG_H
+#define RECONNECT_CONFIG_H
+
+#define RECONNECT_BASE_DELAY_MS 1000
+#define RECONNECT_MAX_DELAY_MS 120000
+#define RECONNECT_MAX_ATTEMPTS 12         // Broker-down attempts before falling back to a reboot
+#define RECONNECT_WIFI_POLL_MS 2000
+#define RECONNECT_WIFI_DOWN_MAX_MS 600000 // Give Wi-Fi 10 minutes to come back before rebooting
+
+#endif // RECONNECT_CONFIG_H
@@ -0,0 +1,22 @@
+#ifndef REMINDER_CONFIG_H
+#define REMINDER_CONFIG_H
+
+// Door-still-open reminders back off the longer a door stays open. Each entry
+// is the interval before the next reminder in percent of the sensor's
+// reminder_ms (or the reminder_ms setting); the last one repeats. With the
+// default 5 minutes: 5, 10, 20, 40 and 80 minutes, then every 3 hours 20.
+#define REMINDER_CURVE_PCT {100, 200, 400, 800, 1600, 4000}
+#define REMINDER_MAX_PER_OPEN 24 // Reminders per opening, 0 for no cap
+
+// No reminders from start to end, local time; one due in between goes out at
+// the end. Equal start and end turn quiet hours off. They need SNTP time, so
+// they do not apply before the clock is set.
+#define REMINDER_QUIET_START_MIN (22 * 60)
+#define REMINDER_QUIET_END_MIN (7 * 60)
+#define REMINDER_TIMEZONE "UTC0" // POSIX TZ, e.g. "CET-1CEST,M3.5.0,M10.5.0/3"
+
+// A reminder due within this long goes out early with any publish happening
+// anyway, or with another sensor's reminder, saving a radio wake of its own
+#define REMINDER_COALESCE_MS 60000
+
+#endif // REMINDER_CONFIG_H
@@ -0,0 +1,40 @@
+#include "reminder_policy.h"
+
+int64_t reminder_policy_interval_ms(const reminder_policy_t *policy, uint32_t sent)
+{
+    if (policy->base_ms == 0 || policy->curve_len == 0 || (policy->max_per_open != 0 && sent >= policy->max_per_open))
+    {
+        return REMINDER_POLICY_NONE;
+    }
+
+    size_t step = (sent < policy->curve_len) ? sent : policy->curve_len - 1;
+    int64_t interval_ms = (int64_t)policy->base_ms * policy->curve_pct[step] / 100;
+    return (interval_ms > 0) ? interval_ms : 1;
+}
+
+int64_t reminder_policy_quiet_delay_ms(const reminder_policy_t *policy, int64_t due_ms)
+{
+    int64_t start_ms = policy->quiet_start_ms;
+    int64_t end_ms = policy->quiet_end_ms;
+
+    due_ms %= REMINDER_POLICY_DAY_MS;
+    if (due_ms < 0)
+    {
+        due_ms += REMINDER_POLICY_DAY_MS;
+    }
+
+    if (start_ms == end_ms)
+    {
+        return 0;
+    }
+    if (start_ms < end_ms)
+    {
+        return (due_ms >= start_ms && due_ms < end_ms) ? end_ms - due_ms : 0;
+    }
+    // Quiet hours across midnight, e.g. 22:00 to 07:00
+    if (due_ms >= start_ms)
+    {
+        return REMINDER_POLICY_DAY_MS - due_ms + end_ms;
+    }
+    return (due_ms < end_ms) ? end_ms - due_ms : 0;
+}
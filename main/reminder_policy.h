@@ -0,0 +1,31 @@
+#ifndef REMINDER_POLICY_H
+#define REMINDER_POLICY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define REMINDER_POLICY_NONE INT64_MAX
+#define REMINDER_POLICY_DAY_MS (24 * 60 * 60 * 1000LL)
+
+// When a door-still-open reminder is due. Pure functions with no RTOS or
+// driver dependencies, so tools/reminder/simulate_reminders.py runs this very
+// file on the host.
+typedef struct
+{
+    uint32_t base_ms;          // 0 for no reminders
+    const uint16_t *curve_pct; // Interval before each reminder, in percent of base_ms; the last one repeats
+    size_t curve_len;
+    uint32_t max_per_open;     // 0 for no cap
+    uint32_t quiet_start_ms;   // Local time of day; equal start and end for no quiet hours
+    uint32_t quiet_end_ms;
+} reminder_policy_t;
+
+// Interval from reminder number `sent` (0 when the door just opened) to the
+// next one, REMINDER_POLICY_NONE once the cap is reached.
+int64_t reminder_policy_interval_ms(const reminder_policy_t *policy, uint32_t sent);
+
+// How much later a reminder due at local time of day `due_ms` goes out, so it
+// lands at the end of quiet hours rather than in them. 0 outside quiet hours.
+int64_t reminder_policy_quiet_delay_ms(const reminder_policy_t *policy, int64_t due_ms);
+
+#endif // REMINDER_POLICY_H
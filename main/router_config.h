@@ -0,0 +1,14 @@
+#ifndef ROUTER_CONFIG_H
+#define ROUTER_CONFIG_H
+
+#define MQTT_ROUTER_MAX_ROUTES 16
+#define MQTT_ROUTER_HASH_SLOTS 32      // Power of two, at least twice MQTT_ROUTER_MAX_ROUTES
+#define MQTT_ROUTER_TOPIC_MAX_LEN 128  // Longer topics reach their handler truncated
+
+// Commands addressed to one device, <root>/<MAC without colons>/<command>, or
+// to all of them, <root>/all/<command>
+#define COMMAND_TOPIC_ROOT CONFIG_MQTT_PUBLISH_DOOR_STATE_TOPIC "/cmd"
+#define COMMAND_PONG_TOPIC CONFIG_MQTT_PUBLISH_DOOR_STATE_TOPIC "/pong"
+#define COMMAND_MAX_LEN 128
+
+#endif // ROUTER_CONFIG_H
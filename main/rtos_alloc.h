@@ -0,0 +1,83 @@
+#ifndef RTOS_ALLOC_H
+#define RTOS_ALLOC_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include "freertos/event_groups.h"
+
+// Built with `idf.py -DRTOS_STATIC_ALLOCATION=ON build`, every long-lived task,
+// queue, timer and semaphore gets its storage in .bss, so it is budgeted at
+// link time and shows up in `memory-report`. Otherwise they come from the heap.
+// The *_STORAGE macros go at file scope, the *_CREATE macros where the object
+// used to be created; both take the same name. Tasks are pinned to `core`,
+// which can be tskNO_AFFINITY (see core_config.h).
+#ifndef RTOS_STATIC_ALLOCATION
+#define RTOS_STATIC_ALLOCATION 0
+#endif
+
+#if RTOS_STATIC_ALLOCATION
+
+#define RTOS_TASK_STORAGE(name, stack_size)                                                                            \
+    static const uint32_t name##_stack_size = (stack_size);                                                            \
+    static StackType_t name##_stack[(stack_size)];                                                                     \
+    static StaticTask_t name##_tcb
+#define RTOS_TASK_CREATE(name, fn, label, arg, priority, handle, core)                                                 \
+    rtos_task_created(xTaskCreateStaticPinnedToCore((fn), (label), name##_stack_size, (arg), (priority), name##_stack,  \
+                                                    &name##_tcb, (core)),                                              \
+                      (handle))
+
+// Gives xTaskCreateStatic() the return convention of xTaskCreate()
+static inline BaseType_t rtos_task_created(TaskHandle_t task, TaskHandle_t *handle)
+{
+    if (handle != NULL)
+    {
+        *handle = task;
+    }
+    return (task != NULL) ? pdPASS : pdFAIL;
+}
+
+#define RTOS_QUEUE_STORAGE(name, length, item_size)                                                                    \
+    static uint8_t name##_queue_storage[(length) * (item_size)];                                                       \
+    static StaticQueue_t name##_queue_struct
+#define RTOS_QUEUE_CREATE(name, length, item_size)                                                                     \
+    xQueueCreateStatic((length), (item_size), name##_queue_storage, &name##_queue_struct)
+
+#define RTOS_TIMER_STORAGE(name, count) static StaticTimer_t name##_timer_structs[(count)]
+#define RTOS_TIMER_CREATE(name, index, label, period, reload, id, callback)                                             \
+    xTimerCreateStatic((label), (period), (reload), (id), (callback), &name##_timer_structs[(index)])
+
+#define RTOS_SEMAPHORE_STORAGE(name) static StaticSemaphore_t name##_semaphore_struct
+#define RTOS_BINARY_SEMAPHORE_CREATE(name) xSemaphoreCreateBinaryStatic(&name##_semaphore_struct)
+#define RTOS_MUTEX_CREATE(name) xSemaphoreCreateMutexStatic(&name##_semaphore_struct)
+
+#define RTOS_EVENT_GROUP_STORAGE(name) static StaticEventGroup_t name##_event_group_struct
+#define RTOS_EVENT_GROUP_CREATE(name) xEventGroupCreateStatic(&name##_event_group_struct)
+
+#else
+
+// The extern declarations only keep `STORAGE(...);` a valid file-scope statement
+#define RTOS_TASK_STORAGE(name, stack_size) static const uint32_t name##_stack_size = (stack_size)
+#define RTOS_TASK_CREATE(name, fn, label, arg, priority, handle, core)                                                 \
+    xTaskCreatePinnedToCore((fn), (label), name##_stack_size, (arg), (priority), (handle), (core))
+
+#define RTOS_QUEUE_STORAGE(name, length, item_size) extern StaticQueue_t name##_queue_struct
+#define RTOS_QUEUE_CREATE(name, length, item_size) xQueueCreate((length), (item_size))
+
+#define RTOS_TIMER_STORAGE(name, count) extern StaticTimer_t name##_timer_structs[]
+#define RTOS_TIMER_CREATE(name, index, label, period, reload, id, callback)                                             \
+    xTimerCreate((label), (period), (reload), (id), (callback))
+
+#define RTOS_SEMAPHORE_STORAGE(name) extern StaticSemaphore_t name##_semaphore_struct
+#define RTOS_BINARY_SEMAPHORE_CREATE(name) xSemaphoreCreateBinary()
+#define RTOS_MUTEX_CREATE(name) xSemaphoreCreateMutex()
+
+#define RTOS_EVENT_GROUP_STORAGE(name) extern StaticEventGroup_t name##_event_group_struct
+#define RTOS_EVENT_GROUP_CREATE(name) xEventGroupCreate()
+
+#endif
+
+#endif // RTOS_ALLOC_H
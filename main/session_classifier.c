@@ -0,0 +1,143 @@
+#include <string.h>
+#include "session_classifier.h"
+
+static const char *const class_names[SESSION_CLASS_COUNT] = {
+    [SESSION_CLASS_DELIVERY] = "delivery",
+    [SESSION_CLASS_RETRIEVAL] = "retrieval",
+    [SESSION_CLASS_BOUNCE] = "bounce",
+};
+
+void session_init(session_state_t *ss, const session_profile_t *profile)
+{
+    memset(ss, 0, sizeof(*ss));
+    ss->profile = *profile;
+    ss->start_time_of_day_ms = -1;
+}
+
+static bool in_carrier_window(const session_profile_t *profile, int64_t time_of_day_ms)
+{
+    if (profile->carrier_start_ms <= profile->carrier_end_ms)
+    {
+        return time_of_day_ms >= profile->carrier_start_ms && time_of_day_ms < profile->carrier_end_ms;
+    }
+    return time_of_day_ms >= profile->carrier_start_ms || time_of_day_ms < profile->carrier_end_ms;
+}
+
+static session_class_t classify(const session_state_t *ss)
+{
+    const session_profile_t *profile = &ss->profile;
+    int32_t score = 0;
+
+    if (ss->longest_open_ms < profile->bounce_max_open_ms)
+    {
+        return SESSION_CLASS_BOUNCE;
+    }
+
+    score += (ss->longest_open_ms <= profile->delivery_max_open_ms) ? profile->weight_duration
+                                                                    : -profile->weight_duration;
+    if (ss->start_time_of_day_ms >= 0)
+    {
+        score += in_carrier_window(profile, ss->start_time_of_day_ms) ? profile->weight_time_of_day
+                                                                       : -profile->weight_time_of_day;
+    }
+    score += ss->mail_waiting ? -profile->weight_mail_waiting : profile->weight_mail_waiting;
+
+    if (score == 0)
+    {
+        return ss->mail_waiting ? SESSION_CLASS_RETRIEVAL : SESSION_CLASS_DELIVERY;
+    }
+    return (score > 0) ? SESSION_CLASS_DELIVERY : SESSION_CLASS_RETRIEVAL;
+}
+
+void session_feed(session_state_t *ss, bool open, int64_t timestamp_us, int64_t time_of_day_ms)
+{
+    if (open == ss->open)
+    {
+        return;
+    }
+    ss->open = open;
+
+    if (open)
+    {
+        if (!ss->active)
+        {
+            ss->active = true;
+            ss->opens = 0;
+            ss->open_ms = 0;
+            ss->longest_open_ms = 0;
+            ss->start_us = timestamp_us;
+            ss->start_time_of_day_ms = time_of_day_ms;
+        }
+        ss->opens++;
+        ss->opened_us = timestamp_us;
+        return;
+    }
+
+    // A close with no session seen opening, e.g. the door was open at boot
+    if (!ss->active)
+    {
+        return;
+    }
+    uint32_t open_ms = (uint32_t)((timestamp_us - ss->opened_us) / 1000);
+    ss->open_ms += open_ms;
+    if (open_ms > ss->longest_open_ms)
+    {
+        ss->longest_open_ms = open_ms;
+    }
+    ss->closed_us = timestamp_us;
+}
+
+bool session_poll(session_state_t *ss, int64_t now_us, session_summary_t *out)
+{
+    if (session_next_deadline_us(ss) > now_us)
+    {
+        return false;
+    }
+
+    if (ss->open)
+    {
+        // Cut at max_open_ms; the close that eventually follows is not a new session
+        uint32_t open_ms = (uint32_t)((now_us - ss->opened_us) / 1000);
+        ss->open_ms += open_ms;
+        if (open_ms > ss->longest_open_ms)
+        {
+            ss->longest_open_ms = open_ms;
+        }
+        ss->closed_us = now_us;
+    }
+
+    out->session_class = classify(ss);
+    out->opens = ss->opens;
+    out->open_ms = ss->open_ms;
+    out->longest_open_ms = ss->longest_open_ms;
+    out->span_ms = (uint32_t)((ss->closed_us - ss->start_us) / 1000);
+    out->start_us = ss->start_us;
+    out->since_last_ms = ss->last_end_us ? (ss->start_us - ss->last_end_us) / 1000 : -1;
+
+    if (out->session_class == SESSION_CLASS_DELIVERY)
+    {
+        ss->mail_waiting = true;
+    }
+    else if (out->session_class == SESSION_CLASS_RETRIEVAL)
+    {
+        ss->mail_waiting = false;
+    }
+    ss->active = false;
+    ss->last_end_us = ss->closed_us;
+    return true;
+}
+
+int64_t session_next_deadline_us(const session_state_t *ss)
+{
+    if (!ss->active)
+    {
+        return SESSION_NO_DEADLINE;
+    }
+    return ss->open ? ss->opened_us + (int64_t)ss->profile.max_open_ms * 1000
+                    : ss->closed_us + (int64_t)ss->profile.gap_ms * 1000;
+}
+
+const char *session_class_name(session_class_t session_class)
+{
+    return (session_class < SESSION_CLASS_COUNT) ? class_names[session_class] : "unknown";
+}
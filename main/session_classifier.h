@@ -0,0 +1,81 @@
+#ifndef SESSION_CLASSIFIER_H
+#define SESSION_CLASSIFIER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SESSION_NO_DEADLINE INT64_MAX
+
+typedef enum
+{
+    SESSION_CLASS_DELIVERY,
+    SESSION_CLASS_RETRIEVAL,
+    SESSION_CLASS_BOUNCE, // Wind, a rattled lid or tampering; no opening long enough to reach in
+    SESSION_CLASS_COUNT
+} session_class_t;
+
+// Sessions with no opening of at least bounce_max_open_ms are bounce. Others
+// are scored, each feature voting its weight for delivery or retrieval:
+//   duration      longest opening up to delivery_max_open_ms: delivery
+//   time of day   start inside the carrier window: delivery (no vote while
+//                 the clock is unset)
+//   mail waiting  no delivery since the last retrieval: delivery
+// A tie goes to retrieval while mail is waiting, to delivery otherwise.
+typedef struct
+{
+    uint32_t gap_ms;      // Closed this long ends a session
+    uint32_t max_open_ms; // Open this long ends it too, with the door still open
+    uint32_t bounce_max_open_ms;
+    uint32_t delivery_max_open_ms;
+    uint32_t carrier_start_ms; // Local time of day
+    uint32_t carrier_end_ms;
+    int32_t weight_duration;
+    int32_t weight_time_of_day;
+    int32_t weight_mail_waiting;
+} session_profile_t;
+
+typedef struct
+{
+    session_class_t session_class;
+    uint32_t opens;
+    uint32_t open_ms;         // Summed over the openings
+    uint32_t longest_open_ms;
+    uint32_t span_ms;         // First open to last close, or to the end of an opening cut at max_open_ms
+    int64_t start_us;         // Time of the first open
+    int64_t since_last_ms;    // Last close of the previous session to the first open, -1 if none
+} session_summary_t;
+
+// Pure state machine over debounced transitions with no RTOS or driver
+// dependencies, timestamps in microseconds, so tools/session/replay_sessions.py
+// runs this very file on the host. Callers feed transitions, and call
+// session_poll() once the deadline from session_next_deadline_us() has passed.
+// There is a deadline for as long as a session is in progress.
+typedef struct
+{
+    session_profile_t profile;
+    bool active;
+    bool open;
+    bool mail_waiting;
+    uint32_t opens;
+    uint32_t open_ms;
+    uint32_t longest_open_ms;
+    int64_t start_us;
+    int64_t opened_us;
+    int64_t closed_us;
+    int64_t start_time_of_day_ms; // -1 if unknown
+    int64_t last_end_us;          // Last close of the previous session, 0 if none
+} session_state_t;
+
+void session_init(session_state_t *ss, const session_profile_t *profile);
+
+// time_of_day_ms is the local time of the transition, -1 while the clock is unset
+void session_feed(session_state_t *ss, bool open, int64_t timestamp_us, int64_t time_of_day_ms);
+
+// Returns true when a session ended, with its summary in *out
+bool session_poll(session_state_t *ss, int64_t now_us, session_summary_t *out);
+
+int64_t session_next_deadline_us(const session_state_t *ss);
+
+const char *session_class_name(session_class_t session_class);
+
+#endif // SESSION_CLASSIFIER_H
@@ -0,0 +1,30 @@
+#ifndef SESSION_CONFIG_H
+#define SESSION_CONFIG_H
+
+// 1 publishes one classified event per door session, instead of every open
+// and close. This changes the wire contract: transitions no longer reach the
+// sensor topic, session events (DOOR_EVENT_FLAG_SESSION in door_payload.h) go
+// to the sensor topic followed by SESSION_TOPIC_SUFFIX, and only reminders and
+// journal replays stay on the sensor topic. Transitions are still journaled
+// and acknowledged by their session event, so a session lost to a reboot or a
+// failed publish is replayed as its transitions. With sleep mode the device
+// stays awake for the whole session, at most SESSION_MAX_OPEN_MS plus
+// SESSION_GAP_MS per opening.
+#define SESSION_SUMMARY 0
+#define SESSION_TOPIC_SUFFIX "/session"
+
+#define SESSION_GAP_MS 30000               // Closed this long ends a session
+#define SESSION_MAX_OPEN_MS 600000         // Open this long ends it too; reminders cover the rest
+#define SESSION_BOUNCE_MAX_OPEN_MS 1200    // Sessions with no longer opening are wind or tamper
+#define SESSION_DELIVERY_MAX_OPEN_MS 8000  // Longest opening of a typical delivery
+#define SESSION_CARRIER_START_MIN (9 * 60) // Local time mail usually arrives, in minutes after midnight
+#define SESSION_CARRIER_END_MIN (18 * 60)
+
+// Votes for delivery (positive) or retrieval (negative) of each feature, see
+// session_classifier.h. tools/session/replay_sessions.py scores a change
+// against labeled traces.
+#define SESSION_WEIGHT_DURATION 2
+#define SESSION_WEIGHT_TIME_OF_DAY 1
+#define SESSION_WEIGHT_MAIL_WAITING 1
+
+#endif // SESSION_CONFIG_H
@@ -0,0 +1,271 @@
+#include <stdio.h>
+#include <string.h>
+#include "cJSON.h"
+#include "settings.h"
+#include "door_config.h"
+#include "door_debounce.h"
+#include "door_handler.h"
+#include "mqtt_outbox.h"
+#include "outbox_config.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_mac.h"
+#include "esp_log.h"
+#include "nvs.h"
+
+static const char *TAG = "SETTINGS";
+
+#define SETTINGS_MAGIC (0x53455400 | SETTING_COUNT) // "SET" and the number of settings
+
+typedef struct
+{
+    const char *key; // In the shadow document
+    uint32_t fallback;
+    uint32_t min;
+    uint32_t max;
+    bool door; // Applied by door_task
+} setting_field_t;
+
+static const setting_field_t fields[SETTING_COUNT] = {
+    [SETTING_DEBOUNCE_MS] = {"debounce_ms", DEBOUNCE_TIME_MS, 1, 10000, true},
+    [SETTING_DEBOUNCE_MODE] = {"debounce_mode", DEBOUNCE_MODE_INTEGRATING, DEBOUNCE_MODE_INTEGRATING,
+                               DEBOUNCE_MODE_LEADING_EDGE, true},
+    [SETTING_REMINDER_MS] = {"reminder_ms", DOOR_OPEN_TIMER_PERIOD_MS, 0, 86400000, true},
+    [SETTING_PUBLISH_RETRIES] = {"publish_retries", MQTT_PUBLISH_RETRIES, 1, 10, false},
+};
+
+// Persisted as one blob; a different SETTINGS_MAGIC discards it
+typedef struct
+{
+    uint32_t magic;
+    uint32_t shadow_version; // Of the last document applied
+    uint32_t set_mask;       // Settings the shadow has set, by setting_t bit
+    uint32_t values[SETTING_COUNT];
+} settings_record_t;
+
+char settings_delta_topic[SETTINGS_TOPIC_MAX_LEN];
+char settings_get_accepted_topic[SETTINGS_TOPIC_MAX_LEN];
+static char shadow_update_topic[SETTINGS_TOPIC_MAX_LEN];
+static char shadow_get_topic[SETTINGS_TOPIC_MAX_LEN];
+
+// Written at boot, then only by the MQTT task, which reads it unlocked; readers on
+// other tasks take settings_lock
+static settings_record_t current;
+static volatile uint32_t generation = 0;
+static portMUX_TYPE settings_lock = portMUX_INITIALIZER_UNLOCKED;
+
+uint32_t settings_get(setting_t setting)
+{
+    portENTER_CRITICAL(&settings_lock);
+    uint32_t value = current.values[setting];
+    portEXIT_CRITICAL(&settings_lock);
+    return value;
+}
+
+bool settings_is_set(setting_t setting)
+{
+    portENTER_CRITICAL(&settings_lock);
+    uint32_t set_mask = current.set_mask;
+    portEXIT_CRITICAL(&settings_lock);
+    return (set_mask & (1u << setting)) != 0;
+}
+
+uint32_t settings_generation(void)
+{
+    return generation;
+}
+
+static void settings_defaults(settings_record_t *record)
+{
+    memset(record, 0, sizeof(*record));
+    record->magic = SETTINGS_MAGIC;
+    for (size_t i = 0; i < SETTING_COUNT; i++)
+    {
+        record->values[i] = fields[i].fallback;
+    }
+}
+
+static void settings_save(const settings_record_t *record)
+{
+    nvs_handle_t nvs;
+
+    if (nvs_open(SETTINGS_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to open NVS, settings last until reboot");
+        return;
+    }
+    if (nvs_set_blob(nvs, SETTINGS_NVS_KEY, record, sizeof(*record)) != ESP_OK || nvs_commit(nvs) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to save settings");
+    }
+    nvs_close(nvs);
+}
+
+static void format_shadow_topics(void)
+{
+    uint8_t mac[6] = {0};
+    char mac_hex[13];
+    char thing[32];
+
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(mac_hex, sizeof(mac_hex), "%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    snprintf(thing, sizeof(thing), SETTINGS_THING_NAME_FORMAT, mac_hex);
+
+    snprintf(settings_delta_topic, sizeof(settings_delta_topic), "$aws/things/%s/shadow/update/delta", thing);
+    snprintf(settings_get_accepted_topic, sizeof(settings_get_accepted_topic), "$aws/things/%s/shadow/get/accepted",
+             thing);
+    snprintf(shadow_update_topic, sizeof(shadow_update_topic), "$aws/things/%s/shadow/update", thing);
+    snprintf(shadow_get_topic, sizeof(shadow_get_topic), "$aws/things/%s/shadow/get", thing);
+}
+
+esp_err_t init_settings(void)
+{
+    nvs_handle_t nvs;
+    settings_record_t stored;
+    size_t len = sizeof(stored);
+
+    format_shadow_topics();
+    settings_defaults(&current);
+
+    if (nvs_open(SETTINGS_NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK)
+    {
+        if (nvs_get_blob(nvs, SETTINGS_NVS_KEY, &stored, &len) == ESP_OK && len == sizeof(stored) &&
+            stored.magic == SETTINGS_MAGIC)
+        {
+            current = stored;
+        }
+        nvs_close(nvs);
+    }
+
+    for (size_t i = 0; i < SETTING_COUNT; i++)
+    {
+        if (settings_is_set((setting_t)i))
+        {
+            ESP_LOGI(TAG, "%s = %lu (shadow version %lu)", fields[i].key, (unsigned long)current.values[i],
+                     (unsigned long)current.shadow_version);
+        }
+    }
+    generation++;
+    return ESP_OK;
+}
+
+void settings_on_connected(void)
+{
+    mqtt_outbox_enqueue(shadow_get_topic, "{}", 0);
+}
+
+// Reports the settings in changed_mask, so the shadow drops them from the delta
+static void report_settings(uint32_t changed_mask)
+{
+    char payload[OUTBOX_PAYLOAD_MAX_LEN];
+    int len = snprintf(payload, sizeof(payload), "{\"state\":{\"reported\":{");
+
+    for (size_t i = 0; i < SETTING_COUNT && len < (int)sizeof(payload); i++)
+    {
+        if (changed_mask & (1u << i))
+        {
+            len += snprintf(payload + len, sizeof(payload) - len, "%s\"%s\":%lu", (payload[len - 1] == '{') ? "" : ",",
+                            fields[i].key, (unsigned long)current.values[i]);
+        }
+    }
+    if (len + 3 >= (int)sizeof(payload))
+    {
+        ESP_LOGE(TAG, "Reported settings do not fit a payload");
+        return;
+    }
+    strcpy(payload + len, "}}}");
+    mqtt_outbox_enqueue(shadow_update_topic, payload, 1);
+}
+
+// `state` holds the desired values that differ from the reported ones. Values
+// out of range stay in the delta, so the backend can see they were refused.
+static void apply_settings(const cJSON *state, uint32_t version)
+{
+    settings_record_t next = current;
+    uint32_t changed_mask = 0;
+    bool door_changed = false;
+
+    for (size_t i = 0; i < SETTING_COUNT; i++)
+    {
+        const cJSON *item = cJSON_GetObjectItemCaseSensitive(state, fields[i].key);
+        if (item == NULL)
+        {
+            continue;
+        }
+        if (!cJSON_IsNumber(item) || item->valuedouble < fields[i].min || item->valuedouble > fields[i].max)
+        {
+            ESP_LOGW(TAG, "Refused %s, needs a number from %lu to %lu", fields[i].key, (unsigned long)fields[i].min,
+                     (unsigned long)fields[i].max);
+            continue;
+        }
+
+        uint32_t value = (uint32_t)item->valuedouble;
+        if (value != next.values[i] || !(next.set_mask & (1u << i)))
+        {
+            ESP_LOGI(TAG, "%s: %lu -> %lu", fields[i].key, (unsigned long)next.values[i], (unsigned long)value);
+            next.values[i] = value;
+            next.set_mask |= 1u << i;
+            door_changed |= fields[i].door;
+        }
+        // Reported even if unchanged, or the shadow keeps it in the delta
+        changed_mask |= 1u << i;
+    }
+
+    next.shadow_version = version;
+    portENTER_CRITICAL(&settings_lock);
+    bool stored_changed = memcmp(&next, &current, sizeof(next)) != 0;
+    current = next;
+    portEXIT_CRITICAL(&settings_lock);
+
+    if (stored_changed)
+    {
+        settings_save(&next);
+        generation++;
+        if (door_changed)
+        {
+            door_handler_reload_settings();
+        }
+    }
+    if (changed_mask != 0)
+    {
+        report_settings(changed_mask);
+    }
+}
+
+static void handle_shadow_document(const mqtt_route_msg_t *msg, bool full_document)
+{
+    cJSON *root = cJSON_ParseWithLength(msg->data, msg->len);
+    const cJSON *version = cJSON_GetObjectItemCaseSensitive(root, "version");
+    const cJSON *state = cJSON_GetObjectItemCaseSensitive(root, "state");
+
+    if (!cJSON_IsNumber(version) || !cJSON_IsObject(state))
+    {
+        ESP_LOGE(TAG, "Shadow document on %s without version or state", msg->topic);
+        cJSON_Delete(root);
+        return;
+    }
+
+    uint32_t doc_version = (uint32_t)version->valuedouble;
+    // Deltas can arrive twice or out of order; the full document from get is
+    // authoritative, also after the shadow was deleted and its version restarted
+    if (!full_document && doc_version <= current.shadow_version)
+    {
+        ESP_LOGW(TAG, "Ignored stale delta, version %lu after %lu", (unsigned long)doc_version,
+                 (unsigned long)current.shadow_version);
+        cJSON_Delete(root);
+        return;
+    }
+
+    const cJSON *delta = full_document ? cJSON_GetObjectItemCaseSensitive(state, "delta") : state;
+    apply_settings(delta, doc_version);
+    cJSON_Delete(root);
+}
+
+void settings_handle_delta(const mqtt_route_msg_t *msg)
+{
+    handle_shadow_document(msg, false);
+}
+
+void settings_handle_get_accepted(const mqtt_route_msg_t *msg)
+{
+    handle_shadow_document(msg, true);
+}
@@ -0,0 +1,43 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "mqtt_router.h"
+#include "settings_config.h"
+
+// Operating parameters that can be changed from the device shadow without a
+// build or a reboot. Defaults come from door_config.h.
+typedef enum
+{
+    SETTING_DEBOUNCE_MS,
+    SETTING_DEBOUNCE_MODE, // debounce_mode_t
+    SETTING_REMINDER_MS,   // First reminder interval, later ones follow the curve; 0 turns reminders off
+    SETTING_PUBLISH_RETRIES,
+    SETTING_COUNT
+} setting_t;
+
+// Shadow topics of this device, filled in by init_settings()
+extern char settings_delta_topic[SETTINGS_TOPIC_MAX_LEN];
+extern char settings_get_accepted_topic[SETTINGS_TOPIC_MAX_LEN];
+
+// Loads the values last set from the shadow out of NVS
+esp_err_t init_settings(void);
+
+uint32_t settings_get(setting_t setting);
+
+// Whether the shadow ever set this value. Unset values leave per-sensor
+// configuration in DOOR_SENSOR_TABLE alone.
+bool settings_is_set(setting_t setting);
+
+// Changes with every applied update, so a consumer can tell that it is behind
+uint32_t settings_generation(void);
+
+// Asks for the shadow, which answers with any delta that piled up while offline
+void settings_on_connected(void);
+
+void settings_handle_delta(const mqtt_route_msg_t *msg);
+void settings_handle_get_accepted(const mqtt_route_msg_t *msg);
+
+#endif // SETTINGS_H
@@ -0,0 +1,13 @@
+#ifndef SETTINGS_CONFIG_H
+#define SETTINGS_CONFIG_H
+
+#define SETTINGS_NVS_NAMESPACE "settings"
+#define SETTINGS_NVS_KEY "values"
+
+// Device shadow of the AWS IoT thing, whose name is this format applied to the
+// Wi-Fi MAC without colons
+#define SETTINGS_THING_NAME_FORMAT "mailbox-%s"
+#define SETTINGS_TOPIC_MAX_LEN 80
+#define SETTINGS_DOC_MAX_LEN 1024 // Delta or get/accepted document, metadata included
+
+#endif // SETTINGS_CONFIG_H
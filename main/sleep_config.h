@@ -0,0 +1,27 @@
+#ifndef SLEEP_CONFIG_H
+#define SLEEP_CONFIG_H
+
+// Deep-sleep between door events instead of staying associated. Groundwork
+// only: every sensor pin must be an RTC GPIO, and the mailbox is wired to
+// GPIO 21, which is not one. Enabling it takes moving that reed switch to an
+// RTC pin such as GPIO 27 and changing BUTTON_GPIO (door_config.h) to match;
+// the build refuses the combination until then. Other sensors on non-RTC pins
+// are caught at boot, and the device logs why and stays awake.
+//
+// Still open from the wake-to-publish latency goal: Wi-Fi rejoins with a full
+// scan, as gecl-wifi-manager takes no cached channel or BSSID. The TLS session
+// (tls_session_transport.c) and the skipped SNTP wait already apply on a wake.
+#define SLEEP_MODE_ENABLED 0
+
+#define SLEEP_POLL_PERIOD_MS 50
+#define SLEEP_MIN_AWAKE_MS 1000        // Catch a door that bounces or swings back right away
+#define SLEEP_PUBLISH_TIMEOUT_MS 15000 // Give up waiting for PUBACKs; the journal keeps the events
+#define SLEEP_TIME_RESYNC_WAKES 100    // SNTP on every Nth wake; the RTC keeps time in between
+#define SLEEP_POLICY_MAX_SENSORS 8
+
+// RTC GPIOs of the ESP32, the only pins ext0/ext1 can wake on
+#define SLEEP_IS_RTC_GPIO(n)                                                                                  \
+    ((n) == 0 || (n) == 2 || (n) == 4 || ((n) >= 12 && (n) <= 15) || ((n) >= 25 && (n) <= 27) ||             \
+     ((n) >= 32 && (n) <= 39))
+
+#endif // SLEEP_CONFIG_H
@@ -0,0 +1,142 @@
+#include <string.h>
+#include "tls_handshake_stats.h"
+#include "metrics.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "TLS_HANDSHAKE_STATS";
+
+#define TLS_STATS_MAGIC 0x544C5331 // "TLS1"
+
+typedef struct
+{
+    uint32_t magic;
+    tls_handshake_stats_t stats;
+} tls_stats_store_t;
+
+// RTC slow memory keeps the counters across deep sleep and software resets
+static RTC_NOINIT_ATTR tls_stats_store_t tls_store;
+static int64_t connect_started_us = 0;
+static portMUX_TYPE tls_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void before_connect_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    portENTER_CRITICAL(&tls_stats_lock);
+    connect_started_us = esp_timer_get_time();
+    tls_store.stats.attempts++;
+    portEXIT_CRITICAL(&tls_stats_lock);
+}
+
+void tls_handshake_stats_on_connected(void)
+{
+    int64_t duration_us;
+
+    portENTER_CRITICAL(&tls_stats_lock);
+    if (connect_started_us == 0)
+    {
+        portEXIT_CRITICAL(&tls_stats_lock);
+        return;
+    }
+
+    duration_us = esp_timer_get_time() - connect_started_us;
+    connect_started_us = 0;
+
+    tls_handshake_stats_t *stats = &tls_store.stats;
+    stats->completed++;
+    stats->last_us = duration_us;
+    stats->total_us += duration_us;
+    if (stats->min_us == 0 || duration_us < stats->min_us)
+    {
+        stats->min_us = duration_us;
+    }
+    if (duration_us > stats->max_us)
+    {
+        stats->max_us = duration_us;
+    }
+    portEXIT_CRITICAL(&tls_stats_lock);
+
+    ESP_LOGI(TAG, "Connect + TLS handshake took %lld ms", (long long)(duration_us / 1000));
+}
+
+void tls_handshake_stats_on_error(esp_mqtt_event_handle_t event)
+{
+    if (event->error_handle->error_type != MQTT_ERROR_TYPE_ESP_TLS)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&tls_stats_lock);
+    tls_store.stats.tls_failures++;
+    connect_started_us = 0;
+    portEXIT_CRITICAL(&tls_stats_lock);
+}
+
+void tls_handshake_stats_on_handshake(bool offered, bool resumed, int64_t duration_us)
+{
+    portENTER_CRITICAL(&tls_stats_lock);
+    tls_handshake_stats_t *stats = &tls_store.stats;
+    if (resumed)
+    {
+        stats->resumed++;
+        stats->resumed_total_us += duration_us;
+    }
+    else
+    {
+        stats->full++;
+        stats->full_total_us += duration_us;
+        if (offered)
+        {
+            stats->resume_refused++;
+        }
+    }
+    portEXIT_CRITICAL(&tls_stats_lock);
+
+    metrics_inc(resumed ? METRIC_TLS_RESUMED_HANDSHAKES : METRIC_TLS_FULL_HANDSHAKES);
+    metrics_observe_ms(resumed ? METRIC_HIST_TLS_RESUMED_MS : METRIC_HIST_TLS_FULL_MS,
+                       (uint32_t)(duration_us / 1000));
+    ESP_LOGI(TAG, "%s TLS handshake took %lld ms%s", resumed ? "Resumed" : "Full", (long long)(duration_us / 1000),
+             (offered && !resumed) ? " (cached session refused)" : "");
+}
+
+void tls_handshake_stats_on_handshake_failed(void)
+{
+    portENTER_CRITICAL(&tls_stats_lock);
+    tls_store.stats.tls_failures++;
+    portEXIT_CRITICAL(&tls_stats_lock);
+}
+
+void tls_handshake_stats_get(tls_handshake_stats_t *stats)
+{
+    portENTER_CRITICAL(&tls_stats_lock);
+    *stats = tls_store.stats;
+    portEXIT_CRITICAL(&tls_stats_lock);
+}
+
+esp_err_t init_tls_handshake_stats(esp_mqtt_client_handle_t client)
+{
+    if (tls_store.magic != TLS_STATS_MAGIC)
+    {
+        // Power-on reset: RTC memory holds garbage
+        memset(&tls_store, 0, sizeof(tls_store));
+        tls_store.magic = TLS_STATS_MAGIC;
+    }
+    tls_store.stats.boots++;
+
+    // init_mqtt() has already started the first connect before we could register
+    portENTER_CRITICAL(&tls_stats_lock);
+    if (connect_started_us == 0)
+    {
+        connect_started_us = esp_timer_get_time();
+        tls_store.stats.attempts++;
+    }
+    portEXIT_CRITICAL(&tls_stats_lock);
+
+    esp_err_t err = esp_mqtt_client_register_event(client, MQTT_EVENT_BEFORE_CONNECT, before_connect_handler, NULL);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to register BEFORE_CONNECT handler: %s", esp_err_to_name(err));
+    }
+    return err;
+}
@@ -0,0 +1,39 @@
+#ifndef TLS_HANDSHAKE_STATS_H
+#define TLS_HANDSHAKE_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "mqtt_client.h"
+
+typedef struct
+{
+    uint32_t attempts;
+    uint32_t completed;
+    uint32_t tls_failures;
+    uint32_t full;           // Handshakes that sent and verified the certificate chain
+    uint32_t resumed;        // Handshakes that resumed the cached session
+    uint32_t resume_refused; // Cached session offered, broker did a full handshake
+    int64_t full_total_us;   // TCP connect + handshake, by kind
+    int64_t resumed_total_us;
+    uint32_t boots; // Resets survived by these counters (deep sleep, error_reload)
+    int64_t last_us;
+    int64_t min_us;
+    int64_t max_us;
+    int64_t total_us;
+} tls_handshake_stats_t;
+
+// Registers for MQTT_EVENT_BEFORE_CONNECT on the client so every connect,
+// including esp-mqtt's own automatic reconnects, is timed up to CONNACK.
+esp_err_t init_tls_handshake_stats(esp_mqtt_client_handle_t client);
+
+void tls_handshake_stats_on_connected(void);
+void tls_handshake_stats_on_error(esp_mqtt_event_handle_t event);
+
+// Reported by tls_session_transport, which knows whether a session was resumed
+void tls_handshake_stats_on_handshake(bool offered, bool resumed, int64_t duration_us);
+void tls_handshake_stats_on_handshake_failed(void);
+
+void tls_handshake_stats_get(tls_handshake_stats_t *stats);
+
+#endif // TLS_HANDSHAKE_STATS_H
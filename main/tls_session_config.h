@@ -0,0 +1,16 @@
+#ifndef TLS_SESSION_CONFIG_H
+#define TLS_SESSION_CONFIG_H
+
+// Connect through tls_session_transport, which offers the last TLS session
+// ticket on every connect, including after deep sleep and error_reload(). 0 goes
+// back to esp-mqtt's own TLS transport and a full handshake every time.
+// Needs CONFIG_MBEDTLS_CLIENT_SSL_SESSION_TICKETS (on by default).
+#define TLS_SESSION_RESUMPTION 1
+
+// Serialized session in RTC memory. A session carries the ticket and, with
+// CONFIG_MBEDTLS_KEEP_PEER_CERTIFICATE, the broker certificate; one that does
+// not fit is not cached and the next connect does a full handshake.
+#define TLS_SESSION_STORE_MAX 2048
+#define TLS_SESSION_HOST_MAX 128
+
+#endif // TLS_SESSION_CONFIG_H
@@ -0,0 +1,414 @@
+#include <stdlib.h>
+#include <string.h>
+#include "tls_session_transport.h"
+#include "tls_session_config.h"
+#include "tls_handshake_stats.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_transport.h"
+#include "esp_transport_tcp.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509_crt.h"
+
+static const char *TAG = "TLS_SESSION";
+
+#define TLS_SESSION_MAGIC 0x544C5353 // "TLSS"
+
+typedef struct
+{
+    uint32_t magic;
+    int port;
+    char host[TLS_SESSION_HOST_MAX];
+    size_t len;
+    uint8_t data[TLS_SESSION_STORE_MAX];
+} tls_session_store_t;
+
+typedef struct
+{
+    esp_transport_handle_t tcp;
+    mbedtls_ssl_config conf;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_entropy_context entropy;
+    mbedtls_x509_crt ca;
+    mbedtls_x509_crt cert;
+    mbedtls_pk_context key;
+    mbedtls_ssl_context ssl;
+    bool ssl_active;
+    bool verified_chain; // Set by the verify callback, which only runs in a full handshake
+    int timeout_ms;      // For the bio callbacks of the current call
+} tls_session_ctx_t;
+
+// RTC slow memory keeps the session across deep sleep and software resets;
+// mbedtls_ssl_session_load() rejects whatever a power-on reset leaves there
+static RTC_NOINIT_ATTR tls_session_store_t session_store;
+
+static void tls_session_forget(void)
+{
+    session_store.magic = 0;
+}
+
+static int bio_send(void *arg, const unsigned char *buf, size_t len)
+{
+    tls_session_ctx_t *ctx = arg;
+    int ret = esp_transport_write(ctx->tcp, (const char *)buf, (int)len, ctx->timeout_ms);
+
+    if (ret > 0)
+    {
+        return ret;
+    }
+    return (ret == 0) ? MBEDTLS_ERR_SSL_WANT_WRITE : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+static int bio_recv(void *arg, unsigned char *buf, size_t len)
+{
+    tls_session_ctx_t *ctx = arg;
+    int ret = esp_transport_read(ctx->tcp, (char *)buf, (int)len, ctx->timeout_ms);
+
+    if (ret > 0)
+    {
+        return ret;
+    }
+    if (ret == 0 || ret == ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT)
+    {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+    return (ret == ERR_TCP_TRANSPORT_CONNECTION_CLOSED_BY_FIN) ? 0 : MBEDTLS_ERR_NET_RECV_FAILED;
+}
+
+static int verify_chain(void *arg, mbedtls_x509_crt *crt, int depth, uint32_t *flags)
+{
+    ((tls_session_ctx_t *)arg)->verified_chain = true;
+    return 0; // mbedTLS still enforces the flags it computed
+}
+
+static void ssl_release(tls_session_ctx_t *ctx)
+{
+    if (ctx->ssl_active)
+    {
+        mbedtls_ssl_free(&ctx->ssl);
+        ctx->ssl_active = false;
+    }
+}
+
+// Loads the cached session into ssl if it was made with the same broker
+static bool offer_cached_session(tls_session_ctx_t *ctx, const char *host, int port)
+{
+    mbedtls_ssl_session session;
+    bool offered = false;
+
+    if (session_store.magic != TLS_SESSION_MAGIC || session_store.port != port ||
+        strncmp(session_store.host, host, sizeof(session_store.host)) != 0 ||
+        session_store.len > sizeof(session_store.data))
+    {
+        return false;
+    }
+
+    mbedtls_ssl_session_init(&session);
+    if (mbedtls_ssl_session_load(&session, session_store.data, session_store.len) == 0 &&
+        mbedtls_ssl_set_session(&ctx->ssl, &session) == 0)
+    {
+        offered = true;
+    }
+    else
+    {
+        tls_session_forget();
+    }
+    mbedtls_ssl_session_free(&session);
+    return offered;
+}
+
+static void store_session(tls_session_ctx_t *ctx, const char *host, int port)
+{
+    mbedtls_ssl_session session;
+    size_t len = 0;
+
+    mbedtls_ssl_session_init(&session);
+    tls_session_forget();
+    if (mbedtls_ssl_get_session(&ctx->ssl, &session) == 0 && strlen(host) < sizeof(session_store.host))
+    {
+        int ret = mbedtls_ssl_session_save(&session, session_store.data, sizeof(session_store.data), &len);
+        if (ret == 0)
+        {
+            strcpy(session_store.host, host);
+            session_store.port = port;
+            session_store.len = len;
+            session_store.magic = TLS_SESSION_MAGIC;
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Session not cached (-0x%04x), %u bytes available", (unsigned)-ret,
+                     (unsigned)sizeof(session_store.data));
+        }
+    }
+    mbedtls_ssl_session_free(&session);
+}
+
+// One TCP connect and handshake; returns 0 once the TLS session is up
+static int connect_once(tls_session_ctx_t *ctx, const char *host, int port, int timeout_ms, bool *offered)
+{
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    int ret;
+
+    *offered = false;
+    if (esp_transport_connect(ctx->tcp, host, port, timeout_ms) < 0)
+    {
+        return -1;
+    }
+
+    mbedtls_ssl_init(&ctx->ssl);
+    ctx->ssl_active = true;
+    ctx->verified_chain = false;
+    ctx->timeout_ms = timeout_ms;
+    ret = mbedtls_ssl_setup(&ctx->ssl, &ctx->conf);
+    if (ret == 0)
+    {
+        ret = mbedtls_ssl_set_hostname(&ctx->ssl, host);
+    }
+    if (ret == 0)
+    {
+        mbedtls_ssl_set_bio(&ctx->ssl, ctx, bio_send, bio_recv, NULL);
+        *offered = offer_cached_session(ctx, host, port);
+        do
+        {
+            ret = mbedtls_ssl_handshake(&ctx->ssl);
+        } while ((ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) &&
+                 esp_timer_get_time() < deadline_us);
+    }
+
+    if (ret != 0)
+    {
+        ESP_LOGW(TAG, "TLS handshake with %s failed: -0x%04x", host, (unsigned)-ret);
+        ssl_release(ctx);
+        esp_transport_close(ctx->tcp);
+    }
+    return ret;
+}
+
+static int tls_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms)
+{
+    tls_session_ctx_t *ctx = esp_transport_get_context_data(t);
+    int64_t started_us = esp_timer_get_time();
+    bool offered;
+    int ret = connect_once(ctx, host, port, timeout_ms, &offered);
+
+    if (ret != 0 && offered)
+    {
+        // A broker that rejects the ticket normally just does a full handshake;
+        // this covers one that fails the connection instead
+        ESP_LOGW(TAG, "Resuming the cached session failed, retrying with a full handshake");
+        tls_session_forget();
+        ret = connect_once(ctx, host, port, timeout_ms, &offered);
+    }
+    if (ret != 0)
+    {
+        tls_handshake_stats_on_handshake_failed();
+        return -1;
+    }
+
+    bool resumed = offered && !ctx->verified_chain;
+    tls_handshake_stats_on_handshake(offered, resumed, esp_timer_get_time() - started_us);
+    store_session(ctx, host, port);
+    return 0;
+}
+
+static int tls_read(esp_transport_handle_t t, char *buffer, int len, int timeout_ms)
+{
+    tls_session_ctx_t *ctx = esp_transport_get_context_data(t);
+
+    if (!ctx->ssl_active)
+    {
+        return ERR_TCP_TRANSPORT_CONNECTION_FAILED;
+    }
+    if (mbedtls_ssl_get_bytes_avail(&ctx->ssl) == 0)
+    {
+        int poll = esp_transport_poll_read(ctx->tcp, timeout_ms);
+        if (poll <= 0)
+        {
+            return poll; // 0 is a timeout to esp-mqtt, -1 an error
+        }
+    }
+
+    ctx->timeout_ms = timeout_ms;
+    int ret = mbedtls_ssl_read(&ctx->ssl, (unsigned char *)buffer, (size_t)len);
+    if (ret > 0)
+    {
+        return ret;
+    }
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+    {
+        return 0;
+    }
+    if (ret == 0 || ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY)
+    {
+        return ERR_TCP_TRANSPORT_CONNECTION_CLOSED_BY_FIN;
+    }
+    ESP_LOGW(TAG, "TLS read failed: -0x%04x", (unsigned)-ret);
+    return ERR_TCP_TRANSPORT_CONNECTION_FAILED;
+}
+
+static int tls_write(esp_transport_handle_t t, const char *buffer, int len, int timeout_ms)
+{
+    tls_session_ctx_t *ctx = esp_transport_get_context_data(t);
+
+    if (!ctx->ssl_active)
+    {
+        return ERR_TCP_TRANSPORT_CONNECTION_FAILED;
+    }
+
+    ctx->timeout_ms = timeout_ms;
+    int ret = mbedtls_ssl_write(&ctx->ssl, (const unsigned char *)buffer, (size_t)len);
+    if (ret >= 0)
+    {
+        return ret;
+    }
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+    {
+        return 0;
+    }
+    ESP_LOGW(TAG, "TLS write failed: -0x%04x", (unsigned)-ret);
+    return ERR_TCP_TRANSPORT_CONNECTION_FAILED;
+}
+
+static int tls_poll_read(esp_transport_handle_t t, int timeout_ms)
+{
+    tls_session_ctx_t *ctx = esp_transport_get_context_data(t);
+
+    if (ctx->ssl_active && mbedtls_ssl_get_bytes_avail(&ctx->ssl) > 0)
+    {
+        return 1;
+    }
+    return esp_transport_poll_read(ctx->tcp, timeout_ms);
+}
+
+static int tls_poll_write(esp_transport_handle_t t, int timeout_ms)
+{
+    tls_session_ctx_t *ctx = esp_transport_get_context_data(t);
+    return esp_transport_poll_write(ctx->tcp, timeout_ms);
+}
+
+static int tls_close(esp_transport_handle_t t)
+{
+    tls_session_ctx_t *ctx = esp_transport_get_context_data(t);
+
+    if (ctx->ssl_active)
+    {
+        mbedtls_ssl_close_notify(&ctx->ssl);
+        ssl_release(ctx);
+    }
+    return esp_transport_close(ctx->tcp);
+}
+
+static void ctx_free(tls_session_ctx_t *ctx)
+{
+    ssl_release(ctx);
+    mbedtls_ssl_config_free(&ctx->conf);
+    mbedtls_pk_free(&ctx->key);
+    mbedtls_x509_crt_free(&ctx->cert);
+    mbedtls_x509_crt_free(&ctx->ca);
+    mbedtls_ctr_drbg_free(&ctx->drbg);
+    mbedtls_entropy_free(&ctx->entropy);
+    if (ctx->tcp != NULL)
+    {
+        esp_transport_destroy(ctx->tcp);
+    }
+    free(ctx);
+}
+
+static int tls_destroy(esp_transport_handle_t t)
+{
+    tls_session_ctx_t *ctx = esp_transport_get_context_data(t);
+
+    tls_close(t);
+    ctx_free(ctx);
+    return 0;
+}
+
+// Parses the credentials once; every connect reuses the same config
+static esp_err_t ctx_setup(tls_session_ctx_t *ctx, const char *ca_pem, const char *cert_pem, const char *key_pem)
+{
+    int ret;
+
+    mbedtls_ssl_config_init(&ctx->conf);
+    mbedtls_entropy_init(&ctx->entropy);
+    mbedtls_ctr_drbg_init(&ctx->drbg);
+    mbedtls_x509_crt_init(&ctx->ca);
+    mbedtls_x509_crt_init(&ctx->cert);
+    mbedtls_pk_init(&ctx->key);
+
+    ret = mbedtls_ctr_drbg_seed(&ctx->drbg, mbedtls_entropy_func, &ctx->entropy, NULL, 0);
+    if (ret == 0)
+    {
+        ret = mbedtls_x509_crt_parse(&ctx->ca, (const unsigned char *)ca_pem, strlen(ca_pem) + 1);
+    }
+    if (ret == 0)
+    {
+        ret = mbedtls_x509_crt_parse(&ctx->cert, (const unsigned char *)cert_pem, strlen(cert_pem) + 1);
+    }
+    if (ret == 0)
+    {
+        ret = mbedtls_pk_parse_key(&ctx->key, (const unsigned char *)key_pem, strlen(key_pem) + 1, NULL, 0,
+                                   mbedtls_ctr_drbg_random, &ctx->drbg);
+    }
+    if (ret == 0)
+    {
+        ret = mbedtls_ssl_config_defaults(&ctx->conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                          MBEDTLS_SSL_PRESET_DEFAULT);
+    }
+    if (ret == 0)
+    {
+        ret = mbedtls_ssl_conf_own_cert(&ctx->conf, &ctx->cert, &ctx->key);
+    }
+    if (ret != 0)
+    {
+        ESP_LOGE(TAG, "TLS setup failed: -0x%04x", (unsigned)-ret);
+        return ESP_FAIL;
+    }
+
+    mbedtls_ssl_conf_authmode(&ctx->conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&ctx->conf, &ctx->ca, NULL);
+    mbedtls_ssl_conf_rng(&ctx->conf, mbedtls_ctr_drbg_random, &ctx->drbg);
+    mbedtls_ssl_conf_verify(&ctx->conf, verify_chain, ctx);
+    mbedtls_ssl_conf_session_tickets(&ctx->conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+    return ESP_OK;
+}
+
+esp_err_t tls_session_install(esp_mqtt_client_handle_t client, const char *ca_pem, const char *cert_pem,
+                              const char *key_pem)
+{
+    tls_session_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    esp_transport_handle_t transport = NULL;
+
+    if (ctx == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    if (ctx_setup(ctx, ca_pem, cert_pem, key_pem) != ESP_OK || (ctx->tcp = esp_transport_tcp_init()) == NULL ||
+        (transport = esp_transport_init()) == NULL)
+    {
+        ctx_free(ctx);
+        return ESP_FAIL;
+    }
+    esp_transport_set_context_data(transport, ctx);
+    esp_transport_set_func(transport, tls_connect, tls_read, tls_write, tls_close, tls_poll_read, tls_poll_write,
+                           tls_destroy);
+    esp_transport_set_default_port(transport, 8883);
+
+    const esp_mqtt_client_config_t config = {.network.transport = transport};
+    esp_mqtt_client_stop(client);
+    esp_err_t err = esp_mqtt_set_config(client, &config);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to set the MQTT transport: %s", esp_err_to_name(err));
+        esp_transport_destroy(transport);
+    }
+    esp_mqtt_client_start(client);
+
+    ESP_LOGI(TAG, "Session resumption on, %s",
+             (session_store.magic == TLS_SESSION_MAGIC) ? "session cached" : "no session cached");
+    return err;
+}
@@ -0,0 +1,15 @@
+#ifndef TLS_SESSION_TRANSPORT_H
+#define TLS_SESSION_TRANSPORT_H
+
+#include "esp_err.h"
+#include "mqtt_client.h"
+
+// Replaces the client's TLS transport with a mutual-TLS one that caches the
+// session ticket in RTC memory and resumes it on the next connect, falling back
+// to a full handshake when the broker refuses it. init_mqtt() has already
+// started the client, so it is stopped and started once around the swap.
+// The PEM buffers must stay valid for the client's lifetime.
+esp_err_t tls_session_install(esp_mqtt_client_handle_t client, const char *ca_pem, const char *cert_pem,
+                              const char *key_pem);
+
+#endif // TLS_SESSION_TRANSPORT_H
@@ -0,0 +1,38 @@
+#!/bin/sh
+# Makes a throwaway CA, a server certificate for the local test broker and one
+# client certificate shared by the device and the simulated fleet, all in
+# tools/broker/certs. The firmware embeds ca.crt, client.crt and client.key when
+# built with -DMQTT_LOCAL_BROKER_URI.
+#
+# usage: gen_certs.sh <broker host or IP as the device will dial it>
+set -e
+
+if [ $# -ne 1 ]; then
+    echo "usage: $0 <broker host or IP>" >&2
+    exit 1
+fi
+host=$1
+dir=$(dirname "$0")/certs
+mkdir -p "$dir"
+cd "$dir"
+
+case $host in
+    *[!0-9.]*) san="DNS:$host" ;;
+    *) san="IP:$host" ;;
+esac
+
+openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes -days 365 \
+    -subj "/CN=mailbox test CA" -keyout ca.key -out ca.crt
+
+openssl req -newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes \
+    -subj "/CN=$host" -keyout server.key -out server.csr
+printf "subjectAltName=%s,DNS:localhost,IP:127.0.0.1\n" "$san" > server.ext
+openssl x509 -req -in server.csr -CA ca.crt -CAkey ca.key -CAcreateserial -days 365 \
+    -extfile server.ext -out server.crt
+
+openssl req -newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes \
+    -subj "/CN=mailbox" -keyout client.key -out client.crt.csr
+openssl x509 -req -in client.crt.csr -CA ca.crt -CAkey ca.key -CAcreateserial -days 365 -out client.crt
+
+rm -f server.csr client.crt.csr server.ext
+echo "Certificates for $host written to $(pwd)"
@@ -0,0 +1,660 @@
+#!/usr/bin/env python3
+"""End-to-end latency, reconnect and load harness against a local MQTT broker.
+
+The firmware talks to AWS IoT over mutual TLS, which a test rig cannot reach.
+tools/broker has a mosquitto stand-in with the same mutual TLS setup:
+
+    tools/broker/gen_certs.sh 192.168.1.20
+    idf.py -DMQTT_LOCAL_BROKER_URI=mqtts://192.168.1.20:8883 build flash
+    tools/broker/harness.py --start-broker --door-topic <door topic> \\
+        --ota-topic <OTA topic> latency
+
+Modes:
+    latency    edge-to-broker latency of door events: from the event's "ts" to
+               the time the harness receives it. Needs the device and this host
+               on NTP; the binary payload format only has whole seconds. Build
+               with -DDOOR_TRACE_FILE for a repeatable series of edges, and
+               keep SESSION_SUMMARY 0 in main/session_config.h so every
+               transition is published rather than one event per session.
+    reconnect  kills the broker, restarts it after --down seconds and times how
+               long the device takes to reconnect and to publish again
+    ota        publishes an OTA manifest for --mac, or with --version a command
+               on its per-device topic, and times the device's first request
+               for the image and the download, served by the harness itself
+               with --serve
+    fleet      simulates --devices mailboxes that publish door events. Each
+               runs the firmware's mqtt_router.c, mqtt_topic_match.c and
+               ota_manifest_scanner.c built for the host (see
+               tools/host/fleet_host.c), subscribes what its router subscribes
+               and hands the router every message in --chunk byte
+               MQTT_EVENT_DATA pieces. Each round times the fan-out of a
+               manifest naming all of them, every mailbox has to scan out its
+               own URL, and then of a command on each per-device topic. A real
+               device on the broker gets the same manifest and has to scan it
+               without finding its MAC.
+    shadow     stands in for the AWS IoT device shadow of --mac: answers the
+               device's get, sends each --set as a delta and times the reported
+               update, then checks that a delta with a stale version is ignored
+    tls        drops the device --cycles times by connecting with its client
+               id, which the broker takes as a session takeover, and reads how
+               many of its reconnects resumed the TLS session from the tls_full
+               and tls_resumed counters of its metrics reports. A broker restart
+               (reconnect mode) changes the ticket key, so there the device
+               must fall back to full handshakes.
+
+Every mode but fleet measures a flashed device on the broker; fleet needs
+none, only a C compiler for the host build. The broker log is how the harness
+sees devices connect, so reconnect and tls need --start-broker and ota only
+reports the reboot into the new image with it. Simulated clients and the
+harness itself connect with the client certificate from gen_certs.sh.
+Requires paho-mqtt.
+"""
+
+import argparse
+import http.server
+import json
+import os
+import random
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+try:
+    import paho.mqtt.client as mqtt
+except ImportError:
+    sys.exit("harness.py needs paho-mqtt: pip install paho-mqtt")
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(os.path.dirname(HERE), "payload"))
+sys.path.insert(0, os.path.join(os.path.dirname(HERE), "ota"))
+sys.path.insert(0, os.path.join(os.path.dirname(HERE), "host"))
+from decode_door_payload import decode  # noqa: E402
+from fleet_device import HOST_SOURCES as FLEET_HOST_SOURCES, MQTT_BUFFER_SIZE, SCAN_FOUND  # noqa: E402
+from fleet_device import SOURCES as FLEET_SOURCES, FleetDevice  # noqa: E402
+from host_c import build_library, load_copy  # noqa: E402
+from ota_command import command_payload, command_topic  # noqa: E402
+
+# Client ids of the harness' own connections, not to be taken for the device
+HARNESS_PREFIXES = ("harness-", "sim-")
+
+
+def percentiles(samples_ms) -> str:
+    ordered = sorted(samples_ms)
+
+    def pick(pct):
+        return ordered[(len(ordered) - 1) * pct // 100]
+
+    return f"n={len(ordered)} p50={pick(50):.0f} p90={pick(90):.0f} p99={pick(99):.0f} max={ordered[-1]:.0f} ms"
+
+
+class Broker:
+    """mosquitto run by the harness; its log tells when clients connect."""
+
+    def __init__(self, command, port):
+        self.command = command
+        self.port = port
+        self.process = None
+        self.connects = []
+        self.cond = threading.Condition()
+
+    def start(self) -> float:
+        self.process = subprocess.Popen(self.command, cwd=HERE, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                                        text=True)
+        threading.Thread(target=self._read_log, args=(self.process,), daemon=True).start()
+        deadline = time.time() + 5
+        while time.time() < deadline:
+            try:
+                socket.create_connection(("127.0.0.1", self.port), timeout=0.2).close()
+                return time.time()
+            except OSError:
+                time.sleep(0.05)
+        raise RuntimeError(f"broker not listening on {self.port}: {' '.join(self.command)}")
+
+    def stop(self):
+        if self.process is not None:
+            self.process.kill()
+            self.process.wait()
+            self.process = None
+
+    def _read_log(self, process):
+        for line in process.stdout:
+            # 1700000000: New client connected from 192.168.1.31:51234 as mailbox (p2, c1, k60, u'mailbox').
+            if "New client connected" in line and " as " in line:
+                client_id = line.split(" as ", 1)[1].split(" ", 1)[0]
+                with self.cond:
+                    self.connects.append((time.time(), client_id))
+                    self.cond.notify_all()
+
+    def wait_connect(self, since, timeout):
+        """First connect of a client other than the harness' own at or after `since`."""
+        deadline = time.time() + timeout
+        with self.cond:
+            while True:
+                for connected_at, client_id in self.connects:
+                    if connected_at >= since and not client_id.startswith(HARNESS_PREFIXES):
+                        return connected_at, client_id
+                remaining = deadline - time.time()
+                if remaining <= 0:
+                    return None
+                self.cond.wait(remaining)
+
+
+def connect(args, client_id, on_message=None, topics=()):
+    if hasattr(mqtt, "CallbackAPIVersion"):
+        client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION1, client_id=client_id)
+    else:
+        client = mqtt.Client(client_id=client_id)
+    client.tls_set(ca_certs=os.path.join(args.certs, "ca.crt"), certfile=os.path.join(args.certs, "client.crt"),
+                   keyfile=os.path.join(args.certs, "client.key"))
+    client.reconnect_delay_set(min_delay=1, max_delay=2)
+
+    def on_connect(client, userdata, flags, rc):
+        # Again after every reconnect, the broker keeps no session for us
+        for topic in topics:
+            client.subscribe(topic, qos=0)
+
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(args.host, args.port, keepalive=60)
+    client.loop_start()
+    return client
+
+
+def disconnect(client):
+    client.disconnect()
+    client.loop_stop()
+
+
+def run_latency(args, broker) -> int:
+    samples = []
+    skipped = {"unsynced": 0, "replay": 0}
+    done = threading.Event()
+
+    def on_message(client, userdata, msg):
+        received_ms = time.time() * 1000
+        try:
+            message = decode(msg.payload)
+        except ValueError as e:
+            print(f"Undecodable payload on {msg.topic}: {e}")
+            return
+        for event in message.get("events", [message]):
+            # Journal replays went out long after their edge, and "ts" is 0
+            # until the device clock is set
+            if event.get("replay"):
+                skipped["replay"] += 1
+                continue
+            if not event.get("ts"):
+                skipped["unsynced"] += 1
+                continue
+            latency_ms = received_ms - event["ts"]
+            samples.append(latency_ms)
+            print(f"{event.get('door')} seq={event.get('seq')} {latency_ms:.0f} ms")
+        if len(samples) >= args.count:
+            done.set()
+
+    client = connect(args, "harness-latency", on_message, [args.door_topic])
+    print(f"Waiting for {args.count} door events on {args.door_topic}")
+    done.wait(args.timeout)
+    disconnect(client)
+
+    print(f"Skipped {skipped['replay']} journal replays, {skipped['unsynced']} events without wall time")
+    if not samples:
+        print("No door events received")
+        return 1
+    print("edge-to-broker " + percentiles(samples))
+    return 0
+
+
+def run_reconnect(args, broker) -> int:
+    if broker is None:
+        print("reconnect needs --start-broker")
+        return 2
+
+    publishes = []
+    cond = threading.Condition()
+
+    def on_message(client, userdata, msg):
+        with cond:
+            publishes.append(time.time())
+            cond.notify_all()
+
+    def wait_publish(since, timeout):
+        deadline = time.time() + timeout
+        with cond:
+            while not any(t >= since for t in publishes):
+                remaining = deadline - time.time()
+                if remaining <= 0:
+                    return None
+                cond.wait(remaining)
+            return min(t for t in publishes if t >= since)
+
+    observer = connect(args, "harness-reconnect", on_message, [args.door_topic, args.door_topic + "/#"])
+    print("Waiting for the device to connect")
+    if broker.wait_connect(0, args.timeout) is None:
+        print("Device never connected")
+        disconnect(observer)
+        return 1
+
+    recovered = []
+    for cycle in range(1, args.cycles + 1):
+        time.sleep(args.settle)
+        broker.stop()
+        time.sleep(args.down)
+        restarted_at = broker.start()
+
+        connected = broker.wait_connect(restarted_at, args.timeout)
+        if connected is None:
+            print(f"cycle {cycle}: no reconnect within {args.timeout:.0f} s")
+            continue
+        connected_at, client_id = connected
+        recovered.append((connected_at - restarted_at) * 1000)
+        published_at = wait_publish(connected_at, args.publish_timeout)
+        first_publish = f"{(published_at - restarted_at) * 1000:.0f} ms" if published_at else "none"
+        print(f"cycle {cycle}: {client_id} reconnected {recovered[-1]:.0f} ms after the broker came back, "
+              f"first publish at {first_publish}")
+
+    disconnect(observer)
+    if not recovered:
+        return 1
+    print(f"reconnect after {args.down:.0f} s down: " + percentiles(recovered))
+    return 0 if len(recovered) == args.cycles else 1
+
+
+def local_address() -> str:
+    # No packet is sent; connecting only picks the interface of the default route
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+        s.connect(("192.0.2.1", 9))
+        return s.getsockname()[0]
+
+
+def serve_image(path, port):
+    """Serves one image with Range support, as ota_stream resumes with it."""
+    requests = []
+    with open(path, "rb") as f:
+        image = f.read()
+
+    class Handler(http.server.BaseHTTPRequestHandler):
+        def do_GET(self):
+            start = 0
+            range_header = self.headers.get("Range", "")
+            if range_header.startswith("bytes=") and range_header[6:].split("-")[0].isdigit():
+                start = min(int(range_header[6:].split("-")[0]), len(image))
+            requests.append({"at": time.time(), "range": range_header, "sent": 0})
+            self.send_response(206 if start else 200)
+            if start:
+                self.send_header("Content-Range", f"bytes {start}-{len(image) - 1}/{len(image)}")
+            self.send_header("Content-Length", str(len(image) - start))
+            self.end_headers()
+            try:
+                self.wfile.write(image[start:])
+                requests[-1]["sent"] = len(image) - start
+            except OSError:
+                pass
+            requests[-1]["done"] = time.time()
+
+        def log_message(self, fmt, *fmt_args):
+            pass
+
+    server = http.server.ThreadingHTTPServer(("", port), Handler)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server, requests, len(image)
+
+
+def run_ota(args, broker) -> int:
+    if not args.url and not args.serve:
+        print("ota needs --url or --serve")
+        return 2
+    if args.version and not (args.serve or args.image):
+        print("a per-device command needs the image for its digest, --serve or --image")
+        return 2
+
+    server = None
+    url = args.url
+    if args.serve:
+        host = args.http_host or local_address()
+        server, requests, size = serve_image(args.serve, args.http_port)
+        url = f"http://{host}:{args.http_port}/{os.path.basename(args.serve)}"
+
+    if args.version:
+        with open(args.image or args.serve, "rb") as f:
+            payload = command_payload(url, f.read(), args.version)
+        topic, qos = command_topic(args.ota_topic, args.mac), 1
+    else:
+        topic, payload, qos = args.ota_topic, json.dumps({args.mac: url}), 0
+
+    client = connect(args, "harness-ota")
+    published_at = time.time()
+    client.publish(topic, payload, qos=qos).wait_for_publish()
+    print(f"Published {url} for {args.mac} on {topic}")
+    disconnect(client)
+
+    result = 0
+    if server is not None:
+        deadline = published_at + args.timeout
+        while not requests and time.time() < deadline:
+            time.sleep(0.05)
+        if not requests:
+            print("The device never requested the image")
+            result = 1
+        else:
+            print(f"First image request {(requests[0]['at'] - published_at) * 1000:.0f} ms after the manifest")
+            while sum(r["sent"] for r in requests) < size and time.time() < deadline:
+                time.sleep(0.1)
+            finished = [r["done"] for r in requests if "done" in r]
+            if finished and sum(r["sent"] for r in requests) >= size:
+                seconds = max(finished) - requests[0]["at"]
+                print(f"Downloaded {size} bytes in {len(requests)} requests, {seconds:.1f} s "
+                      f"({size / 1024 / max(seconds, 0.001):.0f} KiB/s)")
+            else:
+                print(f"Download incomplete: {sum(r['sent'] for r in requests)} of {size} bytes")
+                result = 1
+        server.shutdown()
+
+    if broker is not None and result == 0:
+        connected = broker.wait_connect(time.time(), args.timeout)
+        if connected is None:
+            print("The device did not come back after the update")
+            result = 1
+        else:
+            print(f"{connected[1]} reconnected {connected[0] - published_at:.1f} s after the manifest")
+    return result
+
+
+def door_event(mac, seq, state):
+    now_ms = int(time.time() * 1000)
+    event = {"door": state, "seq": seq, "mono_ms": now_ms % 2**31, "ts": now_ms, "dwell_ms": 0}
+    return json.dumps({"door": state, "v": 1, "dev": mac.replace(":", ""), "rssi": -60, "bat_mv": 3000,
+                       "events": [event]})
+
+
+def run_fleet(args, broker) -> int:
+    macs = [f"02:00:{i >> 16 & 0xff:02x}:{i >> 8 & 0xff:02x}:{i & 0xff:02x}:01" for i in range(args.devices)]
+    received = {"manifest": {}, "command": {}}
+    expected = {}
+    lock = threading.Lock()
+
+    def make_on_message(mac, device):
+        def on_message(client, userdata, msg):
+            before = device.result()
+            device.deliver(msg.topic, msg.payload, args.chunk)
+            after = device.result()
+            now = time.time()
+            with lock:
+                if after.manifests > before.manifests:
+                    ok = after.scan_result == SCAN_FOUND and after.url.decode() == expected["manifest"][mac]
+                    received["manifest"].setdefault(mac, (now, ok))
+                if after.commands > before.commands:
+                    received["command"].setdefault(mac, (now, after.command.decode() == expected["command"]))
+
+        return on_message
+
+    workdir = tempfile.TemporaryDirectory()
+    firmware = build_library(workdir.name, FLEET_SOURCES, name="fleet_device", host_sources=FLEET_HOST_SOURCES)
+    devices = [FleetDevice(load_copy(firmware, f"sim_{n}"), mac, args.ota_topic) for n, mac in enumerate(macs)]
+    print(f"Connecting {args.devices} simulated mailboxes")
+    sims = [connect(args, f"sim-{mac.replace(':', '')}", make_on_message(mac, device), device.subscriptions())
+            for mac, device in zip(macs, devices)]
+    time.sleep(2)
+
+    stop = threading.Event()
+    sent = [0]
+
+    def publish_doors():
+        next_at = [time.time() + random.uniform(0, args.period) for _ in sims]
+        seq = [0] * len(sims)
+        while not stop.is_set():
+            now = time.time()
+            for i, client in enumerate(sims):
+                if next_at[i] <= now:
+                    seq[i] += 1
+                    client.publish(args.door_topic, door_event(macs[i], seq[i], "open" if seq[i] % 2 else "closed"))
+                    next_at[i] = now + args.period
+                    sent[0] += 1
+            stop.wait(0.01)
+
+    doors = threading.Thread(target=publish_doors, daemon=True)
+    doors.start()
+
+    def wait_all(kind, published_at):
+        deadline = published_at + args.timeout
+        while time.time() < deadline:
+            with lock:
+                if len(received[kind]) == len(macs):
+                    break
+            time.sleep(0.05)
+        with lock:
+            latencies = [(at - published_at) * 1000 for at, _ in received[kind].values()]
+            ok = sum(1 for _, good in received[kind].values() if good)
+        return latencies, ok
+
+    publisher = connect(args, "harness-fleet")
+    complete = 0
+    for round_no in range(1, args.rounds + 1):
+        url = f"http://ota.invalid/round-{round_no}.bin"
+        with lock:
+            received["manifest"].clear()
+            received["command"].clear()
+            expected["manifest"] = {mac: f"{url}?mac={mac.replace(':', '')}" for mac in macs}
+            # Nothing is downloaded, so the digest is of a stand-in image
+            expected["command"] = command_payload(url, f"round-{round_no}".encode(), f"round-{round_no}")
+        manifest = json.dumps(expected["manifest"])
+        published_at = time.time()
+        publisher.publish(args.ota_topic, manifest, qos=0)
+        latencies, found = wait_all("manifest", published_at)
+        summary = percentiles(latencies) if latencies else "none delivered"
+        print(f"round {round_no}: {len(manifest)} byte manifest reached {len(latencies)}/{len(macs)}, "
+              f"{found} scanned their own URL, {summary}")
+
+        published_at = time.time()
+        for mac in macs:
+            publisher.publish(command_topic(args.ota_topic, mac), expected["command"], qos=1)
+        commands, parsed = wait_all("command", published_at)
+        summary = percentiles(commands) if commands else "none delivered"
+        print(f"     per-device commands reached {len(commands)}/{len(macs)}, {parsed} intact, {summary}")
+
+        complete += found == len(macs) and parsed == len(macs)
+        time.sleep(args.settle)
+
+    stop.set()
+    doors.join()
+    print(f"{sent[0]} door events published by the fleet")
+    disconnect(publisher)
+    for client in sims:
+        disconnect(client)
+    workdir.cleanup()
+    return 0 if complete == args.rounds else 1
+
+
+def shadow_topic(mac, suffix):
+    return f"$aws/things/mailbox-{mac.replace(':', '')}/shadow/{suffix}"
+
+
+def run_shadow(args, broker) -> int:
+    desired = {}
+    for setting in args.set:
+        key, _, value = setting.partition("=")
+        desired[key] = int(value)
+    version = int(time.time())  # Above anything the device kept from an earlier run
+    reports = []
+    reported = threading.Event()
+
+    def on_message(client, userdata, msg):
+        if msg.topic.endswith("/shadow/get"):
+            # Nothing pending; a real shadow would send the delta here
+            document = {"version": version, "state": {"desired": desired}}
+            client.publish(shadow_topic(args.mac, "get/accepted"), json.dumps(document), qos=1)
+            print(f"Answered get with version {version}")
+            return
+        try:
+            state = json.loads(msg.payload)["state"]["reported"]
+        except (ValueError, KeyError, TypeError):
+            print(f"Unexpected update: {msg.payload!r}")
+            return
+        reports.append((time.time(), state))
+        reported.set()
+
+    client = connect(args, "harness-shadow", on_message,
+                     (shadow_topic(args.mac, "update"), shadow_topic(args.mac, "get")))
+    result = 0
+    try:
+        for key, value in desired.items():
+            version += 1
+            reported.clear()
+            reports.clear()
+            sent_at = time.time()
+            client.publish(shadow_topic(args.mac, "update/delta"),
+                           json.dumps({"version": version, "state": {key: value}}), qos=1)
+            if not reported.wait(args.timeout):
+                print(f"{key}={value}: no reported update")
+                result = 1
+                continue
+            at, state = reports[0]
+            if state.get(key) != value:
+                print(f"{key}={value}: reported {state}")
+                result = 1
+            else:
+                print(f"{key}={value}: reported after {(at - sent_at) * 1000:.0f} ms")
+
+        if desired:
+            key, value = next(iter(desired.items()))
+            reported.clear()
+            client.publish(shadow_topic(args.mac, "update/delta"),
+                           json.dumps({"version": version - len(desired), "state": {key: value + 1}}), qos=1)
+            if reported.wait(args.stale_wait):
+                print(f"Stale delta was applied: {reports[-1][1]}")
+                result = 1
+            else:
+                print("Stale delta ignored")
+    finally:
+        disconnect(client)
+    return result
+
+
+def run_tls(args, broker) -> int:
+    if broker is None:
+        print("tls needs --start-broker")
+        return 2
+
+    handshakes = {"tls_full": 0, "tls_resumed": 0}
+    keyframes = []
+
+    def on_message(client, userdata, msg):
+        try:
+            report = json.loads(msg.payload)
+        except ValueError:
+            return
+        if report.get("k"):
+            keyframes.append(report)  # Totals since boot, not this run's
+            return
+        for name in handshakes:
+            handshakes[name] += report.get(name, 0)
+
+    observer = connect(args, "harness-tls", on_message, [args.door_topic + "/diagnostics/metrics"])
+    print("Waiting for the device to connect")
+    connected = broker.wait_connect(0, args.timeout)
+    if connected is None:
+        print("Device never connected")
+        disconnect(observer)
+        return 1
+    device_id = connected[1]
+
+    reconnected = []
+    for cycle in range(1, args.cycles + 1):
+        time.sleep(args.settle)
+        takeover = connect(args, device_id)
+        time.sleep(1)
+        disconnect(takeover)
+        dropped_at = time.time()
+        connected = broker.wait_connect(dropped_at, args.timeout)
+        if connected is None:
+            print(f"cycle {cycle}: no reconnect within {args.timeout:.0f} s")
+            continue
+        reconnected.append((connected[0] - dropped_at) * 1000)
+        print(f"cycle {cycle}: reconnected {reconnected[-1]:.0f} ms after the takeover")
+
+    print(f"Waiting {args.report_wait:.0f} s for metrics reports")
+    time.sleep(args.report_wait)
+    disconnect(observer)
+
+    if reconnected:
+        print("reconnect after takeover: " + percentiles(reconnected))
+    print(f"handshakes: {handshakes['tls_resumed']} resumed, {handshakes['tls_full']} full")
+    if keyframes:
+        print(f"{len(keyframes)} keyframe report(s) skipped, counts may be short")
+    return 0 if len(reconnected) == args.cycles and handshakes["tls_resumed"] >= args.cycles else 1
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="localhost", help="broker host as seen from this machine")
+    parser.add_argument("--port", type=int, default=8883)
+    parser.add_argument("--certs", default=os.path.join(HERE, "certs"), help="output of gen_certs.sh")
+    parser.add_argument("--door-topic", required=True, help="CONFIG_MQTT_PUBLISH_DOOR_STATE_TOPIC")
+    parser.add_argument("--ota-topic", required=True, help="CONFIG_MQTT_SUBSCRIBE_OTA_UPDATE_MAILBOX_TOPIC")
+    parser.add_argument("--start-broker", action="store_true", help="run mosquitto from here instead of using one")
+    parser.add_argument("--broker-cmd", default="mosquitto -c mosquitto.conf", help="how to run it")
+    parser.add_argument("--timeout", type=float, default=120, help="seconds to wait for the device")
+    modes = parser.add_subparsers(dest="mode", required=True)
+
+    latency = modes.add_parser("latency", help="edge-to-broker latency of door events")
+    latency.add_argument("--count", type=int, default=20, help="door events to measure")
+
+    reconnect = modes.add_parser("reconnect", help="recovery time after a broker outage")
+    reconnect.add_argument("--cycles", type=int, default=5)
+    reconnect.add_argument("--down", type=float, default=10, help="seconds the broker stays down")
+    reconnect.add_argument("--settle", type=float, default=5, help="seconds between cycles")
+    reconnect.add_argument("--publish-timeout", type=float, default=60, help="seconds to wait for a publish")
+
+    ota = modes.add_parser("ota", help="OTA command handling")
+    ota.add_argument("--mac", required=True, help="device Wi-Fi MAC as aa:bb:cc:dd:ee:ff")
+    ota.add_argument("--url", help="image URL to announce")
+    ota.add_argument("--serve", help="image file to serve over HTTP and announce instead")
+    ota.add_argument("--version", help="send a per-device command for this image version")
+    ota.add_argument("--image", help="firmware.bin for the command digest, if --serve or --url is a .mbz or .mbd")
+    ota.add_argument("--http-host", help="address the device reaches this machine at")
+    ota.add_argument("--http-port", type=int, default=8070)
+
+    fleet = modes.add_parser("fleet", help="load test the shared OTA topic with simulated mailboxes")
+    fleet.add_argument("--devices", type=int, default=200)
+    fleet.add_argument("--rounds", type=int, default=3, help="manifests to publish")
+    fleet.add_argument("--period", type=float, default=30, help="seconds between door events per mailbox")
+    fleet.add_argument("--settle", type=float, default=5, help="seconds between rounds")
+    fleet.add_argument("--chunk", type=int, default=MQTT_BUFFER_SIZE,
+                       help="MQTT_EVENT_DATA size the simulated routers get payloads in, as CONFIG_MQTT_BUFFER_SIZE")
+
+    shadow = modes.add_parser("shadow", help="runtime settings from the device shadow")
+    shadow.add_argument("--mac", required=True, help="device Wi-Fi MAC as aa:bb:cc:dd:ee:ff")
+    shadow.add_argument("--set", action="append", default=[], metavar="KEY=VALUE",
+                        help="setting to change, e.g. debounce_ms=80 (see main/settings.c)")
+    shadow.add_argument("--stale-wait", type=float, default=5, help="seconds a stale delta must stay unanswered")
+
+    tls = modes.add_parser("tls", help="TLS session resumption on reconnect")
+    tls.add_argument("--cycles", type=int, default=5)
+    tls.add_argument("--settle", type=float, default=5, help="seconds between cycles")
+    tls.add_argument("--report-wait", type=float, default=70,
+                     help="seconds to wait for metrics reports after the last cycle")
+
+    args = parser.parse_args()
+    args.mac = getattr(args, "mac", "").lower()
+
+    broker = None
+    if args.start_broker:
+        broker = Broker(args.broker_cmd.split(), args.port)
+        broker.start()
+
+    runs = {"latency": run_latency, "reconnect": run_reconnect, "ota": run_ota, "fleet": run_fleet,
+            "shadow": run_shadow, "tls": run_tls}
+    try:
+        return runs[args.mode](args, broker)
+    except KeyboardInterrupt:
+        return 130
+    finally:
+        if broker is not None:
+            broker.stop()
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,39 @@
+// Stand-ins for the system clock and outbox calls clock_sync.c makes, so
+// tools/host/test_clock_sync.py can step the clock and see what it published.
+#include <stdbool.h>
+#include <string.h>
+#include <sys/time.h>
+#include "mqtt_outbox.h"
+
+static int64_t host_wall_us = 0;
+static uint32_t host_published = 0;
+static char host_last_payload[256];
+
+void host_set_wall_us(int64_t wall_us)
+{
+    host_wall_us = wall_us;
+}
+
+int host_gettimeofday(struct timeval *tv, void *tz)
+{
+    tv->tv_sec = (time_t)(host_wall_us / 1000000);
+    tv->tv_usec = (suseconds_t)(host_wall_us % 1000000);
+    return 0;
+}
+
+uint32_t host_published_count(void)
+{
+    return host_published;
+}
+
+const char *host_last_published(void)
+{
+    return host_last_payload;
+}
+
+bool mqtt_outbox_enqueue(const char *topic, const char *payload, int qos)
+{
+    host_published++;
+    strlcpy(host_last_payload, payload, sizeof(host_last_payload));
+    return true;
+}
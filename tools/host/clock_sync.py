@@ -0,0 +1,54 @@
+"""ctypes binding of main/clock_sync.c on the host stand-ins, see
+clock_sync.h. System time and the published sync points go through
+clock_host.c."""
+
+import ctypes
+import os
+
+from host_c import MAIN, evaluate, read_defines
+
+SOURCES = ["clock_sync.c"]
+HOST_SOURCES = ["clock_host.c", "idf_host.c", "rtos_host.c"]
+_CONFIG = read_defines(os.path.join(MAIN, "clock_sync_config.h"))
+MIN_DRIFT_SPAN_MS = evaluate(_CONFIG["CLOCK_SYNC_MIN_DRIFT_SPAN_MS"])
+MAX_DRIFT_PPB = evaluate(_CONFIG["CLOCK_SYNC_MAX_DRIFT_PPB"])
+
+
+class ClockSyncStats(ctypes.Structure):
+    _fields_ = [("syncs", ctypes.c_uint32), ("last_sync_mono_us", ctypes.c_int64), ("last_step_us", ctypes.c_int64),
+                ("max_step_us", ctypes.c_int64), ("drift_ppb", ctypes.c_int32)]
+
+
+def bind(lib):
+    """Declares the clock sync functions of a library built with SOURCES and HOST_SOURCES"""
+    lib.host_set_time_us.argtypes = [ctypes.c_int64]
+    lib.host_set_wall_us.argtypes = [ctypes.c_int64]
+    lib.host_fire_timer.restype = ctypes.c_bool
+    lib.host_fire_timer.argtypes = [ctypes.c_char_p]
+    lib.host_published_count.restype = ctypes.c_uint32
+    lib.host_last_published.restype = ctypes.c_char_p
+    lib.clock_sync_mono_to_wall_us.restype = ctypes.c_bool
+    lib.clock_sync_mono_to_wall_us.argtypes = [ctypes.c_int64, ctypes.POINTER(ctypes.c_int64)]
+    lib.clock_sync_get_stats.argtypes = [ctypes.POINTER(ClockSyncStats)]
+    return lib
+
+
+class Clock:
+    """A clock_sync.c instance sampled at chosen esp_timer and wall times"""
+
+    def __init__(self, lib):
+        self.lib = lib
+
+    def sample(self, mono_us, wall_us):
+        self.lib.host_set_time_us(mono_us)
+        self.lib.host_set_wall_us(wall_us)
+        self.lib.host_fire_timer(b"clock_sync")
+
+    def stats(self):
+        stats = ClockSyncStats()
+        self.lib.clock_sync_get_stats(ctypes.byref(stats))
+        return stats
+
+    def to_wall_us(self, mono_us):
+        wall_us = ctypes.c_int64()
+        return wall_us.value if self.lib.clock_sync_mono_to_wall_us(mono_us, ctypes.byref(wall_us)) else None
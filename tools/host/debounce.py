@@ -0,0 +1,75 @@
+"""ctypes binding of main/door_debounce.c, see door_debounce.h"""
+
+import ctypes
+
+NO_DEADLINE = 2**63 - 1
+MODE_INTEGRATING = 0
+MODE_LEADING_EDGE = 1
+SOURCES = ["door_debounce.c"]
+
+
+class DebounceProfile(ctypes.Structure):
+    _fields_ = [("mode", ctypes.c_int), ("settle_ms", ctypes.c_uint32)]
+
+
+class DebounceState(ctypes.Structure):
+    _fields_ = [("profile", DebounceProfile), ("stable_level", ctypes.c_int), ("raw_level", ctypes.c_int),
+                ("last_edge_us", ctypes.c_int64), ("deadline_us", ctypes.c_int64),
+                ("suppress_until_us", ctypes.c_int64)]
+
+
+def bind(lib):
+    """Declares the debounce functions of a library built with SOURCES"""
+    int_out, us_out = ctypes.POINTER(ctypes.c_int), ctypes.POINTER(ctypes.c_int64)
+    lib.debounce_init.argtypes = [ctypes.POINTER(DebounceState), ctypes.POINTER(DebounceProfile), ctypes.c_int,
+                                  ctypes.c_int64]
+    lib.debounce_feed.restype = ctypes.c_bool
+    lib.debounce_feed.argtypes = [ctypes.POINTER(DebounceState), ctypes.c_int, ctypes.c_int64, int_out, us_out]
+    lib.debounce_poll.restype = ctypes.c_bool
+    lib.debounce_poll.argtypes = [ctypes.POINTER(DebounceState), ctypes.c_int64, int_out, us_out]
+    lib.debounce_next_deadline_us.restype = ctypes.c_int64
+    lib.debounce_next_deadline_us.argtypes = [ctypes.POINTER(DebounceState)]
+    return lib
+
+
+class Debouncer:
+    """One debounce_state_t. feed() and poll() return (level, edge_us) of a
+    committed level, or None."""
+
+    def __init__(self, lib, mode, settle_ms, level=0, now_us=0):
+        self.lib = lib
+        self.profile = DebounceProfile(mode, settle_ms)
+        self.state = DebounceState()
+        lib.debounce_init(ctypes.byref(self.state), ctypes.byref(self.profile), level, now_us)
+
+    def _call(self, fn, *args):
+        level, edge_us = ctypes.c_int(), ctypes.c_int64()
+        if fn(ctypes.byref(self.state), *args, ctypes.byref(level), ctypes.byref(edge_us)):
+            return level.value, edge_us.value
+        return None
+
+    def feed(self, level, timestamp_us):
+        return self._call(self.lib.debounce_feed, level, timestamp_us)
+
+    def poll(self, now_us):
+        return self._call(self.lib.debounce_poll, now_us)
+
+    def deadline_us(self):
+        return self.lib.debounce_next_deadline_us(ctypes.byref(self.state))
+
+    def run(self, edges, until_us=None):
+        """Steps through (timestamp_us, level) edges the way door_task does,
+        polling at every deadline that passes before the next edge, and after
+        the last one up to until_us (None: until no deadline is left). Returns
+        every committed (level, edge_us)."""
+        commits = []
+        for timestamp_us, level in list(edges) + [(until_us, None)]:
+            while self.deadline_us() != NO_DEADLINE and (timestamp_us is None or self.deadline_us() <= timestamp_us):
+                committed = self.poll(self.deadline_us())
+                if committed:
+                    commits.append(committed)
+            if level is not None:
+                committed = self.feed(level, timestamp_us)
+                if committed:
+                    commits.append(committed)
+        return commits
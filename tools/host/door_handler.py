@@ -0,0 +1,109 @@
+"""ctypes binding of main/door_handler.c on the host stand-ins, see
+door_handler.h. door_task and the outbox task run on the host scheduler,
+sensor pins are driven through idf_host.c, and door_handler_host.c records the
+edges door_task took off its queue and the transitions it committed."""
+
+import ctypes
+
+from debounce import SOURCES as DEBOUNCE_SOURCES
+from debounce import DebounceProfile
+from host_c import MAIN, evaluate, read_defines
+from mqtt_outbox import HOST_SOURCES as OUTBOX_HOST_SOURCES
+from mqtt_outbox import SOURCES as OUTBOX_SOURCES
+from mqtt_outbox import bind_publishes, published
+
+SOURCES = ["door_handler.c"] + DEBOUNCE_SOURCES + OUTBOX_SOURCES
+HOST_SOURCES = ["door_handler_host.c"] + OUTBOX_HOST_SOURCES
+
+_CONFIG = read_defines(f"{MAIN}/door_config.h")
+MAX_SENSORS = evaluate(_CONFIG["DOOR_MAX_SENSORS"])
+GPIO_QUEUE_SIZE = evaluate(_CONFIG["GPIO_QUEUE_SIZE"].replace("DOOR_MAX_SENSORS", str(MAX_SENSORS)))
+
+
+class SensorConfig(ctypes.Structure):
+    """door_sensor_config_t"""
+    _fields_ = [("name", ctypes.c_char_p), ("gpio", ctypes.c_int), ("topic_suffix", ctypes.c_char_p),
+                ("debounce", DebounceProfile), ("reminder_ms", ctypes.c_uint32), ("open_level", ctypes.c_int)]
+
+
+class EdgeEvent(ctypes.Structure):
+    """door_edge_event_t"""
+    _fields_ = [("sensor", ctypes.c_uint32), ("level", ctypes.c_int), ("timestamp_us", ctypes.c_int64)]
+
+
+class Transition(ctypes.Structure):
+    """host_door_transition_t"""
+    _fields_ = [("sensor", ctypes.c_uint32), ("state", ctypes.c_int)]
+
+
+def bind(lib):
+    """Declares the door handler functions of a library built with SOURCES and HOST_SOURCES"""
+    bind_publishes(lib)
+    lib.door_handler_set_sensors.restype = ctypes.c_int
+    lib.door_handler_set_sensors.argtypes = [ctypes.POINTER(SensorConfig), ctypes.c_size_t]
+    lib.door_handler_get_overflow_count.restype = ctypes.c_uint32
+    lib.door_handler_settled.restype = ctypes.c_bool
+    lib.init_mqtt_outbox.restype = ctypes.c_int
+    lib.host_set_mac.argtypes = [ctypes.c_char_p]
+    lib.host_gpio_set_level.argtypes = [ctypes.c_int, ctypes.c_int]
+    lib.host_door_edge_count.restype = ctypes.c_uint32
+    lib.host_door_edge.restype = ctypes.c_bool
+    lib.host_door_edge.argtypes = [ctypes.c_uint32, ctypes.POINTER(EdgeEvent)]
+    lib.host_door_transition_count.restype = ctypes.c_uint32
+    lib.host_door_transition.restype = ctypes.c_bool
+    lib.host_door_transition.argtypes = [ctypes.c_uint32, ctypes.POINTER(Transition)]
+    return lib
+
+
+class DoorHandler:
+    """door_handler.c of one freshly loaded library, started on sensors, a
+    list of SensorConfig, whose pins read levels before init. The outbox is
+    started and connected, and door_task has installed its ISRs."""
+
+    def __init__(self, lib, sensors, levels):
+        self.lib = lib
+        self.sensors = sensors
+        for sensor, level in zip(sensors, levels):
+            lib.host_gpio_set_level(sensor.gpio, level)
+        self.table = (SensorConfig * len(sensors))(*sensors)
+        if lib.door_handler_set_sensors(self.table, len(sensors)) != 0:
+            raise RuntimeError("door_handler_set_sensors failed")
+        lib.host_set_mac(bytes(6))
+        lib.init_door_payload()
+        if lib.init_mqtt_outbox() != 0:
+            raise RuntimeError("init_mqtt_outbox failed")
+        lib.host_mqtt_connect(True)
+        lib.init_door_handler()
+        lib.mqtt_outbox_start()
+        self.run()
+
+    def set_level(self, gpio, level, at_us=None):
+        """Drives a pin, running the ISR on a change, at_us on the clock if given"""
+        if at_us is not None:
+            self.lib.host_set_time_us(at_us)
+        self.lib.host_gpio_set_level(gpio, level)
+
+    def run(self, for_us=0):
+        self.lib.host_run_until(self.lib.esp_timer_get_time() + for_us)
+
+    def edges(self):
+        """(sensor, level, timestamp_us) of each edge door_task dequeued"""
+        out, edge = [], EdgeEvent()
+        for n in range(self.lib.host_door_edge_count()):
+            if self.lib.host_door_edge(n, ctypes.byref(edge)):
+                out.append((edge.sensor, edge.level, edge.timestamp_us))
+        return out
+
+    def transitions(self):
+        """(sensor, state) of each committed transition, boot states included"""
+        out, transition = [], Transition()
+        for n in range(self.lib.host_door_transition_count()):
+            if self.lib.host_door_transition(n, ctypes.byref(transition)):
+                out.append((transition.sensor, transition.state))
+        return out
+
+    def published(self, since=0):
+        return published(self.lib, since)
+
+    def overflows(self):
+        return self.lib.door_handler_get_overflow_count()
@@ -0,0 +1,174 @@
+// Stand-ins for the sleep, reminder, journal, trace and LED calls
+// door_handler.c makes, recording the edges door_task took off its queue and
+// the transitions it committed, so tools/host/test_multi_sensor.py can check
+// them. The outbox calls are in outbox_host.c.
+#include <stdbool.h>
+#include <stdint.h>
+#include "clock_sync.h"
+#include "door_handler.h"
+#include "door_jitter.h"
+#include "door_journal.h"
+#include "door_reminder.h"
+#include "door_sleep.h"
+#include "door_trace.h"
+#include "settings.h"
+#include "gecl-rgb-led-manager.h"
+
+#define HOST_DOOR_LOG 512
+
+typedef struct
+{
+    uint32_t sensor;
+    int state;
+} host_door_transition_t;
+
+static door_edge_event_t host_edges[HOST_DOOR_LOG];
+static uint32_t host_edge_count = 0;
+static host_door_transition_t host_transitions[HOST_DOOR_LOG];
+static uint32_t host_transition_count = 0;
+static uint32_t host_journal_seq = 0;
+
+uint32_t host_door_edge_count(void)
+{
+    return host_edge_count;
+}
+
+bool host_door_edge(uint32_t n, door_edge_event_t *evt)
+{
+    if (n >= host_edge_count || n >= HOST_DOOR_LOG)
+    {
+        return false;
+    }
+    *evt = host_edges[n];
+    return true;
+}
+
+uint32_t host_door_transition_count(void)
+{
+    return host_transition_count;
+}
+
+bool host_door_transition(uint32_t n, host_door_transition_t *transition)
+{
+    if (n >= host_transition_count || n >= HOST_DOOR_LOG)
+    {
+        return false;
+    }
+    *transition = host_transitions[n];
+    return true;
+}
+
+void door_trace_capture(const door_edge_event_t *evt)
+{
+    if (host_edge_count < HOST_DOOR_LOG)
+    {
+        host_edges[host_edge_count] = *evt;
+    }
+    host_edge_count++;
+}
+
+void door_trace_note_transition(size_t sensor, door_state_t state)
+{
+    if (host_transition_count < HOST_DOOR_LOG)
+    {
+        host_transitions[host_transition_count] = (host_door_transition_t){.sensor = (uint32_t)sensor, .state = state};
+    }
+    host_transition_count++;
+}
+
+uint32_t door_journal_append(uint8_t sensor, uint8_t state, int64_t timestamp_us)
+{
+    (void)sensor;
+    (void)state;
+    (void)timestamp_us;
+    return ++host_journal_seq;
+}
+
+sleep_action_t door_sleep_boot_action(size_t sensor, door_state_t state)
+{
+    (void)sensor;
+    (void)state;
+    return SLEEP_ACTION_TRANSITION;
+}
+
+void door_sleep_note_published(size_t sensor, door_state_t state, uint32_t next_reminder_ms)
+{
+    (void)sensor;
+    (void)state;
+    (void)next_reminder_ms;
+}
+
+int64_t door_sleep_reminder_due_in_ms(size_t sensor)
+{
+    (void)sensor;
+    return 0;
+}
+
+esp_err_t init_door_reminder(door_reminder_fn_t fire)
+{
+    (void)fire;
+    return ESP_OK;
+}
+
+void door_reminder_start(size_t sensor, uint32_t base_ms)
+{
+    (void)sensor;
+    (void)base_ms;
+}
+
+void door_reminder_stop(size_t sensor)
+{
+    (void)sensor;
+}
+
+void door_reminder_set_base(size_t sensor, uint32_t base_ms)
+{
+    (void)sensor;
+    (void)base_ms;
+}
+
+void door_reminder_resume(size_t sensor, uint32_t base_ms, int64_t due_in_ms)
+{
+    (void)sensor;
+    (void)base_ms;
+    (void)due_in_ms;
+}
+
+uint32_t door_reminder_next_ms(size_t sensor)
+{
+    (void)sensor;
+    return 0;
+}
+
+void door_jitter_record(door_jitter_source_t source, int64_t latency_us)
+{
+    (void)source;
+    (void)latency_us;
+}
+
+esp_err_t door_jitter_start(void)
+{
+    return ESP_OK;
+}
+
+bool settings_is_set(setting_t setting)
+{
+    (void)setting;
+    return false;
+}
+
+uint32_t settings_generation(void)
+{
+    return 0;
+}
+
+int64_t clock_sync_local_time_of_day_ms(int64_t mono_us)
+{
+    (void)mono_us;
+    return -1;
+}
+
+void set_rgb_led_named_color(const char *color)
+{
+    (void)color;
+}
@@ -0,0 +1,46 @@
+"""ctypes binding of main/door_payload.c on the host stand-ins, see
+door_payload.h. The MAC, RSSI and wall clock it reads are set through
+payload_host.c."""
+
+import ctypes
+
+SOURCES = ["door_payload.c", "session_classifier.c"]
+HOST_SOURCES = ["payload_host.c", "idf_host.c", "rtos_host.c"]
+FORMAT_JSON, FORMAT_BINARY = range(2)
+FLAG_REMINDER, FLAG_REPLAY, FLAG_SESSION = 0x01, 0x02, 0x04
+DELIVERY, RETRIEVAL, BOUNCE = range(3)
+
+
+class PayloadSession(ctypes.Structure):
+    _fields_ = [("opens", ctypes.c_uint16), ("open_ms", ctypes.c_uint32), ("longest_open_ms", ctypes.c_uint32),
+                ("since_last_ms", ctypes.c_int64)]
+
+
+class PayloadEvent(ctypes.Structure):
+    _fields_ = [("seq", ctypes.c_uint32), ("state", ctypes.c_uint8), ("flags", ctypes.c_uint8),
+                ("mono_us", ctypes.c_int64), ("dwell_ms", ctypes.c_uint32), ("session", PayloadSession)]
+
+
+def bind(lib):
+    """Declares the payload functions of a library built with SOURCES and HOST_SOURCES"""
+    lib.door_payload_encode.restype = ctypes.c_size_t
+    lib.door_payload_encode.argtypes = [ctypes.POINTER(PayloadEvent), ctypes.c_size_t, ctypes.c_char_p,
+                                        ctypes.c_size_t, ctypes.POINTER(ctypes.c_size_t)]
+    lib.host_set_mac.argtypes = [ctypes.c_char_p]
+    lib.host_set_rssi.argtypes = [ctypes.c_int8]
+    lib.host_set_clock.argtypes = [ctypes.c_bool, ctypes.c_int64]
+    return lib
+
+
+def session_event(seq, session_class, start_us, span_ms, opens, open_ms, longest_ms, since_last_ms):
+    return PayloadEvent(seq, session_class, FLAG_SESSION, start_us, span_ms,
+                        PayloadSession(opens, open_ms, longest_ms, since_last_ms))
+
+
+def encode(lib, events, size=256):
+    """(events encoded, payload bytes)"""
+    array = (PayloadEvent * max(len(events), 1))(*events)
+    buf = ctypes.create_string_buffer(size)
+    length = ctypes.c_size_t()
+    encoded = lib.door_payload_encode(array, len(events), buf, size, ctypes.byref(length))
+    return encoded, buf.raw[:length.value] if encoded else b""
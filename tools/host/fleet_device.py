@@ -0,0 +1,60 @@
+"""ctypes binding of tools/host/fleet_host.c: the OTA routes of one mailbox,
+through main/mqtt_router.c, mqtt_topic_match.c and ota_manifest_scanner.c"""
+
+import ctypes
+
+from host_c import MAIN, evaluate, read_defines
+
+SOURCES = ["mqtt_router.c", "mqtt_topic_match.c", "ota_manifest_scanner.c"]
+HOST_SOURCES = ["fleet_host.c", "idf_host.c"]
+
+SCAN_MORE, SCAN_FOUND, SCAN_NOT_FOUND, SCAN_ERROR = range(4)
+COMMAND_MAX_LEN = evaluate(read_defines(f"{MAIN}/ota_stream_config.h")["OTA_COMMAND_MAX_LEN"])
+MQTT_BUFFER_SIZE = 1024  # esp-mqtt's default CONFIG_MQTT_BUFFER_SIZE, the largest MQTT_EVENT_DATA chunk
+
+
+class Result(ctypes.Structure):
+    """host_fleet_result_t"""
+    _fields_ = [("manifests", ctypes.c_uint32), ("scan_result", ctypes.c_int), ("url", ctypes.c_char * 256),
+                ("commands", ctypes.c_uint32), ("command", ctypes.c_char * COMMAND_MAX_LEN)]
+
+
+def bind(lib):
+    """Declares the functions of a library built with SOURCES and HOST_SOURCES"""
+    lib.host_fleet_init.restype = ctypes.c_int
+    lib.host_fleet_init.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
+    lib.host_fleet_deliver.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int, ctypes.c_int]
+    lib.host_fleet_result.argtypes = [ctypes.POINTER(Result)]
+    lib.host_mqtt_subscription_count.restype = ctypes.c_uint32
+    lib.host_mqtt_subscription.restype = ctypes.c_char_p
+    lib.host_mqtt_subscription.argtypes = [ctypes.c_uint32, ctypes.POINTER(ctypes.c_int)]
+    return lib
+
+
+class FleetDevice:
+    """One mailbox's router, in its own copy of the library since the router's
+    state is static. Not thread-safe; a paho client calls on_message from one
+    thread."""
+
+    def __init__(self, lib, mac, ota_topic):
+        self.lib = bind(lib)
+        if lib.host_fleet_init(mac.encode(), ota_topic.encode()) != 0:
+            raise ValueError(f"cannot route {ota_topic} for {mac}")
+
+    def subscriptions(self):
+        """(filter, qos) of each SUBSCRIBE mqtt_router_subscribe() made"""
+        subscribed = []
+        qos = ctypes.c_int()
+        for n in range(self.lib.host_mqtt_subscription_count()):
+            subscribed.append((self.lib.host_mqtt_subscription(n, ctypes.byref(qos)).decode(), qos.value))
+        return subscribed
+
+    def deliver(self, topic, payload, chunk=MQTT_BUFFER_SIZE):
+        if isinstance(payload, str):
+            payload = payload.encode()
+        self.lib.host_fleet_deliver(topic.encode(), payload, len(payload), chunk)
+
+    def result(self):
+        result = Result()
+        self.lib.host_fleet_result(ctypes.byref(result))
+        return result
@@ -0,0 +1,128 @@
+// The OTA routes of main/mqtt_custom_handler.c for one simulated mailbox of
+// tools/broker/harness.py fleet mode: the per-device command topic, buffered by
+// mqtt_router.c, and the fleet manifest, scanned chunk by chunk with
+// ota_manifest_scanner.c. What the device would download is recorded instead of
+// started. host_fleet_deliver() splits a message into MQTT_EVENT_DATA events
+// the way esp-mqtt does for payloads larger than its buffer.
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "mqtt_client.h"
+#include "mqtt_router.h"
+#include "ota_manifest_scanner.h"
+#include "ota_stream.h"
+#include "ota_stream_config.h"
+#include "router_config.h"
+
+typedef struct
+{
+    uint32_t manifests; // Fleet manifests handed over to the end or to this device's key
+    int scan_result;    // ota_scan_result_t of the last one
+    char url[OTA_STREAM_URL_MAX_LEN];
+    uint32_t commands; // Per-device commands handed over whole
+    char command[OTA_COMMAND_MAX_LEN];
+} host_fleet_result_t;
+
+static const char *TAG = "FLEET_HOST";
+
+static char mac_address[18];
+static char ota_topic[MQTT_ROUTER_TOPIC_MAX_LEN];
+static char ota_device_topic[MQTT_ROUTER_TOPIC_MAX_LEN];
+static char ota_command[OTA_COMMAND_MAX_LEN];
+static ota_manifest_scanner_t ota_scanner;
+static char ota_url[OTA_STREAM_URL_MAX_LEN];
+static bool ota_manifest_in_progress = false;
+static host_fleet_result_t result;
+
+static void handle_ota_command(const mqtt_route_msg_t *msg)
+{
+    result.commands++;
+    memcpy(result.command, msg->data, msg->len);
+    result.command[msg->len] = '\0';
+}
+
+// As custom_handle_mqtt_event_ota() with extract_ota_url_from_event()
+static void handle_ota_manifest(const mqtt_route_msg_t *msg)
+{
+    if (msg->offset == 0)
+    {
+        ota_scanner_init(&ota_scanner, mac_address, ota_url, sizeof(ota_url));
+        ota_manifest_in_progress = true;
+    }
+    if (!ota_manifest_in_progress)
+    {
+        return;
+    }
+
+    ota_scan_result_t scan = ota_scanner_feed(&ota_scanner, msg->data, msg->len);
+    if (scan == OTA_SCAN_MORE && msg->offset + msg->len >= msg->total_len)
+    {
+        ESP_LOGW(TAG, "OTA manifest ended before its closing brace");
+        scan = OTA_SCAN_ERROR;
+    }
+    if (scan == OTA_SCAN_MORE)
+    {
+        return;
+    }
+
+    ota_manifest_in_progress = false;
+    result.manifests++;
+    result.scan_result = scan;
+    strlcpy(result.url, (scan == OTA_SCAN_FOUND) ? ota_url : "", sizeof(result.url));
+}
+
+static const mqtt_route_t routes[] = {
+    {.filter = ota_device_topic,
+     .qos = OTA_COMMAND_QOS,
+     .handler = handle_ota_command,
+     .buffer = ota_command,
+     .buffer_size = sizeof(ota_command)},
+    {.filter = ota_topic, .qos = 0, .handler = handle_ota_manifest},
+};
+
+// ota_topic is CONFIG_MQTT_SUBSCRIBE_OTA_UPDATE_MAILBOX_TOPIC of the broker run
+esp_err_t host_fleet_init(const char *mac, const char *topic)
+{
+    size_t len;
+
+    strlcpy(mac_address, mac, sizeof(mac_address));
+    strlcpy(ota_topic, topic, sizeof(ota_topic));
+    len = (size_t)snprintf(ota_device_topic, sizeof(ota_device_topic), "%s/", topic);
+    for (const char *p = mac; *p != '\0' && len + 1 < sizeof(ota_device_topic); p++)
+    {
+        if (*p != ':')
+        {
+            ota_device_topic[len++] = *p;
+        }
+    }
+    ota_device_topic[len] = '\0';
+
+    esp_err_t err = mqtt_router_init(routes, sizeof(routes) / sizeof(routes[0]));
+    if (err == ESP_OK)
+    {
+        mqtt_router_subscribe(NULL);
+    }
+    return err;
+}
+
+void host_fleet_deliver(const char *topic, const char *data, int len, int chunk)
+{
+    esp_mqtt_event_t event = {.event_id = MQTT_EVENT_DATA, .total_data_len = len};
+    int offset = 0;
+
+    do
+    {
+        event.topic = (offset == 0) ? (char *)topic : NULL;
+        event.topic_len = (offset == 0) ? (int)strlen(topic) : 0;
+        event.data = (char *)data + offset;
+        event.data_len = (len - offset < chunk) ? len - offset : chunk;
+        event.current_data_offset = offset;
+        mqtt_router_dispatch(&event);
+        offset += event.data_len;
+    } while (offset < len);
+}
+
+void host_fleet_result(host_fleet_result_t *out)
+{
+    *out = result;
+}
@@ -0,0 +1,60 @@
+"""Builds pure C modules from main/ for the host and loads them with ctypes.
+
+Modules such as door_debounce.c or session_classifier.c have no RTOS or driver
+dependencies, so the host tools and tests run the firmware's own code:
+
+    with tempfile.TemporaryDirectory() as workdir:
+        lib = build_library(workdir, ["door_debounce.c"])
+
+Modules that lock, log or touch flash, such as door_journal.c, build against
+the stand-in headers in tools/host/include and link idf_host.c and
+rtos_host.c, passed with the other tools/host sources in host_sources. Their
+tasks run one at a time on a virtual clock, inside host_run_until().
+"""
+
+import ctypes
+import os
+import re
+import shutil
+import subprocess
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+MAIN = os.path.join(os.path.dirname(os.path.dirname(HERE)), "main")
+
+
+def build_library(workdir, sources, defines=(), name="host", host_sources=()):
+    """Compiles main/<sources> and tools/host/<host_sources> into a shared
+    library in workdir and loads it"""
+    lib = os.path.join(workdir, f"{name}.so")
+    # Warnings as ESP-IDF sets them
+    command = [os.environ.get("CC", "cc"), "-shared", "-fPIC", "-O2", "-Wall", "-Wextra", "-Wno-unused-parameter",
+               "-I", MAIN, "-I", os.path.join(HERE, "include")]
+    command += [f"-D{define}" for define in defines]
+    command += [os.path.join(MAIN, source) for source in sources]
+    command += [os.path.join(HERE, source) for source in host_sources] + ["-o", lib]
+    subprocess.run(command, check=True)
+    return ctypes.CDLL(lib)
+
+
+def load_copy(lib, name):
+    """Loads a private copy of a built library, with its static state fresh,
+    for modules that can only be initialized once"""
+    path = os.path.join(os.path.dirname(lib._name), f"{name}.so")
+    shutil.copyfile(lib._name, path)
+    return ctypes.CDLL(path)
+
+
+def read_defines(path):
+    """#define NAME VALUE lines of a config header, trailing // comments dropped"""
+    defines = {}
+    with open(path) as f:
+        for line in f:
+            match = re.match(r"#define\s+(\w+)\s+(.+?)\s*(//.*)?$", line)
+            if match:
+                defines[match.group(1)] = match.group(2)
+    return defines
+
+
+def evaluate(expr):
+    """Value of a numeric config expression such as (9 * 60) or {100, 200}"""
+    return eval(expr.replace("{", "[").replace("}", "]"), {"__builtins__": {}})
@@ -0,0 +1,433 @@
+// Host implementations of the ESP-IDF calls declared in include/; the
+// FreeRTOS ones are in rtos_host.c. Timers run when host_fire_timer() says so,
+// or as their deadlines pass in host_run_until(). Tests drive work such as
+// flushes by calling the module's API directly, MQTT events with
+// host_mqtt_dispatch() and GPIO interrupts with host_gpio_set_level().
+// Partitions added with host_partition_add() behave like NOR flash and count
+// what was erased or written twice.
+#include <stdlib.h>
+#include <string.h>
+#include "esp_err.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "mqtt_client.h"
+#include "driver/gpio.h"
+#include "hal/gpio_ll.h"
+
+#define HOST_GPIO_COUNT 40
+#define HOST_PUBLISH_LOG 256 // Most recent publishes kept for host_mqtt_published()
+#define HOST_SUBSCRIBE_LOG 16 // First subscribes kept for host_mqtt_subscription()
+
+struct host_timer
+{
+    esp_timer_create_args_t args;
+    bool active;
+    int64_t deadline_us;
+    uint64_t period_us; // 0 for a one-shot timer
+};
+
+// What each byte of a backed partition last saw, unknown until erased
+enum
+{
+    HOST_FLASH_UNKNOWN,
+    HOST_FLASH_ERASED,
+    HOST_FLASH_WRITTEN
+};
+
+struct host_partition
+{
+    const esp_partition_t *partition;
+    uint8_t *flash;
+    uint8_t *bytes; // HOST_FLASH_* per byte
+    host_flash_stats_t stats;
+};
+
+struct host_mqtt_handler
+{
+    esp_mqtt_event_id_t event;
+    esp_event_handler_t handler;
+    void *args;
+};
+
+static struct host_timer *host_timers[16];
+static size_t host_timers_used = 0;
+static struct host_partition *host_partitions[4];
+static size_t host_partitions_used = 0;
+static struct host_mqtt_handler host_mqtt_handlers[8];
+static size_t host_mqtt_handlers_used = 0;
+static int64_t host_time_us = 0;
+static host_mqtt_publish_t host_publishes[HOST_PUBLISH_LOG];
+static uint32_t host_publish_count = 0;
+static uint32_t host_publish_failures = 0; // Publishes still to refuse
+static const char *host_subscriptions[HOST_SUBSCRIBE_LOG];
+static int host_subscription_qos[HOST_SUBSCRIBE_LOG];
+static uint32_t host_subscription_count = 0;
+static int host_gpio_levels[HOST_GPIO_COUNT];
+static gpio_isr_t host_gpio_isrs[HOST_GPIO_COUNT];
+static void *host_gpio_isr_args[HOST_GPIO_COUNT];
+gpio_dev_t GPIO;
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    return (code == ESP_OK) ? "ESP_OK" : "ESP_ERR";
+}
+
+void host_set_time_us(int64_t now_us)
+{
+    host_time_us = now_us;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return host_time_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle)
+{
+    struct host_timer *timer = calloc(1, sizeof(*timer));
+    if (timer == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    timer->args = *args;
+    if (host_timers_used < sizeof(host_timers) / sizeof(host_timers[0]))
+    {
+        host_timers[host_timers_used++] = timer;
+    }
+    *handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    timer->active = true;
+    timer->deadline_us = host_time_us + (int64_t)period_us;
+    timer->period_us = period_us;
+    return ESP_OK;
+}
+
+bool host_fire_timer(const char *name)
+{
+    for (size_t i = 0; i < host_timers_used; i++)
+    {
+        if (host_timers[i]->active && strcmp(host_timers[i]->args.name, name) == 0)
+        {
+            host_timers[i]->args.callback(host_timers[i]->args.arg);
+            return true;
+        }
+    }
+    return false;
+}
+
+int64_t host_next_timer_us(void)
+{
+    int64_t next_us = INT64_MAX;
+
+    for (size_t i = 0; i < host_timers_used; i++)
+    {
+        if (host_timers[i]->active && host_timers[i]->deadline_us < next_us)
+        {
+            next_us = host_timers[i]->deadline_us;
+        }
+    }
+    return next_us;
+}
+
+bool host_fire_due_timer(void)
+{
+    struct host_timer *due = NULL;
+
+    for (size_t i = 0; i < host_timers_used; i++)
+    {
+        struct host_timer *timer = host_timers[i];
+        if (timer->active && timer->deadline_us <= host_time_us &&
+            (due == NULL || timer->deadline_us < due->deadline_us))
+        {
+            due = timer;
+        }
+    }
+    if (due == NULL)
+    {
+        return false;
+    }
+
+    // Rescheduled before the callback, which may stop or restart it
+    if (due->period_us > 0)
+    {
+        due->deadline_us += (int64_t)due->period_us;
+    }
+    else
+    {
+        due->active = false;
+    }
+    due->args.callback(due->args.arg);
+    return true;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    timer->active = true;
+    timer->deadline_us = host_time_us + (int64_t)timeout_us;
+    timer->period_us = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    timer->active = false;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer->active;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    (void)type;
+    (void)subtype;
+    (void)label;
+    return NULL;
+}
+
+bool host_partition_add(const esp_partition_t *partition, uint8_t *flash)
+{
+    struct host_partition *backed;
+
+    if (host_partitions_used == sizeof(host_partitions) / sizeof(host_partitions[0]) ||
+        (backed = calloc(1, sizeof(*backed))) == NULL)
+    {
+        return false;
+    }
+    if ((backed->bytes = calloc(partition->size, 1)) == NULL)
+    {
+        free(backed);
+        return false;
+    }
+    backed->partition = partition;
+    backed->flash = flash;
+    host_partitions[host_partitions_used++] = backed;
+    return true;
+}
+
+static struct host_partition *host_partition_find(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    for (size_t i = 0; i < host_partitions_used; i++)
+    {
+        if (host_partitions[i]->partition == partition)
+        {
+            return (offset + size <= partition->size) ? host_partitions[i] : NULL;
+        }
+    }
+    return NULL;
+}
+
+void host_flash_stats(const esp_partition_t *partition, host_flash_stats_t *stats)
+{
+    struct host_partition *backed = host_partition_find(partition, 0, 0);
+
+    *stats = (backed != NULL) ? backed->stats : (host_flash_stats_t){0};
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *dst, size_t size)
+{
+    struct host_partition *backed = host_partition_find(partition, offset, size);
+
+    if (backed == NULL)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    memcpy(dst, backed->flash + offset, size);
+    return ESP_OK;
+}
+
+// Like NOR flash, a write can only clear bits
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t offset, const void *src, size_t size)
+{
+    struct host_partition *backed = host_partition_find(partition, offset, size);
+
+    if (backed == NULL)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    for (size_t i = 0; i < size; i++)
+    {
+        backed->stats.overwritten_bytes += backed->bytes[offset + i] == HOST_FLASH_WRITTEN;
+        backed->bytes[offset + i] = HOST_FLASH_WRITTEN;
+        backed->flash[offset + i] &= ((const uint8_t *)src)[i];
+    }
+    backed->stats.written_bytes += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    struct host_partition *backed = host_partition_find(partition, offset, size);
+
+    if (backed == NULL)
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (offset % partition->erase_size != 0 || size % partition->erase_size != 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < size; i++)
+    {
+        backed->stats.reerased_bytes += backed->bytes[offset + i] == HOST_FLASH_ERASED;
+        backed->bytes[offset + i] = HOST_FLASH_ERASED;
+    }
+    memset(backed->flash + offset, 0xFF, size);
+    backed->stats.erased_bytes += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event,
+                                         esp_event_handler_t handler, void *handler_args)
+{
+    (void)client;
+    if (host_mqtt_handlers_used == sizeof(host_mqtt_handlers) / sizeof(host_mqtt_handlers[0]))
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    host_mqtt_handlers[host_mqtt_handlers_used++] =
+        (struct host_mqtt_handler){.event = event, .handler = handler, .args = handler_args};
+    return ESP_OK;
+}
+
+void host_mqtt_dispatch(esp_mqtt_event_id_t event, int msg_id)
+{
+    esp_mqtt_event_t data = {.event_id = event, .msg_id = msg_id};
+
+    for (size_t i = 0; i < host_mqtt_handlers_used; i++)
+    {
+        if (host_mqtt_handlers[i].event == event || host_mqtt_handlers[i].event == MQTT_EVENT_ANY)
+        {
+            host_mqtt_handlers[i].handler(host_mqtt_handlers[i].args, "MQTT_EVENTS", event, &data);
+        }
+    }
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data, int len, int qos,
+                            int retain)
+{
+    (void)client;
+    (void)retain;
+    if (host_publish_failures > 0)
+    {
+        host_publish_failures--;
+        return -1;
+    }
+
+    host_mqtt_publish_t *publish = &host_publishes[host_publish_count % HOST_PUBLISH_LOG];
+    size_t data_len = (len > 0) ? (size_t)len : strlen(data);
+    *publish = (host_mqtt_publish_t){.qos = qos, .time_us = host_time_us};
+    strlcpy(publish->topic, topic, sizeof(publish->topic));
+    publish->len = (data_len < sizeof(publish->data)) ? data_len : sizeof(publish->data);
+    memcpy(publish->data, data, publish->len);
+    return (int)(++host_publish_count);
+}
+
+uint32_t host_mqtt_publish_count(void)
+{
+    return host_publish_count;
+}
+
+bool host_mqtt_published(uint32_t n, host_mqtt_publish_t *publish)
+{
+    if (n >= host_publish_count || host_publish_count - n > HOST_PUBLISH_LOG)
+    {
+        return false;
+    }
+    *publish = host_publishes[n % HOST_PUBLISH_LOG];
+    return true;
+}
+
+void host_mqtt_fail_publishes(uint32_t count)
+{
+    host_publish_failures = count;
+}
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char *topic, int qos)
+{
+    (void)client;
+    if (host_subscription_count < HOST_SUBSCRIBE_LOG)
+    {
+        host_subscriptions[host_subscription_count] = topic;
+        host_subscription_qos[host_subscription_count] = qos;
+    }
+    return (int)(++host_subscription_count);
+}
+
+uint32_t host_mqtt_subscription_count(void)
+{
+    return host_subscription_count;
+}
+
+const char *host_mqtt_subscription(uint32_t n, int *qos)
+{
+    if (n >= host_subscription_count || n >= HOST_SUBSCRIBE_LOG)
+    {
+        return NULL;
+    }
+    *qos = host_subscription_qos[n];
+    return host_subscriptions[n];
+}
+
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    (void)config;
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio)
+{
+    return (gpio >= 0 && gpio < HOST_GPIO_COUNT) ? host_gpio_levels[gpio] : 0;
+}
+
+esp_err_t gpio_install_isr_service(int flags)
+{
+    (void)flags;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio, gpio_isr_t isr, void *args)
+{
+    if (gpio < 0 || gpio >= HOST_GPIO_COUNT)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    host_gpio_isrs[gpio] = isr;
+    host_gpio_isr_args[gpio] = args;
+    return ESP_OK;
+}
+
+void host_gpio_set_level(gpio_num_t gpio, int level)
+{
+    if (gpio < 0 || gpio >= HOST_GPIO_COUNT || host_gpio_levels[gpio] == level)
+    {
+        return;
+    }
+    host_gpio_levels[gpio] = level;
+    if (host_gpio_isrs[gpio] != NULL)
+    {
+        host_gpio_isrs[gpio](host_gpio_isr_args[gpio]);
+    }
+}
+
+#if HOST_STRLCPY
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+
+    if (size > 0)
+    {
+        size_t copy = (len < size - 1) ? len : size - 1;
+        memcpy(dst, src, copy);
+        dst[copy] = '\0';
+    }
+    return len;
+}
+#endif
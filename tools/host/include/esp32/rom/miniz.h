@@ -0,0 +1,31 @@
+// Host stand-in for the ROM miniz header. Packed images are not inflated on
+// the host: tinfl_decompress() always fails, so only raw images stream.
+#ifndef HOST_MINIZ_H
+#define HOST_MINIZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TINFL_FLAG_PARSE_ZLIB_HEADER 1
+#define TINFL_FLAG_HAS_MORE_INPUT 2
+
+typedef enum
+{
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+typedef struct
+{
+    uint32_t state;
+} tinfl_decompressor;
+
+#define tinfl_init(r) ((r)->state = 0)
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const uint8_t *in_buf_next, size_t *in_buf_size,
+                              uint8_t *out_buf_start, uint8_t *out_buf_next, size_t *out_buf_size,
+                              const uint32_t decomp_flags);
+
+#endif // HOST_MINIZ_H
@@ -0,0 +1,10 @@
+// Host stand-in for the ESP-IDF header: placement attributes are no-ops
+#ifndef ESP_ATTR_H
+#define ESP_ATTR_H
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+
+#endif // ESP_ATTR_H
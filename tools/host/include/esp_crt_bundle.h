@@ -0,0 +1,9 @@
+// Host stand-in for the ESP-IDF header; the host HTTP client has no TLS
+#ifndef ESP_CRT_BUNDLE_H
+#define ESP_CRT_BUNDLE_H
+
+#include "esp_err.h"
+
+esp_err_t esp_crt_bundle_attach(void *conf);
+
+#endif // ESP_CRT_BUNDLE_H
@@ -0,0 +1,27 @@
+// Host stand-in for the ESP-IDF header: plain HTTP/1.1 over POSIX sockets,
+// enough for ota_stream.c against a local test server. No TLS, no redirects.
+#ifndef ESP_HTTP_CLIENT_H
+#define ESP_HTTP_CLIENT_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef struct host_http_client *esp_http_client_handle_t;
+
+typedef struct
+{
+    const char *url;
+    int timeout_ms;
+    esp_err_t (*crt_bundle_attach)(void *conf);
+} esp_http_client_config_t;
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config);
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value);
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len);
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client);
+int esp_http_client_get_status_code(esp_http_client_handle_t client);
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len);
+esp_err_t esp_http_client_close(esp_http_client_handle_t client);
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client);
+
+#endif // ESP_HTTP_CLIENT_H
@@ -0,0 +1,13 @@
+// Host stand-in for the ESP-IDF header, enough for the modules tools/host builds
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+#include <stdio.h>
+
+// Errors and warnings go to stderr, the rest is dropped but still type-checked
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) ((void)(0 && fprintf(stderr, "I %s: " fmt "\n", tag, ##__VA_ARGS__)))
+#define ESP_LOGD(tag, fmt, ...) ((void)(0 && fprintf(stderr, "D %s: " fmt "\n", tag, ##__VA_ARGS__)))
+
+#endif // ESP_LOG_H
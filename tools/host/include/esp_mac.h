@@ -0,0 +1,18 @@
+// Host stand-in for the ESP-IDF header, enough for the modules tools/host builds.
+// The MAC is whatever host_set_mac() last set.
+#ifndef ESP_MAC_H
+#define ESP_MAC_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum
+{
+    ESP_MAC_WIFI_STA
+} esp_mac_type_t;
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type);
+
+void host_set_mac(const uint8_t *mac);
+
+#endif // ESP_MAC_H
@@ -0,0 +1,17 @@
+// Host stand-in for the ESP-IDF header. The running and next update
+// partitions are whatever host_ota_set_partitions() set, and setting the boot
+// partition is only recorded.
+#ifndef ESP_OTA_OPS_H
+#define ESP_OTA_OPS_H
+
+#include "esp_err.h"
+#include "esp_partition.h"
+
+const esp_partition_t *esp_ota_get_running_partition(void);
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start_from);
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition);
+
+void host_ota_set_partitions(const esp_partition_t *running, const esp_partition_t *next);
+const esp_partition_t *host_ota_boot_partition(void);
+
+#endif // ESP_OTA_OPS_H
@@ -0,0 +1,48 @@
+// Host stand-in for the ESP-IDF header, enough for the modules tools/host builds.
+// No partition is ever found; tests plug in their own backend, or back one with
+// memory through host_partition_add().
+#ifndef ESP_PARTITION_H
+#define ESP_PARTITION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum
+{
+    ESP_PARTITION_TYPE_APP,
+    ESP_PARTITION_TYPE_DATA
+} esp_partition_type_t;
+
+typedef int esp_partition_subtype_t;
+
+typedef struct
+{
+    uint32_t address;
+    uint32_t size;
+    uint32_t erase_size;
+    char label[17];
+} esp_partition_t;
+
+// What happened to the flash of a partition since host_partition_add()
+typedef struct
+{
+    uint32_t erased_bytes;
+    uint32_t reerased_bytes;    // Erased again without anything written in between
+    uint32_t written_bytes;
+    uint32_t overwritten_bytes; // Written again without an erase in between
+} host_flash_stats_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t offset, const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size);
+
+// Backs a partition with flash, partition->size bytes that stay owned by the
+// caller. Erases must be sector aligned.
+bool host_partition_add(const esp_partition_t *partition, uint8_t *flash);
+void host_flash_stats(const esp_partition_t *partition, host_flash_stats_t *stats);
+
+#endif // ESP_PARTITION_H
@@ -0,0 +1,11 @@
+// Host stand-in for the ESP-IDF header. esp_restart() is counted and ends the
+// calling task.
+#ifndef ESP_SYSTEM_H
+#define ESP_SYSTEM_H
+
+#include <stdint.h>
+
+void esp_restart(void);
+uint32_t host_restart_count(void);
+
+#endif // ESP_SYSTEM_H
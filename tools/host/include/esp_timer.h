@@ -0,0 +1,35 @@
+// Host stand-in for the ESP-IDF header, enough for the modules tools/host builds.
+// Time is whatever host_set_time_us() last set; timers fire through
+// host_fire_timer(), or as host_run_until() moves the clock past them.
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef struct host_timer *esp_timer_handle_t;
+
+typedef struct
+{
+    void (*callback)(void *arg);
+    void *arg;
+    const char *name;
+} esp_timer_create_args_t;
+
+int64_t esp_timer_get_time(void);
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+bool esp_timer_is_active(esp_timer_handle_t timer);
+
+void host_set_time_us(int64_t now_us);
+// Runs the callback of the active timer created with this name
+bool host_fire_timer(const char *name);
+// Earliest deadline of an active timer, INT64_MAX if none
+int64_t host_next_timer_us(void);
+// Runs the earliest timer whose deadline has passed, if any
+bool host_fire_due_timer(void);
+
+#endif // ESP_TIMER_H
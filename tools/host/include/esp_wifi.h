@@ -0,0 +1,20 @@
+// Host stand-in for the ESP-IDF header, enough for the modules tools/host builds.
+// The station is associated while host_set_rssi() last set a non-zero RSSI.
+#ifndef ESP_WIFI_H
+#define ESP_WIFI_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define ESP_ERR_WIFI_NOT_CONNECT 0x300F
+
+typedef struct
+{
+    int8_t rssi;
+} wifi_ap_record_t;
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap_info);
+
+void host_set_rssi(int8_t rssi);
+
+#endif // ESP_WIFI_H
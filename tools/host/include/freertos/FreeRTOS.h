@@ -0,0 +1,42 @@
+// Host stand-in for the FreeRTOS headers, enough for the modules tools/host
+// builds. Tasks run one at a time on a virtual clock, see rtos_host.c.
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t StackType_t;
+typedef struct host_object *TaskHandle_t;
+typedef struct host_object *QueueHandle_t;
+typedef struct host_object *SemaphoreHandle_t;
+typedef struct host_object *TimerHandle_t;
+typedef struct host_object *EventGroupHandle_t;
+typedef struct
+{
+    int unused;
+} StaticTask_t, StaticQueue_t, StaticSemaphore_t, StaticTimer_t, StaticEventGroup_t;
+typedef struct
+{
+    int unused;
+} portMUX_TYPE;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY UINT32_MAX
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define portMUX_INITIALIZER_UNLOCKED {0}
+// Only one task runs at a time and none is preempted, so there is nothing to hold off
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portYIELD_FROM_ISR() ((void)0)
+#define xPortGetCoreID() 0
+
+#endif // FREERTOS_H
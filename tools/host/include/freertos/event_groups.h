@@ -0,0 +1,8 @@
+// Host stand-in, see FreeRTOS.h. Declared so rtos_alloc.h compiles; nothing
+// tools/host builds creates one.
+#ifndef EVENT_GROUPS_H
+#define EVENT_GROUPS_H
+
+#include "FreeRTOS.h"
+
+#endif // EVENT_GROUPS_H
@@ -0,0 +1,25 @@
+// Host stand-in, see FreeRTOS.h
+#ifndef TASK_H
+#define TASK_H
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *arg);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_size, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core);
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_size, void *arg,
+                                           UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb,
+                                           BaseType_t core);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait);
+void vTaskDelay(TickType_t ticks);
+// Only a task deleting itself, with NULL
+void vTaskDelete(TaskHandle_t task);
+
+// Runs the created tasks, highest priority first, until every one is blocked.
+// Whenever they all are, the clock moves to the next esp_timer deadline or
+// wait timeout up to until_us, and ends at until_us.
+void host_run_until(int64_t until_us);
+
+#endif // TASK_H
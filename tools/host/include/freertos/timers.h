@@ -0,0 +1,8 @@
+// Host stand-in, see FreeRTOS.h. Declared so rtos_alloc.h compiles; nothing
+// tools/host builds creates one.
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#include "FreeRTOS.h"
+
+#endif // TIMERS_H
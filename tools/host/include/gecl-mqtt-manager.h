@@ -0,0 +1,7 @@
+// Host stand-in for the gecl-mqtt-manager component header
+#ifndef GECL_MQTT_MANAGER_H
+#define GECL_MQTT_MANAGER_H
+
+#include "mqtt_client.h"
+
+#endif // GECL_MQTT_MANAGER_H
@@ -0,0 +1,11 @@
+// Host stand-in for the gecl-ota-manager component header, declared so
+// mqtt_custom_handler.h compiles; nothing tools/host builds runs an OTA
+#ifndef GECL_OTA_MANAGER_H
+#define GECL_OTA_MANAGER_H
+
+typedef struct
+{
+    const char *url;
+} ota_config_t;
+
+#endif // GECL_OTA_MANAGER_H
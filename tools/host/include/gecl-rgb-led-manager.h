@@ -0,0 +1,7 @@
+// Host stand-in for the gecl-rgb-led-manager component header
+#ifndef GECL_RGB_LED_MANAGER_H
+#define GECL_RGB_LED_MANAGER_H
+
+void set_rgb_led_named_color(const char *color);
+
+#endif // GECL_RGB_LED_MANAGER_H
@@ -0,0 +1,9 @@
+// Host stand-in for the gecl-wifi-manager component header
+#ifndef GECL_WIFI_MANAGER_H
+#define GECL_WIFI_MANAGER_H
+
+#include <stdbool.h>
+
+bool wifi_active(void);
+
+#endif // GECL_WIFI_MANAGER_H
@@ -0,0 +1,21 @@
+// Host stand-in for the ESP-IDF header: register reads go to gpio_get_level()
+#ifndef HAL_GPIO_LL_H
+#define HAL_GPIO_LL_H
+
+#include <stdint.h>
+#include "driver/gpio.h"
+
+typedef struct
+{
+    int unused;
+} gpio_dev_t;
+
+extern gpio_dev_t GPIO;
+
+static inline int gpio_ll_get_level(gpio_dev_t *hw, uint32_t gpio_num)
+{
+    (void)hw;
+    return gpio_get_level((gpio_num_t)gpio_num);
+}
+
+#endif // HAL_GPIO_LL_H
@@ -0,0 +1,72 @@
+// Host stand-in for the esp-mqtt header, enough for the modules tools/host
+// builds. host_mqtt_dispatch() calls the handlers registered for an event, and
+// publishes and subscriptions are recorded for host_mqtt_published() and
+// host_mqtt_subscription().
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef const char *esp_event_base_t;
+typedef void (*esp_event_handler_t)(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
+typedef struct host_mqtt_client *esp_mqtt_client_handle_t;
+
+typedef enum
+{
+    MQTT_EVENT_ANY = -1,
+    MQTT_EVENT_CONNECTED = 1,
+    MQTT_EVENT_DISCONNECTED,
+    MQTT_EVENT_SUBSCRIBED,
+    MQTT_EVENT_UNSUBSCRIBED,
+    MQTT_EVENT_PUBLISHED,
+    MQTT_EVENT_DATA
+} esp_mqtt_event_id_t;
+
+typedef struct
+{
+    esp_mqtt_event_id_t event_id;
+    esp_mqtt_client_handle_t client;
+    int msg_id;
+    char *topic; // Only on the first MQTT_EVENT_DATA of a message
+    int topic_len;
+    char *data;
+    int data_len;
+    int total_data_len;
+    int current_data_offset;
+} esp_mqtt_event_t;
+
+typedef esp_mqtt_event_t *esp_mqtt_event_handle_t;
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event,
+                                         esp_event_handler_t handler, void *handler_args);
+
+// Returns msg_ids 1, 2, ... in publish order, -1 while refusing
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data, int len, int qos,
+                            int retain);
+
+// Returns msg_ids 1, 2, ... in subscribe order
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char *topic, int qos);
+
+typedef struct
+{
+    char topic[128];
+    uint8_t data[512];
+    size_t len;
+    int qos;
+    int64_t time_us; // esp_timer time of the publish
+} host_mqtt_publish_t;
+
+void host_mqtt_dispatch(esp_mqtt_event_id_t event, int msg_id);
+uint32_t host_mqtt_publish_count(void);
+// Publish number n, counted from 0; false once it dropped out of the log
+bool host_mqtt_published(uint32_t n, host_mqtt_publish_t *publish);
+uint32_t host_mqtt_subscription_count(void);
+// Filter of subscribe number n, as passed in; NULL past the last
+const char *host_mqtt_subscription(uint32_t n, int *qos);
+// Makes the next count publishes fail
+void host_mqtt_fail_publishes(uint32_t count);
+
+#endif // MQTT_CLIENT_H
@@ -0,0 +1,32 @@
+// Host stand-in for the ESP-IDF header: blobs kept in memory. Tests carry
+// them across a simulated reboot with host_nvs_get() and host_nvs_set().
+#ifndef NVS_H
+#define NVS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum
+{
+    NVS_READONLY,
+    NVS_READWRITE
+} nvs_open_mode_t;
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle);
+void nvs_close(nvs_handle_t handle);
+esp_err_t nvs_commit(nvs_handle_t handle);
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length);
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length);
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key);
+
+// Length of a blob, 0 when there is none, copied to out if it fits size
+size_t host_nvs_get(const char *name, const char *key, void *out, size_t size);
+bool host_nvs_set(const char *name, const char *key, const void *value, size_t length);
+
+#endif // NVS_H
@@ -0,0 +1,9 @@
+// Host stand-in for the generated header: a single core and the topics the
+// host-built modules need, nothing else configured
+#ifndef SDKCONFIG_H
+#define SDKCONFIG_H
+
+#define CONFIG_FREERTOS_UNICORE 1
+#define CONFIG_MQTT_PUBLISH_DOOR_STATE_TOPIC "mailbox/door"
+
+#endif // SDKCONFIG_H
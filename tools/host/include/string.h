@@ -0,0 +1,12 @@
+// Host stand-in that adds strlcpy(), which newlib has and glibc only from 2.38
+#ifndef HOST_STRING_H
+#define HOST_STRING_H
+
+#include_next <string.h>
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+#define HOST_STRLCPY 1
+size_t strlcpy(char *dst, const char *src, size_t size);
+#endif
+
+#endif // HOST_STRING_H
@@ -0,0 +1,11 @@
+// Host stand-in that routes gettimeofday() to host_gettimeofday(), so tests
+// can set the system clock the modules read
+#ifndef HOST_SYS_TIME_H
+#define HOST_SYS_TIME_H
+
+#include_next <sys/time.h>
+
+int host_gettimeofday(struct timeval *tv, void *tz);
+#define gettimeofday host_gettimeofday
+
+#endif // HOST_SYS_TIME_H
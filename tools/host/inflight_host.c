@@ -0,0 +1,52 @@
+// Recording stand-ins for the door journal and outbox calls mqtt_inflight.c
+// makes, so tools/host/test_mqtt_inflight.py can check what it acknowledged.
+#include <stdbool.h>
+#include <stdint.h>
+#include "door_journal.h"
+#include "mqtt_outbox.h"
+
+typedef struct
+{
+    uint32_t acked_through;     // Last door_journal_ack()
+    uint32_t delivered_through; // Last door_journal_mark_delivered()
+    uint32_t failed_seq;        // Last door_journal_mark_failed()
+    uint32_t replay_requests;
+    uint32_t enqueued;          // mqtt_outbox_enqueue() calls, i.e. diagnostics reports
+} host_inflight_calls_t;
+
+static host_inflight_calls_t calls;
+
+void host_inflight_calls(host_inflight_calls_t *out)
+{
+    *out = calls;
+}
+
+esp_err_t door_journal_ack(uint32_t seq)
+{
+    calls.acked_through = seq;
+    return ESP_OK;
+}
+
+void door_journal_mark_delivered(uint32_t seq)
+{
+    calls.delivered_through = seq;
+}
+
+void door_journal_mark_failed(uint32_t seq)
+{
+    calls.failed_seq = seq;
+}
+
+void mqtt_outbox_request_replay(void)
+{
+    calls.replay_requests++;
+}
+
+bool mqtt_outbox_enqueue(const char *topic, const char *payload, int qos)
+{
+    (void)topic;
+    (void)payload;
+    (void)qos;
+    calls.enqueued++;
+    return true;
+}
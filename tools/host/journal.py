@@ -0,0 +1,88 @@
+"""ctypes binding of main/door_journal.c on the file-backed flash emulator in
+journal_file_backend.c, see door_journal.h"""
+
+import ctypes
+
+SOURCES = ["door_journal.c"]
+HOST_SOURCES = ["journal_file_backend.c", "idf_host.c", "rtos_host.c"]
+RECORD_SIZE = 16
+ESP_OK = 0
+
+
+class JournalEntry(ctypes.Structure):
+    _fields_ = [("seq", ctypes.c_uint32), ("sensor", ctypes.c_uint8), ("state", ctypes.c_uint8),
+                ("timestamp_us", ctypes.c_int64)]
+
+
+class JournalStats(ctypes.Structure):
+    _fields_ = [("next_seq", ctypes.c_uint32), ("acked_seq", ctypes.c_uint32), ("flash_writes", ctypes.c_uint32),
+                ("sector_erases", ctypes.c_uint32), ("overwritten", ctypes.c_uint32),
+                ("replay_needed", ctypes.c_bool)]
+
+
+def bind(lib):
+    """Declares the journal and emulator functions of a library built with
+    SOURCES and HOST_SOURCES"""
+    lib.journal_file_mount.argtypes = [ctypes.c_char_p, ctypes.c_size_t, ctypes.c_size_t]
+    lib.journal_file_cut_power_after.argtypes = [ctypes.c_long]
+    lib.door_journal_append.restype = ctypes.c_uint32
+    lib.door_journal_append.argtypes = [ctypes.c_uint8, ctypes.c_uint8, ctypes.c_int64]
+    lib.door_journal_mark_delivered.argtypes = [ctypes.c_uint32]
+    lib.door_journal_mark_failed.argtypes = [ctypes.c_uint32]
+    lib.door_journal_read_pending.restype = ctypes.c_size_t
+    lib.door_journal_read_pending.argtypes = [ctypes.POINTER(JournalEntry), ctypes.c_size_t]
+    lib.door_journal_ack.argtypes = [ctypes.c_uint32]
+    lib.door_journal_replay_needed.restype = ctypes.c_bool
+    lib.door_journal_get_stats.argtypes = [ctypes.POINTER(JournalStats)]
+    lib.host_set_time_us.argtypes = [ctypes.c_int64]
+    return lib
+
+
+class Journal:
+    """The journal on one flash image file. mount() is a reboot; cut_power()
+    makes flash operations fail once the given number of bytes were touched."""
+
+    def __init__(self, lib, path, size, sector_size):
+        self.lib, self.path, self.size, self.sector_size = lib, path, size, sector_size
+
+    def mount(self):
+        return self.lib.journal_file_mount(self.path.encode(), self.size, self.sector_size)
+
+    def cut_power(self, after_bytes):
+        self.lib.journal_file_cut_power_after(after_bytes)
+
+    def append(self, sensor, state, timestamp_us):
+        return self.lib.door_journal_append(sensor, state, timestamp_us)
+
+    def flush(self):
+        return self.lib.door_journal_flush()
+
+    def ack(self, seq):
+        return self.lib.door_journal_ack(seq)
+
+    def mark_delivered(self, seq):
+        self.lib.door_journal_mark_delivered(seq)
+
+    def mark_failed(self, seq):
+        self.lib.door_journal_mark_failed(seq)
+
+    def pending(self, limit=1024):
+        """(seq, sensor, state, timestamp_us) of every unacknowledged event"""
+        entries = (JournalEntry * limit)()
+        count = self.lib.door_journal_read_pending(entries, limit)
+        return [(e.seq, e.sensor, e.state, e.timestamp_us) for e in entries[:count]]
+
+    def pending_seqs(self):
+        return [entry[0] for entry in self.pending()]
+
+    def replay_needed(self):
+        return self.lib.door_journal_replay_needed()
+
+    def stats(self):
+        stats = JournalStats()
+        self.lib.door_journal_get_stats(ctypes.byref(stats))
+        return stats
+
+    def image(self):
+        with open(self.path, "rb") as f:
+            return f.read()
@@ -0,0 +1,128 @@
+// door_journal backend on a plain file that behaves like NOR flash: a program
+// can only clear bits, an erase sets a whole sector back to 0xFF. Power can be
+// cut after a given number of programmed or erased bytes, leaving a torn record
+// or a half-erased sector behind; nothing succeeds again until the next mount.
+#include <stdio.h>
+#include <string.h>
+#include "door_journal.h"
+
+static FILE *flash_file = NULL;
+static long power_budget = -1; // Bytes left before the cut, -1 for no limit
+
+// Consumes budget for len bytes and returns how many may still be touched
+static size_t power_allow(size_t len)
+{
+    if (power_budget < 0)
+    {
+        return len;
+    }
+    size_t allowed = ((size_t)power_budget < len) ? (size_t)power_budget : len;
+    power_budget -= (long)allowed;
+    return allowed;
+}
+
+static esp_err_t file_read(void *ctx, size_t offset, void *dst, size_t len)
+{
+    (void)ctx;
+    if (power_budget == 0)
+    {
+        return ESP_FAIL;
+    }
+    if (fseek(flash_file, (long)offset, SEEK_SET) != 0 || fread(dst, 1, len, flash_file) != len)
+    {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t file_write(void *ctx, size_t offset, const void *src, size_t len)
+{
+    const uint8_t *bytes = src;
+    uint8_t current;
+    size_t allowed = power_allow(len);
+
+    (void)ctx;
+    for (size_t i = 0; i < allowed; i++)
+    {
+        if (fseek(flash_file, (long)(offset + i), SEEK_SET) != 0 || fread(&current, 1, 1, flash_file) != 1)
+        {
+            return ESP_FAIL;
+        }
+        current &= bytes[i];
+        if (fseek(flash_file, (long)(offset + i), SEEK_SET) != 0 || fwrite(&current, 1, 1, flash_file) != 1)
+        {
+            return ESP_FAIL;
+        }
+    }
+    fflush(flash_file);
+    return (allowed == len) ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t file_erase_sector(void *ctx, size_t offset)
+{
+    const door_journal_backend_t *backend = ctx;
+    uint8_t blank[256];
+    size_t allowed = power_allow(backend->sector_size);
+
+    memset(blank, 0xFF, sizeof(blank));
+    if (fseek(flash_file, (long)offset, SEEK_SET) != 0)
+    {
+        return ESP_FAIL;
+    }
+    for (size_t done = 0; done < allowed;)
+    {
+        size_t len = (allowed - done < sizeof(blank)) ? allowed - done : sizeof(blank);
+        if (fwrite(blank, 1, len, flash_file) != len)
+        {
+            return ESP_FAIL;
+        }
+        done += len;
+    }
+    fflush(flash_file);
+    return (allowed == backend->sector_size) ? ESP_OK : ESP_FAIL;
+}
+
+// Power stays on for bytes more programmed or erased bytes; negative restores it
+void journal_file_cut_power_after(long bytes)
+{
+    power_budget = (bytes < 0) ? -1 : bytes;
+}
+
+// Opens the image at path, blank-filling it up to size, and mounts the journal
+// on it as a reboot would. Power comes back on.
+esp_err_t journal_file_mount(const char *path, size_t size, size_t sector_size)
+{
+    static door_journal_backend_t backend;
+    uint8_t blank = 0xFF;
+
+    if (flash_file != NULL)
+    {
+        fclose(flash_file);
+    }
+    flash_file = fopen(path, "r+b");
+    if (flash_file == NULL)
+    {
+        flash_file = fopen(path, "w+b");
+    }
+    if (flash_file == NULL || fseek(flash_file, 0, SEEK_END) != 0)
+    {
+        return ESP_FAIL;
+    }
+    for (long end = ftell(flash_file); end >= 0 && (size_t)end < size; end++)
+    {
+        if (fwrite(&blank, 1, 1, flash_file) != 1)
+        {
+            return ESP_FAIL;
+        }
+    }
+    fflush(flash_file);
+
+    power_budget = -1;
+    backend = (door_journal_backend_t){.read = file_read,
+                                       .write = file_write,
+                                       .erase_sector = file_erase_sector,
+                                       .size = size,
+                                       .sector_size = sector_size,
+                                       .ctx = &backend};
+    return door_journal_init_with_backend(&backend);
+}
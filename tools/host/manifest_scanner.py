@@ -0,0 +1,54 @@
+"""ctypes binding of main/ota_manifest_scanner.c, see ota_manifest_scanner.h"""
+
+import ctypes
+
+SCAN_MORE, SCAN_FOUND, SCAN_NOT_FOUND, SCAN_ERROR = range(4)
+SOURCES = ["ota_manifest_scanner.c"]
+
+
+class ManifestScanner(ctypes.Structure):
+    _fields_ = [("key", ctypes.c_char_p), ("key_len", ctypes.c_size_t), ("out", ctypes.c_void_p),
+                ("out_size", ctypes.c_size_t), ("out_len", ctypes.c_size_t), ("key_pos", ctypes.c_size_t),
+                ("state", ctypes.c_int), ("depth", ctypes.c_int), ("key_match", ctypes.c_bool),
+                ("escape", ctypes.c_bool), ("result", ctypes.c_int)]
+
+
+def bind(lib):
+    """Declares the scanner functions of a library built with SOURCES"""
+    lib.ota_scanner_init.argtypes = [ctypes.POINTER(ManifestScanner), ctypes.c_char_p, ctypes.c_void_p,
+                                     ctypes.c_size_t]
+    lib.ota_scanner_feed.restype = ctypes.c_int
+    lib.ota_scanner_feed.argtypes = [ctypes.POINTER(ManifestScanner), ctypes.c_char_p, ctypes.c_size_t]
+    return lib
+
+
+class Scanner:
+    """One ota_manifest_scanner_t looking for key. The output buffer has
+    GUARD bytes after out_size to catch writes past its end."""
+
+    GUARD = 16
+
+    def __init__(self, lib, key, out_size=256):
+        self.lib = lib
+        self.key = key.encode()  # Kept alive: the scanner only stores the pointer
+        self.out_size = out_size
+        self.buf = ctypes.create_string_buffer(b"\xaa" * (out_size + self.GUARD), out_size + self.GUARD)
+        self.state = ManifestScanner()
+        lib.ota_scanner_init(ctypes.byref(self.state), self.key, ctypes.addressof(self.buf), out_size)
+
+    def feed(self, data):
+        if isinstance(data, str):
+            data = data.encode()
+        return self.lib.ota_scanner_feed(ctypes.byref(self.state), data, len(data))
+
+    def feed_chunks(self, data, size):
+        result = SCAN_MORE
+        for i in range(0, len(data), size):
+            result = self.feed(data[i:i + size])
+        return result
+
+    def value(self):
+        return self.buf.raw[:self.out_size].split(b"\0", 1)[0].decode()
+
+    def guard_intact(self):
+        return self.buf.raw[self.out_size:] == b"\xaa" * self.GUARD
@@ -0,0 +1,92 @@
+"""ctypes binding of main/mqtt_inflight.c on the host stand-ins, see
+mqtt_inflight.h. The door journal and outbox calls it makes are recorded by
+inflight_host.c."""
+
+import ctypes
+
+from host_c import MAIN, evaluate, read_defines
+
+SOURCES = ["mqtt_inflight.c"]
+HOST_SOURCES = ["inflight_host.c", "idf_host.c", "rtos_host.c"]
+NO_SLOT = -1
+MQTT_EVENT_PUBLISHED = 5
+
+CONFIG = read_defines(f"{MAIN}/inflight_config.h")
+MAX_MSGS = evaluate(CONFIG["INFLIGHT_MAX_MSGS"])
+EARLY_ACKS = evaluate(CONFIG["INFLIGHT_EARLY_ACKS"])
+ACK_TIMEOUT_US = evaluate(CONFIG["INFLIGHT_ACK_TIMEOUT_MS"]) * 1000
+RTT_BUCKETS = evaluate(CONFIG["INFLIGHT_RTT_BUCKETS"])
+
+
+class InflightMsg(ctypes.Structure):
+    _fields_ = [("topic", ctypes.c_char_p), ("origin_us", ctypes.c_int64), ("first_seq", ctypes.c_uint32),
+                ("last_seq", ctypes.c_uint32), ("replay", ctypes.c_bool)]
+
+
+class InflightStats(ctypes.Structure):
+    _fields_ = [("tracked", ctypes.c_uint32), ("acked", ctypes.c_uint32), ("timeouts", ctypes.c_uint32),
+                ("journaled", ctypes.c_uint32), ("untracked", ctypes.c_uint32), ("unknown_acks", ctypes.c_uint32),
+                ("in_flight", ctypes.c_uint32), ("in_flight_high_water", ctypes.c_uint32),
+                ("last_rtt_us", ctypes.c_int64), ("max_rtt_us", ctypes.c_int64), ("total_rtt_us", ctypes.c_int64),
+                ("last_e2e_us", ctypes.c_int64), ("max_e2e_us", ctypes.c_int64),
+                ("rtt_histogram", ctypes.c_uint32 * RTT_BUCKETS)]
+
+
+class Calls(ctypes.Structure):
+    _fields_ = [("acked_through", ctypes.c_uint32), ("delivered_through", ctypes.c_uint32),
+                ("failed_seq", ctypes.c_uint32), ("replay_requests", ctypes.c_uint32),
+                ("enqueued", ctypes.c_uint32)]
+
+
+def bind(lib):
+    """Declares the in-flight and stand-in functions of a library built with
+    SOURCES and HOST_SOURCES"""
+    lib.init_mqtt_inflight.argtypes = [ctypes.c_void_p]
+    lib.mqtt_inflight_reserve.restype = ctypes.c_int
+    lib.mqtt_inflight_reserve.argtypes = [ctypes.POINTER(InflightMsg)]
+    lib.mqtt_inflight_commit.argtypes = [ctypes.c_int, ctypes.c_int]
+    lib.mqtt_inflight_cancel.argtypes = [ctypes.c_int]
+    lib.mqtt_inflight_replay_pending.restype = ctypes.c_bool
+    lib.mqtt_inflight_get_stats.argtypes = [ctypes.POINTER(InflightStats)]
+    lib.host_inflight_calls.argtypes = [ctypes.POINTER(Calls)]
+    lib.host_set_time_us.argtypes = [ctypes.c_int64]
+    lib.host_fire_timer.restype = ctypes.c_bool
+    lib.host_fire_timer.argtypes = [ctypes.c_char_p]
+    lib.host_mqtt_dispatch.argtypes = [ctypes.c_int, ctypes.c_int]
+    return lib
+
+
+class Inflight:
+    """The in-flight table of one freshly loaded library"""
+
+    def __init__(self, lib):
+        self.lib = lib
+        assert lib.init_mqtt_inflight(None) == 0
+        lib.mqtt_inflight_on_connected()
+
+    def reserve(self, first_seq=0, last_seq=0, replay=False, origin_us=0):
+        msg = InflightMsg(b"mailbox/door", origin_us, first_seq, last_seq if last_seq else first_seq, replay)
+        return self.lib.mqtt_inflight_reserve(ctypes.byref(msg))
+
+    def commit(self, handle, msg_id):
+        self.lib.mqtt_inflight_commit(handle, msg_id)
+
+    def cancel(self, handle):
+        self.lib.mqtt_inflight_cancel(handle)
+
+    def puback(self, msg_id):
+        self.lib.host_mqtt_dispatch(MQTT_EVENT_PUBLISHED, msg_id)
+
+    def sweep(self, now_us):
+        self.lib.host_set_time_us(now_us)
+        assert self.lib.host_fire_timer(b"inflight_sweep")
+
+    def stats(self):
+        stats = InflightStats()
+        self.lib.mqtt_inflight_get_stats(ctypes.byref(stats))
+        return stats
+
+    def calls(self):
+        calls = Calls()
+        self.lib.host_inflight_calls(ctypes.byref(calls))
+        return calls
@@ -0,0 +1,121 @@
+"""ctypes binding of main/mqtt_outbox.c on the host stand-ins, see
+mqtt_outbox.h. Payloads are encoded by the real door_payload.c; the journal,
+in-flight and settings calls are recorded by outbox_host.c, and what reaches
+esp_mqtt_client_publish() by idf_host.c."""
+
+import ctypes
+
+from door_payload import HOST_SOURCES as PAYLOAD_HOST_SOURCES
+from door_payload import SOURCES as PAYLOAD_SOURCES
+from door_payload import PayloadEvent
+from host_c import MAIN, evaluate, read_defines
+
+SOURCES = ["mqtt_outbox.c"] + PAYLOAD_SOURCES
+HOST_SOURCES = ["outbox_host.c"] + PAYLOAD_HOST_SOURCES
+
+_CONFIG = read_defines(f"{MAIN}/outbox_config.h")
+QUEUE_SIZE = evaluate(_CONFIG["OUTBOX_QUEUE_SIZE"])
+_PAYLOAD_CONFIG = read_defines(f"{MAIN}/payload_config.h")
+MAX_BATCH = evaluate(_PAYLOAD_CONFIG["PAYLOAD_MAX_BATCH"])
+PUBLISH_RETRIES = evaluate(read_defines(f"{MAIN}/door_config.h")["MQTT_PUBLISH_RETRIES"])
+
+
+class OutboxStats(ctypes.Structure):
+    _fields_ = [("enqueued", ctypes.c_uint32), ("sent", ctypes.c_uint32), ("dropped", ctypes.c_uint32),
+                ("failed", ctypes.c_uint32), ("retries", ctypes.c_uint32), ("replayed", ctypes.c_uint32),
+                ("depth", ctypes.c_uint32), ("depth_high_water", ctypes.c_uint32),
+                ("last_latency_us", ctypes.c_int64), ("max_latency_us", ctypes.c_int64),
+                ("total_latency_us", ctypes.c_int64), ("last_origin_latency_us", ctypes.c_int64),
+                ("max_origin_latency_us", ctypes.c_int64), ("door_events", ctypes.c_uint32),
+                ("door_payload_bytes", ctypes.c_uint32)]
+
+
+class OutboxCalls(ctypes.Structure):
+    _fields_ = [("reserved", ctypes.c_uint32), ("committed", ctypes.c_uint32), ("cancelled", ctypes.c_uint32),
+                ("reserved_first_seq", ctypes.c_uint32), ("reserved_last_seq", ctypes.c_uint32),
+                ("failed_seq", ctypes.c_uint32), ("failed_calls", ctypes.c_uint32),
+                ("delivered_seq", ctypes.c_uint32)]
+
+
+class Publish(ctypes.Structure):
+    """host_mqtt_publish_t"""
+    _fields_ = [("topic", ctypes.c_char * 128), ("data", ctypes.c_uint8 * 512), ("len", ctypes.c_size_t),
+                ("qos", ctypes.c_int), ("time_us", ctypes.c_int64)]
+
+
+def bind_publishes(lib):
+    """Declares the clock, scheduler and publish log of any library linking
+    idf_host.c and rtos_host.c"""
+    lib.host_set_time_us.argtypes = [ctypes.c_int64]
+    lib.esp_timer_get_time.restype = ctypes.c_int64
+    lib.host_run_until.argtypes = [ctypes.c_int64]
+    lib.host_mqtt_publish_count.restype = ctypes.c_uint32
+    lib.host_mqtt_published.restype = ctypes.c_bool
+    lib.host_mqtt_published.argtypes = [ctypes.c_uint32, ctypes.POINTER(Publish)]
+    lib.host_mqtt_fail_publishes.argtypes = [ctypes.c_uint32]
+    lib.host_mqtt_connect.argtypes = [ctypes.c_bool]
+    return lib
+
+
+def published(lib, since=0):
+    """(topic, payload bytes, qos, time_us) of each publish from number since on"""
+    out = []
+    publish = Publish()
+    for n in range(since, lib.host_mqtt_publish_count()):
+        if lib.host_mqtt_published(n, ctypes.byref(publish)):
+            out.append((publish.topic.decode(), bytes(publish.data[:publish.len]), publish.qos, publish.time_us))
+    return out
+
+
+def bind(lib):
+    """Declares the outbox functions of a library built with SOURCES and HOST_SOURCES"""
+    bind_publishes(lib)
+    lib.init_mqtt_outbox.restype = ctypes.c_int
+    lib.mqtt_outbox_enqueue.restype = ctypes.c_bool
+    lib.mqtt_outbox_enqueue.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int]
+    lib.mqtt_outbox_enqueue_door_event.restype = ctypes.c_bool
+    lib.mqtt_outbox_enqueue_door_event.argtypes = [ctypes.c_char_p, ctypes.POINTER(PayloadEvent), ctypes.c_int]
+    lib.mqtt_outbox_get_stats.argtypes = [ctypes.POINTER(OutboxStats)]
+    lib.host_outbox_calls.argtypes = [ctypes.POINTER(OutboxCalls)]
+    lib.host_set_mac.argtypes = [ctypes.c_char_p]
+    lib.host_set_rssi.argtypes = [ctypes.c_int8]
+    lib.host_set_clock.argtypes = [ctypes.c_bool, ctypes.c_int64]
+    return lib
+
+
+class Outbox:
+    """The outbox of one freshly loaded library, with its task created but
+    not started"""
+
+    def __init__(self, lib):
+        self.lib = lib
+        lib.host_set_mac(bytes(6))
+        lib.init_door_payload()
+        if lib.init_mqtt_outbox() != 0:
+            raise RuntimeError("init_mqtt_outbox failed")
+        lib.host_mqtt_connect(True)
+
+    def enqueue(self, topic, payload, qos=1):
+        return self.lib.mqtt_outbox_enqueue(topic.encode(), payload.encode(), qos)
+
+    def enqueue_door_event(self, topic, event, qos=1):
+        return self.lib.mqtt_outbox_enqueue_door_event(topic.encode(), ctypes.byref(event), qos)
+
+    def start(self):
+        self.lib.mqtt_outbox_start()
+
+    def run(self, for_us=0):
+        self.lib.host_run_until(self.lib.esp_timer_get_time() + for_us)
+
+    def published(self):
+        return published(self.lib)
+
+    def stats(self):
+        stats = OutboxStats()
+        self.lib.mqtt_outbox_get_stats(ctypes.byref(stats))
+        return stats
+
+    def calls(self):
+        calls = OutboxCalls()
+        self.lib.host_outbox_calls(ctypes.byref(calls))
+        return calls
@@ -0,0 +1,372 @@
+// Stand-ins for the HTTP client, NVS, OTA and restart calls ota_stream.c
+// makes, so tools/host/test_ota_stream.py can stream an image from a local
+// http.server into a partition backed by idf_host.c and reboot in between.
+#include <netdb.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "esp_crt_bundle.h"
+#include "esp_http_client.h"
+#include "esp_ota_ops.h"
+#include "esp_system.h"
+#include "esp32/rom/miniz.h"
+#include "freertos/task.h"
+#include "gecl-wifi-manager.h"
+#include "nvs.h"
+
+#define HOST_NVS_ENTRIES 8
+#define HOST_NVS_BLOB_MAX 1024
+#define HOST_HTTP_HEADERS 4
+
+struct host_nvs_entry
+{
+    char name[16];
+    char key[16];
+    size_t length; // 0 for a free entry
+    uint8_t value[HOST_NVS_BLOB_MAX];
+};
+
+struct host_http_client
+{
+    char url[256];
+    int timeout_ms;
+    char headers[HOST_HTTP_HEADERS][96];
+    size_t header_count;
+    int fd;
+    int status;
+    int64_t content_length; // -1 when the response did not say
+    int64_t received;
+};
+
+static struct host_nvs_entry host_nvs[HOST_NVS_ENTRIES];
+static char host_nvs_names[HOST_NVS_ENTRIES][16]; // Namespace behind each open handle
+static const esp_partition_t *host_running_partition = NULL;
+static const esp_partition_t *host_next_partition = NULL;
+static const esp_partition_t *host_boot_partition = NULL;
+static uint32_t host_restarts = 0;
+
+bool wifi_active(void)
+{
+    return true;
+}
+
+// Counted, and like a real restart never returns to the task that asked
+void esp_restart(void)
+{
+    host_restarts++;
+    vTaskDelete(NULL);
+}
+
+uint32_t host_restart_count(void)
+{
+    return host_restarts;
+}
+
+void host_ota_set_partitions(const esp_partition_t *running, const esp_partition_t *next)
+{
+    host_running_partition = running;
+    host_next_partition = next;
+}
+
+const esp_partition_t *host_ota_boot_partition(void)
+{
+    return host_boot_partition;
+}
+
+const esp_partition_t *esp_ota_get_running_partition(void)
+{
+    return host_running_partition;
+}
+
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start_from)
+{
+    (void)start_from;
+    return host_next_partition;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition)
+{
+    host_boot_partition = partition;
+    return ESP_OK;
+}
+
+esp_err_t esp_crt_bundle_attach(void *conf)
+{
+    (void)conf;
+    return ESP_OK;
+}
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const uint8_t *in_buf_next, size_t *in_buf_size,
+                              uint8_t *out_buf_start, uint8_t *out_buf_next, size_t *out_buf_size,
+                              const uint32_t decomp_flags)
+{
+    (void)r;
+    (void)in_buf_next;
+    (void)out_buf_start;
+    (void)out_buf_next;
+    (void)decomp_flags;
+    *in_buf_size = 0;
+    *out_buf_size = 0;
+    return TINFL_STATUS_FAILED;
+}
+
+static struct host_nvs_entry *host_nvs_find(const char *name, const char *key)
+{
+    for (size_t i = 0; i < HOST_NVS_ENTRIES; i++)
+    {
+        if (host_nvs[i].length > 0 && strcmp(host_nvs[i].name, name) == 0 && strcmp(host_nvs[i].key, key) == 0)
+        {
+            return &host_nvs[i];
+        }
+    }
+    return NULL;
+}
+
+size_t host_nvs_get(const char *name, const char *key, void *out, size_t size)
+{
+    struct host_nvs_entry *entry = host_nvs_find(name, key);
+
+    if (entry == NULL)
+    {
+        return 0;
+    }
+    if (entry->length <= size)
+    {
+        memcpy(out, entry->value, entry->length);
+    }
+    return entry->length;
+}
+
+bool host_nvs_set(const char *name, const char *key, const void *value, size_t length)
+{
+    struct host_nvs_entry *entry = host_nvs_find(name, key);
+
+    for (size_t i = 0; entry == NULL && i < HOST_NVS_ENTRIES; i++)
+    {
+        entry = (host_nvs[i].length == 0) ? &host_nvs[i] : NULL;
+    }
+    if (entry == NULL || length == 0 || length > HOST_NVS_BLOB_MAX || strlen(name) >= sizeof(entry->name) ||
+        strlen(key) >= sizeof(entry->key))
+    {
+        return false;
+    }
+    strcpy(entry->name, name);
+    strcpy(entry->key, key);
+    memcpy(entry->value, value, length);
+    entry->length = length;
+    return true;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    (void)open_mode;
+    for (size_t i = 0; i < HOST_NVS_ENTRIES; i++)
+    {
+        if (host_nvs_names[i][0] == '\0' && strlen(name) < sizeof(host_nvs_names[i]))
+        {
+            strcpy(host_nvs_names[i], name);
+            *out_handle = (nvs_handle_t)i + 1;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    host_nvs_names[handle - 1][0] = '\0';
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    (void)handle;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return host_nvs_set(host_nvs_names[handle - 1], key, value, length) ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    size_t stored = host_nvs_get(host_nvs_names[handle - 1], key, out_value, *length);
+
+    if (stored == 0)
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (stored > *length)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *length = stored;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    struct host_nvs_entry *entry = host_nvs_find(host_nvs_names[handle - 1], key);
+
+    if (entry == NULL)
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    entry->length = 0;
+    return ESP_OK;
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    struct host_http_client *client = calloc(1, sizeof(*client));
+
+    if (client == NULL || strlen(config->url) >= sizeof(client->url))
+    {
+        free(client);
+        return NULL;
+    }
+    strcpy(client->url, config->url);
+    client->timeout_ms = config->timeout_ms;
+    client->fd = -1;
+    client->content_length = -1;
+    return client;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value)
+{
+    if (client->header_count == HOST_HTTP_HEADERS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    snprintf(client->headers[client->header_count++], sizeof(client->headers[0]), "%s: %s\r\n", key, value);
+    return ESP_OK;
+}
+
+// Only http://host:port/path
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len)
+{
+    char host[64];
+    char port[8];
+    const char *path;
+    struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+    struct addrinfo *addr;
+    char request[512];
+    int len;
+
+    (void)write_len;
+    if (sscanf(client->url, "http://%63[^:/]:%7[0-9]", host, port) != 2 ||
+        (path = strchr(client->url + strlen("http://"), '/')) == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (getaddrinfo(host, port, &hints, &addr) != 0)
+    {
+        return ESP_FAIL;
+    }
+    client->fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    if (client->fd < 0 || connect(client->fd, addr->ai_addr, addr->ai_addrlen) != 0)
+    {
+        freeaddrinfo(addr);
+        return ESP_FAIL;
+    }
+    freeaddrinfo(addr);
+
+    struct timeval timeout = {.tv_sec = client->timeout_ms / 1000, .tv_usec = (client->timeout_ms % 1000) * 1000};
+    setsockopt(client->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: %s:%s\r\nConnection: close\r\n", path, host,
+                   port);
+    for (size_t i = 0; i < client->header_count; i++)
+    {
+        len += snprintf(request + len, sizeof(request) - len, "%s", client->headers[i]);
+    }
+    len += snprintf(request + len, sizeof(request) - len, "\r\n");
+    return send(client->fd, request, len, 0) == len ? ESP_OK : ESP_FAIL;
+}
+
+// Reads the status line and headers a byte at a time, so no body byte is
+// taken before esp_http_client_read()
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client)
+{
+    char line[256];
+    size_t used = 0;
+    char c;
+
+    while (recv(client->fd, &c, 1, 0) == 1)
+    {
+        if (c == '\r')
+        {
+            continue;
+        }
+        if (c != '\n')
+        {
+            if (used < sizeof(line) - 1)
+            {
+                line[used++] = c;
+            }
+            continue;
+        }
+        line[used] = '\0';
+        if (used == 0)
+        {
+            return client->content_length;
+        }
+        if (strncmp(line, "HTTP/", 5) == 0)
+        {
+            sscanf(line, "HTTP/%*s %d", &client->status);
+        }
+        else if (strncasecmp(line, "Content-Length:", 15) == 0)
+        {
+            client->content_length = strtoll(line + 15, NULL, 10);
+        }
+        used = 0;
+    }
+    return -1;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+    return client->status;
+}
+
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len)
+{
+    if (client->content_length >= 0 && client->received + len > client->content_length)
+    {
+        len = (int)(client->content_length - client->received);
+    }
+    if (len == 0)
+    {
+        return 0;
+    }
+
+    ssize_t got = recv(client->fd, buffer, len, 0);
+    if (got < 0)
+    {
+        return -1;
+    }
+    client->received += got;
+    return (int)got;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client)
+{
+    if (client->fd >= 0)
+    {
+        close(client->fd);
+        client->fd = -1;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+    esp_http_client_close(client);
+    free(client);
+    return ESP_OK;
+}
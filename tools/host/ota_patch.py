@@ -0,0 +1,163 @@
+"""ctypes binding of main/ota_patch.c, see ota_patch.h, and a host-side
+stand-in for the device's download path in main/ota_stream.c"""
+
+import ctypes
+import hashlib
+import random
+import struct
+import time
+import urllib.request
+import zlib
+
+PATCH_OK, PATCH_BAD_OP, PATCH_OUT_OF_RANGE, PATCH_IO_ERROR = range(4)
+SOURCES = ["ota_patch.c"]
+BUFFER_SIZE = 256
+HEADER_SIZE = 80
+HTTP_BUFFER_SIZE = 1024  # OTA_STREAM_HTTP_BUFFER_SIZE
+
+READ_FN = ctypes.CFUNCTYPE(ctypes.c_bool, ctypes.c_void_p, ctypes.c_uint32, ctypes.POINTER(ctypes.c_uint8),
+                           ctypes.c_size_t)
+WRITE_FN = ctypes.CFUNCTYPE(ctypes.c_bool, ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint8), ctypes.c_size_t)
+
+
+class PatchState(ctypes.Structure):
+    _fields_ = [("read_base", READ_FN), ("write", WRITE_FN), ("ctx", ctypes.c_void_p),
+                ("base_size", ctypes.c_uint32), ("written", ctypes.c_uint32), ("op", ctypes.c_int),
+                ("args", ctypes.c_uint8 * 8), ("args_len", ctypes.c_size_t), ("src", ctypes.c_uint32),
+                ("remaining", ctypes.c_uint32), ("result", ctypes.c_int), ("buf", ctypes.c_uint8 * BUFFER_SIZE)]
+
+
+def bind(lib):
+    """Declares the patch functions of a library built with SOURCES"""
+    lib.ota_patch_init.argtypes = [ctypes.POINTER(PatchState), ctypes.c_uint32, READ_FN, WRITE_FN, ctypes.c_void_p]
+    lib.ota_patch_feed.restype = ctypes.c_int
+    lib.ota_patch_feed.argtypes = [ctypes.POINTER(PatchState), ctypes.c_char_p, ctypes.c_size_t]
+    lib.ota_patch_complete.restype = ctypes.c_bool
+    lib.ota_patch_complete.argtypes = [ctypes.POINTER(PatchState)]
+    return lib
+
+
+class Patcher:
+    """One ota_patch_t applying a delta to base. Output collects in
+    self.output; fail_write_at makes the write callback fail once that many
+    bytes have been written."""
+
+    def __init__(self, lib, base, fail_write_at=None):
+        self.lib = lib
+        self.base = base
+        self.output = bytearray()
+        self.reads = 0
+        self.fail_write_at = fail_write_at
+        # Kept alive: the C side only stores the pointers
+        self.read_fn = READ_FN(self._read)
+        self.write_fn = WRITE_FN(self._write)
+        self.state = PatchState()
+        lib.ota_patch_init(ctypes.byref(self.state), len(base), self.read_fn, self.write_fn, None)
+
+    def _read(self, ctx, offset, buf, size):
+        if offset + size > len(self.base):
+            return False
+        self.reads += 1
+        ctypes.memmove(buf, self.base[offset:offset + size], size)
+        return True
+
+    def _write(self, ctx, data, size):
+        if self.fail_write_at is not None and len(self.output) + size > self.fail_write_at:
+            return False
+        self.output += ctypes.string_at(data, size)
+        return True
+
+    def feed(self, data):
+        return self.lib.ota_patch_feed(ctypes.byref(self.state), data, len(data))
+
+    def feed_chunks(self, data, size):
+        result = PATCH_OK
+        for i in range(0, len(data), size):
+            result = self.feed(data[i:i + size])
+        return result
+
+    def complete(self):
+        return self.lib.ota_patch_complete(ctypes.byref(self.state))
+
+
+def synthetic_release(records=16 * 1024, seed=1):
+    """(base, image) standing in for two builds of the firmware: 16-byte
+    records of code followed by an absolute address of another record. The
+    newer build inserts and rewrites a few records, so everything after an
+    insertion moves and every address pointing past one changes."""
+    rng = random.Random(seed)
+    vocabulary = [rng.randbytes(12) for _ in range(512)]
+    code = [rng.choice(vocabulary) for _ in range(records)]
+    target = [rng.randrange(records) for _ in range(records)]
+
+    def build(order):
+        position = {record: i for i, record in enumerate(order)}
+        return b"".join(code[r] + struct.pack("<I", 0x400D0000 + 16 * position[target[r]]) for r in order)
+
+    order = list(range(records))
+    base = build(order)
+    for _ in range(8):
+        at = rng.randrange(len(order))
+        added = range(len(code), len(code) + rng.randrange(4, 64))
+        code.extend(rng.randbytes(12) for _ in added)
+        target.extend(rng.randrange(records) for _ in added)
+        order[at:at] = added
+    for r in rng.sample(range(records), 32):
+        code[r] = rng.randbytes(12)
+    return base, build(order)
+
+
+def split_delta(delta):
+    """(image size, image SHA-256, base size, base SHA-256, inflated operations)"""
+    assert delta[:4] == b"MBD1"
+    size, _ = struct.unpack_from("<II", delta, 4)
+    (base_size,) = struct.unpack_from("<I", delta, 44)
+    return size, delta[12:44], base_size, delta[48:80], zlib.decompress(delta[HEADER_SIZE:], 12)
+
+
+def download(lib, url, base=None):
+    """Fetches url as ota_stream.c would: HTTP_BUFFER_SIZE reads, inflated as
+    they arrive and, for a .mbd, patched against base. Returns the image and
+    a dict of bytes_transferred and wall_time_us."""
+    started = time.perf_counter()
+    transferred = 0
+    header = b""
+    image = bytearray()
+    patcher = None
+    inflater = None
+    header_size = HEADER_SIZE if url.endswith(".mbd") else 44 if url.endswith(".mbz") else 0
+
+    with urllib.request.urlopen(url) as response:
+        while True:
+            chunk = response.read(HTTP_BUFFER_SIZE)
+            if not chunk:
+                break
+            transferred += len(chunk)
+            if header_size == 0:
+                image += chunk
+                continue
+            if len(header) < header_size:
+                take = header_size - len(header)
+                header += chunk[:take]
+                chunk = chunk[take:]
+                if len(header) < header_size:
+                    continue
+                inflater = zlib.decompressobj(12)
+                if header_size == HEADER_SIZE:
+                    if hashlib.sha256(base).digest() != header[48:80]:
+                        raise ValueError("delta was made against a different image")
+                    patcher = Patcher(lib, base)
+            out = inflater.decompress(chunk)
+            if patcher is None:
+                image += out
+            elif patcher.feed(out) != PATCH_OK:
+                raise ValueError("malformed delta")
+
+    if patcher is not None:
+        if not patcher.complete():
+            raise ValueError("delta ends inside an operation")
+        image = patcher.output
+    if header_size and hashlib.sha256(image).digest() != header[12:44]:
+        raise ValueError("image SHA-256 differs from the container header")
+    return bytes(image), {"bytes_transferred": transferred,
+                          "wall_time_us": int((time.perf_counter() - started) * 1e6)}
@@ -0,0 +1,113 @@
+"""ctypes binding of main/ota_stream.c on the host stand-ins, see
+ota_stream.h. HTTP goes over real sockets through ota_host.c, the update
+partition is flash in idf_host.c that counts repeated erases and writes, and
+NVS is kept in memory so a checkpoint can be carried across a reboot."""
+
+import ctypes
+
+from host_c import MAIN, evaluate, read_defines
+
+SOURCES = ["ota_stream.c", "ota_patch.c"]
+HOST_SOURCES = ["ota_host.c", "sha256_host.c", "idf_host.c", "rtos_host.c"]
+
+_CONFIG = read_defines(f"{MAIN}/ota_stream_config.h")
+CHECKPOINT_INTERVAL = evaluate(_CONFIG["OTA_STREAM_CHECKPOINT_INTERVAL"])
+NVS_NAMESPACE = _CONFIG["OTA_STREAM_NVS_NAMESPACE"].strip('"').encode()
+NVS_KEY = _CONFIG["OTA_STREAM_NVS_KEY"].strip('"').encode()
+ESP_ERR_INVALID_CRC = 0x109
+
+
+class Request(ctypes.Structure):
+    """ota_stream_request_t"""
+    _fields_ = [("url", ctypes.c_char * 256), ("version", ctypes.c_char * 32), ("sha256", ctypes.c_uint8 * 32),
+                ("has_sha256", ctypes.c_bool)]
+
+
+class Stats(ctypes.Structure):
+    """ota_stream_stats_t"""
+    _fields_ = [("bytes_transferred", ctypes.c_uint32), ("bytes_written", ctypes.c_uint32),
+                ("resumes", ctypes.c_uint32), ("checkpoints", ctypes.c_uint32), ("wall_time_us", ctypes.c_int64),
+                ("last_error", ctypes.c_int)]
+
+
+class Partition(ctypes.Structure):
+    """esp_partition_t of the host stand-in"""
+    _fields_ = [("address", ctypes.c_uint32), ("size", ctypes.c_uint32), ("erase_size", ctypes.c_uint32),
+                ("label", ctypes.c_char * 17)]
+
+
+class FlashStats(ctypes.Structure):
+    """host_flash_stats_t"""
+    _fields_ = [("erased_bytes", ctypes.c_uint32), ("reerased_bytes", ctypes.c_uint32),
+                ("written_bytes", ctypes.c_uint32), ("overwritten_bytes", ctypes.c_uint32)]
+
+
+def bind(lib):
+    """Declares the OTA stream functions of a library built with SOURCES and HOST_SOURCES"""
+    lib.host_set_time_us.argtypes = [ctypes.c_int64]
+    lib.esp_timer_get_time.restype = ctypes.c_int64
+    lib.host_run_until.argtypes = [ctypes.c_int64]
+    lib.ota_stream_start.argtypes = [ctypes.POINTER(Request)]
+    lib.ota_stream_running.restype = ctypes.c_bool
+    lib.ota_stream_get_stats.argtypes = [ctypes.POINTER(Stats)]
+    lib.host_partition_add.restype = ctypes.c_bool
+    lib.host_partition_add.argtypes = [ctypes.POINTER(Partition), ctypes.POINTER(ctypes.c_uint8)]
+    lib.host_flash_stats.argtypes = [ctypes.POINTER(Partition), ctypes.POINTER(FlashStats)]
+    lib.host_ota_set_partitions.argtypes = [ctypes.POINTER(Partition), ctypes.POINTER(Partition)]
+    lib.host_ota_boot_partition.restype = ctypes.c_void_p
+    lib.host_restart_count.restype = ctypes.c_uint32
+    lib.host_nvs_get.restype = ctypes.c_size_t
+    lib.host_nvs_get.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_void_p, ctypes.c_size_t]
+    lib.host_nvs_set.restype = ctypes.c_bool
+    lib.host_nvs_set.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_size_t]
+    return lib
+
+
+class Device:
+    """One boot of a device: a freshly loaded library whose next update
+    partition is backed by flash, a ctypes byte array that outlives it the way
+    real flash outlives a reboot"""
+
+    def __init__(self, lib, flash, erase_size=4096):
+        self.lib = lib
+        self.flash = flash
+        self.running = Partition(0x10000, len(flash), erase_size, b"ota_0")
+        self.next = Partition(0x10000 + len(flash), len(flash), erase_size, b"ota_1")
+        if not lib.host_partition_add(ctypes.byref(self.next), flash):
+            raise RuntimeError("host_partition_add failed")
+        lib.host_ota_set_partitions(ctypes.byref(self.running), ctypes.byref(self.next))
+
+    def start(self, url, sha256=None):
+        request = Request(url.encode(), b"", (ctypes.c_uint8 * 32)(*(sha256 or bytes(32))), sha256 is not None)
+        return self.lib.ota_stream_start(ctypes.byref(request))
+
+    def run(self, for_us):
+        self.lib.host_run_until(self.lib.esp_timer_get_time() + for_us)
+
+    def running_ota(self):
+        return self.lib.ota_stream_running()
+
+    def stats(self):
+        stats = Stats()
+        self.lib.ota_stream_get_stats(ctypes.byref(stats))
+        return stats
+
+    def flash_stats(self):
+        stats = FlashStats()
+        self.lib.host_flash_stats(ctypes.byref(self.next), ctypes.byref(stats))
+        return stats
+
+    def booted_update(self):
+        """Whether the next partition was made the boot partition and the device restarted"""
+        return (self.lib.host_ota_boot_partition() == ctypes.addressof(self.next) and
+                self.lib.host_restart_count() == 1)
+
+    def checkpoint(self):
+        """The checkpoint blob in NVS, b"" without one"""
+        buf = ctypes.create_string_buffer(4096)
+        length = self.lib.host_nvs_get(NVS_NAMESPACE, NVS_KEY, buf, len(buf))
+        return buf.raw[:length]
+
+    def restore_checkpoint(self, blob):
+        if not self.lib.host_nvs_set(NVS_NAMESPACE, NVS_KEY, blob, len(blob)):
+            raise RuntimeError("host_nvs_set failed")
@@ -0,0 +1,135 @@
+// Recording stand-ins for the journal, in-flight, settings and metrics calls
+// mqtt_outbox.c makes, so tools/host/test_mqtt_outbox.py can check what it
+// handed on. Publishes themselves are recorded by idf_host.c.
+#include <stdbool.h>
+#include <stdint.h>
+#include "door_config.h"
+#include "door_handler.h"
+#include "door_journal.h"
+#include "door_reminder.h"
+#include "door_trace.h"
+#include "metrics.h"
+#include "mqtt_custom_handler.h"
+#include "mqtt_inflight.h"
+#include "settings.h"
+
+typedef struct
+{
+    uint32_t reserved;
+    uint32_t committed;
+    uint32_t cancelled;
+    uint32_t reserved_first_seq; // Journal range of the last reservation
+    uint32_t reserved_last_seq;
+    uint32_t failed_seq;         // Last door_journal_mark_failed()
+    uint32_t failed_calls;
+    uint32_t delivered_seq;      // Last door_journal_mark_delivered()
+} host_outbox_calls_t;
+
+esp_mqtt_client_handle_t mqtt_client_handle = NULL;
+static host_outbox_calls_t calls;
+static struct host_mqtt_client
+{
+    int unused;
+} host_client;
+
+void host_outbox_calls(host_outbox_calls_t *out)
+{
+    *out = calls;
+}
+
+void host_mqtt_connect(bool connected)
+{
+    mqtt_client_handle = connected ? &host_client : NULL;
+}
+
+void door_journal_mark_failed(uint32_t seq)
+{
+    calls.failed_seq = seq;
+    calls.failed_calls++;
+}
+
+void door_journal_mark_delivered(uint32_t seq)
+{
+    calls.delivered_seq = seq;
+}
+
+size_t door_journal_read_pending(door_journal_entry_t *entries, size_t max)
+{
+    (void)entries;
+    (void)max;
+    return 0;
+}
+
+bool door_journal_replay_needed(void)
+{
+    return false;
+}
+
+int mqtt_inflight_reserve(const mqtt_inflight_msg_t *msg)
+{
+    calls.reserved_first_seq = msg->first_seq;
+    calls.reserved_last_seq = msg->last_seq;
+    return (int)calls.reserved++;
+}
+
+void mqtt_inflight_commit(int handle, int msg_id)
+{
+    (void)handle;
+    (void)msg_id;
+    calls.committed++;
+}
+
+void mqtt_inflight_cancel(int handle)
+{
+    (void)handle;
+    calls.cancelled++;
+}
+
+bool mqtt_inflight_replay_pending(void)
+{
+    return false;
+}
+
+uint32_t settings_get(setting_t setting)
+{
+    return (setting == SETTING_PUBLISH_RETRIES) ? MQTT_PUBLISH_RETRIES : 0;
+}
+
+void metrics_add(metric_counter_t counter, uint32_t n)
+{
+    (void)counter;
+    (void)n;
+}
+
+void metrics_inc(metric_counter_t counter)
+{
+    (void)counter;
+}
+
+void metrics_observe_ms(metric_histogram_t histogram, uint32_t value_ms)
+{
+    (void)histogram;
+    (void)value_ms;
+}
+
+void metrics_watch_task(TaskHandle_t task)
+{
+    (void)task;
+}
+
+void door_trace_note_published(int64_t origin_us, size_t events)
+{
+    (void)origin_us;
+    (void)events;
+}
+
+void door_reminder_note_publish(void)
+{
+}
+
+// Replaced by the real one when door_handler.c is linked too
+__attribute__((weak)) const char *door_handler_sensor_topic(uint8_t sensor)
+{
+    (void)sensor;
+    return NULL;
+}
@@ -0,0 +1,55 @@
+// Stand-ins for the MAC, Wi-Fi and clock calls door_payload.c makes, so
+// tools/host/test_door_payload.py can set what they return.
+#include <stdbool.h>
+#include <string.h>
+#include "esp_mac.h"
+#include "esp_wifi.h"
+#include "clock_sync.h"
+
+static uint8_t host_mac[6];
+static int8_t host_rssi = 0;
+static bool host_clock_synced = false;
+static int64_t host_wall_offset_us = 0;
+
+void host_set_mac(const uint8_t *mac)
+{
+    memcpy(host_mac, mac, sizeof(host_mac));
+}
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type)
+{
+    memcpy(mac, host_mac, sizeof(host_mac));
+    return ESP_OK;
+}
+
+void host_set_rssi(int8_t rssi)
+{
+    host_rssi = rssi;
+}
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap_info)
+{
+    if (host_rssi == 0)
+    {
+        return ESP_ERR_WIFI_NOT_CONNECT;
+    }
+    ap_info->rssi = host_rssi;
+    return ESP_OK;
+}
+
+// Wall clock is esp_timer time plus offset_us once synced
+void host_set_clock(bool synced, int64_t offset_us)
+{
+    host_clock_synced = synced;
+    host_wall_offset_us = offset_us;
+}
+
+bool clock_sync_mono_to_wall_us(int64_t mono_us, int64_t *wall_us)
+{
+    if (!host_clock_synced)
+    {
+        return false;
+    }
+    *wall_us = mono_us + host_wall_offset_us;
+    return true;
+}
@@ -0,0 +1,416 @@
+// Host implementations of the FreeRTOS calls declared in include/freertos/.
+// Tasks get a thread each but run one at a time, like tasks sharing one core
+// without preemption: a task runs until it blocks on a queue, semaphore,
+// notification or delay, and only inside host_run_until(). Until a test calls
+// that, created tasks just wait, and a module driven through its API behaves
+// single-threaded. Queues and semaphores count properly; callers outside a
+// task never block, their waits time out at once.
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#define HOST_MAX_TASKS 16
+
+// A queue, a semaphore (a queue of zero-size items) or a task
+struct host_object
+{
+    uint8_t *items;
+    size_t item_size;
+    size_t length;
+    size_t count;
+    size_t head;
+
+    TaskFunction_t fn;
+    void *arg;
+    UBaseType_t priority;
+    pthread_t thread;
+    pthread_cond_t turn;
+    uint32_t notified;
+    bool finished;
+    const struct host_object *waiting_on; // NULL when ready to run
+    int64_t wake_us;                      // A wait times out here
+};
+
+static pthread_mutex_t host_cpu = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t host_driver_turn = PTHREAD_COND_INITIALIZER;
+static struct host_object *host_running = NULL; // Task on the CPU, NULL while the test drives
+static struct host_object *host_tasks[HOST_MAX_TASKS];
+static size_t host_task_count = 0;
+static struct host_object host_delay; // What vTaskDelay() waits on
+
+static int64_t host_deadline_us(TickType_t wait)
+{
+    return (wait == portMAX_DELAY) ? INT64_MAX : esp_timer_get_time() + (int64_t)wait * portTICK_PERIOD_MS * 1000;
+}
+
+// Gives the CPU to next, NULL for the test, and returns once self has it back
+static void host_switch(struct host_object *self, struct host_object *next)
+{
+    pthread_mutex_lock(&host_cpu);
+    host_running = next;
+    pthread_cond_broadcast(next != NULL ? &next->turn : &host_driver_turn);
+    while (host_running != self)
+    {
+        pthread_cond_wait(self != NULL ? &self->turn : &host_driver_turn, &host_cpu);
+    }
+    pthread_mutex_unlock(&host_cpu);
+}
+
+// Blocks the running task until object changes or deadline_us passes. False
+// when the caller has to give up instead: outside a task, or timed out.
+static bool host_wait(const struct host_object *object, int64_t deadline_us)
+{
+    struct host_object *self = host_running;
+
+    if (self == NULL || esp_timer_get_time() >= deadline_us)
+    {
+        return false;
+    }
+    self->waiting_on = object;
+    self->wake_us = deadline_us;
+    host_switch(self, NULL);
+    return true;
+}
+
+static void host_wake(const struct host_object *object)
+{
+    for (size_t i = 0; i < host_task_count; i++)
+    {
+        if (host_tasks[i]->waiting_on == object)
+        {
+            host_tasks[i]->waiting_on = NULL;
+        }
+    }
+}
+
+// Hands the CPU back for good
+static void host_task_exit(struct host_object *task)
+{
+    task->finished = true;
+    pthread_mutex_lock(&host_cpu);
+    host_running = NULL;
+    pthread_cond_broadcast(&host_driver_turn);
+    pthread_mutex_unlock(&host_cpu);
+}
+
+static void *host_task_thread(void *arg)
+{
+    struct host_object *task = arg;
+
+    pthread_mutex_lock(&host_cpu);
+    while (host_running != task)
+    {
+        pthread_cond_wait(&task->turn, &host_cpu);
+    }
+    pthread_mutex_unlock(&host_cpu);
+
+    task->fn(task->arg);
+    host_task_exit(task);
+    return NULL;
+}
+
+static struct host_object *host_next_ready(void)
+{
+    struct host_object *next = NULL;
+
+    for (size_t i = 0; i < host_task_count; i++)
+    {
+        struct host_object *task = host_tasks[i];
+        if (!task->finished && task->waiting_on == NULL && (next == NULL || task->priority > next->priority))
+        {
+            next = task;
+        }
+    }
+    return next;
+}
+
+void host_run_until(int64_t until_us)
+{
+    while (1)
+    {
+        struct host_object *next = host_next_ready();
+        if (next != NULL)
+        {
+            host_switch(NULL, next);
+            continue;
+        }
+
+        // Everything is blocked: move the clock to whatever is due first
+        int64_t due_us = host_next_timer_us();
+        for (size_t i = 0; i < host_task_count; i++)
+        {
+            if (host_tasks[i]->waiting_on != NULL && host_tasks[i]->wake_us < due_us)
+            {
+                due_us = host_tasks[i]->wake_us;
+            }
+        }
+        if (due_us == INT64_MAX || due_us > until_us)
+        {
+            break;
+        }
+        if (due_us > esp_timer_get_time())
+        {
+            host_set_time_us(due_us);
+        }
+
+        // Timers first, as the esp_timer task outranks every task here
+        if (!host_fire_due_timer())
+        {
+            for (size_t i = 0; i < host_task_count; i++)
+            {
+                if (host_tasks[i]->waiting_on != NULL && host_tasks[i]->wake_us <= esp_timer_get_time())
+                {
+                    host_tasks[i]->waiting_on = NULL;
+                }
+            }
+        }
+    }
+
+    if (until_us > esp_timer_get_time())
+    {
+        host_set_time_us(until_us);
+    }
+}
+
+static struct host_object *host_queue_new(size_t length, size_t item_size, size_t count)
+{
+    struct host_object *queue = calloc(1, sizeof(*queue));
+
+    if (queue == NULL)
+    {
+        return NULL;
+    }
+    if (item_size > 0 && (queue->items = calloc(length, item_size)) == NULL)
+    {
+        free(queue);
+        return NULL;
+    }
+    queue->item_size = item_size;
+    queue->length = length;
+    queue->count = count;
+    return queue;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    return host_queue_new(length, item_size, 0);
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *storage,
+                                 StaticQueue_t *queue)
+{
+    (void)storage;
+    (void)queue;
+    return host_queue_new(length, item_size, 0);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait)
+{
+    int64_t deadline_us = host_deadline_us(wait);
+
+    while (queue->count == queue->length)
+    {
+        if (!host_wait(queue, deadline_us))
+        {
+            return pdFALSE;
+        }
+    }
+    if (queue->item_size > 0)
+    {
+        memcpy(queue->items + (queue->head + queue->count) % queue->length * queue->item_size, item,
+               queue->item_size);
+    }
+    queue->count++;
+    host_wake(queue);
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higher_priority_task_woken)
+{
+    bool waiting = false;
+
+    for (size_t i = 0; i < host_task_count; i++)
+    {
+        waiting |= host_tasks[i]->waiting_on == queue;
+    }
+    BaseType_t sent = xQueueSend(queue, item, 0);
+    if (sent == pdTRUE && waiting && higher_priority_task_woken != NULL)
+    {
+        *higher_priority_task_woken = pdTRUE;
+    }
+    return sent;
+}
+
+static BaseType_t host_queue_take(QueueHandle_t queue, void *item, TickType_t wait, bool remove)
+{
+    int64_t deadline_us = host_deadline_us(wait);
+
+    while (queue->count == 0)
+    {
+        if (!host_wait(queue, deadline_us))
+        {
+            return pdFALSE;
+        }
+    }
+    if (queue->item_size > 0)
+    {
+        memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+    }
+    if (remove)
+    {
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        host_wake(queue);
+    }
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait)
+{
+    return host_queue_take(queue, item, wait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t wait)
+{
+    return host_queue_take(queue, item, wait, false);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    return (UBaseType_t)queue->count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return host_queue_new(1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return host_queue_new(1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *storage)
+{
+    (void)storage;
+    return xSemaphoreCreateMutex();
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *storage)
+{
+    (void)storage;
+    return xSemaphoreCreateBinary();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t wait)
+{
+    return host_queue_take(semaphore, NULL, wait, true);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    return xQueueSend(semaphore, NULL, 0);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_size, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    struct host_object *task;
+
+    (void)name;
+    (void)stack_size;
+    (void)core;
+    if (host_task_count == HOST_MAX_TASKS || (task = calloc(1, sizeof(*task))) == NULL)
+    {
+        return pdFAIL;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    task->priority = priority;
+    pthread_cond_init(&task->turn, NULL);
+    if (pthread_create(&task->thread, NULL, host_task_thread, task) != 0)
+    {
+        free(task);
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+    host_tasks[host_task_count++] = task;
+    if (handle != NULL)
+    {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_size, void *arg,
+                                           UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb,
+                                           BaseType_t core)
+{
+    TaskHandle_t handle = NULL;
+
+    (void)stack;
+    (void)tcb;
+    xTaskCreatePinnedToCore(fn, name, stack_size, arg, priority, &handle, core);
+    return handle;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    task->notified++;
+    host_wake(task);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait)
+{
+    struct host_object *self = host_running;
+    int64_t deadline_us = host_deadline_us(wait);
+
+    if (self == NULL)
+    {
+        return 0;
+    }
+    while (self->notified == 0)
+    {
+        if (!host_wait(self, deadline_us))
+        {
+            return 0;
+        }
+    }
+    uint32_t value = self->notified;
+    self->notified = clear ? 0 : value - 1;
+    return value;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    struct host_object *self = host_running;
+
+    if (self == NULL || (task != NULL && task != self))
+    {
+        return;
+    }
+    host_task_exit(self);
+    pthread_exit(NULL);
+}
+
+// Outside a task there is nothing else to run, so the clock just moves on
+void vTaskDelay(TickType_t ticks)
+{
+    int64_t deadline_us = host_deadline_us(ticks);
+
+    if (host_running == NULL)
+    {
+        host_set_time_us(deadline_us);
+        return;
+    }
+    while (esp_timer_get_time() < deadline_us)
+    {
+        host_wait(&host_delay, deadline_us);
+    }
+}
@@ -0,0 +1,50 @@
+"""ctypes binding of main/door_sleep_policy.c, see door_sleep_policy.h"""
+
+import ctypes
+
+from host_c import MAIN, evaluate, read_defines
+
+SOURCES = ["door_sleep_policy.c"]
+NO_WAKE = 2**63 - 1
+ACTION_NONE, ACTION_TRANSITION, ACTION_REMINDER = range(3)
+MAX_SENSORS = evaluate(read_defines(f"{MAIN}/sleep_config.h")["SLEEP_POLICY_MAX_SENSORS"])
+
+
+class SleepPolicyState(ctypes.Structure):
+    _fields_ = [("magic", ctypes.c_uint32), ("sensor_count", ctypes.c_uint8),
+                ("reported_state", ctypes.c_uint8 * MAX_SENSORS), ("next_reminder_us", ctypes.c_int64 * MAX_SENSORS)]
+
+
+def bind(lib):
+    """Declares the policy functions of a library built with SOURCES"""
+    state = ctypes.POINTER(SleepPolicyState)
+    lib.sleep_policy_reset.argtypes = [state, ctypes.c_size_t]
+    lib.sleep_policy_valid.restype = ctypes.c_bool
+    lib.sleep_policy_valid.argtypes = [state, ctypes.c_size_t]
+    lib.sleep_policy_on_wake.restype = ctypes.c_int
+    lib.sleep_policy_on_wake.argtypes = [state, ctypes.c_size_t, ctypes.c_uint8, ctypes.c_int64]
+    lib.sleep_policy_reported.argtypes = [state, ctypes.c_size_t, ctypes.c_uint8, ctypes.c_uint32, ctypes.c_int64]
+    lib.sleep_policy_next_wake_us.restype = ctypes.c_int64
+    lib.sleep_policy_next_wake_us.argtypes = [state]
+    return lib
+
+
+class Policy:
+    """One sleep_policy_state_t, as RTC memory would hold it across wakes"""
+
+    def __init__(self, lib, sensor_count):
+        self.lib = lib
+        self.state = SleepPolicyState()
+        lib.sleep_policy_reset(ctypes.byref(self.state), sensor_count)
+
+    def valid(self, sensor_count):
+        return self.lib.sleep_policy_valid(ctypes.byref(self.state), sensor_count)
+
+    def on_wake(self, sensor, state, now_us):
+        return self.lib.sleep_policy_on_wake(ctypes.byref(self.state), sensor, state, now_us)
+
+    def reported(self, sensor, state, reminder_ms, now_us):
+        self.lib.sleep_policy_reported(ctypes.byref(self.state), sensor, state, reminder_ms, now_us)
+
+    def next_wake_us(self):
+        return self.lib.sleep_policy_next_wake_us(ctypes.byref(self.state))
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""Host tests of the drift estimate in main/clock_sync.c: plausible crystal
+drift is averaged in, and clock steps far beyond any crystal's error are
+kept out of it instead of wrapping it.
+
+    python3 tools/host/test_clock_sync.py
+    python3 -m unittest discover -s tools/host     (every host test)
+"""
+
+import os
+import sys
+import tempfile
+import unittest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, HERE)
+from clock_sync import HOST_SOURCES, MAX_DRIFT_PPB, MIN_DRIFT_SPAN_MS, SOURCES, Clock, bind  # noqa: E402
+from host_c import build_library  # noqa: E402
+
+EPOCH_US = 1_760_000_000_000_000
+SPAN_US = 2 * MIN_DRIFT_SPAN_MS * 1000
+DAY_US = 86_400_000_000
+
+
+def setUpModule():
+    global workdir, builds
+    workdir = tempfile.TemporaryDirectory()
+    builds = 0
+
+
+def tearDownModule():
+    workdir.cleanup()
+
+
+def new_clock():
+    """A freshly loaded clock_sync.c, since its state is static"""
+    global builds
+    builds += 1
+    lib = bind(build_library(workdir.name, SOURCES, name=f"clock_sync_{builds}", host_sources=HOST_SOURCES))
+    lib.host_set_time_us(1_000_000)
+    lib.host_set_wall_us(EPOCH_US)
+    lib.init_clock_sync()
+    return Clock(lib)
+
+
+def drifted(clock, ppm, syncs, start_us=1_000_000):
+    """Resyncs every SPAN_US with the crystal running ppm slow; returns the last esp_timer time"""
+    mono_us = start_us
+    for _ in range(syncs):
+        mono_us += SPAN_US
+        clock.sample(mono_us, EPOCH_US + mono_us - start_us + (mono_us - start_us) * ppm // 1_000_000)
+    return mono_us
+
+
+class DriftTest(unittest.TestCase):
+    def test_crystal_drift_is_estimated(self):
+        clock = new_clock()
+        drifted(clock, 20, 4)
+        self.assertAlmostEqual(clock.stats().drift_ppb, 20_000, delta=100)
+
+    def test_steps_beyond_the_bound_are_not_averaged_in(self):
+        clock = new_clock()
+        mono_us = drifted(clock, 20, 4)
+        wall_us = EPOCH_US + mono_us - 1_000_000 + (mono_us - 1_000_000) * 20 // 1_000_000
+
+        # Someone sets the clock an hour ahead
+        clock.sample(mono_us + SPAN_US, wall_us + SPAN_US + 3_600_000_000)
+        stats = clock.stats()
+        self.assertEqual(stats.last_step_us // 1_000_000, 3600)
+        self.assertAlmostEqual(stats.drift_ppb, 20_000, delta=100)
+        self.assertIn(b'"step_ms":3600', clock.lib.host_last_published())
+
+    def test_step_that_would_overflow_int32_is_rejected(self):
+        clock = new_clock()
+        clock.sample(1_000_000 + SPAN_US, EPOCH_US + SPAN_US + 30 * DAY_US)
+        clock.sample(1_000_000 + 2 * SPAN_US, EPOCH_US + 2 * SPAN_US + 30 * DAY_US)
+        self.assertEqual(clock.stats().drift_ppb, 0)
+
+        # Mapping far past the last sync stays on the unskewed offset
+        mono_us = 1_000_000 + 2 * SPAN_US + DAY_US
+        self.assertEqual(clock.to_wall_us(mono_us), EPOCH_US + 30 * DAY_US + mono_us - 1_000_000)
+
+    def test_drift_at_the_bound_is_kept(self):
+        clock = new_clock()
+        drifted(clock, MAX_DRIFT_PPB // 1000, 1)
+        self.assertEqual(clock.stats().drift_ppb, MAX_DRIFT_PPB)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""Host tests of main/door_debounce.c, both modes.
+
+    python3 tools/host/test_debounce.py
+    python3 -m unittest discover -s tools/host     (every host test)
+"""
+
+import os
+import sys
+import tempfile
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from debounce import MODE_INTEGRATING, MODE_LEADING_EDGE, NO_DEADLINE, SOURCES, Debouncer, bind  # noqa: E402
+from host_c import build_library  # noqa: E402
+
+SETTLE_MS = 50
+SETTLE_US = SETTLE_MS * 1000
+MS = 1000
+
+
+def setUpModule():
+    global workdir, lib
+    workdir = tempfile.TemporaryDirectory()
+    lib = bind(build_library(workdir.name, SOURCES, name="debounce"))
+
+
+def tearDownModule():
+    workdir.cleanup()
+
+
+class DebounceTest(unittest.TestCase):
+    mode = None
+
+    def debouncer(self, level=0):
+        return Debouncer(lib, self.mode, SETTLE_MS, level, 0)
+
+
+class IntegratingTest(DebounceTest):
+    mode = MODE_INTEGRATING
+
+    def test_bounce_inside_window_commits_once_after_settling(self):
+        db = self.debouncer()
+        edges = [(10 * MS, 1), (10 * MS + 300, 0), (10 * MS + 700, 1), (11 * MS, 0), (12 * MS, 1)]
+        self.assertEqual(db.run(edges), [(1, 12 * MS)])
+
+    def test_nothing_commits_before_the_level_has_been_stable_for_settle_ms(self):
+        db = self.debouncer()
+        self.assertIsNone(db.feed(1, 10 * MS))
+        self.assertIsNone(db.poll(10 * MS + SETTLE_US - 1))
+        self.assertEqual(db.poll(10 * MS + SETTLE_US), (1, 10 * MS))
+
+    def test_every_edge_restarts_the_settle_timer(self):
+        db = self.debouncer()
+        db.feed(1, 0)
+        db.feed(0, 40 * MS)
+        db.feed(1, 80 * MS)
+        self.assertEqual(db.deadline_us(), 80 * MS + SETTLE_US)
+        self.assertIsNone(db.poll(100 * MS))
+        self.assertEqual(db.poll(80 * MS + SETTLE_US), (1, 80 * MS))
+
+    def test_glitch_back_to_the_stable_level_commits_nothing(self):
+        db = self.debouncer()
+        self.assertEqual(db.run([(10 * MS, 1), (10 * MS + 400, 0)]), [])
+        self.assertEqual(db.deadline_us(), NO_DEADLINE)
+
+    def test_settles_on_the_final_level(self):
+        db = self.debouncer()
+        edges = [(0, 1), (200, 0), (400, 1), (600, 0), (800, 1), (1000, 0), (1200, 1)]
+        self.assertEqual(db.run(edges), [(1, 1200)])
+        self.assertEqual(db.state.stable_level, 1)
+
+    def test_open_and_close_both_commit(self):
+        db = self.debouncer()
+        edges = [(0, 1), (300, 0), (600, 1), (500 * MS, 0), (500 * MS + 250, 1), (500 * MS + 800, 0)]
+        self.assertEqual(db.run(edges), [(1, 600), (0, 500 * MS + 800)])
+
+
+class LeadingEdgeTest(DebounceTest):
+    mode = MODE_LEADING_EDGE
+
+    def test_bounce_inside_window_commits_the_first_edge_only(self):
+        db = self.debouncer()
+        self.assertEqual(db.feed(1, 10 * MS), (1, 10 * MS))
+        edges = [(10 * MS + 300, 0), (10 * MS + 700, 1), (11 * MS, 0), (12 * MS, 1)]
+        self.assertEqual(db.run(edges), [])
+        self.assertEqual(db.state.stable_level, 1)
+
+    def test_echoes_inside_the_window_are_suppressed(self):
+        db = self.debouncer()
+        db.feed(1, 0)
+        for i, level in enumerate([0, 1, 0, 1]):
+            self.assertIsNone(db.feed(level, (i + 1) * 5 * MS))
+        self.assertEqual(db.deadline_us(), SETTLE_US)
+        self.assertIsNone(db.poll(SETTLE_US))  # Ended where it was committed
+
+    def test_settles_on_the_final_level_when_the_bounce_ends_elsewhere(self):
+        db = self.debouncer()
+        edges = [(0, 1), (200, 0), (400, 1), (600, 0)]
+        # Committed open on the first edge, then closed once the window shows it stayed closed
+        self.assertEqual(db.run(edges), [(1, 0), (0, 600)])
+        self.assertEqual(db.state.stable_level, 0)
+
+    def test_late_final_edge_waits_a_full_settle_time(self):
+        db = self.debouncer()
+        db.feed(1, 0)
+        db.feed(0, SETTLE_US - 1 * MS)
+        self.assertIsNone(db.poll(SETTLE_US))
+        self.assertEqual(db.deadline_us(), 2 * SETTLE_US - 1 * MS)
+        self.assertEqual(db.poll(2 * SETTLE_US - 1 * MS), (0, SETTLE_US - 1 * MS))
+
+    def test_edge_after_the_window_commits_immediately(self):
+        db = self.debouncer()
+        self.assertEqual(db.run([(0, 1), (300, 0), (600, 1)], until_us=SETTLE_US), [(1, 0)])
+        self.assertEqual(db.feed(0, 500 * MS), (0, 500 * MS))
+
+    def test_open_and_close_both_commit(self):
+        db = self.debouncer()
+        edges = [(0, 1), (300, 0), (600, 1), (500 * MS, 0), (500 * MS + 250, 1), (500 * MS + 800, 0)]
+        self.assertEqual(db.run(edges), [(1, 0), (0, 500 * MS)])
+
+
+if __name__ == "__main__":
+    unittest.main()
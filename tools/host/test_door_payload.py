@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""Host tests of main/door_payload.c in both wire formats, each payload read
+back with tools/payload/decode_door_payload.py: transitions, reminders and
+replays, session events, batches that fill the payload, and wall clock
+stamps taken when the event is encoded.
+
+    python3 tools/host/test_door_payload.py
+    python3 -m unittest discover -s tools/host     (every host test)
+"""
+
+import os
+import sys
+import tempfile
+import unittest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, HERE)
+sys.path.insert(0, os.path.join(os.path.dirname(HERE), "payload"))
+from decode_door_payload import decode  # noqa: E402
+from door_payload import (BOUNCE, DELIVERY, FLAG_REMINDER, FLAG_REPLAY, FORMAT_BINARY, FORMAT_JSON,  # noqa: E402
+                          HOST_SOURCES, RETRIEVAL, SOURCES, PayloadEvent, bind, encode, session_event)
+from host_c import MAIN, build_library, evaluate, read_defines  # noqa: E402
+
+MAC = bytes.fromhex("a4cf12345678")
+WALL_OFFSET_US = 1_760_000_000_000_000
+DAY_US = 86_400_000_000
+PAYLOAD_MAX_LEN = evaluate(read_defines(os.path.join(MAIN, "outbox_config.h"))["OUTBOX_PAYLOAD_MAX_LEN"])
+
+
+def setUpModule():
+    global workdir, libs
+    workdir = tempfile.TemporaryDirectory()
+    libs = {}
+    for fmt, name in ((FORMAT_JSON, "json"), (FORMAT_BINARY, "binary")):
+        lib = bind(build_library(workdir.name, SOURCES, [f"DOOR_PAYLOAD_FORMAT={fmt}"], f"door_payload_{name}",
+                                 HOST_SOURCES))
+        lib.host_set_mac(MAC)
+        lib.init_door_payload()
+        lib.host_set_rssi(-61)
+        lib.host_set_clock(True, WALL_OFFSET_US)
+        libs[name] = lib
+
+
+def tearDownModule():
+    workdir.cleanup()
+
+
+class FormatTest(unittest.TestCase):
+    def roundtrip(self, events):
+        """Decoded payload of each format, the binary one's wall clock in whole seconds"""
+        decoded = {}
+        for name, lib in libs.items():
+            encoded, payload = encode(lib, events, 1024)
+            self.assertEqual(encoded, len(events), name)
+            decoded[name] = decode(payload)
+        for event in decoded["json"]["events"]:
+            event["ts"] -= event["ts"] % 1000
+        self.assertEqual(decoded["json"], decoded["binary"])
+        return decoded["json"]
+
+
+class TransitionTest(FormatTest):
+    def test_transitions_reminders_and_replays(self):
+        message = self.roundtrip([PayloadEvent(7, 1, 0, 5_000_000, 1200),
+                                  PayloadEvent(0, 1, FLAG_REMINDER, 65_000_000, 60000),
+                                  PayloadEvent(8, 0, FLAG_REPLAY, 70_000_000, 65000)])
+        self.assertEqual((message["door"], message["v"], message["dev"], message["rssi"]),
+                         ("closed", 1, MAC.hex(), -61))
+        self.assertEqual([e["door"] for e in message["events"]], ["open", "open", "closed"])
+        self.assertTrue(message["events"][1]["reminder"])
+        self.assertTrue(message["events"][2]["replay"])
+        self.assertEqual(message["events"][0]["ts"], (WALL_OFFSET_US + 5_000_000) // 1000)
+
+
+    def test_monotonic_time_past_49_days_does_not_wrap(self):
+        mono_us = 2**32 * 1000 + 50 * DAY_US
+        message = self.roundtrip([PayloadEvent(9, 1, 0, mono_us, 0)])
+        self.assertEqual(message["events"][0]["mono_ms"], mono_us // 1000)
+
+
+class SessionTest(FormatTest):
+    def test_session_event(self):
+        message = self.roundtrip([session_event(12, RETRIEVAL, 3_600_000_000, 41000, 2, 9000, 7000, 86_400_000)])
+        self.assertEqual(message["session"], "retrieval")
+        self.assertNotIn("door", message)
+        self.assertEqual(message["events"], [{"session": "retrieval", "seq": 12, "mono_ms": 3_600_000,
+                                              "ts": (WALL_OFFSET_US + 3_600_000_000) // 1_000_000 * 1000,
+                                              "span_ms": 41000, "opens": 2, "open_ms": 9000, "longest_ms": 7000,
+                                              "since_last_ms": 86_400_000}])
+
+    def test_first_session_has_no_previous_one(self):
+        message = self.roundtrip([session_event(0, DELIVERY, 1_000_000, 3000, 1, 3000, 3000, -1)])
+        self.assertEqual(message["events"][0]["since_last_ms"], -1)
+
+    def test_sessions_batch_with_transitions(self):
+        message = self.roundtrip([PayloadEvent(3, 1, FLAG_REPLAY, 1_000_000, 0),
+                                  session_event(4, BOUNCE, 2_000_000, 800, 3, 900, 400, 1000)])
+        self.assertEqual(message["session"], "bounce")
+        self.assertEqual([("door" in e, "session" in e) for e in message["events"]], [(True, False), (False, True)])
+
+    def test_largest_session_event_fits_an_outbox_payload(self):
+        event = session_event(0xFFFFFFFF, RETRIEVAL, 10 * 365 * DAY_US, 0xFFFFFFFF, 0xFFFF, 0xFFFFFFFF,
+                              0xFFFFFFFF, 2**32 - 2)
+        for name, lib in libs.items():
+            with self.subTest(format=name):
+                lib.host_set_rssi(-100)
+                encoded, payload = encode(lib, [event], PAYLOAD_MAX_LEN)
+                lib.host_set_rssi(-61)
+                self.assertEqual(encoded, 1)
+                self.assertLessEqual(len(payload), PAYLOAD_MAX_LEN)
+
+
+class BatchTest(unittest.TestCase):
+    def test_binary_sizes(self):
+        lib = libs["binary"]
+        self.assertEqual(len(encode(lib, [PayloadEvent(1, 1, 0, 0, 0)])[1]), 11 + 22)
+        self.assertEqual(len(encode(lib, [session_event(1, DELIVERY, 0, 0, 1, 0, 0, -1)])[1]), 11 + 36)
+
+    def test_batch_stops_at_the_payload_size(self):
+        events = [session_event(i + 1, DELIVERY, i * 1_000_000, 1000, 1, 1000, 1000, 5000) for i in range(8)]
+        for name, size in (("json", 600), ("binary", 120)):
+            with self.subTest(format=name):
+                encoded, payload = encode(libs[name], events, size)
+                self.assertGreater(encoded, 1)
+                self.assertLess(encoded, len(events))
+                self.assertLessEqual(len(payload), size)
+                self.assertEqual(len(decode(payload)["events"]), encoded)
+
+    def test_nothing_fits(self):
+        for name, lib in libs.items():
+            with self.subTest(format=name):
+                self.assertEqual(encode(lib, [session_event(1, DELIVERY, 0, 0, 1, 0, 0, -1)], 30)[0], 0)
+
+    def test_truncated_binary_session_is_refused(self):
+        payload = encode(libs["binary"], [session_event(1, DELIVERY, 0, 0, 1, 0, 0, -1)])[1]
+        with self.assertRaises(ValueError):
+            decode(payload[:-4])
+
+
+class ClockTest(unittest.TestCase):
+    def test_wall_clock_is_stamped_when_encoded(self):
+        event = session_event(5, DELIVERY, 2_000_000, 4000, 1, 4000, 4000, -1)
+        for name, lib in libs.items():
+            with self.subTest(format=name):
+                lib.host_set_clock(False, 0)
+                self.assertEqual(decode(encode(lib, [event])[1])["events"][0]["ts"], 0)
+                lib.host_set_clock(True, WALL_OFFSET_US)
+                self.assertEqual(decode(encode(lib, [event])[1])["events"][0]["ts"] // 1000,
+                                 (WALL_OFFSET_US + 2_000_000) // 1_000_000)
+
+
+if __name__ == "__main__":
+    unittest.main()
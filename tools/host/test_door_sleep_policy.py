@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""Host tests of main/door_sleep_policy.c: what a wake publishes, when the
+next reminder wake is due, and a run of random wakes against a model.
+
+    python3 tools/host/test_door_sleep_policy.py
+    python3 -m unittest discover -s tools/host     (every host test)
+"""
+
+import ctypes
+import os
+import random
+import sys
+import tempfile
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from host_c import build_library  # noqa: E402
+from sleep_policy import (ACTION_NONE, ACTION_REMINDER, ACTION_TRANSITION, MAX_SENSORS, NO_WAKE,  # noqa: E402
+                          SOURCES, Policy, SleepPolicyState, bind)
+
+OPEN, CLOSED = 1, 0
+S = 1000000
+REMINDER_MS = 300000
+REMINDER_US = REMINDER_MS * 1000
+EARLY_US = 500000  # SLEEP_POLICY_EARLY_US
+
+
+def setUpModule():
+    global workdir, lib
+    workdir = tempfile.TemporaryDirectory()
+    lib = bind(build_library(workdir.name, SOURCES, name="sleep_policy"))
+
+
+def tearDownModule():
+    workdir.cleanup()
+
+
+class ValidityTest(unittest.TestCase):
+    def test_reset_state_is_valid_for_its_sensor_count(self):
+        policy = Policy(lib, 2)
+        self.assertTrue(policy.valid(2))
+        self.assertFalse(policy.valid(3))
+
+    def test_blank_rtc_memory_is_invalid(self):
+        self.assertFalse(lib.sleep_policy_valid(ctypes.byref(SleepPolicyState()), 0))
+
+
+class WakeTest(unittest.TestCase):
+    def setUp(self):
+        self.policy = Policy(lib, 2)
+
+    def test_first_wake_publishes_every_sensor(self):
+        for state in (OPEN, CLOSED):
+            self.assertEqual(self.policy.on_wake(0, state, 0), ACTION_TRANSITION)
+            self.assertEqual(self.policy.on_wake(1, state, 0), ACTION_TRANSITION)
+        self.assertEqual(self.policy.next_wake_us(), NO_WAKE)
+
+    def test_unchanged_closed_door_publishes_nothing(self):
+        self.policy.reported(0, CLOSED, REMINDER_MS, 0)
+        self.assertEqual(self.policy.on_wake(0, CLOSED, 3600 * S), ACTION_NONE)
+        self.assertEqual(self.policy.on_wake(0, OPEN, 3600 * S), ACTION_TRANSITION)
+        self.assertEqual(self.policy.next_wake_us(), NO_WAKE)
+
+    def test_open_door_reminder_is_due_after_the_period(self):
+        self.policy.reported(0, OPEN, REMINDER_MS, 10 * S)
+        self.assertEqual(self.policy.next_wake_us(), 10 * S + REMINDER_US)
+        self.assertEqual(self.policy.on_wake(0, OPEN, 10 * S + REMINDER_US - EARLY_US - 1), ACTION_NONE)
+        # A timer wake may come up slightly early
+        self.assertEqual(self.policy.on_wake(0, OPEN, 10 * S + REMINDER_US - EARLY_US), ACTION_REMINDER)
+        self.assertEqual(self.policy.on_wake(0, OPEN, 10 * S + 2 * REMINDER_US), ACTION_REMINDER)
+        self.assertEqual(self.policy.on_wake(0, CLOSED, 10 * S + REMINDER_US), ACTION_TRANSITION)
+
+    def test_reminder_reschedules_from_when_it_was_published(self):
+        self.policy.reported(0, OPEN, REMINDER_MS, 0)
+        self.policy.reported(0, OPEN, REMINDER_MS, REMINDER_US + 3 * S)
+        self.assertEqual(self.policy.next_wake_us(), 2 * REMINDER_US + 3 * S)
+
+    def test_closing_cancels_the_reminder(self):
+        self.policy.reported(0, OPEN, REMINDER_MS, 0)
+        self.policy.reported(0, CLOSED, REMINDER_MS, 5 * S)
+        self.assertEqual(self.policy.next_wake_us(), NO_WAKE)
+        self.assertEqual(self.policy.on_wake(0, CLOSED, REMINDER_US), ACTION_NONE)
+
+    def test_no_reminder_period_means_no_timer_wake(self):
+        self.policy.reported(0, OPEN, 0, 0)
+        self.assertEqual(self.policy.next_wake_us(), NO_WAKE)
+        self.assertEqual(self.policy.on_wake(0, OPEN, 10 * REMINDER_US), ACTION_NONE)
+
+    def test_next_wake_is_the_earliest_reminder(self):
+        self.policy.reported(0, OPEN, REMINDER_MS, 20 * S)
+        self.policy.reported(1, OPEN, 60000, 30 * S)
+        self.assertEqual(self.policy.next_wake_us(), 30 * S + 60 * S)
+        self.policy.reported(1, CLOSED, 60000, 40 * S)
+        self.assertEqual(self.policy.next_wake_us(), 20 * S + REMINDER_US)
+
+    def test_sensor_out_of_range_is_ignored(self):
+        self.assertEqual(self.policy.on_wake(2, OPEN, 0), ACTION_NONE)
+        self.policy.reported(2, OPEN, REMINDER_MS, 0)
+        self.assertEqual(self.policy.next_wake_us(), NO_WAKE)
+        self.assertEqual(self.policy.on_wake(MAX_SENSORS, OPEN, 0), ACTION_NONE)
+
+
+class RandomWakesTest(unittest.TestCase):
+    def test_against_a_model(self):
+        """Wakes at random times with random door states. Every change is
+        published exactly once, and an open door is reminded once per period
+        and never sooner."""
+        rng = random.Random(13)
+        sensors = 3
+        periods = [REMINDER_MS, 60000, 0]
+        policy = Policy(lib, sensors)
+        published = [None] * sensors
+        last_publish_us = [0] * sensors
+        now_us = 0
+
+        for _ in range(5000):
+            next_wake = policy.next_wake_us()
+            # The timer wake, or a door wake before it
+            if next_wake != NO_WAKE and rng.random() < 0.5:
+                now_us = max(now_us, next_wake - rng.randrange(EARLY_US))
+            else:
+                now_us += rng.randrange(1, 2 * REMINDER_US)
+            states = [rng.choice((OPEN, CLOSED)) if rng.random() < 0.3 else (published[i] or CLOSED)
+                      for i in range(sensors)]
+
+            for i, state in enumerate(states):
+                action = policy.on_wake(i, state, now_us)
+                if state != published[i]:
+                    self.assertEqual(action, ACTION_TRANSITION)
+                elif state == OPEN and periods[i] and now_us + EARLY_US >= last_publish_us[i] + periods[i] * 1000:
+                    self.assertEqual(action, ACTION_REMINDER)
+                else:
+                    self.assertEqual(action, ACTION_NONE)
+                if action != ACTION_NONE:
+                    policy.reported(i, state, periods[i], now_us)
+                    published[i] = state
+                    last_publish_us[i] = now_us
+
+            due = [last_publish_us[i] + periods[i] * 1000 for i in range(sensors)
+                   if published[i] == OPEN and periods[i]]
+            self.assertEqual(policy.next_wake_us(), min(due) if due else NO_WAKE)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""Host tests of tools/host/fleet_host.c, the mailbox tools/broker/harness.py
+simulates in fleet mode: mqtt_router.c subscribes the OTA routes, hands a
+manifest larger than the MQTT buffer to ota_manifest_scanner.c chunk by chunk
+and a per-device command over whole.
+
+    python3 tools/host/test_fleet_device.py
+    python3 -m unittest discover -s tools/host     (every host test)
+"""
+
+import json
+import os
+import sys
+import tempfile
+import unittest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, HERE)
+sys.path.insert(0, os.path.join(os.path.dirname(HERE), "ota"))
+from fleet_device import (COMMAND_MAX_LEN, HOST_SOURCES, MQTT_BUFFER_SIZE, SCAN_ERROR, SCAN_FOUND,  # noqa: E402
+                          SCAN_NOT_FOUND, SOURCES, FleetDevice)
+from host_c import build_library, load_copy  # noqa: E402
+from ota_command import command_topic  # noqa: E402
+
+OTA_TOPIC = "mailbox/ota"
+MAC = "02:00:00:00:07:01"
+
+
+def setUpModule():
+    global workdir, lib, copies
+    workdir = tempfile.TemporaryDirectory()
+    lib = build_library(workdir.name, SOURCES, name="fleet_device", host_sources=HOST_SOURCES)
+    copies = 0
+
+
+def tearDownModule():
+    workdir.cleanup()
+
+
+def device(mac=MAC):
+    global copies
+    copies += 1
+    return FleetDevice(load_copy(lib, f"fleet_device_{copies}"), mac, OTA_TOPIC)
+
+
+def manifest(count, url="http://ota.invalid/{}.bin"):
+    macs = [f"02:00:00:00:{i >> 8:02x}:{i & 0xff:02x}" for i in range(count)]
+    return json.dumps({mac: url.format(mac.replace(":", "")) for mac in macs})
+
+
+class FleetDeviceTest(unittest.TestCase):
+    def test_subscribes_the_device_topic_and_the_manifest(self):
+        self.assertEqual(device().subscriptions(), [(command_topic(OTA_TOPIC, MAC), 1), (OTA_TOPIC, 0)])
+
+    def test_manifest_larger_than_the_buffer_is_scanned_in_chunks(self):
+        payload = manifest(2000)
+        self.assertGreater(len(payload), 50 * MQTT_BUFFER_SIZE)
+        for chunk in (MQTT_BUFFER_SIZE, 7, len(payload)):
+            with self.subTest(chunk=chunk):
+                sim = device()
+                sim.deliver(OTA_TOPIC, payload, chunk)
+                result = sim.result()
+                self.assertEqual((result.manifests, result.scan_result), (1, SCAN_FOUND))
+                self.assertEqual(result.url, b"http://ota.invalid/020000000701.bin")
+
+    def test_manifest_without_the_mac_is_not_found(self):
+        sim = device("02:00:00:00:ff:01")
+        sim.deliver(OTA_TOPIC, manifest(300))
+        self.assertEqual((sim.result().manifests, sim.result().scan_result), (1, SCAN_NOT_FOUND))
+
+    def test_truncated_manifest_is_an_error(self):
+        sim = device("02:00:00:00:ff:01")
+        sim.deliver(OTA_TOPIC, manifest(300)[:-1])
+        self.assertEqual(sim.result().scan_result, SCAN_ERROR)
+
+    def test_command_is_reassembled_and_other_devices_ignored(self):
+        sim = device()
+        command = json.dumps({"url": "http://ota.invalid/x.mbz", "sha256": "ab" * 32, "version": "v9"})
+        sim.deliver(command_topic(OTA_TOPIC, "02:00:00:00:07:02"), command)
+        sim.deliver(command_topic(OTA_TOPIC, MAC), command, 50)
+        self.assertEqual((sim.result().commands, sim.result().command), (1, command.encode()))
+        sim.deliver(command_topic(OTA_TOPIC, MAC), "x" * COMMAND_MAX_LEN)
+        self.assertEqual(sim.result().commands, 1)
+        self.assertEqual(sim.result().manifests, 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
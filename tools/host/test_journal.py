@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""Host tests of main/door_journal.c on a file-backed NOR flash emulator,
+including power cuts in the middle of a record and of an erase.
+
+    python3 tools/host/test_journal.py
+    python3 -m unittest discover -s tools/host     (every host test)
+"""
+
+import os
+import random
+import sys
+import tempfile
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from host_c import MAIN, build_library, evaluate, read_defines  # noqa: E402
+from journal import ESP_OK, HOST_SOURCES, RECORD_SIZE, SOURCES, Journal, bind  # noqa: E402
+
+SECTOR_SIZE = 256
+SECTORS = 4
+SLOTS_PER_SECTOR = SECTOR_SIZE // RECORD_SIZE
+BATCH = evaluate(read_defines(os.path.join(MAIN, "journal_config.h"))["JOURNAL_WRITE_BATCH"])
+
+
+def setUpModule():
+    global workdir, lib
+    workdir = tempfile.TemporaryDirectory()
+    lib = bind(build_library(workdir.name, SOURCES, name="journal", host_sources=HOST_SOURCES))
+
+
+def tearDownModule():
+    workdir.cleanup()
+
+
+class JournalTest(unittest.TestCase):
+    def setUp(self):
+        self.path = os.path.join(workdir.name, f"{self.id()}.bin")
+        self.journal = Journal(lib, self.path, SECTOR_SIZE * SECTORS, SECTOR_SIZE)
+        self.remount()
+
+    def remount(self):
+        self.assertEqual(self.journal.mount(), ESP_OK)
+
+    def append(self, count):
+        """Appends count events and returns their seqs; every BATCH-th one flushes"""
+        return [self.journal.append(seq % 3, seq % 2, seq * 1000) for seq in range(count)]
+
+    def fill_ring_to_wrap(self):
+        """Appends unacknowledged batches until the next batch ends exactly at
+        the end of the ring, so its erase-ahead wraps to sector 0"""
+        self.append(SLOTS_PER_SECTOR * SECTORS - BATCH)
+
+    def has_blank_slot(self):
+        image = self.journal.image()
+        return any(image[i:i + RECORD_SIZE] == b"\xff" * RECORD_SIZE for i in range(0, len(image), RECORD_SIZE))
+
+    def blank_sectors(self):
+        image = self.journal.image()
+        return sum(image[i:i + SECTOR_SIZE] == b"\xff" * SECTOR_SIZE for i in range(0, len(image), SECTOR_SIZE))
+
+
+class MountTest(JournalTest):
+    def test_flushed_events_survive_a_remount(self):
+        self.journal.append(2, 1, 1234)
+        self.journal.append(0, 0, 5678)
+        self.assertEqual(self.journal.flush(), ESP_OK)
+        self.remount()
+        self.assertEqual(self.journal.pending(), [(1, 2, 1, 1234), (2, 0, 0, 5678)])
+        self.assertEqual(self.journal.stats().next_seq, 3)
+        self.assertTrue(self.journal.replay_needed())
+
+    def test_ack_watermark_is_recovered(self):
+        self.append(6)
+        self.journal.ack(2)
+        self.journal.flush()
+        self.journal.ack(4)
+        self.journal.flush()
+        self.remount()
+        stats = self.journal.stats()
+        self.assertEqual((stats.acked_seq, stats.next_seq), (4, 7))
+        self.assertEqual(self.journal.pending_seqs(), [5, 6])
+
+    def test_unflushed_ack_is_replayed_again(self):
+        self.append(4)
+        self.journal.flush()
+        self.journal.ack(4)
+        self.remount()
+        self.assertEqual(self.journal.pending_seqs(), [1, 2, 3, 4])
+
+    def test_delivered_events_do_not_come_back(self):
+        for seq in self.append(5):
+            self.journal.mark_delivered(seq)
+        self.journal.flush()
+        self.remount()
+        self.assertEqual(self.journal.pending_seqs(), [])
+        self.assertFalse(self.journal.replay_needed())
+        self.assertEqual(self.journal.stats().next_seq, 6)
+
+
+class WraparoundTest(JournalTest):
+    def test_erase_ahead_keeps_a_slot_blank_on_every_lap(self):
+        for lap in range(4 * SECTORS):
+            seqs = self.append(SLOTS_PER_SECTOR)
+            self.journal.ack(seqs[-1])
+            self.journal.flush()
+            self.assertTrue(self.has_blank_slot())
+            self.remount()
+            self.assertEqual(self.journal.stats().next_seq, seqs[-1] + 1)
+            self.assertEqual(self.journal.pending_seqs(), [])
+        self.assertEqual(self.journal.stats().overwritten, 0)
+
+    def test_pending_events_read_back_in_order_across_the_wrap(self):
+        acked = self.append(2 * SLOTS_PER_SECTOR)
+        self.journal.ack(acked[-1])
+        seqs = self.append(SLOTS_PER_SECTOR + BATCH)  # Crosses the end of the ring
+        self.journal.flush()
+        self.remount()
+        self.assertEqual(self.journal.pending_seqs(), seqs)
+
+    def test_wrapping_over_unacknowledged_events_counts_them(self):
+        seqs = self.append(6 * SLOTS_PER_SECTOR)
+        pending = self.journal.pending_seqs()
+        self.assertEqual(pending, seqs[-len(pending):])
+        self.assertEqual(self.journal.stats().overwritten, len(seqs) - len(pending))
+
+    def test_ack_watermark_matches_a_model_through_random_reboots(self):
+        rng = random.Random(4)
+        flushed, unflushed, acked, durable, newest = [], [], 0, 0, 0
+        for _ in range(3000):
+            op = rng.random()
+            if op < 0.6:
+                unflushed.append(self.journal.append(0, 1, 0))
+                if len(unflushed) >= BATCH:
+                    flushed, unflushed, durable = flushed + unflushed, [], acked
+                    newest = flushed[-1]
+            elif op < 0.7:
+                self.journal.flush()
+                flushed, unflushed, durable = flushed + unflushed, [], acked
+                newest = flushed[-1] if flushed else newest
+            elif op < 0.9 and newest > acked:
+                # Keep the unacknowledged tail inside the ring so nothing is overwritten
+                acked = rng.randint(max(acked, newest - SLOTS_PER_SECTOR), newest)
+                self.journal.ack(acked)
+            elif op < 0.95:
+                self.remount()
+                unflushed, acked = [], durable
+                flushed = [seq for seq in flushed if seq > acked]
+                self.assertEqual(self.journal.stats().next_seq, max(newest, acked) + 1)
+            else:
+                flushed, unflushed, durable = flushed + unflushed, [], acked
+                newest = flushed[-1] if flushed else newest
+                self.assertEqual(self.journal.pending_seqs(), [seq for seq in flushed if seq > acked])
+            if unflushed:
+                self.assertEqual(unflushed, list(range(unflushed[0], unflushed[0] + len(unflushed))))
+        self.assertEqual(self.journal.stats().overwritten, 0)
+
+
+class PowerCutTest(JournalTest):
+    def test_torn_record_is_skipped_and_writing_resumes_after_it(self):
+        self.append(3)
+        self.journal.flush()
+        self.journal.cut_power(2 * RECORD_SIZE + 5)
+        self.append(BATCH)  # Seqs 4..11, power fails inside seq 6
+        self.remount()
+        self.assertEqual(self.journal.pending_seqs(), [1, 2, 3, 4, 5])
+        self.assertEqual(self.journal.stats().next_seq, 6)
+
+        seqs = self.append(2)
+        self.journal.flush()
+        self.remount()
+        self.assertEqual(self.journal.pending_seqs(), [1, 2, 3, 4, 5] + seqs)
+
+    def test_half_erased_sector_is_erased_again_on_mount(self):
+        self.fill_ring_to_wrap()
+        self.journal.cut_power(BATCH * RECORD_SIZE + SECTOR_SIZE // 3)
+        self.append(BATCH)  # Ends the ring, then the erase of sector 0 is cut short
+        self.remount()
+        self.assertEqual(self.blank_sectors(), 1)
+        expected = list(range(SLOTS_PER_SECTOR + 1, SLOTS_PER_SECTOR * SECTORS + 1))
+        self.assertEqual(self.journal.pending_seqs(), expected)
+
+        seqs = self.append(BATCH)
+        self.journal.flush()
+        self.remount()
+        self.assertEqual(self.journal.pending_seqs(), expected + seqs)
+
+    def test_cut_before_erase_ahead_resumes_after_the_newest_record(self):
+        self.fill_ring_to_wrap()
+        self.append(SLOTS_PER_SECTOR)  # Wraps into sector 0, seqs up to 72
+        self.journal.cut_power(BATCH * RECORD_SIZE)
+        self.append(BATCH)  # Fills sector 0, then the erase of sector 1 never starts
+        self.assertEqual(self.blank_sectors(), 0)
+        self.remount()
+        newest = SLOTS_PER_SECTOR * (SECTORS + 1)
+        expected = list(range(2 * SLOTS_PER_SECTOR + 1, newest + 1))
+        self.assertEqual(self.journal.pending_seqs(), expected)
+        self.assertEqual(self.journal.stats().next_seq, newest + 1)
+
+        seqs = self.append(BATCH)
+        self.journal.flush()
+        self.remount()
+        self.assertEqual(self.journal.pending_seqs(), expected + seqs)
+
+
+if __name__ == "__main__":
+    unittest.main()
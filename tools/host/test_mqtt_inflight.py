@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""Host tests of main/mqtt_inflight.c: PUBACKs that overtake the msg_id
+returned by esp_mqtt_client_publish(), ack timeouts and what the door journal
+is told.
+
+    python3 tools/host/test_mqtt_inflight.py
+    python3 -m unittest discover -s tools/host     (every host test)
+"""
+
+import ctypes
+import os
+import shutil
+import sys
+import tempfile
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from host_c import build_library  # noqa: E402
+from mqtt_inflight import (ACK_TIMEOUT_US, EARLY_ACKS, HOST_SOURCES, MAX_MSGS, NO_SLOT, SOURCES,  # noqa: E402
+                           Inflight, bind)
+
+
+def setUpModule():
+    global workdir, built
+    workdir = tempfile.TemporaryDirectory()
+    build_library(workdir.name, SOURCES, name="mqtt_inflight", host_sources=HOST_SOURCES)
+    built = os.path.join(workdir.name, "mqtt_inflight.so")
+
+
+def tearDownModule():
+    workdir.cleanup()
+
+
+class InflightTest(unittest.TestCase):
+    loaded = 0
+
+    def setUp(self):
+        # The table is module state, so every test loads its own copy
+        InflightTest.loaded += 1
+        copy = os.path.join(workdir.name, f"mqtt_inflight_{InflightTest.loaded}.so")
+        shutil.copy(built, copy)
+        self.inflight = Inflight(bind(ctypes.CDLL(copy)))
+
+    def publish(self, msg_id, seq=0, replay=False):
+        handle = self.inflight.reserve(seq, replay=replay)
+        self.assertNotEqual(handle, NO_SLOT)
+        self.inflight.commit(handle, msg_id)
+        return handle
+
+
+class EarlyAckTest(InflightTest):
+    def test_puback_before_commit_is_matched(self):
+        handle = self.inflight.reserve(first_seq=1)
+        self.inflight.puback(7)
+        self.assertEqual(self.inflight.stats().acked, 0)
+        self.inflight.commit(handle, 7)
+
+        stats = self.inflight.stats()
+        self.assertEqual((stats.acked, stats.unknown_acks, stats.in_flight), (1, 0, 0))
+        self.assertEqual(self.inflight.calls().delivered_through, 1)
+
+    def test_matched_early_ack_never_times_out(self):
+        handle = self.inflight.reserve(first_seq=1)
+        self.inflight.puback(7)
+        self.inflight.commit(handle, 7)
+        self.inflight.sweep(2 * ACK_TIMEOUT_US)
+        self.assertEqual(self.inflight.stats().timeouts, 0)
+        self.assertEqual(self.inflight.calls().failed_seq, 0)
+
+    def test_early_acks_for_several_pending_publishes(self):
+        handles = [self.inflight.reserve(first_seq=seq) for seq in (1, 2, 3)]
+        for msg_id in (12, 11, 13):
+            self.inflight.puback(msg_id)
+        for handle, msg_id in zip(handles, (11, 12, 13)):
+            self.inflight.commit(handle, msg_id)
+        stats = self.inflight.stats()
+        self.assertEqual((stats.acked, stats.unknown_acks, stats.in_flight), (3, 0, 0))
+        self.assertEqual(self.inflight.calls().delivered_through, 3)
+
+    def test_unmatched_early_ack_counts_as_unknown_once_nothing_is_pending(self):
+        handle = self.inflight.reserve(first_seq=1)
+        self.inflight.puback(99)
+        self.inflight.commit(handle, 7)
+        stats = self.inflight.stats()
+        self.assertEqual((stats.acked, stats.unknown_acks, stats.in_flight), (0, 1, 1))
+        self.inflight.puback(7)
+        self.assertEqual(self.inflight.stats().acked, 1)
+
+    def test_buffer_overflow_counts_the_oldest_as_unknown(self):
+        handle = self.inflight.reserve(first_seq=1)
+        for msg_id in range(100, 100 + EARLY_ACKS + 1):
+            self.inflight.puback(msg_id)
+        self.assertEqual(self.inflight.stats().unknown_acks, 1)
+        self.inflight.commit(handle, 100 + EARLY_ACKS)
+        stats = self.inflight.stats()
+        self.assertEqual((stats.acked, stats.unknown_acks), (1, EARLY_ACKS))
+
+    def test_puback_with_nothing_pending_is_unknown(self):
+        self.inflight.puback(5)
+        self.assertEqual(self.inflight.stats().unknown_acks, 1)
+
+    def test_cancel_releases_the_slot(self):
+        handle = self.inflight.reserve(first_seq=4)
+        self.inflight.puback(3)
+        self.inflight.cancel(handle)
+        stats = self.inflight.stats()
+        self.assertEqual((stats.tracked, stats.in_flight, stats.unknown_acks), (0, 0, 1))
+        self.inflight.sweep(2 * ACK_TIMEOUT_US)
+        self.assertEqual(self.inflight.stats().timeouts, 0)
+
+    def test_full_table(self):
+        for i in range(MAX_MSGS):
+            self.publish(i + 1)
+        self.assertEqual(self.inflight.reserve(), NO_SLOT)
+        self.assertEqual(self.inflight.stats().untracked, 1)
+
+
+class TimeoutTest(InflightTest):
+    def test_untracked_qos1_timeout_is_only_counted(self):
+        self.publish(7)
+        self.inflight.sweep(ACK_TIMEOUT_US)
+        stats = self.inflight.stats()
+        calls = self.inflight.calls()
+        self.assertEqual((stats.timeouts, stats.journaled, stats.in_flight), (1, 0, 0))
+        # esp-mqtt resends it with DUP set; nothing is published again from here
+        self.assertEqual((calls.enqueued, calls.replay_requests, calls.failed_seq), (0, 0, 0))
+
+    def test_journaled_timeout_goes_to_replay(self):
+        self.publish(7, seq=5)
+        self.inflight.sweep(ACK_TIMEOUT_US - 1)
+        self.assertEqual(self.inflight.stats().timeouts, 0)
+        self.inflight.sweep(ACK_TIMEOUT_US)
+        calls = self.inflight.calls()
+        self.assertEqual((calls.failed_seq, calls.replay_requests), (5, 1))
+        self.assertEqual(self.inflight.stats().journaled, 1)
+
+    def test_pending_reservation_does_not_time_out(self):
+        handle = self.inflight.reserve(first_seq=5)
+        self.inflight.sweep(2 * ACK_TIMEOUT_US)
+        self.assertEqual(self.inflight.stats().timeouts, 0)
+        # A slow publish still gets the full timeout from its commit
+        self.inflight.commit(handle, 7)
+        self.inflight.sweep(3 * ACK_TIMEOUT_US - 1)
+        self.assertEqual(self.inflight.stats().timeouts, 0)
+        self.inflight.sweep(3 * ACK_TIMEOUT_US)
+        self.assertEqual(self.inflight.stats().timeouts, 1)
+
+
+class JournalAckTest(InflightTest):
+    def test_out_of_order_pubacks_deliver_up_to_the_oldest_outstanding(self):
+        for msg_id, seq in ((1, 1), (2, 2), (3, 3)):
+            self.publish(msg_id, seq)
+        self.inflight.puback(3)
+        self.assertEqual(self.inflight.calls().delivered_through, 0)
+        self.inflight.puback(1)
+        self.assertEqual(self.inflight.calls().delivered_through, 1)
+        self.inflight.puback(2)
+        self.assertEqual(self.inflight.calls().delivered_through, 3)
+
+    def test_confirmed_replay_batch_requests_the_next(self):
+        self.publish(1, seq=10, replay=True)
+        self.publish(2, seq=11, replay=True)
+        self.assertTrue(self.inflight.lib.mqtt_inflight_replay_pending())
+        self.inflight.puback(1)
+        self.assertEqual(self.inflight.calls().replay_requests, 0)
+        self.inflight.puback(2)
+        calls = self.inflight.calls()
+        self.assertEqual((calls.acked_through, calls.replay_requests), (11, 1))
+
+    def test_early_ack_completes_a_replay_batch(self):
+        handle = self.inflight.reserve(first_seq=10, replay=True)
+        self.inflight.puback(4)
+        self.inflight.commit(handle, 4)
+        calls = self.inflight.calls()
+        self.assertEqual((calls.acked_through, calls.replay_requests), (10, 1))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+"""Host tests of main/mqtt_outbox.c with its task running on the host
+scheduler: nothing leaves before mqtt_outbox_start(), slots come back once
+sent, a full outbox drops and counts, door events for one topic are coalesced
+through door_payload_encode(), and mqtt_outbox_get_stats() adds up.
+
+    python3 tools/host/test_mqtt_outbox.py
+    python3 -m unittest discover -s tools/host     (every host test)
+"""
+
+import os
+import sys
+import tempfile
+import unittest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, HERE)
+sys.path.insert(0, os.path.join(os.path.dirname(HERE), "payload"))
+from decode_door_payload import decode  # noqa: E402
+from door_payload import FLAG_SESSION, PayloadEvent  # noqa: E402
+from host_c import MAIN, build_library, evaluate, load_copy, read_defines  # noqa: E402
+from mqtt_outbox import HOST_SOURCES, MAX_BATCH, PUBLISH_RETRIES, QUEUE_SIZE, SOURCES, Outbox, bind  # noqa: E402
+
+PAYLOAD_MAX_LEN = evaluate(read_defines(os.path.join(MAIN, "outbox_config.h"))["OUTBOX_PAYLOAD_MAX_LEN"])
+
+TOPIC = "mailbox/door"
+START_US = 10_000_000
+
+
+def setUpModule():
+    global workdir, built, copies
+    workdir = tempfile.TemporaryDirectory()
+    built = build_library(workdir.name, SOURCES, name="mqtt_outbox", host_sources=HOST_SOURCES)
+    copies = 0
+
+
+def tearDownModule():
+    workdir.cleanup()
+
+
+def new_outbox():
+    """An initialized outbox in a fresh copy of the library, since its state is static"""
+    global copies
+    copies += 1
+    lib = bind(load_copy(built, f"mqtt_outbox_{copies}"))
+    lib.host_set_time_us(START_US)
+    return Outbox(lib)
+
+
+def door_event(seq, state, mono_us=START_US, flags=0):
+    return PayloadEvent(seq, state, flags, mono_us, 0)
+
+
+class StartTest(unittest.TestCase):
+    def test_nothing_is_published_before_start(self):
+        outbox = new_outbox()
+        self.assertTrue(outbox.enqueue(TOPIC + "/clock", '{"a":1}'))
+        self.assertTrue(outbox.enqueue_door_event(TOPIC, door_event(1, 1)))
+        outbox.run(1_000_000)
+        self.assertEqual(outbox.published(), [])
+        self.assertEqual((outbox.stats().enqueued, outbox.stats().depth), (2, 2))
+
+        outbox.start()
+        outbox.run()
+        self.assertEqual([(topic, qos) for topic, _, qos, _ in outbox.published()],
+                         [(TOPIC + "/clock", 1), (TOPIC, 1)])
+        self.assertEqual(outbox.published()[0][1], b'{"a":1}')
+        self.assertEqual(outbox.stats().depth, 0)
+
+    def test_published_in_enqueue_order(self):
+        outbox = new_outbox()
+        outbox.start()
+        for i in range(5):
+            outbox.enqueue(f"{TOPIC}/{i}", str(i))
+        outbox.run()
+        self.assertEqual([payload for _, payload, _, _ in outbox.published()], [b"0", b"1", b"2", b"3", b"4"])
+
+
+class SlotTest(unittest.TestCase):
+    def test_slots_are_released_once_sent(self):
+        outbox = new_outbox()
+        outbox.start()
+        for round_ in range(3):
+            for i in range(QUEUE_SIZE):
+                self.assertTrue(outbox.enqueue(TOPIC + "/x", f"{round_}.{i}"))
+            outbox.run()
+        self.assertEqual(len(outbox.published()), 3 * QUEUE_SIZE)
+        self.assertEqual((outbox.stats().dropped, outbox.stats().depth_high_water), (0, QUEUE_SIZE))
+
+    def test_full_outbox_drops_and_counts(self):
+        outbox = new_outbox()
+        for i in range(QUEUE_SIZE):
+            self.assertTrue(outbox.enqueue(TOPIC + "/x", str(i)))
+        self.assertFalse(outbox.enqueue(TOPIC + "/x", "late"))
+        self.assertFalse(outbox.enqueue_door_event(TOPIC, door_event(42, 1)))
+
+        stats, calls = outbox.stats(), outbox.calls()
+        self.assertEqual((stats.enqueued, stats.dropped, stats.depth), (QUEUE_SIZE, 2, QUEUE_SIZE))
+        # A dropped door event is left to the journal replay
+        self.assertEqual(calls.failed_seq, 42)
+
+        outbox.start()
+        outbox.run()
+        self.assertEqual(len(outbox.published()), QUEUE_SIZE)
+        self.assertTrue(outbox.enqueue(TOPIC + "/x", "room again"))
+
+    def test_oversized_message_is_refused_without_taking_a_slot(self):
+        outbox = new_outbox()
+        self.assertFalse(outbox.enqueue(TOPIC, "x" * 4096))
+        self.assertEqual((outbox.stats().enqueued, outbox.stats().dropped), (0, 0))
+
+
+class CoalesceTest(unittest.TestCase):
+    def test_queued_door_events_for_one_topic_share_a_publish(self):
+        outbox = new_outbox()
+        for seq in range(1, 4):
+            outbox.enqueue_door_event(TOPIC, door_event(seq, seq % 2, START_US + seq * 1000))
+        outbox.start()
+        outbox.run()
+
+        publishes = outbox.published()
+        self.assertEqual(len(publishes), 1)
+        message = decode(publishes[0][1])
+        self.assertEqual([(e["seq"], e["door"]) for e in message["events"]],
+                         [(1, "open"), (2, "closed"), (3, "open")])
+        calls = outbox.calls()
+        self.assertEqual((calls.reserved, calls.committed), (1, 1))
+        self.assertEqual((calls.reserved_first_seq, calls.reserved_last_seq), (1, 3))
+
+        stats = outbox.stats()
+        self.assertEqual((stats.enqueued, stats.sent, stats.door_events), (3, 1, 3))
+        self.assertEqual(stats.door_payload_bytes, len(publishes[0][1]))
+
+    def test_batches_split_at_max_batch_and_payload_size(self):
+        outbox = new_outbox()
+        for seq in range(1, MAX_BATCH + 3):
+            outbox.enqueue_door_event(TOPIC, door_event(seq, seq % 2))
+        outbox.start()
+        outbox.run()
+
+        payloads = [payload for _, payload, _, _ in outbox.published()]
+        self.assertTrue(all(len(p) <= PAYLOAD_MAX_LEN for p in payloads))
+        seqs = [[e["seq"] for e in decode(p)["events"]] for p in payloads]
+        self.assertEqual(sum(seqs, []), list(range(1, MAX_BATCH + 3)))
+        # The events past MAX_BATCH were taken off the queue separately
+        self.assertIn(MAX_BATCH + 1, [s[0] for s in seqs])
+        self.assertEqual(outbox.stats().door_events, MAX_BATCH + 2)
+
+    def test_other_topics_and_plain_messages_end_a_batch(self):
+        outbox = new_outbox()
+        outbox.enqueue_door_event(TOPIC, door_event(1, 1))
+        outbox.enqueue_door_event(TOPIC + "/locker", door_event(2, 1))
+        outbox.enqueue(TOPIC + "/clock", "{}")
+        outbox.enqueue_door_event(TOPIC, door_event(3, 0))
+        outbox.start()
+        outbox.run()
+        self.assertEqual([topic for topic, _, _, _ in outbox.published()],
+                         [TOPIC, TOPIC + "/locker", TOPIC + "/clock", TOPIC])
+
+    def test_event_after_the_batch_left_goes_on_its_own(self):
+        outbox = new_outbox()
+        outbox.start()
+        outbox.enqueue_door_event(TOPIC, door_event(1, 1))
+        outbox.run(1000)
+        outbox.enqueue_door_event(TOPIC, door_event(2, 0))
+        outbox.run()
+        self.assertEqual([len(decode(p)["events"]) for _, p, _, _ in outbox.published()], [1, 1])
+
+
+class StatsTest(unittest.TestCase):
+    def test_latency_counts_from_enqueue_and_from_the_edge(self):
+        outbox = new_outbox()
+        outbox.lib.host_set_time_us(START_US + 2000)
+        outbox.enqueue_door_event(TOPIC, door_event(1, 1, START_US))
+        outbox.lib.host_set_time_us(START_US + 50_000)
+        outbox.start()
+        outbox.run()
+        stats = outbox.stats()
+        self.assertEqual((stats.last_latency_us, stats.max_latency_us), (48_000, 48_000))
+        self.assertEqual(stats.last_origin_latency_us, 50_000)
+
+    def test_session_latency_counts_from_enqueue(self):
+        outbox = new_outbox()
+        outbox.start()
+        outbox.enqueue_door_event(TOPIC + "/session", door_event(1, 0, START_US - 60_000_000, FLAG_SESSION))
+        outbox.run()
+        self.assertEqual(outbox.stats().last_origin_latency_us, 0)
+
+    def test_failed_publish_is_retried_then_left_to_the_journal(self):
+        outbox = new_outbox()
+        outbox.start()
+        outbox.lib.host_mqtt_fail_publishes(PUBLISH_RETRIES)
+        outbox.enqueue_door_event(TOPIC, door_event(7, 1))
+        outbox.run(1_000_000)
+        stats, calls = outbox.stats(), outbox.calls()
+        self.assertEqual((stats.sent, stats.failed, stats.retries), (0, 1, PUBLISH_RETRIES))
+        self.assertEqual((calls.reserved, calls.cancelled, calls.failed_seq), (1, 1, 7))
+
+        # The slot came back
+        outbox.enqueue_door_event(TOPIC, door_event(8, 0))
+        outbox.run()
+        self.assertEqual(outbox.stats().sent, 1)
+
+    def test_qos0_is_marked_delivered_when_handed_over(self):
+        outbox = new_outbox()
+        outbox.start()
+        outbox.enqueue_door_event(TOPIC, door_event(9, 1), qos=0)
+        outbox.run()
+        calls = outbox.calls()
+        self.assertEqual((calls.reserved, calls.delivered_seq), (0, 9))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""Host tests of main/mqtt_topic_match.c: exact, + and # filters, $-topics,
+which route wins when several match, and a randomized comparison with the
+MQTT 3.1.1 matching rules (section 4.7).
+
+    python3 tools/host/test_mqtt_topic_match.py
+    python3 -m unittest discover -s tools/host     (every host test)
+"""
+
+import os
+import random
+import sys
+import tempfile
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from host_c import build_library  # noqa: E402
+from topic_match import MAX_ROUTES, SOURCES, TopicIndex, bind, filter_matches  # noqa: E402
+
+
+def setUpModule():
+    global workdir, lib
+    workdir = tempfile.TemporaryDirectory()
+    lib = bind(build_library(workdir.name, SOURCES, name="topic_match"))
+
+
+def tearDownModule():
+    workdir.cleanup()
+
+
+def reference_matches(filter_, topic):
+    """MQTT 3.1.1 section 4.7, level by level"""
+    if topic.startswith("$") and filter_[:1] in ("+", "#"):
+        return False
+    levels, topic_levels = filter_.split("/"), topic.split("/")
+    for i, level in enumerate(levels):
+        if level == "#":
+            return True
+        if i >= len(topic_levels) or (level != "+" and level != topic_levels[i]):
+            return False
+    return len(levels) == len(topic_levels)
+
+
+class FilterTest(unittest.TestCase):
+    def check(self, filter_, matching, other):
+        for topic in matching:
+            with self.subTest(filter=filter_, topic=topic):
+                self.assertTrue(filter_matches(lib, filter_, topic))
+        for topic in other:
+            with self.subTest(filter=filter_, topic=topic):
+                self.assertFalse(filter_matches(lib, filter_, topic))
+
+    def test_exact(self):
+        self.check("mailbox/door", ["mailbox/door"], ["mailbox/doo", "mailbox/door/", "mailbox/doors", "mailbox",
+                                                       "Mailbox/door", ""])
+
+    def test_single_level(self):
+        self.check("mailbox/+/ping", ["mailbox/aabbcc/ping", "mailbox//ping"],
+                   ["mailbox/ping", "mailbox/a/b/ping", "mailbox/a/pong", "mailbox/a/ping/x"])
+        self.check("+", ["mailbox", ""], ["mailbox/door", "/"])
+        self.check("mailbox/+", ["mailbox/door", "mailbox/"], ["mailbox", "mailbox/door/x"])
+        self.check("+/+", ["a/b", "/b", "a/", "/"], ["a", "a/b/c"])
+
+    def test_multi_level(self):
+        self.check("#", ["mailbox", "mailbox/door/x", "/", ""], [])
+        self.check("mailbox/#", ["mailbox", "mailbox/", "mailbox/door", "mailbox/door/locker"],
+                   ["mailboxes", "mailbox2/door", "other/mailbox"])
+        self.check("mailbox/+/#", ["mailbox/a", "mailbox/a/b/c"], ["mailbox", "other/a"])
+
+    def test_dollar_topics_need_a_literal_first_level(self):
+        self.check("#", [], ["$SYS/broker/uptime", "$aws/things/x"])
+        self.check("+/broker/uptime", [], ["$SYS/broker/uptime"])
+        self.check("$SYS/#", ["$SYS/broker/uptime", "$SYS"], ["SYS/broker"])
+        self.check("$SYS/+/uptime", ["$SYS/broker/uptime"], [])
+        self.check("mailbox/+", ["mailbox/$cmd"], [])
+
+    def test_matches_the_mqtt_rules(self):
+        rng = random.Random(7)
+        words = ["a", "b", "", "$x"]
+        for _ in range(5000):
+            topic = "/".join(rng.choice(words) for _ in range(rng.randint(1, 4)))
+            levels = [rng.choice(["a", "b", "", "+", "$x"]) for _ in range(rng.randint(1, 4))]
+            if rng.random() < 0.3:
+                levels.append("#")
+            filter_ = "/".join(levels)
+            with self.subTest(filter=filter_, topic=topic):
+                self.assertEqual(filter_matches(lib, filter_, topic), reference_matches(filter_, topic))
+
+
+class IndexTest(unittest.TestCase):
+    def test_exact_route_wins_over_earlier_wildcards(self):
+        index = TopicIndex(lib, ["mailbox/#", "mailbox/+/ping", "mailbox/all/ping"])
+        self.assertEqual(index.match("mailbox/all/ping"), 2)
+        self.assertEqual(index.match("mailbox/aabbcc/ping"), 0)
+        self.assertEqual(index.match("other"), -1)
+
+    def test_wildcards_match_in_the_order_added(self):
+        index = TopicIndex(lib, ["mailbox/+/ping", "mailbox/#"])
+        self.assertEqual(index.match("mailbox/aabbcc/ping"), 0)
+        self.assertEqual(index.match("mailbox/aabbcc/config"), 1)
+
+    def test_topic_length_bounds_the_match(self):
+        index = TopicIndex(lib, ["mailbox/door"])
+        encoded = b"mailbox/door/locker"
+        self.assertEqual(lib.topic_index_match(index.state, encoded, 12), 0)
+        self.assertEqual(lib.topic_index_match(index.state, encoded, 11), -1)
+
+    def test_duplicate_exact_filter_is_refused(self):
+        index = TopicIndex(lib, ["mailbox/door"])
+        self.assertEqual(index.add("mailbox/door"), -1)
+        self.assertEqual(index.add("mailbox/door/#"), 1)
+
+    def test_full_table_of_exact_filters(self):
+        filters = [f"mailbox/{i:012x}/ota" for i in range(MAX_ROUTES)]
+        index = TopicIndex(lib, filters)
+        self.assertEqual(index.add("mailbox/extra"), -1)
+        for i, filter_ in enumerate(filters):
+            self.assertEqual(index.match(filter_), i)
+        self.assertEqual(index.match("mailbox/extra"), -1)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+"""Host tests of main/door_handler.c with DOOR_MAX_SENSORS sensors bouncing at
+once: door_task and the outbox task run on the host scheduler, edges come
+from the GPIO ISR, and each sensor has to commit its own settled level to its
+own topic. A bounce burst on every sensor fits GPIO_QUEUE_SIZE, so no edge is
+lost; one edge more is.
+
+    python3 tools/host/test_multi_sensor.py
+    python3 -m unittest discover -s tools/host     (every host test)
+"""
+
+import os
+import sys
+import tempfile
+import unittest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, HERE)
+sys.path.insert(0, os.path.join(os.path.dirname(HERE), "payload"))
+from debounce import MODE_INTEGRATING, DebounceProfile  # noqa: E402
+from decode_door_payload import decode  # noqa: E402
+from door_handler import GPIO_QUEUE_SIZE, HOST_SOURCES, MAX_SENSORS, SOURCES  # noqa: E402
+from door_handler import DoorHandler, SensorConfig, bind  # noqa: E402
+from host_c import build_library, load_copy  # noqa: E402
+
+TOPIC = "mailbox/door"
+START_US = 10_000_000
+SETTLE_MS = 50
+FIRST_GPIO = 12
+EDGE_GAP_US = 100
+BURST_EDGES = 8  # Per sensor, what GPIO_QUEUE_SIZE is sized for
+
+
+def setUpModule():
+    global workdir, built, copies
+    workdir = tempfile.TemporaryDirectory()
+    built = build_library(workdir.name, SOURCES, name="door_handler", host_sources=HOST_SOURCES)
+    copies = 0
+
+
+def tearDownModule():
+    workdir.cleanup()
+
+
+def sensor(i):
+    return SensorConfig(f"door{i}".encode(), FIRST_GPIO + i, f"/s{i}".encode(),
+                        DebounceProfile(MODE_INTEGRATING, SETTLE_MS), 0, 1)
+
+
+def new_handler(levels):
+    """A started door handler on MAX_SENSORS sensors in a fresh copy of the library"""
+    global copies
+    copies += 1
+    lib = bind(load_copy(built, f"door_handler_{copies}"))
+    lib.host_set_time_us(START_US)
+    return DoorHandler(lib, [sensor(i) for i in range(MAX_SENSORS)], levels)
+
+
+def burst(handler, levels, edges):
+    """Bounces every sensor edges[i] times, round robin so the sensors'
+    edges interleave, without door_task getting to run. Returns the edges
+    the ISR saw, as (sensor, level, timestamp_us)."""
+    driven = []
+    now_us = handler.lib.esp_timer_get_time()
+    for n in range(max(edges)):
+        for i in range(MAX_SENSORS):
+            if n < edges[i]:
+                levels[i] ^= 1
+                now_us += EDGE_GAP_US
+                handler.set_level(FIRST_GPIO + i, levels[i], now_us)
+                driven.append((i, levels[i], now_us))
+    return driven
+
+
+def door_states(publishes):
+    """{topic: [door state of each event published to it]}"""
+    states = {}
+    for topic, payload, _, _ in publishes:
+        states.setdefault(topic, []).extend(event["door"] for event in decode(payload)["events"])
+    return states
+
+
+class BootTest(unittest.TestCase):
+    def test_each_sensor_publishes_its_initial_state_to_its_own_topic(self):
+        levels = [i % 2 for i in range(MAX_SENSORS)]
+        handler = new_handler(levels)
+        self.assertEqual(door_states(handler.published()),
+                         {f"{TOPIC}/s{i}": ["open" if levels[i] else "closed"] for i in range(MAX_SENSORS)})
+
+
+class InterleavedBurstTest(unittest.TestCase):
+    def test_each_sensor_commits_its_own_settled_level(self):
+        levels = [i % 2 for i in range(MAX_SENSORS)]
+        handler = new_handler(list(levels))
+        booted = len(handler.published())
+        transitions = len(handler.transitions())
+
+        # An odd number of edges each, so every sensor ends up flipped
+        driven = burst(handler, levels, [BURST_EDGES - 1] * MAX_SENSORS)
+        handler.run(2 * SETTLE_MS * 1000)
+
+        self.assertEqual(handler.overflows(), 0)
+        self.assertEqual(handler.edges(), driven)
+        self.assertEqual(sorted(handler.transitions()[transitions:]), [(i, levels[i]) for i in range(MAX_SENSORS)])
+        self.assertEqual(door_states(handler.published(booted)),
+                         {f"{TOPIC}/s{i}": ["open" if levels[i] else "closed"] for i in range(MAX_SENSORS)})
+        self.assertTrue(handler.lib.door_handler_settled())
+
+    def test_sensors_bouncing_different_amounts_only_commit_their_own_change(self):
+        levels = [0] * MAX_SENSORS
+        handler = new_handler(list(levels))
+        booted = len(handler.published())
+
+        # Even counts bounce back to closed, odd ones end open
+        edges = [BURST_EDGES - i % 2 - (i // 2) * 2 for i in range(MAX_SENSORS)]
+        driven = burst(handler, levels, edges)
+        handler.run(2 * SETTLE_MS * 1000)
+
+        self.assertEqual(handler.overflows(), 0)
+        self.assertEqual(handler.edges(), driven)
+        self.assertEqual(door_states(handler.published(booted)),
+                         {f"{TOPIC}/s{i}": ["open"] for i in range(MAX_SENSORS) if edges[i] % 2})
+
+
+class QueueSizeTest(unittest.TestCase):
+    def test_queue_holds_a_bounce_burst_on_every_sensor(self):
+        self.assertGreaterEqual(GPIO_QUEUE_SIZE, MAX_SENSORS * BURST_EDGES)
+        levels = [0] * MAX_SENSORS
+        handler = new_handler(list(levels))
+        booted = len(handler.published())
+
+        driven = burst(handler, levels, [BURST_EDGES] * MAX_SENSORS)
+        self.assertFalse(handler.lib.door_handler_settled())
+        handler.run(2 * SETTLE_MS * 1000)
+
+        self.assertEqual(handler.overflows(), 0)
+        self.assertEqual(handler.edges(), driven)
+        self.assertEqual(handler.published(booted), [])
+
+    def test_edge_past_a_full_queue_is_counted_and_lost(self):
+        levels = [0] * MAX_SENSORS
+        handler = new_handler(list(levels))
+        booted = len(handler.published())
+
+        driven = burst(handler, levels, [GPIO_QUEUE_SIZE // MAX_SENSORS] * MAX_SENSORS)
+        self.assertEqual(len(driven), GPIO_QUEUE_SIZE)
+        burst(handler, levels, [1] + [0] * (MAX_SENSORS - 1))
+        handler.run(4 * SETTLE_MS * 1000)
+
+        # The queued edges bounce back to closed, which cancels the settle
+        # check, so the door stays closed with its pin reading open
+        self.assertEqual(handler.overflows(), 1)
+        self.assertEqual(handler.edges(), driven)
+        self.assertEqual(levels[0], 1)
+        self.assertEqual(handler.published(booted), [])
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""Host tests of main/ota_manifest_scanner.c: chunked input, bounds of the
+output buffer and what a flat manifest may contain.
+
+    python3 tools/host/test_ota_manifest_scanner.py
+    python3 -m unittest discover -s tools/host     (every host test)
+"""
+
+import json
+import os
+import sys
+import tempfile
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from host_c import build_library  # noqa: E402
+from manifest_scanner import SCAN_ERROR, SCAN_FOUND, SCAN_MORE, SCAN_NOT_FOUND, SOURCES, Scanner, bind  # noqa: E402
+
+MAC = "aa:bb:cc:dd:ee:ff"
+URL = "https://updates.example.com/mailbox/v1.4.2/firmware.bin"
+
+
+def setUpModule():
+    global workdir, lib
+    workdir = tempfile.TemporaryDirectory()
+    lib = bind(build_library(workdir.name, SOURCES, name="manifest_scanner"))
+
+
+def tearDownModule():
+    workdir.cleanup()
+
+
+def manifest(entries):
+    return json.dumps(dict(entries))
+
+
+def fleet(devices, target_at=None):
+    entries = [(f"10:20:30:{i >> 16 & 0xff:02x}:{i >> 8 & 0xff:02x}:{i & 0xff:02x}", f"https://u/{i}.bin")
+               for i in range(devices)]
+    if target_at is not None:
+        entries.insert(target_at, (MAC, URL))
+    return manifest(entries)
+
+
+class ScanTest(unittest.TestCase):
+    def scan(self, text, key=MAC, out_size=256):
+        scanner = Scanner(lib, key, out_size)
+        result = scanner.feed(text)
+        self.assertTrue(scanner.guard_intact())
+        return result, scanner
+
+    def test_finds_the_key(self):
+        result, scanner = self.scan(fleet(50, target_at=20))
+        self.assertEqual(result, SCAN_FOUND)
+        self.assertEqual(scanner.value(), URL)
+
+    def test_keys_compare_case_insensitively(self):
+        result, scanner = self.scan(manifest([(MAC.upper(), URL)]))
+        self.assertEqual((result, scanner.value()), (SCAN_FOUND, URL))
+        result, scanner = self.scan(manifest([(MAC, URL)]), key=MAC.upper())
+        self.assertEqual((result, scanner.value()), (SCAN_FOUND, URL))
+
+    def test_first_of_duplicate_keys_wins(self):
+        result, scanner = self.scan('{"%s": "first", "%s": "second"}' % (MAC, MAC.upper()))
+        self.assertEqual((result, scanner.value()), (SCAN_FOUND, "first"))
+
+    def test_missing_key_ends_when_the_object_closes(self):
+        text = fleet(30)
+        scanner = Scanner(lib, MAC)
+        self.assertEqual(scanner.feed(text[:-1]), SCAN_MORE)
+        self.assertEqual(scanner.feed(text[-1:]), SCAN_NOT_FOUND)
+        self.assertEqual(self.scan("{}")[0], SCAN_NOT_FOUND)
+
+    def test_prefix_and_extension_of_the_key_do_not_match(self):
+        text = manifest([(MAC[:-3], "short"), (MAC + ":00", "long"), ("", "empty")])
+        self.assertEqual(self.scan(text)[0], SCAN_NOT_FOUND)
+
+    def test_nested_and_literal_values_are_skipped(self):
+        text = ('{"a": {"b": [1, {"c": "x\\"}]"}], "d": "}"}, "n": null, "t": true, "x": -1.5e3, '
+                '"%s": "%s"}' % (MAC, URL))
+        result, scanner = self.scan(text)
+        self.assertEqual((result, scanner.value()), (SCAN_FOUND, URL))
+
+    def test_escapes_in_the_value_are_decoded(self):
+        result, scanner = self.scan('{"%s": "https:\\/\\/u\\/a\\"b"}' % MAC)
+        self.assertEqual((result, scanner.value()), (SCAN_FOUND, 'https://u/a"b'))
+
+    def test_escaped_key_never_matches(self):
+        self.assertEqual(self.scan('{"aa:bb:cc:dd:ee:f\\u0066": "x"}')[0], SCAN_NOT_FOUND)
+
+    def test_malformed_input_is_an_error(self):
+        for text in ['[]', 'x{', '{"k" "v"}', '{"k": "v" "k2": "v"}', '{1: 2}']:
+            with self.subTest(text=text):
+                self.assertEqual(self.scan(text)[0], SCAN_ERROR)
+
+    def test_result_is_sticky(self):
+        scanner = Scanner(lib, MAC)
+        self.assertEqual(scanner.feed(manifest([(MAC, URL)])), SCAN_FOUND)
+        self.assertEqual(scanner.feed('garbage'), SCAN_FOUND)
+        self.assertEqual(scanner.value(), URL)
+
+
+class ChunkTest(unittest.TestCase):
+    def test_every_split_point_gives_the_same_result(self):
+        text = ('{"x": {"y": "a\\"}"}, "z": 1, "%s": "%s"}' % (MAC.upper(), "ht\\/tp")).encode()
+        for split in range(1, len(text)):
+            with self.subTest(split=split):
+                scanner = Scanner(lib, MAC)
+                scanner.feed(text[:split])
+                self.assertEqual(scanner.feed(text[split:]), SCAN_FOUND)
+                self.assertEqual(scanner.value(), "ht/tp")
+
+    def test_byte_by_byte_and_mqtt_sized_chunks(self):
+        text = fleet(400, target_at=350).encode()
+        for size in (1, 7, 64, 1024, len(text)):
+            with self.subTest(size=size):
+                scanner = Scanner(lib, MAC)
+                self.assertEqual(scanner.feed_chunks(text, size), SCAN_FOUND)
+                self.assertEqual(scanner.value(), URL)
+
+    def test_missing_key_in_chunks(self):
+        text = fleet(400).encode()
+        scanner = Scanner(lib, MAC)
+        self.assertEqual(scanner.feed_chunks(text, 100), SCAN_NOT_FOUND)
+
+
+class BoundsTest(unittest.TestCase):
+    def test_value_filling_the_buffer_exactly_fits(self):
+        value = "u" * 31
+        scanner = Scanner(lib, MAC, out_size=32)
+        self.assertEqual(scanner.feed(manifest([(MAC, value)])), SCAN_FOUND)
+        self.assertEqual(scanner.value(), value)
+        self.assertTrue(scanner.guard_intact())
+
+    def test_value_one_byte_too_long_is_an_error_without_overflow(self):
+        scanner = Scanner(lib, MAC, out_size=32)
+        self.assertEqual(scanner.feed(manifest([(MAC, "u" * 32)])), SCAN_ERROR)
+        self.assertTrue(scanner.guard_intact())
+
+    def test_long_values_of_other_keys_do_not_count(self):
+        scanner = Scanner(lib, MAC, out_size=8)
+        self.assertEqual(scanner.feed(manifest([("other", "v" * 1000), (MAC, "short")])), SCAN_FOUND)
+        self.assertEqual(scanner.value(), "short")
+        self.assertTrue(scanner.guard_intact())
+
+    def test_empty_value_in_a_one_byte_buffer(self):
+        scanner = Scanner(lib, MAC, out_size=1)
+        self.assertEqual(scanner.feed(manifest([(MAC, "")])), SCAN_FOUND)
+        self.assertEqual(scanner.value(), "")
+        self.assertTrue(scanner.guard_intact())
+
+    def test_zero_sized_buffer_is_never_written(self):
+        for value in ("x", ""):
+            with self.subTest(value=value):
+                scanner = Scanner(lib, MAC, out_size=0)
+                self.assertEqual(scanner.feed(manifest([(MAC, value)])), SCAN_ERROR)
+                self.assertTrue(scanner.guard_intact())
+
+
+if __name__ == "__main__":
+    unittest.main()
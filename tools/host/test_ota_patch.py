@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""Host tests of main/ota_patch.c with deltas from tools/ota/make_ota_delta.py:
+round trips split at every size, malformed operation streams, and a download
+from a local HTTP server that reports bytes transferred and wall time for
+the raw, packed and delta images.
+
+    python3 tools/host/test_ota_patch.py
+    python3 -m unittest discover -s tools/host     (every host test)
+"""
+
+import functools
+import hashlib
+import http.server
+import os
+import struct
+import sys
+import tempfile
+import threading
+import unittest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, HERE)
+sys.path.insert(0, os.path.join(os.path.dirname(HERE), "ota"))
+from host_c import build_library  # noqa: E402
+from make_ota_delta import OP_COPY, OP_DIFF, OP_INSERT, diff_ops, encode_ops, make_delta  # noqa: E402
+from ota_patch import (PATCH_BAD_OP, PATCH_IO_ERROR, PATCH_OK, PATCH_OUT_OF_RANGE, SOURCES, Patcher,  # noqa: E402
+                       bind, download, split_delta, synthetic_release)
+from pack_ota_image import pack  # noqa: E402
+
+
+def setUpModule():
+    global workdir, lib, base, image, delta
+    workdir = tempfile.TemporaryDirectory()
+    lib = bind(build_library(workdir.name, SOURCES, name="ota_patch"))
+    base, image = synthetic_release()
+    delta = make_delta(base, image)
+
+
+def tearDownModule():
+    workdir.cleanup()
+
+
+def apply(operations, base_bytes, chunk):
+    patcher = Patcher(lib, base_bytes)
+    result = patcher.feed_chunks(operations, chunk)
+    return patcher, result
+
+
+class RoundTripTest(unittest.TestCase):
+    def test_header_describes_both_images(self):
+        size, image_sha, base_size, base_sha, _ = split_delta(delta)
+        self.assertEqual((size, base_size), (len(image), len(base)))
+        self.assertEqual(image_sha, hashlib.sha256(image).digest())
+        self.assertEqual(base_sha, hashlib.sha256(base).digest())
+
+    def test_rebuilds_the_image_whatever_the_chunk_size(self):
+        operations = split_delta(delta)[4]
+        for chunk in (1, 3, 9, 255, 256, 257, 1024, len(operations)):
+            with self.subTest(chunk=chunk):
+                patcher, result = apply(operations, base, chunk)
+                self.assertEqual(result, PATCH_OK)
+                self.assertTrue(patcher.complete())
+                self.assertEqual(bytes(patcher.output), image)
+
+    def test_delta_is_much_smaller_than_the_packed_image(self):
+        self.assertLess(len(delta), len(pack(image)) / 4)
+
+    def test_identical_images_are_copies_only(self):
+        ops = diff_ops(base, base)
+        self.assertEqual([op for op, _, _ in ops], [OP_COPY])
+        patcher, result = apply(encode_ops(ops), base, 4096)
+        self.assertEqual(bytes(patcher.output), base)
+
+    def test_unrelated_images_are_inserted(self):
+        other = os.urandom(4096)
+        ops = diff_ops(base, other)
+        self.assertEqual([op for op, _, _ in ops], [OP_INSERT])
+        patcher, result = apply(encode_ops(ops), base, 100)
+        self.assertEqual(bytes(patcher.output), other)
+
+    def test_empty_base(self):
+        patcher, result = apply(encode_ops(diff_ops(b"", image[:1000])), b"", 7)
+        self.assertEqual(bytes(patcher.output), image[:1000])
+
+    def test_diff_adds_modulo_256(self):
+        operations = struct.pack("<BII", OP_DIFF, 1, 3) + bytes([1, 0xFF, 0x80])
+        patcher, result = apply(operations, bytes([0, 0xFF, 0x01, 0x80]), 1)
+        self.assertEqual(bytes(patcher.output), bytes([0x00, 0x00, 0x00]))
+        self.assertTrue(patcher.complete())
+
+    def test_base_reads_are_bounded_by_the_buffer(self):
+        operations = struct.pack("<BII", OP_COPY, 0, len(base))
+        patcher, _ = apply(operations, base, len(operations))
+        self.assertEqual(bytes(patcher.output), base)
+        self.assertEqual(patcher.reads, -(-len(base) // 256))
+
+
+class MalformedTest(unittest.TestCase):
+    def test_unknown_opcode_is_sticky(self):
+        patcher = Patcher(lib, base)
+        self.assertEqual(patcher.feed(bytes([3])), PATCH_BAD_OP)
+        self.assertEqual(patcher.feed(struct.pack("<BI", OP_INSERT, 1) + b"x"), PATCH_BAD_OP)
+        self.assertEqual(patcher.output, b"")
+        self.assertFalse(patcher.complete())
+
+    def test_copy_past_the_base(self):
+        for src, length in ((len(base) - 1, 2), (len(base) + 1, 0), (0xFFFFFFFF, 2), (1, 0xFFFFFFFF)):
+            for op in (OP_COPY, OP_DIFF):
+                with self.subTest(op=op, src=src, length=length):
+                    patcher, result = apply(struct.pack("<BII", op, src, length), base, 1)
+                    self.assertEqual(result, PATCH_OUT_OF_RANGE)
+                    self.assertEqual(patcher.output, b"")
+
+    def test_copy_up_to_the_end_of_the_base(self):
+        patcher, result = apply(struct.pack("<BII", OP_COPY, len(base) - 5, 5), base, 1)
+        self.assertEqual(result, PATCH_OK)
+        self.assertEqual(bytes(patcher.output), base[-5:])
+
+    def test_truncated_streams_are_incomplete(self):
+        operations = struct.pack("<BI", OP_INSERT, 4) + b"abcd" + struct.pack("<BII", OP_DIFF, 0, 2) + b"\0\0"
+        for cut in range(1, len(operations)):
+            with self.subTest(cut=cut):
+                patcher, result = apply(operations[:cut], base, 1)
+                self.assertEqual(result, PATCH_OK)
+                self.assertEqual(patcher.complete(), cut in (9,))
+        patcher, _ = apply(operations, base, 1)
+        self.assertTrue(patcher.complete())
+
+    def test_write_failure_stops_the_patch(self):
+        patcher = Patcher(lib, base, fail_write_at=1000)
+        self.assertEqual(patcher.feed_chunks(split_delta(delta)[4], 512), PATCH_IO_ERROR)
+        self.assertLessEqual(len(patcher.output), 1000)
+        self.assertFalse(patcher.complete())
+
+
+class QuietHandler(http.server.SimpleHTTPRequestHandler):
+    def log_message(self, *args):
+        pass
+
+
+class HttpTest(unittest.TestCase):
+    """ota_stream.c's download path against a local HTTP server"""
+
+    @classmethod
+    def setUpClass(cls):
+        cls.files = tempfile.TemporaryDirectory()
+        for name, data in (("firmware.bin", image), ("firmware.mbz", pack(image)), ("firmware.mbd", delta)):
+            with open(os.path.join(cls.files.name, name), "wb") as f:
+                f.write(data)
+        handler = functools.partial(QuietHandler, directory=cls.files.name)
+        cls.server = http.server.ThreadingHTTPServer(("127.0.0.1", 0), handler)
+        threading.Thread(target=cls.server.serve_forever, daemon=True).start()
+        cls.url = f"http://127.0.0.1:{cls.server.server_address[1]}/"
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.server.shutdown()
+        cls.server.server_close()
+        cls.files.cleanup()
+
+    def test_every_format_downloads_the_same_image(self):
+        stats = {}
+        for name in ("firmware.bin", "firmware.mbz", "firmware.mbd"):
+            with self.subTest(name=name):
+                downloaded, stats[name] = download(lib, self.url + name, base)
+                self.assertEqual(downloaded, image)
+        for name, s in stats.items():
+            print(f"\n  {name}: {s['bytes_transferred']} bytes transferred in {s['wall_time_us'] / 1000:.1f} ms",
+                  end="", file=sys.stderr)
+        self.assertEqual(stats["firmware.bin"]["bytes_transferred"], len(image))
+        self.assertEqual(stats["firmware.mbd"]["bytes_transferred"], len(delta))
+        self.assertLess(stats["firmware.mbd"]["bytes_transferred"], stats["firmware.mbz"]["bytes_transferred"])
+
+    def test_delta_refuses_a_different_base(self):
+        with self.assertRaises(ValueError):
+            download(lib, self.url + "firmware.mbd", image)
+
+
+if __name__ == "__main__":
+    unittest.main()
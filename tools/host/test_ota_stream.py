@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+"""Host tests of main/ota_stream.c resuming raw images: a local http.server
+honours Range requests and cuts the connection mid-body, the download task
+runs on the host scheduler, and the image lands in flash that counts repeated
+erases and writes. A resumed download, within one boot or after a reboot
+with the NVS checkpoint, has to end with the right digest without erasing or
+writing any byte twice.
+
+    python3 tools/host/test_ota_stream.py
+    python3 -m unittest discover -s tools/host     (every host test)
+"""
+
+import ctypes
+import hashlib
+import http.server
+import os
+import random
+import re
+import socket
+import sys
+import tempfile
+import threading
+import unittest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, HERE)
+from host_c import build_library, load_copy  # noqa: E402
+from ota_stream import CHECKPOINT_INTERVAL, ESP_ERR_INVALID_CRC, HOST_SOURCES, SOURCES, Device, bind  # noqa: E402
+
+PARTITION_SIZE = 512 * 1024
+SECTOR = 4096
+IMAGE_SIZE = 3 * CHECKPOINT_INTERVAL + 12345
+HASH_APPENDED_OFFSET = 23  # esp_image_header_t.hash_appended
+RUN_US = 120_000_000  # Long enough for every retry delay
+
+
+def make_image(size):
+    """A raw app image: random bytes with hash_appended set and the SHA-256 of
+    the rest appended"""
+    body = bytearray(random.Random(size).randbytes(size - 32))
+    body[HASH_APPENDED_OFFSET] = 1
+    return bytes(body) + hashlib.sha256(body).digest()
+
+
+def sectors(size):
+    return -(-size // SECTOR) * SECTOR
+
+
+class ImageHandler(http.server.BaseHTTPRequestHandler):
+    """Serves server.image, honouring "Range: bytes=N-" unless
+    server.ignore_range, and cuts the connection at the next absolute offset
+    in server.cuts"""
+
+    def do_GET(self):
+        image, cut = self.server.image, None
+        range_header = self.headers.get("Range")
+        self.server.ranges.append(range_header)
+        start = int(re.match(r"bytes=(\d+)-", range_header).group(1)) if range_header else 0
+        if self.server.ignore_range:
+            start = 0
+        if self.server.cuts:
+            cut = self.server.cuts.pop(0)
+
+        self.send_response(206 if start else 200)
+        if start:
+            self.send_header("Content-Range", f"bytes {start}-{len(image) - 1}/{len(image)}")
+        self.send_header("Content-Length", str(len(image) - start))
+        self.end_headers()
+        self.wfile.write(image[start:cut])
+        self.wfile.flush()
+        if cut is not None:
+            self.connection.shutdown(socket.SHUT_RDWR)
+        self.close_connection = True
+
+    def log_message(self, format, *args):
+        pass
+
+
+def setUpModule():
+    global workdir, built, copies, server, url
+    workdir = tempfile.TemporaryDirectory()
+    built = build_library(workdir.name, SOURCES, name="ota_stream", host_sources=HOST_SOURCES)
+    copies = 0
+    server = http.server.ThreadingHTTPServer(("127.0.0.1", 0), ImageHandler)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    url = f"http://127.0.0.1:{server.server_address[1]}/mailbox.bin"
+
+
+def tearDownModule():
+    server.shutdown()
+    server.server_close()
+    workdir.cleanup()
+
+
+def boot(flash):
+    """A device booting on flash, in a fresh copy of the library"""
+    global copies
+    copies += 1
+    lib = bind(load_copy(built, f"ota_stream_{copies}"))
+    return Device(lib, flash)
+
+
+def garbage_flash():
+    """Flash holding an older image, so a write into an unerased sector shows"""
+    return (ctypes.c_uint8 * PARTITION_SIZE).from_buffer_copy(random.Random(1).randbytes(PARTITION_SIZE))
+
+
+class OtaStreamTest(unittest.TestCase):
+    def setUp(self):
+        server.image = make_image(IMAGE_SIZE)
+        server.cuts = []
+        server.ranges = []
+        server.ignore_range = False
+        self.flash = garbage_flash()
+
+    def assertImageFlashed(self, device):
+        self.assertEqual(device.stats().last_error, 0)
+        self.assertTrue(device.booted_update())
+        self.assertEqual(bytes(self.flash[:IMAGE_SIZE]), server.image)
+        self.assertEqual(device.checkpoint(), b"")
+
+    def download(self, device, sha256=None):
+        self.assertEqual(device.start(url, sha256), 0)
+        device.run(RUN_US)
+
+    def test_uninterrupted_download_checks_the_appended_digest(self):
+        device = boot(self.flash)
+        self.download(device, hashlib.sha256(server.image).digest())
+
+        self.assertImageFlashed(device)
+        self.assertEqual(server.ranges, [None])
+        flash = device.flash_stats()
+        self.assertEqual((flash.written_bytes, flash.erased_bytes), (IMAGE_SIZE, sectors(IMAGE_SIZE)))
+
+    def test_dropped_connections_resume_where_they_stopped(self):
+        cuts = [CHECKPOINT_INTERVAL + 1000, CHECKPOINT_INTERVAL + 1001, 2 * CHECKPOINT_INTERVAL + SECTOR]
+        server.cuts = list(cuts)
+        device = boot(self.flash)
+        self.download(device, hashlib.sha256(server.image).digest())
+
+        self.assertImageFlashed(device)
+        self.assertEqual(server.ranges, [None] + [f"bytes={cut}-" for cut in cuts])
+        stats, flash = device.stats(), device.flash_stats()
+        self.assertEqual(stats.resumes, len(cuts))
+        self.assertEqual(stats.bytes_transferred, IMAGE_SIZE)
+        self.assertEqual((flash.written_bytes, flash.overwritten_bytes), (IMAGE_SIZE, 0))
+        self.assertEqual((flash.erased_bytes, flash.reerased_bytes), (sectors(IMAGE_SIZE), 0))
+
+    def test_reboot_resumes_from_the_nvs_checkpoint(self):
+        cut = 2 * CHECKPOINT_INTERVAL + 777
+        server.cuts = [cut]
+        first = boot(self.flash)
+        self.assertEqual(first.start(url), 0)
+        first.run(1_000_000)  # Reboot while waiting to retry
+        checkpoint = first.checkpoint()
+        self.assertTrue(checkpoint)
+        before = first.flash_stats()
+
+        second = boot(self.flash)
+        second.restore_checkpoint(checkpoint)
+        self.assertEqual(second.lib.init_ota_stream(), 0)
+        second.run(RUN_US)
+
+        self.assertImageFlashed(second)
+        self.assertEqual(server.ranges, [None, f"bytes={cut}-"])
+        after = second.flash_stats()
+        self.assertEqual((before.written_bytes, after.written_bytes), (cut, IMAGE_SIZE - cut))
+        self.assertEqual(before.erased_bytes + after.erased_bytes, sectors(IMAGE_SIZE))
+        self.assertEqual(before.overwritten_bytes + after.overwritten_bytes + after.reerased_bytes, 0)
+
+    def test_server_ignoring_range_restarts_from_zero(self):
+        cut = CHECKPOINT_INTERVAL + 1000
+        server.cuts = [cut]
+        server.ignore_range = True
+        device = boot(self.flash)
+        self.download(device, hashlib.sha256(server.image).digest())
+
+        self.assertImageFlashed(device)
+        self.assertEqual(server.ranges, [None, f"bytes={cut}-"])
+        flash = device.flash_stats()
+        self.assertEqual((flash.written_bytes, flash.overwritten_bytes), (IMAGE_SIZE + cut, 0))
+        # Only the tail of the sector the drop left half written was erased twice
+        self.assertEqual(flash.reerased_bytes, sectors(cut) - cut)
+
+    def test_digest_differing_from_the_command_is_refused(self):
+        server.cuts = [CHECKPOINT_INTERVAL + 1000]
+        device = boot(self.flash)
+        self.download(device, bytes(32))
+
+        self.assertEqual(device.stats().last_error, ESP_ERR_INVALID_CRC)
+        self.assertFalse(device.running_ota())
+        self.assertEqual(device.lib.host_restart_count(), 0)
+        self.assertEqual(device.checkpoint(), b"")
+
+
+if __name__ == "__main__":
+    unittest.main()
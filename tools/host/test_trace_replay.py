@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""Host tests of tools/trace/replay_trace.py: the recorded traces pass with the
+settings in main/door_config.h, a wrong expectation fails, and edges of
+several sensors are debounced independently. Replayed through door_handler.c
+on the host scheduler, the same traces publish their expected states.
+
+    python3 tools/host/test_trace_replay.py
+    python3 -m unittest discover -s tools/host     (every host test)
+"""
+
+import glob
+import os
+import sys
+import tempfile
+import unittest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+TRACES = os.path.join(os.path.dirname(HERE), "trace")
+sys.path.insert(0, TRACES)
+from replay_trace import build, build_firmware, check, config_defaults, read_expectation, replay  # noqa: E402
+from replay_trace import replay_firmware  # noqa: E402
+
+
+def setUpModule():
+    global workdir, binary, firmware, copies, defaults
+    workdir = tempfile.TemporaryDirectory()
+    binary = build(workdir.name)
+    firmware = build_firmware(workdir.name)
+    copies = 0
+    defaults = config_defaults()
+
+
+def tearDownModule():
+    workdir.cleanup()
+
+
+def write_trace(text):
+    path = os.path.join(workdir.name, "trace.csv")
+    with open(path, "w") as f:
+        f.write(text)
+    return path
+
+
+def run(path, mode=None, settle_ms=None, repeat=10):
+    default_mode, default_settle_ms, open_level = defaults
+    return replay(binary, path, mode or default_mode, settle_ms or default_settle_ms, open_level, repeat)
+
+
+def run_firmware(path, mode=None, settle_ms=None):
+    global copies
+    copies += 1
+    default_mode, default_settle_ms, open_level = defaults
+    return replay_firmware(firmware, path, mode or default_mode, settle_ms or default_settle_ms, open_level,
+                           f"replay_firmware_{copies}")
+
+
+class RecordedTraceTest(unittest.TestCase):
+    def test_recorded_traces_match_their_expectation(self):
+        paths = sorted(glob.glob(os.path.join(TRACES, "*.csv")))
+        self.assertTrue(paths)
+        for path in paths:
+            with self.subTest(trace=os.path.basename(path)):
+                result = run(path)
+                self.assertTrue(check(result, read_expectation(path)))
+                self.assertGreater(result["ns_per_edge"], 0)
+
+    def test_integrating_commits_settle_after_the_last_bounce(self):
+        result = run(os.path.join(TRACES, "mailbox_bounce.csv"), "integrating", 500)
+        self.assertEqual([(s, edge, commit) for _, s, edge, commit in result["transitions"]],
+                         [("open", 1002100, 1502100), ("closed", 9001900, 9501900)])
+        self.assertEqual(result["latency_us"], [500000] * 4)
+
+    def test_leading_edge_commits_on_the_first_edge_and_reports_the_rattle(self):
+        result = run(os.path.join(TRACES, "mailbox_bounce.csv"), "leading-edge", 500)
+        self.assertEqual([(s, edge, commit) for _, s, edge, commit in result["transitions"]],
+                         [("open", 1000000, 1000000), ("closed", 3500000, 3500000), ("open", 3500400, 4000400),
+                          ("closed", 9000000, 9000000)])
+        self.assertFalse(check(result, read_expectation(os.path.join(TRACES, "mailbox_bounce.csv"))))
+
+
+class ExpectationTest(unittest.TestCase):
+    def test_wrong_expectation_fails(self):
+        path = write_trace("# expect: open\n1000000,1,0\n2000000,0,0\n")
+        self.assertFalse(check(run(path), read_expectation(path)))
+
+    def test_trace_without_expectation_is_not_judged(self):
+        path = write_trace("1000000,1,0\n")
+        self.assertIsNone(check(run(path), read_expectation(path)))
+
+    def test_sensors_debounce_independently(self):
+        path = write_trace("# expect: open open closed closed\n"
+                           "1000000,1,0\n1100000,1,1\n3000000,0,0\n3000100,0,1\n")
+        result = run(path, "integrating", 500)
+        self.assertTrue(check(result, read_expectation(path)))
+        self.assertEqual([sensor for sensor, _, _, _ in result["transitions"]], [0, 1, 0, 1])
+
+    def test_bounce_shorter_than_settle_commits_nothing(self):
+        path = write_trace("# expect:\n1000000,1,0\n1000200,0,0\n")
+        result = run(path, "integrating", 500)
+        self.assertTrue(check(result, read_expectation(path)))
+        self.assertIsNone(result["latency_us"])
+
+
+
+class FirmwareReplayTest(unittest.TestCase):
+    def test_recorded_traces_publish_their_expectation(self):
+        paths = sorted(glob.glob(os.path.join(TRACES, "*.csv")))
+        for path in paths:
+            with self.subTest(trace=os.path.basename(path)):
+                result = run_firmware(path)
+                self.assertTrue(check(result, read_expectation(path)))
+                self.assertEqual(result["overflows"], 0)
+                self.assertGreater(result["edges_per_s"], 0)
+
+    def test_published_events_carry_the_settled_edge_time(self):
+        result = run_firmware(os.path.join(TRACES, "mailbox_bounce.csv"), "integrating", 500)
+        self.assertEqual(result["published"], [(0, "open", 1002), (0, "closed", 9001)])
+
+    def test_leading_edge_publishes_the_rattle(self):
+        path = os.path.join(TRACES, "mailbox_bounce.csv")
+        result = run_firmware(path, "leading-edge", 500)
+        self.assertEqual(result["published"], [(0, "open", 1000), (0, "closed", 3500), (0, "open", 3500),
+                                               (0, "closed", 9000)])
+        self.assertFalse(check(result, read_expectation(path)))
+
+    def test_sensors_publish_to_their_own_topics_in_commit_order(self):
+        path = write_trace("# expect: open open closed closed\n"
+                           "1000000,1,0\n1100000,1,1\n3000000,0,0\n3000100,0,1\n")
+        result = run_firmware(path, "integrating", 500)
+        self.assertTrue(check(result, read_expectation(path)))
+        self.assertEqual([(sensor, state) for sensor, state, _ in result["published"]],
+                         [(0, "open"), (1, "open"), (0, "closed"), (1, "closed")])
+
+    def test_bounce_shorter_than_settle_publishes_nothing(self):
+        path = write_trace("# expect:\n1000000,1,0\n1000200,0,0\n")
+        result = run_firmware(path, "integrating", 500)
+        self.assertEqual(result["published"], [])
+        self.assertTrue(check(result, read_expectation(path)))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,59 @@
+"""ctypes binding of main/mqtt_topic_match.c, see mqtt_topic_match.h"""
+
+import ctypes
+import os
+
+from host_c import MAIN, evaluate, read_defines
+
+SOURCES = ["mqtt_topic_match.c"]
+_CONFIG = read_defines(os.path.join(MAIN, "router_config.h"))
+MAX_ROUTES = evaluate(_CONFIG["MQTT_ROUTER_MAX_ROUTES"])
+HASH_SLOTS = evaluate(_CONFIG["MQTT_ROUTER_HASH_SLOTS"])
+
+
+class TopicSlot(ctypes.Structure):
+    _fields_ = [("hash", ctypes.c_uint32), ("filter", ctypes.c_int8)]
+
+
+class TopicIndexState(ctypes.Structure):
+    _fields_ = [("filters", ctypes.c_char_p * MAX_ROUTES), ("filter_lens", ctypes.c_uint16 * MAX_ROUTES),
+                ("count", ctypes.c_size_t), ("exact", TopicSlot * HASH_SLOTS),
+                ("wildcards", ctypes.c_uint8 * MAX_ROUTES), ("wildcard_count", ctypes.c_size_t)]
+
+
+def bind(lib):
+    """Declares the matcher functions of a library built with SOURCES"""
+    lib.topic_index_init.argtypes = [ctypes.POINTER(TopicIndexState)]
+    lib.topic_index_add.restype = ctypes.c_int
+    lib.topic_index_add.argtypes = [ctypes.POINTER(TopicIndexState), ctypes.c_char_p]
+    lib.topic_index_match.restype = ctypes.c_int
+    lib.topic_index_match.argtypes = [ctypes.POINTER(TopicIndexState), ctypes.c_char_p, ctypes.c_size_t]
+    lib.topic_filter_matches.restype = ctypes.c_bool
+    lib.topic_filter_matches.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_size_t]
+    return lib
+
+
+class TopicIndex:
+    """One topic_index_t. add() and match() return filter positions or -1."""
+
+    def __init__(self, lib, filters=()):
+        self.lib = lib
+        self.filters = []  # Kept alive: the C side only stores the pointers
+        self.state = TopicIndexState()
+        lib.topic_index_init(ctypes.byref(self.state))
+        for f in filters:
+            self.add(f)
+
+    def add(self, filter_):
+        encoded = ctypes.c_char_p(filter_.encode())
+        self.filters.append(encoded)
+        return self.lib.topic_index_add(ctypes.byref(self.state), encoded)
+
+    def match(self, topic):
+        encoded = topic.encode()
+        return self.lib.topic_index_match(ctypes.byref(self.state), encoded, len(encoded))
+
+
+def filter_matches(lib, filter_, topic):
+    encoded = topic.encode()
+    return lib.topic_filter_matches(filter_.encode(), encoded, len(encoded))
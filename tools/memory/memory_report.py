@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+"""Report static RAM, IRAM and stack budgets per module from the linker map.
+
+Reads the GNU ld map file written next to the ELF (build/firmware.map) and sums
+every input section by the object it came from. Files of the main component
+are listed individually, every other component as one row.
+
+Columns:
+    iram     code and data placed in internal instruction RAM
+    data     initialised DRAM (.dram0.data)
+    bss      zero-initialised DRAM (.dram0.bss, .noinit)
+    stacks   part of bss in sections named *stack*, i.e. task stacks given to
+             xTaskCreateStatic() in an RTOS_STATIC_ALLOCATION build
+    rtc      RTC memory, e.g. RTC_DATA_ATTR state kept across deep sleep
+    flash    code and read-only data left in flash
+
+Task stack sizes configured in main/*_config.h are listed as well; in the
+default build they come from the heap and do not show up in the map.
+
+Run through the build system with `cmake --build build --target memory-report`.
+"""
+
+import argparse
+import collections
+import os
+import re
+import sys
+
+COLUMNS = ("iram", "data", "bss", "stacks", "rtc", "flash")
+
+# Input section with its address, size and object on one line, or the address,
+# size and object alone when a long section name took the line before
+SECTION_LINE = re.compile(r"^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+CONTINUATION_LINE = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+OUTPUT_SECTION = re.compile(r"^(\.\S+)")
+MEMORY_REGION = re.compile(r"^(\w+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)")
+ARCHIVE_MEMBER = re.compile(r"lib([^/()]+)\.a\(([^)]+)\)$")
+STACK_DEFINE = re.compile(r"^#define\s+(\w+_STACK_SIZE)\s+(\d+)", re.MULTILINE)
+
+REGIONS = (("iram0_0_seg", "iram"), ("dram0_0_seg", "data+bss"), ("rtc_slow_seg", "rtc"))
+
+
+def classify(output_section: str):
+    if output_section.startswith(".iram0"):
+        return "iram"
+    if output_section.startswith(".dram0.data"):
+        return "data"
+    if output_section.startswith((".dram0.bss", ".noinit", ".dram0.noinit")):
+        return "bss"
+    if output_section.startswith(".rtc"):
+        return "rtc"
+    if output_section.startswith((".flash.text", ".flash.rodata", ".flash.appdesc")):
+        return "flash"
+    return None
+
+
+def module_name(obj: str, main_component: str) -> str:
+    match = ARCHIVE_MEMBER.search(obj)
+    if match is None:
+        return os.path.basename(obj)
+    component, member = match.groups()
+    if component == main_component:
+        return f"{component}/{member.split('.')[0]}"
+    return component
+
+
+def parse_map(path: str, main_component: str):
+    modules = collections.defaultdict(lambda: dict.fromkeys(COLUMNS, 0))
+    regions = {}
+    in_memory_config = False
+    output_section = None
+    pending_name = None
+
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            line = line.rstrip("\n")
+
+            if line.startswith("Memory Configuration"):
+                in_memory_config = True
+                continue
+            if line.startswith("Linker script and memory map"):
+                in_memory_config = False
+                continue
+            if in_memory_config:
+                match = MEMORY_REGION.match(line)
+                if match:
+                    regions[match.group(1)] = int(match.group(3), 16)
+                continue
+
+            match = OUTPUT_SECTION.match(line)
+            if match:
+                output_section = match.group(1)
+                pending_name = None
+                continue
+
+            match = SECTION_LINE.match(line)
+            if match:
+                name, _, size, obj = match.groups()
+            else:
+                match = CONTINUATION_LINE.match(line)
+                if match is None or pending_name is None:
+                    stripped = line.strip()
+                    # A section name too long for its column continues on the next line
+                    pending_name = stripped if line.startswith(" .") and " " not in stripped else None
+                    continue
+                name = pending_name
+                _, size, obj = match.groups()
+            pending_name = None
+
+            column = classify(output_section or "")
+            size = int(size, 16)
+            if column is None or size == 0 or name == "*fill*":
+                continue
+
+            module = modules[module_name(obj, main_component)]
+            module[column] += size
+            if column == "bss" and "stack" in name:
+                module["stacks"] += size
+
+    return modules, regions
+
+
+def configured_stacks(config_dir: str):
+    stacks = []
+    for entry in sorted(os.listdir(config_dir)):
+        if entry.endswith(".h"):
+            with open(os.path.join(config_dir, entry), encoding="utf-8") as f:
+                stacks += [(name, int(size), entry) for name, size in STACK_DEFINE.findall(f.read())]
+    return stacks
+
+
+def main() -> int:
+    root = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("map", help="linker map, e.g. build/firmware.map")
+    parser.add_argument("--main-component", default="main", help="component listed per source file")
+    parser.add_argument("--config-dir", default=os.path.join(root, "main"), help="where *_STACK_SIZE is defined")
+    parser.add_argument("--top", type=int, default=0, help="only the N modules using the most RAM")
+    args = parser.parse_args()
+
+    modules, regions = parse_map(args.map, args.main_component)
+    if not modules:
+        print(f"No sections found in {args.map}", file=sys.stderr)
+        return 1
+
+    rows = sorted(modules.items(), key=lambda item: item[1]["iram"] + item[1]["data"] + item[1]["bss"], reverse=True)
+    if args.top > 0:
+        rows = rows[: args.top]
+
+    width = max(len(name) for name, _ in rows)
+    print(f"{'module':<{width}}" + "".join(f"{column:>10}" for column in COLUMNS))
+    for name, sizes in rows:
+        print(f"{name:<{width}}" + "".join(f"{sizes[column]:>10}" for column in COLUMNS))
+
+    totals = {column: sum(sizes[column] for sizes in modules.values()) for column in COLUMNS}
+    print(f"{'total':<{width}}" + "".join(f"{totals[column]:>10}" for column in COLUMNS))
+
+    print()
+    for region, label in REGIONS:
+        if region in regions:
+            used = totals["iram"] if label == "iram" else totals["rtc"] if label == "rtc" else totals["data"] + totals["bss"]
+            print(f"{region:<14} {label:<9} {used:>8} of {regions[region]:>8} bytes ({100 * used / regions[region]:.1f}%)")
+
+    stacks = configured_stacks(args.config_dir)
+    if stacks:
+        print()
+        print("Configured task stacks (heap unless built with RTOS_STATIC_ALLOCATION):")
+        for name, size, header in stacks:
+            print(f"  {name:<32} {size:>6}  {header}")
+        print(f"  {'total':<32} {sum(size for _, size, _ in stacks):>6}")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,143 @@
+// Driver for bench_manifest_scan.py: finds one device's URL in a manifest file
+// with ota_manifest_scanner, fed in MQTT-sized chunks, and with cJSON the way
+// the firmware did before, then prints time per lookup and peak heap of each.
+//
+//     bench_manifest_scan <manifest> <key> <iterations> <chunk>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ota_manifest_scanner.h"
+#if BENCH_CJSON
+#include "cJSON.h"
+#endif
+
+#define BENCH_URL_MAX 256
+
+#if BENCH_CJSON
+static size_t heap_now = 0;
+static size_t heap_peak = 0;
+
+static void *counting_malloc(size_t size)
+{
+    size_t *block = malloc(sizeof(size_t) + size);
+    if (block == NULL)
+    {
+        return NULL;
+    }
+    *block = size;
+    heap_now += size;
+    if (heap_now > heap_peak)
+    {
+        heap_peak = heap_now;
+    }
+    return block + 1;
+}
+
+static void counting_free(void *ptr)
+{
+    if (ptr != NULL)
+    {
+        size_t *block = (size_t *)ptr - 1;
+        heap_now -= *block;
+        free(block);
+    }
+}
+#endif
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int scan_once(const char *data, size_t len, const char *key, size_t chunk, char *url)
+{
+    ota_manifest_scanner_t scanner;
+    ota_scan_result_t result = OTA_SCAN_MORE;
+
+    ota_scanner_init(&scanner, key, url, BENCH_URL_MAX);
+    for (size_t i = 0; i < len && result == OTA_SCAN_MORE; i += chunk)
+    {
+        result = ota_scanner_feed(&scanner, data + i, (len - i < chunk) ? len - i : chunk);
+    }
+    return result == OTA_SCAN_FOUND;
+}
+
+#if BENCH_CJSON
+static int cjson_once(const char *data, size_t len, const char *key, char *url)
+{
+    // The firmware copied the chunks into one buffer before parsing
+    char *copy = counting_malloc(len + 1);
+    int found = 0;
+
+    memcpy(copy, data, len);
+    copy[len] = '\0';
+    cJSON *root = cJSON_ParseWithLength(copy, len);
+    const cJSON *item = cJSON_GetObjectItem(root, key);
+    if (cJSON_IsString(item) && strlen(item->valuestring) < BENCH_URL_MAX)
+    {
+        strcpy(url, item->valuestring);
+        found = 1;
+    }
+    cJSON_Delete(root);
+    counting_free(copy);
+    return found;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    if (argc != 5)
+    {
+        fprintf(stderr, "usage: %s <manifest> <key> <iterations> <chunk>\n", argv[0]);
+        return 2;
+    }
+
+    FILE *f = fopen(argv[1], "rb");
+    if (f == NULL)
+    {
+        perror(argv[1]);
+        return 2;
+    }
+    fseek(f, 0, SEEK_END);
+    size_t len = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = malloc(len);
+    if (data == NULL || fread(data, 1, len, f) != len)
+    {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 2;
+    }
+    fclose(f);
+
+    const char *key = argv[2];
+    long iterations = atol(argv[3]);
+    size_t chunk = (size_t)atol(argv[4]);
+    char url[BENCH_URL_MAX] = "";
+    int found = 0;
+    double started;
+
+    started = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        found = scan_once(data, len, key, chunk, url);
+    }
+    printf("scanner %.0f %zu %d %s\n", (now_ns() - started) / iterations, (size_t)0, found, found ? url : "-");
+
+#if BENCH_CJSON
+    cJSON_Hooks hooks = {.malloc_fn = counting_malloc, .free_fn = counting_free};
+    cJSON_InitHooks(&hooks);
+    url[0] = '\0';
+    started = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        found = cjson_once(data, len, key, url);
+    }
+    printf("cjson %.0f %zu %d %s\n", (now_ns() - started) / iterations, heap_peak, found, found ? url : "-");
+#endif
+
+    free(data);
+    return 0;
+}
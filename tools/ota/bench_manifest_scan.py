@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""Benchmark of main/ota_manifest_scanner.c against cJSON on the host.
+
+Builds bench_manifest_scan.c with the firmware's scanner and with the cJSON
+that ESP-IDF ships, then looks up one MAC in generated fleet manifests of
+growing size, with the device first, in the middle and missing. The scanner is
+fed in MQTT-sized chunks; cJSON gets the whole payload, as before. Reports the
+time per lookup, peak heap and whether both found the same URL.
+
+    tools/ota/bench_manifest_scan.py                  (cJSON from $IDF_PATH)
+    tools/ota/bench_manifest_scan.py --cjson ~/src/cJSON
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+MAIN = os.path.join(os.path.dirname(os.path.dirname(HERE)), "main")
+MAC = "aa:bb:cc:dd:ee:ff"
+
+
+def find_cjson(path):
+    candidates = [path] if path else []
+    if os.environ.get("IDF_PATH"):
+        candidates.append(os.path.join(os.environ["IDF_PATH"], "components", "json", "cJSON"))
+    for candidate in candidates:
+        if os.path.isfile(os.path.join(candidate, "cJSON.c")):
+            return candidate
+    return None
+
+
+def build(workdir, cjson):
+    binary = os.path.join(workdir, "bench_manifest_scan")
+    command = [os.environ.get("CC", "cc"), "-O2", "-Wall", "-Wextra", "-I", MAIN,
+               os.path.join(HERE, "bench_manifest_scan.c"), os.path.join(MAIN, "ota_manifest_scanner.c"),
+               "-o", binary]
+    if cjson:
+        command += ["-DBENCH_CJSON=1", "-I", cjson, os.path.join(cjson, "cJSON.c"), "-lm"]
+    subprocess.run(command, check=True)
+    return binary
+
+
+def fleet_manifest(devices, target_at):
+    entries = [(f"10:20:30:{i >> 16 & 0xff:02x}:{i >> 8 & 0xff:02x}:{i & 0xff:02x}",
+                f"https://updates.example.com/mailbox/{i:06d}/firmware.mbz") for i in range(devices)]
+    if target_at is not None:
+        entries.insert(target_at, (MAC.upper(), "https://updates.example.com/mailbox/target/firmware.mbz"))
+    return json.dumps(dict(entries))
+
+
+def run(binary, path, iterations, chunk):
+    out = subprocess.run([binary, path, MAC, str(iterations), str(chunk)], check=True, capture_output=True,
+                         text=True).stdout
+    results = {}
+    for line in out.splitlines():
+        name, ns, heap, found, url = line.split(" ", 4)
+        results[name] = (float(ns), int(heap), found == "1", url)
+    return results
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--cjson", help="directory with cJSON.c and cJSON.h, default $IDF_PATH/components/json/cJSON")
+    parser.add_argument("--devices", type=int, nargs="+", default=[10, 100, 1000, 5000])
+    parser.add_argument("--chunk", type=int, default=1024, help="bytes per scanner feed, like MQTT_EVENT_DATA")
+    parser.add_argument("--budget", type=float, default=0.5, help="seconds per measurement")
+    args = parser.parse_args()
+
+    cjson = find_cjson(args.cjson)
+    if cjson is None:
+        print("cJSON not found (set IDF_PATH or --cjson), timing the scanner alone")
+
+    failures = 0
+    with tempfile.TemporaryDirectory() as workdir:
+        binary = build(workdir, cjson)
+        print(f"{'devices':>7} {'where':>6} {'bytes':>8} {'scanner us':>11} {'cJSON us':>10} {'speedup':>8} "
+              f"{'cJSON heap':>11}  result")
+        for devices in args.devices:
+            for where, target_at in (("first", 0), ("middle", devices // 2), ("none", None)):
+                path = os.path.join(workdir, "manifest.json")
+                text = fleet_manifest(devices, target_at)
+                with open(path, "w") as f:
+                    f.write(text)
+
+                # Size the iteration count from one calibration run
+                probe = run(binary, path, 20, args.chunk)
+                slowest_ns = max(ns for ns, _, _, _ in probe.values())
+                iterations = max(20, int(args.budget * 1e9 / max(slowest_ns, 1)))
+                results = run(binary, path, iterations, args.chunk)
+
+                scan_ns, _, scan_found, scan_url = results["scanner"]
+                expected = target_at is not None
+                ok = scan_found == expected
+                line = f"{devices:>7} {where:>6} {len(text):>8} {scan_ns / 1000:>11.1f}"
+                if "cjson" in results:
+                    cjson_ns, heap, cjson_found, cjson_url = results["cjson"]
+                    ok = ok and (scan_found, scan_url) == (cjson_found, cjson_url)
+                    line += f" {cjson_ns / 1000:>10.1f} {cjson_ns / scan_ns:>7.1f}x {heap:>11}"
+                else:
+                    line += f" {'-':>10} {'-':>8} {'-':>11}"
+                failures += not ok
+                print(f"{line}  {'ok' if ok else 'MISMATCH'}")
+
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""Make a delta OTA image that patches one application image into another.
+
+The device applies it against its running partition while the download
+streams (main/ota_patch.c), so the base must be the exact firmware.bin the
+device runs. Layout, little-endian, see main/ota_patch.h:
+    0   4   magic "MBD1"
+    4   4   patched image size
+    8   4   compressed stream size
+    12  32  SHA-256 of the patched image
+    44  4   base image size
+    48  32  SHA-256 of the base image
+    80  ..  zlib stream of COPY, DIFF and INSERT operations, 4 KB window
+
+Matching is bsdiff-like: a seed found through a hash of the base is extended
+as long as most bytes agree, and the region becomes a DIFF whose body is the
+bytewise difference. Code that moved keeps mostly zero differences with a
+few changed addresses, which deflate squeezes far better than the code itself.
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+import zlib
+
+from pack_ota_image import WBITS
+
+MAGIC = b"MBD1"
+OP_COPY, OP_DIFF, OP_INSERT = range(3)
+SEED = 16        # Bytes that must match exactly to start a region
+STEP = 4         # Base offsets indexed; any match SEED + STEP long is found
+EXACT_CHUNK = 64  # Compared as slices before falling back to bytewise scoring
+GIVE_UP = 32     # Mismatches in excess of matches since the best point that end a region
+
+
+def index_base(base):
+    seeds = {}
+    for i in range(0, len(base) - SEED + 1, STEP):
+        seeds.setdefault(base[i:i + SEED], i)
+    return seeds
+
+
+def extend(base, image, i, j):
+    """Length of the region at base[i:], image[j:] that maximises matches
+    minus mismatches"""
+    limit = min(len(base) - i, len(image) - j)
+    k = score = best = best_len = 0
+    while k < limit:
+        if k + EXACT_CHUNK <= limit and base[i + k:i + k + EXACT_CHUNK] == image[j + k:j + k + EXACT_CHUNK]:
+            k += EXACT_CHUNK
+            score += EXACT_CHUNK
+        else:
+            score += 1 if base[i + k] == image[j + k] else -1
+            k += 1
+        if score > best:
+            best, best_len = score, k
+        elif score < best - GIVE_UP:
+            break
+    return best_len
+
+
+def diff_ops(base, image):
+    """(op, src, data) tuples that rebuild image from base"""
+    seeds = index_base(base)
+    ops = []
+    literal = 0
+    shift = 0  # base offset minus image offset of the last region, tried first
+    j = 0
+    while j <= len(image) - SEED:
+        seed = image[j:j + SEED]
+        i = j + shift
+        if not (0 <= i <= len(base) - SEED and base[i:i + SEED] == seed):
+            i = seeds.get(seed)
+            if i is None:
+                j += 1
+                continue
+        while j > literal and i > 0 and base[i - 1] == image[j - 1]:
+            i -= 1
+            j -= 1
+        length = extend(base, image, i, j)
+        if j > literal:
+            ops.append((OP_INSERT, 0, image[literal:j]))
+        delta = bytes((n - o) & 0xFF for n, o in zip(image[j:j + length], base[i:i + length]))
+        ops.append((OP_COPY, i, length) if delta.count(0) == length else (OP_DIFF, i, delta))
+        shift = i - j
+        j = literal = j + length
+    if literal < len(image):
+        ops.append((OP_INSERT, 0, image[literal:]))
+    return ops
+
+
+def encode_ops(ops):
+    out = bytearray()
+    for op, src, data in ops:
+        if op == OP_COPY:
+            out += struct.pack("<BII", op, src, data)
+        elif op == OP_DIFF:
+            out += struct.pack("<BII", op, src, len(data)) + data
+        else:
+            out += struct.pack("<BI", op, len(data)) + data
+    return bytes(out)
+
+
+def make_delta(base: bytes, image: bytes) -> bytes:
+    compressor = zlib.compressobj(level=9, method=zlib.DEFLATED, wbits=WBITS)
+    stream = compressor.compress(encode_ops(diff_ops(base, image))) + compressor.flush()
+    header = (MAGIC + struct.pack("<II", len(image), len(stream)) + hashlib.sha256(image).digest() +
+              struct.pack("<I", len(base)) + hashlib.sha256(base).digest())
+    return header + stream
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("base", help="application image the devices run, e.g. the previous release's firmware.bin")
+    parser.add_argument("image", help="new application image, e.g. build/firmware.bin")
+    parser.add_argument("output", help="delta image, e.g. build/firmware.mbd")
+    args = parser.parse_args()
+
+    with open(args.base, "rb") as f:
+        base = f.read()
+    with open(args.image, "rb") as f:
+        image = f.read()
+    delta = make_delta(base, image)
+    with open(args.output, "wb") as f:
+        f.write(delta)
+
+    print(f"{args.image}: {len(image)} bytes -> {args.output}: {len(delta)} bytes "
+          f"({100.0 * len(delta) / len(image):.1f}%) against {args.base}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
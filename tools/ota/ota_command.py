@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Build the per-device OTA command for one or more mailboxes.
+
+Each device subscribes to <OTA topic>/<Wi-Fi MAC without colons> and expects
+    {"url": "...", "sha256": "<hex digest of the application image>", "version": "..."}
+The digest is of the image as flashed, i.e. build/firmware.bin, also when the
+URL points at its packed .mbz (see pack_ota_image.py) or a delta .mbd (see
+make_ota_delta.py). A device already running `version` ignores the command, so
+it may be published retained.
+
+Prints one "<topic> <payload>" line per MAC, e.g. for CI:
+
+    ota_command.py --topic "$OTA_TOPIC" --image build/firmware.bin --version "$VERSION_TAG" \\
+        --url "https://.../firmware.mbz" aa:bb:cc:dd:ee:ff | while read -r topic payload; do
+        aws iot-data publish --topic "$topic" --qos 1 --retain --cli-binary-format raw-in-base64-out \\
+            --payload "$payload"
+    done
+"""
+
+import argparse
+import hashlib
+import json
+import re
+import sys
+
+MAC = re.compile(r"^([0-9a-f]{2}:){5}[0-9a-f]{2}$")
+
+
+def command_topic(ota_topic: str, mac: str) -> str:
+    return f"{ota_topic}/{mac.lower().replace(':', '')}"
+
+
+def command_payload(url: str, image: bytes, version: str) -> str:
+    return json.dumps({"url": url, "sha256": hashlib.sha256(image).hexdigest(), "version": version},
+                      separators=(",", ":"))
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("macs", nargs="+", help="Wi-Fi MAC as aa:bb:cc:dd:ee:ff")
+    parser.add_argument("--topic", required=True, help="CONFIG_MQTT_SUBSCRIBE_OTA_UPDATE_MAILBOX_TOPIC")
+    parser.add_argument("--image", required=True, help="application image, e.g. build/firmware.bin")
+    parser.add_argument("--url", required=True, help="where the device downloads the image from")
+    parser.add_argument("--version", required=True, help="version of the image, as in its app description")
+    args = parser.parse_args()
+
+    if len(args.version.encode()) >= 32:
+        print("version must be shorter than 32 bytes", file=sys.stderr)
+        return 1
+    with open(args.image, "rb") as f:
+        payload = command_payload(args.url, f.read(), args.version)
+
+    for mac in args.macs:
+        if not MAC.match(mac.lower()):
+            print(f"not a MAC address: {mac}", file=sys.stderr)
+            return 1
+        print(command_topic(args.topic, mac), payload)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
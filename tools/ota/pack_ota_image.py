@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""Pack an ESP-IDF application image into the compressed OTA container.
+
+Layout (little-endian), read by main/ota_stream.c:
+    0   4   magic "MBZ1"
+    4   4   inflated image size
+    8   4   compressed stream size
+    12  32  SHA-256 of the inflated image
+    44  ..  zlib stream, 4 KB window (wbits=12) to match OTA_STREAM_WINDOW_SIZE
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+import zlib
+
+MAGIC = b"MBZ1"
+WBITS = 12
+
+
+def pack(image: bytes) -> bytes:
+    compressor = zlib.compressobj(level=9, method=zlib.DEFLATED, wbits=WBITS)
+    stream = compressor.compress(image) + compressor.flush()
+    header = MAGIC + struct.pack("<II", len(image), len(stream)) + hashlib.sha256(image).digest()
+    return header + stream
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("image", help="application image, e.g. build/firmware.bin")
+    parser.add_argument("output", help="packed image, e.g. build/firmware.mbz")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    packed = pack(image)
+    with open(args.output, "wb") as f:
+        f.write(packed)
+
+    print(f"{args.image}: {len(image)} bytes -> {args.output}: {len(packed)} bytes "
+          f"({100.0 * len(packed) / len(image):.1f}%)")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""Decode a door state payload produced by main/door_payload.c.
+
+Both formats are accepted; a JSON payload starts with '{', a binary one with
+its version byte. Binary layout, version 1, little-endian:
+    header  0 u8 version, 1 u8 event count, 2 u8[6] Wi-Fi MAC, 8 i8 RSSI,
+            9 u16 battery mV
+    event   0 u32 seq, 4 u8 state, 5 u8 flags, 6 u64 monotonic ms,
+            14 u32 wall clock s, 18 u32 dwell ms
+    session an event with flag 0x04, whose state is the session class and
+            dwell the span, followed by 22 u16 openings, 24 u32 open ms,
+            28 u32 longest opening ms, 32 u32 ms since the previous session
+            (0xffffffff = none)
+
+Reads the payload from a file, or from stdin when no file is given. --hex
+accepts a hex dump, e.g. as copied from an MQTT client.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+HEADER = struct.Struct("<BB6sbH")
+EVENT = struct.Struct("<IBBQII")
+SESSION = struct.Struct("<HIII")
+FLAG_REMINDER = 0x01
+FLAG_REPLAY = 0x02
+FLAG_SESSION = 0x04
+SESSION_CLASSES = ["delivery", "retrieval", "bounce"]  # session_class_t
+NO_SESSION = 0xFFFFFFFF
+
+
+def decode_binary(payload: bytes) -> dict:
+    version, count, mac, rssi, battery_mv = HEADER.unpack_from(payload, 0)
+    if version != 1:
+        raise ValueError(f"unsupported payload version {version}")
+
+    events = []
+    offset = HEADER.size
+    for _ in range(count):
+        if offset + EVENT.size > len(payload):
+            raise ValueError(f"{len(payload)} bytes does not hold {count} events")
+        seq, state, flags, mono_ms, wall_s, dwell_ms = EVENT.unpack_from(payload, offset)
+        offset += EVENT.size
+        if flags & FLAG_SESSION:
+            if offset + SESSION.size > len(payload):
+                raise ValueError(f"{len(payload)} bytes does not hold {count} events")
+            opens, open_ms, longest_ms, since_last_ms = SESSION.unpack_from(payload, offset)
+            offset += SESSION.size
+            event = {"session": SESSION_CLASSES[state] if state < len(SESSION_CLASSES) else str(state), "seq": seq,
+                     "mono_ms": mono_ms, "ts": wall_s * 1000, "span_ms": dwell_ms, "opens": opens,
+                     "open_ms": open_ms, "longest_ms": longest_ms,
+                     "since_last_ms": -1 if since_last_ms == NO_SESSION else since_last_ms}
+        else:
+            event = {"door": "open" if state else "closed", "seq": seq, "mono_ms": mono_ms,
+                     "ts": wall_s * 1000, "dwell_ms": dwell_ms}
+        if flags & FLAG_REMINDER:
+            event["reminder"] = True
+        if flags & FLAG_REPLAY:
+            event["replay"] = True
+        events.append(event)
+    if offset != len(payload):
+        raise ValueError(f"{len(payload)} bytes does not hold {count} events")
+
+    message = {"door": None} if not events else {k: events[-1][k] for k in ("door", "session") if k in events[-1]}
+    message.update({"v": version, "dev": mac.hex(), "rssi": rssi, "bat_mv": battery_mv, "events": events})
+    return message
+
+
+def decode(payload: bytes) -> dict:
+    if payload[:1] == b"{":
+        return json.loads(payload)
+    return decode_binary(payload)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("payload", nargs="?", help="file holding one payload, default stdin")
+    parser.add_argument("--hex", action="store_true", help="input is a hex dump")
+    args = parser.parse_args()
+
+    if args.payload:
+        with open(args.payload, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+    if args.hex:
+        data = bytes.fromhex(data.decode().replace(" ", "").replace("\n", ""))
+
+    message = decode(data)
+    print(json.dumps(message, indent=2))
+    events = len(message.get("events", [])) or 1
+    print(f"{len(data)} bytes, {events} events, {len(data) / events:.1f} bytes/event", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""Publishes per day under typical door patterns, fixed vs adaptive reminders.
+
+Builds main/reminder_policy.c for the host and drives it with the settings in
+main/reminder_config.h and main/door_config.h, so the numbers are those of the
+firmware's own schedule. Fixed is the old behaviour: a reminder every
+DOOR_OPEN_TIMER_PERIOD_MS for as long as the door stays open.
+
+Every pattern runs for a week starting on a Monday at 00:00 local time, with
+the clock set so quiet hours apply. A publish is a transition or a reminder;
+coalescing across sensors is not modelled, each pattern is one door.
+"""
+
+import argparse
+import ctypes
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+MAIN = os.path.join(os.path.dirname(os.path.dirname(HERE)), "main")
+
+MINUTE_MS = 60 * 1000
+HOUR_MS = 60 * MINUTE_MS
+DAY_MS = 24 * HOUR_MS
+NONE = 2**63 - 1
+
+
+class Policy(ctypes.Structure):
+    _fields_ = [("base_ms", ctypes.c_uint32), ("curve_pct", ctypes.POINTER(ctypes.c_uint16)),
+                ("curve_len", ctypes.c_size_t), ("max_per_open", ctypes.c_uint32),
+                ("quiet_start_ms", ctypes.c_uint32), ("quiet_end_ms", ctypes.c_uint32)]
+
+
+def at(day, hour, minute=0):
+    return day * DAY_MS + hour * HOUR_MS + minute * MINUTE_MS
+
+
+# Name -> list of (opened, closed) in ms from Monday 00:00
+PATTERNS = {
+    "mail twice a day": [(at(d, h), at(d, h) + 20000) for d in range(7) for h in (11, 18)],
+    "ajar 2 h each afternoon": [(at(d, 14), at(d, 16)) for d in range(7)],
+    "open overnight": [(at(d, 20), at(d + 1, 7, 30)) for d in range(6)],
+    "open all weekend": [(at(4, 18), at(7, 8))],
+    "open all week": [(at(0, 0, 1), at(7, 0))],
+}
+
+
+def read_defines(path):
+    defines = {}
+    with open(path) as f:
+        for line in f:
+            match = re.match(r"#define\s+(\w+)\s+(.+?)\s*(//.*)?$", line)
+            if match:
+                defines[match.group(1)] = match.group(2)
+    return defines
+
+
+def evaluate(expr):
+    return eval(expr.replace("{", "[").replace("}", "]"), {"__builtins__": {}})
+
+
+def build_policy_lib(workdir):
+    lib = os.path.join(workdir, "reminder_policy.so")
+    subprocess.run([os.environ.get("CC", "cc"), "-shared", "-fPIC", "-O2", "-I", MAIN,
+                    os.path.join(MAIN, "reminder_policy.c"), "-o", lib], check=True)
+    policy_lib = ctypes.CDLL(lib)
+    policy_lib.reminder_policy_interval_ms.restype = ctypes.c_int64
+    policy_lib.reminder_policy_interval_ms.argtypes = [ctypes.POINTER(Policy), ctypes.c_uint32]
+    policy_lib.reminder_policy_quiet_delay_ms.restype = ctypes.c_int64
+    policy_lib.reminder_policy_quiet_delay_ms.argtypes = [ctypes.POINTER(Policy), ctypes.c_int64]
+    return policy_lib
+
+
+def adaptive_reminders(lib, policy, opened, closed):
+    times = []
+    now = opened
+    while True:
+        interval = lib.reminder_policy_interval_ms(ctypes.byref(policy), len(times))
+        if interval == NONE:
+            break
+        due = now + interval + lib.reminder_policy_quiet_delay_ms(ctypes.byref(policy), (now + interval) % DAY_MS)
+        if due >= closed:
+            break
+        times.append(due)
+        now = due
+    return times
+
+
+def fixed_reminders(base_ms, opened, closed):
+    return list(range(opened + base_ms, closed, base_ms)) if base_ms else []
+
+
+def per_day(times):
+    days = [0] * 8
+    for t in times:
+        days[min(t // DAY_MS, 7)] += 1
+    return days[:7]
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--base-ms", type=int, help="first reminder interval instead of DOOR_OPEN_TIMER_PERIOD_MS")
+    args = parser.parse_args()
+
+    config = read_defines(os.path.join(MAIN, "reminder_config.h"))
+    base_ms = args.base_ms if args.base_ms is not None else evaluate(
+        read_defines(os.path.join(MAIN, "door_config.h"))["DOOR_OPEN_TIMER_PERIOD_MS"])
+    curve = evaluate(config["REMINDER_CURVE_PCT"])
+    curve_array = (ctypes.c_uint16 * len(curve))(*curve)
+    policy = Policy(base_ms, curve_array, len(curve), evaluate(config["REMINDER_MAX_PER_OPEN"]),
+                    evaluate(config["REMINDER_QUIET_START_MIN"]) * MINUTE_MS,
+                    evaluate(config["REMINDER_QUIET_END_MIN"]) * MINUTE_MS)
+
+    with tempfile.TemporaryDirectory() as workdir:
+        try:
+            lib = build_policy_lib(workdir)
+        except (OSError, subprocess.CalledProcessError) as e:
+            print(f"Could not build reminder_policy.c: {e}", file=sys.stderr)
+            return 1
+
+        print(f"First reminder after {base_ms / MINUTE_MS:g} min, curve {curve} %, cap "
+              f"{policy.max_per_open or 'none'}, quiet {policy.quiet_start_ms // HOUR_MS}:00-"
+              f"{policy.quiet_end_ms // HOUR_MS}:{policy.quiet_end_ms % HOUR_MS // MINUTE_MS:02d}\n")
+        print(f"{'pattern':<26}{'fixed/day':>10}{'max':>6}{'adaptive/day':>14}{'max':>6}{'saved':>8}")
+        for name, openings in PATTERNS.items():
+            transitions = [t for opening in openings for t in opening if t < 7 * DAY_MS]
+            fixed = transitions + [t for o, c in openings for t in fixed_reminders(base_ms, o, c)]
+            adaptive = transitions + [t for o, c in openings for t in adaptive_reminders(lib, policy, o, c)]
+            fixed_days, adaptive_days = per_day(fixed), per_day(adaptive)
+            saved = 1 - len(adaptive) / len(fixed) if fixed else 0
+            print(f"{name:<26}{sum(fixed_days) / 7:>10.1f}{max(fixed_days):>6}"
+                  f"{sum(adaptive_days) / 7:>14.1f}{max(adaptive_days):>6}{saved:>8.0%}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
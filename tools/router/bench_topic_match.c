@@ -0,0 +1,90 @@
+// Driver for bench_topic_match.py: indexes the filters given on the command
+// line with mqtt_topic_match, then times a lookup of each topic read from
+// stdin through the index and through a scan that tries every filter in turn,
+// and prints both times and the filter each one picked.
+//
+//     bench_topic_match <iterations> <filter>... < topics
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mqtt_topic_match.h"
+
+#define BENCH_TOPIC_MAX 256
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Exact filters first, then wildcards in order, as the index resolves them
+static int scan_match(char **filters, int count, const char *topic, size_t topic_len)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (strpbrk(filters[i], "+#") == NULL && strlen(filters[i]) == topic_len &&
+            strncmp(filters[i], topic, topic_len) == 0)
+        {
+            return i;
+        }
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (strpbrk(filters[i], "+#") != NULL && topic_filter_matches(filters[i], topic, topic_len))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s <iterations> <filter>... < topics\n", argv[0]);
+        return 2;
+    }
+
+    long iterations = strtol(argv[1], NULL, 10);
+    char **filters = argv + 2;
+    int count = argc - 2;
+    topic_index_t index;
+    char topic[BENCH_TOPIC_MAX];
+
+    topic_index_init(&index);
+    for (int i = 0; i < count; i++)
+    {
+        if (topic_index_add(&index, filters[i]) != i)
+        {
+            fprintf(stderr, "cannot index %s\n", filters[i]);
+            return 2;
+        }
+    }
+
+    while (fgets(topic, sizeof(topic), stdin) != NULL)
+    {
+        size_t len = strcspn(topic, "\n");
+        volatile int sink = 0;
+
+        double start_ns = now_ns();
+        for (long n = 0; n < iterations; n++)
+        {
+            sink += topic_index_match(&index, topic, len);
+        }
+        double index_ns = (now_ns() - start_ns) / iterations;
+
+        start_ns = now_ns();
+        for (long n = 0; n < iterations; n++)
+        {
+            sink += scan_match(filters, count, topic, len);
+        }
+        double scan_ns = (now_ns() - start_ns) / iterations;
+
+        printf("%.1f %.1f %d %d %.*s\n", index_ns, scan_ns, topic_index_match(&index, topic, len),
+               scan_match(filters, count, topic, len), (int)len, topic);
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""Benchmark of main/mqtt_topic_match.c on the host.
+
+Builds bench_topic_match.c with the firmware's topic index and routes a set
+of topics through a table shaped like the one in mqtt_custom_handler.c,
+padded with per-device command routes up to MQTT_ROUTER_MAX_ROUTES. Each
+lookup is timed through the hash index and through a scan that compares every
+filter in turn, and both must pick the same route.
+
+    tools/router/bench_topic_match.py
+    tools/router/bench_topic_match.py --routes 4 --budget 0.2
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+TOOLS = os.path.dirname(HERE)
+MAIN = os.path.join(os.path.dirname(TOOLS), "main")
+sys.path.insert(0, os.path.join(TOOLS, "host"))
+from topic_match import MAX_ROUTES  # noqa: E402
+
+ROOT = "mailbox/door"
+DEVICE = "aabbccddeeff"
+COMMANDS = ["config", "diagnostics", "reboot", "log", "settings", "locate", "sleep", "wake", "reset", "time",
+            "journal", "metrics", "reminder", "jitter", "session", "ota"]
+
+
+def route_table(count):
+    filters = [f"mailbox/ota/{DEVICE}", "mailbox/ota", f"{ROOT}/cmd/{DEVICE}/ping", f"{ROOT}/cmd/all/ping"]
+    filters += [f"{ROOT}/cmd/{DEVICE}/{c}" for c in COMMANDS]
+    return filters[:count - 1] + [f"{ROOT}/cmd/+/#"]
+
+
+def topics(filters):
+    """(name, topic) pairs that end at different points of a lookup"""
+    return [("first route", filters[0]), ("last exact", filters[-2]),
+            ("wildcard", f"{ROOT}/cmd/112233445566/config"), ("unrouted", "mailbox/weather/temperature"),
+            ("$-topic", "$SYS/broker/uptime")]
+
+
+def build(workdir):
+    binary = os.path.join(workdir, "bench_topic_match")
+    subprocess.run([os.environ.get("CC", "cc"), "-O2", "-Wall", "-Wextra", "-I", MAIN,
+                    os.path.join(HERE, "bench_topic_match.c"), os.path.join(MAIN, "mqtt_topic_match.c"),
+                    "-o", binary], check=True)
+    return binary
+
+
+def run(binary, filters, topic_list, iterations):
+    out = subprocess.run([binary, str(iterations)] + filters, input="".join(t + "\n" for t in topic_list),
+                         check=True, capture_output=True, text=True).stdout
+    results = []
+    for line in out.splitlines():
+        index_ns, scan_ns, index_route, scan_route, _ = line.split(" ", 4)
+        results.append((float(index_ns), float(scan_ns), int(index_route), int(scan_route)))
+    return results
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--routes", type=int, nargs="+", default=[4, 8, MAX_ROUTES],
+                        help=f"route table sizes, at most {MAX_ROUTES}")
+    parser.add_argument("--budget", type=float, default=0.5, help="seconds per measurement")
+    args = parser.parse_args()
+
+    failures = 0
+    with tempfile.TemporaryDirectory() as workdir:
+        binary = build(workdir)
+        print(f"{'routes':>6} {'topic':<12} {'index ns':>9} {'scan ns':>8} {'speedup':>8}  route")
+        for count in args.routes:
+            filters = route_table(min(count, MAX_ROUTES))
+            named = topics(filters)
+            topic_list = [t for _, t in named]
+
+            # Size the iteration count from one calibration run
+            probe = run(binary, filters, topic_list, 1000)
+            slowest_ns = max(max(index_ns, scan_ns) for index_ns, scan_ns, _, _ in probe)
+            iterations = max(1000, int(args.budget * 1e9 / (2 * len(topic_list) * max(slowest_ns, 1))))
+
+            for (name, _), (index_ns, scan_ns, index_route, scan_route) in zip(
+                    named, run(binary, filters, topic_list, iterations)):
+                ok = index_route == scan_route
+                failures += not ok
+                print(f"{len(filters):>6} {name:<12} {index_ns:>9.1f} {scan_ns:>8.1f} {scan_ns / index_ns:>7.1f}x  "
+                      f"{index_route if ok else f'MISMATCH {index_route} != {scan_route}'}")
+
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
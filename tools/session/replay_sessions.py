@@ -0,0 +1,281 @@
+#!/usr/bin/env python3
+"""Replay labeled edge traces through the door session classifier.
+
+Builds main/door_debounce.c and main/session_classifier.c for the host and
+feeds them raw edges the way door_task does, with the settings in
+main/session_config.h and main/door_config.h. Reports how many sessions were
+classified as labeled, and how many publishes the session events save over
+publishing every transition (reminders are the same either way and not
+counted).
+
+Traces are the CSV of main/door_trace.h, "timestamp_us,level[,sensor]" rows,
+plus two kinds of comment lines:
+    # clock: HH:MM        local time at timestamp 0; without it the clock is
+                          unset and time of day does not vote
+    # label: <class>      delivery, retrieval or bounce, for the session that
+                          starts with the next edge
+"""
+
+import argparse
+import ctypes
+import glob
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+MAIN = os.path.join(os.path.dirname(os.path.dirname(HERE)), "main")
+
+DAY_MS = 24 * 60 * 60 * 1000
+NO_DEADLINE = 2**63 - 1
+CLASSES = ["delivery", "retrieval", "bounce"]
+
+
+class DebounceProfile(ctypes.Structure):
+    _fields_ = [("mode", ctypes.c_int), ("settle_ms", ctypes.c_uint32)]
+
+
+class DebounceState(ctypes.Structure):
+    _fields_ = [("profile", DebounceProfile), ("stable_level", ctypes.c_int), ("raw_level", ctypes.c_int),
+                ("last_edge_us", ctypes.c_int64), ("deadline_us", ctypes.c_int64),
+                ("suppress_until_us", ctypes.c_int64)]
+
+
+class SessionProfile(ctypes.Structure):
+    _fields_ = [("gap_ms", ctypes.c_uint32), ("max_open_ms", ctypes.c_uint32),
+                ("bounce_max_open_ms", ctypes.c_uint32), ("delivery_max_open_ms", ctypes.c_uint32),
+                ("carrier_start_ms", ctypes.c_uint32), ("carrier_end_ms", ctypes.c_uint32),
+                ("weight_duration", ctypes.c_int32), ("weight_time_of_day", ctypes.c_int32),
+                ("weight_mail_waiting", ctypes.c_int32)]
+
+
+class SessionSummary(ctypes.Structure):
+    _fields_ = [("session_class", ctypes.c_int), ("opens", ctypes.c_uint32), ("open_ms", ctypes.c_uint32),
+                ("longest_open_ms", ctypes.c_uint32), ("span_ms", ctypes.c_uint32), ("start_us", ctypes.c_int64),
+                ("since_last_ms", ctypes.c_int64)]
+
+
+class SessionState(ctypes.Structure):
+    _fields_ = [("profile", SessionProfile), ("active", ctypes.c_bool), ("open", ctypes.c_bool),
+                ("mail_waiting", ctypes.c_bool), ("opens", ctypes.c_uint32), ("open_ms", ctypes.c_uint32),
+                ("longest_open_ms", ctypes.c_uint32), ("start_us", ctypes.c_int64), ("opened_us", ctypes.c_int64),
+                ("closed_us", ctypes.c_int64), ("start_time_of_day_ms", ctypes.c_int64),
+                ("last_end_us", ctypes.c_int64)]
+
+
+def read_defines(path):
+    defines = {}
+    with open(path) as f:
+        for line in f:
+            match = re.match(r"#define\s+(\w+)\s+(.+?)\s*(//.*)?$", line)
+            if match:
+                defines[match.group(1)] = match.group(2)
+    return defines
+
+
+def evaluate(expr):
+    return eval(expr, {"__builtins__": {}})
+
+
+def build_lib(workdir):
+    lib = os.path.join(workdir, "session.so")
+    subprocess.run([os.environ.get("CC", "cc"), "-shared", "-fPIC", "-O2", "-I", MAIN,
+                    os.path.join(MAIN, "door_debounce.c"), os.path.join(MAIN, "session_classifier.c"), "-o", lib],
+                   check=True)
+    session_lib = ctypes.CDLL(lib)
+    int_out, us_out = ctypes.POINTER(ctypes.c_int), ctypes.POINTER(ctypes.c_int64)
+    session_lib.debounce_init.argtypes = [ctypes.POINTER(DebounceState), ctypes.POINTER(DebounceProfile),
+                                          ctypes.c_int, ctypes.c_int64]
+    session_lib.debounce_feed.restype = ctypes.c_bool
+    session_lib.debounce_feed.argtypes = [ctypes.POINTER(DebounceState), ctypes.c_int, ctypes.c_int64, int_out, us_out]
+    session_lib.debounce_poll.restype = ctypes.c_bool
+    session_lib.debounce_poll.argtypes = [ctypes.POINTER(DebounceState), ctypes.c_int64, int_out, us_out]
+    session_lib.session_init.argtypes = [ctypes.POINTER(SessionState), ctypes.POINTER(SessionProfile)]
+    session_lib.session_feed.argtypes = [ctypes.POINTER(SessionState), ctypes.c_bool, ctypes.c_int64, ctypes.c_int64]
+    session_lib.session_poll.restype = ctypes.c_bool
+    session_lib.session_poll.argtypes = [ctypes.POINTER(SessionState), ctypes.c_int64, ctypes.POINTER(SessionSummary)]
+    session_lib.session_next_deadline_us.restype = ctypes.c_int64
+    session_lib.session_next_deadline_us.argtypes = [ctypes.POINTER(SessionState)]
+    return session_lib
+
+
+def parse_trace(path):
+    """Returns (clock_ms or None, edges [(t, level, sensor)], labels [(t, sensor, label)])"""
+    clock_ms, edges, labels, pending = None, [], [], []
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            match = re.match(r"#\s*clock:\s*(\d+):(\d+)", line)
+            if match:
+                clock_ms = (int(match.group(1)) * 60 + int(match.group(2))) * 60000
+                continue
+            match = re.match(r"#\s*label:\s*(\w+)", line)
+            if match:
+                if match.group(1) not in CLASSES:
+                    raise ValueError(f"{path}: unknown label {match.group(1)}")
+                pending.append(match.group(1))
+                continue
+            fields = line.split(",")
+            if not line or line.startswith("#") or not fields[0].strip().lstrip("-").isdigit():
+                continue
+            t, level = int(fields[0]), int(fields[1])
+            sensor = int(fields[2]) if len(fields) > 2 and fields[2].strip() else 0
+            labels += [(t, sensor, label) for label in pending]
+            pending = []
+            edges.append((t, level, sensor))
+    return clock_ms, sorted(edges), labels
+
+
+class Pipeline:
+    """One sensor from debounce to session events, stepped like door_task"""
+
+    def __init__(self, lib, debounce_profile, session_profile, open_level, clock_ms, start_us):
+        self.lib, self.open_level, self.clock_ms = lib, open_level, clock_ms
+        self.debounce, self.session = DebounceState(), SessionState()
+        lib.debounce_init(ctypes.byref(self.debounce), ctypes.byref(debounce_profile), 1 - open_level, start_us)
+        lib.session_init(ctypes.byref(self.session), ctypes.byref(session_profile))
+        self.transitions, self.sessions = 0, []
+
+    def time_of_day_ms(self, t_us):
+        return -1 if self.clock_ms is None else (self.clock_ms + t_us // 1000) % DAY_MS
+
+    def transition(self, level, edge_us):
+        self.transitions += 1
+        self.poll_session(edge_us)
+        self.lib.session_feed(ctypes.byref(self.session), level == self.open_level, edge_us,
+                              self.time_of_day_ms(edge_us))
+
+    def poll_session(self, now_us):
+        summary = SessionSummary()
+        if self.lib.session_poll(ctypes.byref(self.session), now_us, ctypes.byref(summary)):
+            self.sessions.append((summary.start_us, CLASSES[summary.session_class], summary.opens,
+                                  summary.longest_open_ms))
+
+    def advance(self, until_us):
+        level, edge_us = ctypes.c_int(), ctypes.c_int64()
+        while True:
+            debounce_at = self.debounce.deadline_us
+            session_at = self.lib.session_next_deadline_us(ctypes.byref(self.session))
+            now_us = min(debounce_at, session_at)
+            if now_us == NO_DEADLINE or now_us > until_us:
+                return
+            if debounce_at <= session_at:
+                if self.lib.debounce_poll(ctypes.byref(self.debounce), now_us, ctypes.byref(level),
+                                          ctypes.byref(edge_us)):
+                    self.transition(level.value, edge_us.value)
+            else:
+                self.poll_session(now_us)
+
+    def edge(self, t_us, raw_level):
+        level, edge_us = ctypes.c_int(), ctypes.c_int64()
+        self.advance(t_us)
+        if self.lib.debounce_feed(ctypes.byref(self.debounce), raw_level, t_us, ctypes.byref(level),
+                                  ctypes.byref(edge_us)):
+            self.transition(level.value, edge_us.value)
+
+
+def score(sessions, labels):
+    """Pairs each session with the label of the edge that started it. Returns
+    (confusion {(label, predicted): n}, sessions nobody labeled, labels with no session)"""
+    confusion, unlabeled = {}, 0
+    labels = sorted(labels)
+    used = 0
+    for start_us, predicted, _, _ in sorted(sessions):
+        matched = None
+        while used < len(labels) and labels[used][0] <= start_us:
+            matched = labels[used]
+            used += 1
+        if matched is None:
+            unlabeled += 1
+            continue
+        confusion[(matched[2], predicted)] = confusion.get((matched[2], predicted), 0) + 1
+    missed = len(labels) - sum(confusion.values())
+    return confusion, unlabeled, missed
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("traces", nargs="*", help="labeled traces, default tools/session/*.csv")
+    parser.add_argument("--set", action="append", default=[], metavar="NAME=VALUE",
+                        help="override a session_config.h define, e.g. SESSION_GAP_MS=60000")
+    parser.add_argument("--open-level", type=int, default=1, help="trace level of an open door")
+    parser.add_argument("-v", "--verbose", action="store_true", help="list every session")
+    args = parser.parse_args()
+
+    config = read_defines(os.path.join(MAIN, "session_config.h"))
+    door = read_defines(os.path.join(MAIN, "door_config.h"))
+    for override in args.set:
+        name, _, value = override.partition("=")
+        if name not in config:
+            parser.error(f"{name} is not in session_config.h")
+        config[name] = value
+
+    debounce_profile = DebounceProfile(0, evaluate(door["DEBOUNCE_TIME_MS"]))  # DOOR_DEBOUNCE_PROFILE, integrating
+    session_profile = SessionProfile(*(evaluate(config[name]) for name in (
+        "SESSION_GAP_MS", "SESSION_MAX_OPEN_MS", "SESSION_BOUNCE_MAX_OPEN_MS", "SESSION_DELIVERY_MAX_OPEN_MS")),
+        evaluate(config["SESSION_CARRIER_START_MIN"]) * 60000, evaluate(config["SESSION_CARRIER_END_MIN"]) * 60000,
+        *(evaluate(config[name]) for name in (
+            "SESSION_WEIGHT_DURATION", "SESSION_WEIGHT_TIME_OF_DAY", "SESSION_WEIGHT_MAIL_WAITING")))
+
+    traces = args.traces or sorted(glob.glob(os.path.join(HERE, "*.csv")))
+    if not traces:
+        parser.error("no traces given and none in tools/session")
+
+    with tempfile.TemporaryDirectory() as workdir:
+        try:
+            lib = build_lib(workdir)
+        except (OSError, subprocess.CalledProcessError) as e:
+            print(f"Could not build the classifier: {e}", file=sys.stderr)
+            return 1
+
+        total_confusion, total_transitions, total_sessions, total_unlabeled, total_missed = {}, 0, 0, 0, 0
+        for path in traces:
+            clock_ms, edges, labels = parse_trace(path)
+            if not edges:
+                print(f"{path}: no edges", file=sys.stderr)
+                continue
+            pipelines = {}
+            for t, level, sensor in edges:
+                if sensor not in pipelines:
+                    pipelines[sensor] = Pipeline(lib, debounce_profile, session_profile, args.open_level, clock_ms,
+                                                 edges[0][0])
+                pipelines[sensor].edge(t, level)
+
+            transitions = sessions = 0
+            for sensor, pipeline in sorted(pipelines.items()):
+                pipeline.advance(NO_DEADLINE - 1)
+                confusion, unlabeled, missed = score(pipeline.sessions,
+                                                     [label for label in labels if label[1] == sensor])
+                for key, n in confusion.items():
+                    total_confusion[key] = total_confusion.get(key, 0) + n
+                total_unlabeled += unlabeled
+                total_missed += missed
+                transitions += pipeline.transitions
+                sessions += len(pipeline.sessions)
+                if args.verbose:
+                    for start_us, predicted, opens, longest_ms in pipeline.sessions:
+                        print(f"  sensor {sensor} at {start_us / 1e6:>12.1f} s: {predicted:<10} {opens} opening(s), "
+                              f"longest {longest_ms} ms")
+            print(f"{os.path.basename(path)}: {len(edges)} edges, {transitions} transitions, {sessions} sessions")
+            total_transitions += transitions
+            total_sessions += sessions
+
+    correct = sum(n for (label, predicted), n in total_confusion.items() if label == predicted)
+    scored = sum(total_confusion.values())
+    print(f"\n{'labeled':<12}" + "".join(f"{c:>11}" for c in CLASSES) + f"{'recall':>9}")
+    for label in CLASSES:
+        row = [total_confusion.get((label, predicted), 0) for predicted in CLASSES]
+        recall = f"{row[CLASSES.index(label)] / sum(row):.0%}" if sum(row) else "-"
+        print(f"{label:<12}" + "".join(f"{n:>11}" for n in row) + f"{recall:>9}")
+    print(f"\nAccuracy {correct}/{scored}" + (f" ({correct / scored:.1%})" if scored else "") +
+          f", {total_unlabeled} unlabeled session(s), {total_missed} labeled session(s) not found")
+    if total_transitions:
+        print(f"Publishes: {total_transitions} transitions -> {total_sessions} session events, "
+              f"{1 - total_sessions / total_transitions:.0%} fewer")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
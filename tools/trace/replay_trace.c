@@ -0,0 +1,240 @@
+// Driver for replay_trace.py: replays a recorded edge trace through the
+// firmware's door_debounce.c on a virtual clock, the way door_task feeds it,
+// and prints every committed transition followed by throughput and
+// edge-to-commit latency.
+//
+//     replay_trace <trace.csv> <mode> <settle_ms> <open_level> <initial_level> <repeat>
+//
+// Output, one line each:
+//     transition <sensor> <open|closed> <edge_us> <commit_us>
+//     edges <n> transitions <n> ns_per_edge <ns> span_us <us>
+//     latency_us <p50> <p90> <p99> <max>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "door_debounce.h"
+
+#define TRACE_MAX_SENSORS 8
+#define TRACE_LINE_MAX 256
+
+typedef struct
+{
+    int64_t timestamp_us;
+    int level;
+    int sensor;
+} trace_edge_t;
+
+typedef struct
+{
+    int sensor;
+    int level;
+    int64_t edge_us;
+    int64_t commit_us;
+} trace_commit_t;
+
+typedef struct
+{
+    trace_commit_t *items;
+    size_t count;
+    size_t capacity;
+} trace_commits_t;
+
+static trace_edge_t *edges = NULL;
+static size_t edge_count = 0;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int load_trace(const char *path)
+{
+    char line[TRACE_LINE_MAX];
+    size_t capacity = 0;
+    FILE *f = fopen(path, "r");
+
+    if (f == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        char *end;
+        trace_edge_t edge = {0};
+
+        if (!((line[0] >= '0' && line[0] <= '9') || line[0] == '-'))
+        {
+            continue; // Comments, the expect line and a header row
+        }
+        edge.timestamp_us = strtoll(line, &end, 10);
+        if (*end != ',')
+        {
+            continue;
+        }
+        edge.level = (int)strtol(end + 1, &end, 10);
+        edge.sensor = (*end == ',') ? (int)strtol(end + 1, &end, 10) : 0;
+        if (edge.sensor < 0 || edge.sensor >= TRACE_MAX_SENSORS)
+        {
+            fprintf(stderr, "%s: sensor %d out of range\n", path, edge.sensor);
+            fclose(f);
+            return -1;
+        }
+
+        if (edge_count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64;
+            edges = realloc(edges, capacity * sizeof(*edges));
+            if (edges == NULL)
+            {
+                fclose(f);
+                return -1;
+            }
+        }
+        edges[edge_count++] = edge;
+    }
+
+    fclose(f);
+    return 0;
+}
+
+static void record(trace_commits_t *commits, int sensor, int level, int64_t edge_us, int64_t commit_us)
+{
+    if (commits == NULL)
+    {
+        return;
+    }
+    if (commits->count == commits->capacity)
+    {
+        commits->capacity = commits->capacity ? commits->capacity * 2 : 64;
+        commits->items = realloc(commits->items, commits->capacity * sizeof(*commits->items));
+    }
+    commits->items[commits->count++] = (trace_commit_t){sensor, level, edge_us, commit_us};
+}
+
+// Polls every sensor whose deadline passed by until_us, earliest first, as
+// door_task's queue timeout would
+static size_t poll_until(debounce_state_t *db, int64_t until_us, trace_commits_t *commits)
+{
+    size_t transitions = 0;
+
+    while (1)
+    {
+        int next = -1;
+        for (int s = 0; s < TRACE_MAX_SENSORS; s++)
+        {
+            int64_t deadline_us = debounce_next_deadline_us(&db[s]);
+            if (deadline_us != DEBOUNCE_NO_DEADLINE && deadline_us <= until_us &&
+                (next < 0 || deadline_us < debounce_next_deadline_us(&db[next])))
+            {
+                next = s;
+            }
+        }
+        if (next < 0)
+        {
+            return transitions;
+        }
+
+        int64_t now_us = debounce_next_deadline_us(&db[next]);
+        int level;
+        int64_t edge_us;
+        if (debounce_poll(&db[next], now_us, &level, &edge_us))
+        {
+            record(commits, next, level, edge_us, now_us);
+            transitions++;
+        }
+    }
+}
+
+static size_t replay(const debounce_profile_t *profile, int initial_level, trace_commits_t *commits)
+{
+    debounce_state_t db[TRACE_MAX_SENSORS];
+    int64_t start_us = edge_count ? edges[0].timestamp_us - 1 : 0;
+    size_t transitions = 0;
+
+    for (int s = 0; s < TRACE_MAX_SENSORS; s++)
+    {
+        debounce_init(&db[s], profile, initial_level, start_us);
+    }
+
+    for (size_t i = 0; i < edge_count; i++)
+    {
+        int level;
+        int64_t edge_us;
+
+        transitions += poll_until(db, edges[i].timestamp_us, commits);
+        if (debounce_feed(&db[edges[i].sensor], edges[i].level, edges[i].timestamp_us, &level, &edge_us))
+        {
+            record(commits, edges[i].sensor, level, edge_us, edges[i].timestamp_us);
+            transitions++;
+        }
+    }
+    return transitions + poll_until(db, INT64_MAX - 1, commits);
+}
+
+static int compare_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 7)
+    {
+        fprintf(stderr, "usage: %s <trace.csv> <mode> <settle_ms> <open_level> <initial_level> <repeat>\n", argv[0]);
+        return 2;
+    }
+
+    const debounce_profile_t profile = {.mode = (debounce_mode_t)atoi(argv[2]),
+                                        .settle_ms = (uint32_t)strtoul(argv[3], NULL, 10)};
+    int open_level = atoi(argv[4]);
+    int initial_level = atoi(argv[5]);
+    long repeat = strtol(argv[6], NULL, 10);
+    trace_commits_t commits = {0};
+    size_t transitions = 0;
+
+    if (load_trace(argv[1]) != 0)
+    {
+        return 2;
+    }
+
+    replay(&profile, initial_level, &commits);
+
+    double start_ns = now_ns();
+    for (long r = 0; r < repeat; r++)
+    {
+        transitions += replay(&profile, initial_level, NULL);
+    }
+    double elapsed_ns = now_ns() - start_ns;
+
+    int64_t *latencies = malloc((commits.count + 1) * sizeof(*latencies));
+    for (size_t i = 0; i < commits.count; i++)
+    {
+        const trace_commit_t *c = &commits.items[i];
+        printf("transition %d %s %lld %lld\n", c->sensor, c->level == open_level ? "open" : "closed",
+               (long long)c->edge_us, (long long)c->commit_us);
+        latencies[i] = c->commit_us - c->edge_us;
+    }
+    qsort(latencies, commits.count, sizeof(*latencies), compare_i64);
+
+    printf("edges %zu transitions %zu ns_per_edge %.1f span_us %lld\n", edge_count, transitions / (repeat ? repeat : 1),
+           (repeat && edge_count) ? elapsed_ns / ((double)repeat * edge_count) : 0.0,
+           edge_count ? (long long)(edges[edge_count - 1].timestamp_us - edges[0].timestamp_us) : 0LL);
+    if (commits.count > 0)
+    {
+        printf("latency_us %lld %lld %lld %lld\n", (long long)latencies[commits.count * 50 / 100],
+               (long long)latencies[commits.count * 90 / 100], (long long)latencies[commits.count * 99 / 100],
+               (long long)latencies[commits.count - 1]);
+    }
+
+    free(latencies);
+    free(commits.items);
+    free(edges);
+    return 0;
+}
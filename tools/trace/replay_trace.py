@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+"""Replay recorded edge traces through main/door_debounce.c on the host.
+
+Builds replay_trace.c with the firmware's debouncer and runs each trace on a
+virtual clock, feeding edges and polling deadlines the way door_task does.
+The transitions are compared with the trace's "# expect:" line, the same
+check the device makes for an idf.py -DDOOR_TRACE_FILE build, and the run is
+repeated to report throughput and edge-to-commit latency.
+
+Each trace is then replayed through the firmware path as well: door_handler.c
+and the outbox built against tools/host/include, with door_task and the
+outbox task on the host scheduler and virtual clock. Every edge raises the
+GPIO ISR at its timestamp, and what reaches esp_mqtt_client_publish() has to
+carry the expected states too. Its rate, in edges per second from ISR to
+publish, includes driving the library from Python.
+
+Traces are the CSV of main/door_trace.h, "timestamp_us,level[,sensor]" rows.
+Replay starts with every sensor closed, and the debounce profile and open
+level come from main/door_config.h unless overridden.
+
+    tools/trace/replay_trace.py                           (every tools/trace/*.csv)
+    tools/trace/replay_trace.py my_trace.csv --mode leading-edge --settle-ms 50
+"""
+
+import argparse
+import glob
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+TOOLS = os.path.dirname(HERE)
+MAIN = os.path.join(os.path.dirname(TOOLS), "main")
+sys.path.insert(0, os.path.join(TOOLS, "host"))
+sys.path.insert(0, os.path.join(TOOLS, "payload"))
+from debounce import DebounceProfile  # noqa: E402
+from decode_door_payload import decode  # noqa: E402
+from door_handler import HOST_SOURCES, SOURCES, DoorHandler, SensorConfig, bind  # noqa: E402
+from host_c import build_library, evaluate, load_copy, read_defines  # noqa: E402
+
+MODES = {"integrating": 0, "leading-edge": 1}
+FIRST_GPIO = 12  # Sensor n of a trace is wired to GPIO FIRST_GPIO + n
+
+
+def build(workdir):
+    binary = os.path.join(workdir, "replay_trace")
+    subprocess.run([os.environ.get("CC", "cc"), "-O2", "-Wall", "-Wextra", "-I", MAIN,
+                    os.path.join(HERE, "replay_trace.c"), os.path.join(MAIN, "door_debounce.c"), "-o", binary],
+                   check=True)
+    return binary
+
+
+def build_firmware(workdir):
+    return build_library(workdir, SOURCES, name="replay_firmware", host_sources=HOST_SOURCES)
+
+
+def config_defaults():
+    """(mode, settle_ms, open_level) of the first sensor in door_config.h"""
+    path = os.path.join(MAIN, "door_config.h")
+    defines = read_defines(path)
+    profile = defines["DOOR_DEBOUNCE_PROFILE"]
+    mode = "leading-edge" if "DEBOUNCE_MODE_LEADING_EDGE" in profile else "integrating"
+    settle = re.search(r"\.settle_ms\s*=\s*(\w+)", profile).group(1)
+    with open(path) as f:
+        code = "".join(line for line in f if not line.lstrip().startswith("//"))
+    open_level = int(re.search(r"\.open_level\s*=\s*(\d)", code).group(1))
+    return mode, evaluate(defines.get(settle, settle)), open_level
+
+
+def read_expectation(path):
+    """States listed on the trace's "# expect:" line, or None without one"""
+    with open(path) as f:
+        for line in f:
+            if line.startswith("# expect:"):
+                return line[len("# expect:"):].split()
+    return None
+
+
+def replay(binary, path, mode, settle_ms, open_level, repeat):
+    out = subprocess.run([binary, path, str(MODES[mode]), str(settle_ms), str(open_level), str(1 - open_level),
+                          str(repeat)], check=True, capture_output=True, text=True).stdout
+    result = {"transitions": [], "latency_us": None}
+    for line in out.splitlines():
+        fields = line.split()
+        if fields[0] == "transition":
+            result["transitions"].append((int(fields[1]), fields[2], int(fields[3]), int(fields[4])))
+        elif fields[0] == "edges":
+            result["edges"] = int(fields[1])
+            result["ns_per_edge"] = float(fields[5])
+            result["span_us"] = int(fields[7])
+        elif fields[0] == "latency_us":
+            result["latency_us"] = [int(v) for v in fields[1:]]
+    return result
+
+
+def read_edges(path):
+    """(timestamp_us, level, sensor) of each row of a trace"""
+    edges = []
+    with open(path) as f:
+        for line in f:
+            if line.strip() and not line.startswith("#"):
+                fields = [int(v) for v in line.split(",")]
+                edges.append((fields[0], fields[1], fields[2] if len(fields) > 2 else 0))
+    return edges
+
+
+def replay_firmware(firmware, path, mode, settle_ms, open_level, name):
+    """Replays a trace through door_handler.c in a fresh copy of the
+    firmware library, from boot with every sensor closed. The result lists
+    the door events published after the boot states, as (sensor, state,
+    mono_ms)."""
+    edges = read_edges(path)
+    count = max(sensor for _, _, sensor in edges) + 1 if edges else 1
+    sensors = [SensorConfig(f"sensor{n}".encode(), FIRST_GPIO + n, f"/sensor{n}".encode() if n else b"",
+                            DebounceProfile(MODES[mode], settle_ms), 0, open_level) for n in range(count)]
+    lib = bind(load_copy(firmware, name))
+    lib.host_set_time_us(0)
+    handler = DoorHandler(lib, sensors, [1 - open_level] * count)
+    booted = len(handler.published())
+    topics = {topic: n for n, (topic, _, _, _) in enumerate(handler.published())}
+
+    started = time.perf_counter()
+    for timestamp_us, level, sensor in edges:
+        lib.host_run_until(timestamp_us)
+        handler.set_level(FIRST_GPIO + sensor, level)
+    handler.run(2 * settle_ms * 1000)
+    elapsed = time.perf_counter() - started
+
+    published = [(topics[topic], event["door"], event["mono_ms"])
+                 for topic, payload, _, _ in handler.published(booted) for event in decode(payload)["events"]]
+    return {"published": published, "edges": len(edges), "overflows": handler.overflows(),
+            "edges_per_s": len(edges) / elapsed if elapsed > 0 else 0}
+
+
+def check(result, expected):
+    """True, False, or None when the trace has no expectation"""
+    if expected is None:
+        return None
+    if "published" in result:
+        return [state for _, state, _ in result["published"]] == expected
+    return [state for _, state, _, _ in result["transitions"]] == expected
+
+
+def main() -> int:
+    mode, settle_ms, open_level = config_defaults()
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("traces", nargs="*", help="edge traces, default tools/trace/*.csv")
+    parser.add_argument("--mode", choices=MODES, default=mode, help=f"debounce mode, default {mode}")
+    parser.add_argument("--settle-ms", type=int, default=settle_ms, help=f"settle time, default {settle_ms}")
+    parser.add_argument("--open-level", type=int, choices=(0, 1), default=open_level,
+                        help=f"level read while open, default {open_level}")
+    parser.add_argument("--repeat", type=int, default=10000, help="replays timed per trace")
+    parser.add_argument("--verbose", action="store_true", help="list every transition")
+    args = parser.parse_args()
+
+    traces = args.traces or sorted(glob.glob(os.path.join(HERE, "*.csv")))
+    failures = 0
+    with tempfile.TemporaryDirectory() as workdir:
+        binary = build(workdir)
+        firmware = build_firmware(workdir)
+        print(f"{args.mode}, settle {args.settle_ms} ms, open level {args.open_level}")
+        for n, path in enumerate(traces):
+            expected = read_expectation(path)
+            result = replay(binary, path, args.mode, args.settle_ms, args.open_level, args.repeat)
+            observed = [state for _, state, _, _ in result["transitions"]]
+            ok = check(result, expected)
+            failures += ok is False
+
+            ns = result["ns_per_edge"]
+            speedup = result["span_us"] * 1000 / (ns * result["edges"]) if ns and result["edges"] else 0
+            print(f"{'PASS' if ok else 'FAIL' if ok is False else 'NONE'} {os.path.basename(path)}: "
+                  f"{result['edges']} edges, {len(observed)} transitions, {ns:.1f} ns/edge "
+                  f"({1e9 / ns if ns else 0:,.0f} edges/s, {speedup:,.0f}x real time)")
+            if result["latency_us"]:
+                p50, p90, p99, worst = (v / 1000 for v in result["latency_us"])
+                print(f"     latency ms p50 {p50:.1f} p90 {p90:.1f} p99 {p99:.1f} max {worst:.1f}")
+            if ok is False:
+                print(f"     expected {' '.join(expected)}, got {' '.join(observed)}")
+            if args.verbose:
+                for sensor, state, edge_us, commit_us in result["transitions"]:
+                    print(f"     sensor {sensor} {state:<6} edge {edge_us} us, committed {commit_us} us")
+
+            firmware_result = replay_firmware(firmware, path, args.mode, args.settle_ms, args.open_level,
+                                              f"replay_firmware_{n}")
+            published = [state for _, state, _ in firmware_result["published"]]
+            ok = check(firmware_result, expected)
+            failures += ok is False
+            print(f"     firmware {'PASS' if ok else 'FAIL' if ok is False else 'NONE'}: "
+                  f"{len(published)} published, {firmware_result['overflows']} edges lost, "
+                  f"{firmware_result['edges_per_s']:,.0f} edges/s ISR to publish")
+            if ok is False:
+                print(f"     expected {' '.join(expected)}, published {' '.join(published)}")
+            if args.verbose:
+                for sensor, state, mono_ms in firmware_result["published"]:
+                    print(f"     sensor {sensor} {state:<6} published with edge at {mono_ms} ms")
+
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())